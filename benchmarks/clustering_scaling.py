@@ -0,0 +1,125 @@
+"""Strong-scaling benchmark of the OpenMP pair counters.
+
+Times the ``*_omp`` counters of :mod:`scampy.measure.clustering_core` on
+a uniform random catalogue for an increasing number of threads and
+prints wall-clock time, speedup and parallel efficiency with respect to
+the single-thread run.  Every thread count runs in a fresh interpreter,
+since OpenMP reads ``OMP_NUM_THREADS`` only once per process.
+
+Usage::
+
+    python benchmarks/clustering_scaling.py [--size N] [--max-threads T]
+
+Recorded results
+----------------
+No speedup is claimed here: only a single-core machine (Intel Xeon,
+AVX-512) has been available so far, so the parallel efficiency of the
+counters beyond one thread is unmeasured. Run this script on a
+multi-core node to obtain it. The times below are single-thread
+baselines at the default ``--size 100000``, best of 3. They come from a
+C++ driver that calls the same counters on the same catalogues and
+bins, because the extension could not be built there.
+
+=================  ==========
+counter            1 thread
+=================  ==========
+d2D_DD_omp         15.96 s
+d2D_DR_omp         31.46 s
+d3D_DD_omp          2.21 s
+d3D_DR_omp          4.67 s
+d3D_DD_grid_omp     0.74 s
+d3D_DR_grid_omp     1.46 s
+d3D_DD_tree_omp     0.58 s
+d3D_DR_tree_omp     1.13 s
+=================  ==========
+"""
+
+##################################################################################
+# External imports
+import argparse
+import os
+import subprocess
+import sys
+import time
+
+import numpy
+
+##################################################################################
+
+COUNTERS = ( 'd2D_DD_omp', 'd2D_DR_omp',
+             'd3D_DD_omp', 'd3D_DR_omp',
+             'd3D_DD_grid_omp', 'd3D_DR_grid_omp',
+             'd3D_DD_tree_omp', 'd3D_DR_tree_omp' )
+
+def _catalogue ( size, ndim, seed ) :
+    """Uniform random catalogue in a box of side 1000, as C-contiguous
+    float32 rows that the counters read without conversion."""
+
+    rng = numpy.random.default_rng( seed )
+    return numpy.ascontiguousarray( rng.uniform( 0., 1000., ( ndim, size ) ), dtype = numpy.float32 )
+
+def _run ( name, size, repeat ) :
+    """Best-of-``repeat`` wall-clock time of one counter in this process."""
+
+    import scampy.measure.clustering_core as cc
+
+    ndim = 2 if name.startswith( 'd2D' ) else 3
+    data = _catalogue( size, ndim, 1 )
+    rbins = list( numpy.logspace( 0., 2., 21 ) )
+    args = [ *data, *( _catalogue( size, ndim, 2 ) if '_DR' in name else () ) ]
+
+    best = numpy.inf
+    for _ in range( repeat ) :
+        tic = time.perf_counter()
+        getattr( cc, name )( *args, rbins )
+        best = min( best, time.perf_counter() - tic )
+    return best
+
+def _time ( name, size, repeat, nthreads ) :
+    """Times one counter in a child process with ``nthreads`` OpenMP threads."""
+
+    env = dict( os.environ, OMP_NUM_THREADS = str( nthreads ), OMP_PROC_BIND = 'close' )
+    out = subprocess.run( [ sys.executable, __file__, '--child', name,
+                            '--size', str( size ), '--repeat', str( repeat ) ],
+                          env = env, check = True, capture_output = True, text = True )
+    return float( out.stdout )
+
+##################################################################################
+
+def main () :
+
+    parser = argparse.ArgumentParser( description = __doc__.split( '\n' )[ 0 ] )
+    parser.add_argument( '--size', type = int, default = 100000,
+                         help = 'number of objects per catalogue' )
+    parser.add_argument( '--max-threads', type = int, default = os.cpu_count(),
+                         help = 'largest number of threads' )
+    parser.add_argument( '--repeat', type = int, default = 3,
+                         help = 'timings per run, the best is kept' )
+    parser.add_argument( '--counters', nargs = '+', default = COUNTERS,
+                         help = 'counters to benchmark' )
+    parser.add_argument( '--child', help = argparse.SUPPRESS )
+    args = parser.parse_args()
+
+    if args.child :
+        print( _run( args.child, args.size, args.repeat ) )
+        return
+
+    threads = [ 1 ]
+    while 2 * threads[ -1 ] <= args.max_threads :
+        threads.append( 2 * threads[ -1 ] )
+    if threads[ -1 ] != args.max_threads :
+        threads.append( args.max_threads )
+
+    print( f'# N = {args.size}, best of {args.repeat}' )
+    print( f'# {"counter":<18s} {"threads":>7s} {"time [s]":>10s} '
+           f'{"speedup":>8s} {"efficiency":>10s}' )
+    for name in args.counters :
+        t1 = None
+        for nt in threads :
+            tt = _time( name, args.size, args.repeat, nt )
+            t1 = tt if t1 is None else t1
+            print( f'  {name:<18s} {nt:>7d} {tt:>10.4f} '
+                   f'{t1 / tt:>8.2f} {t1 / tt / nt:>10.2f}', flush = True )
+
+if __name__ == '__main__' :
+    main()
@@ -0,0 +1,69 @@
+/**
+ *  @file utilities/include/array_view.h
+ *
+ *  @brief The class array_view
+ *
+ *  This file defines a read-only, non-owning view on a contiguous
+ *  array, used by the pair counters to accept coordinates stored in
+ *  std::vector as well as in external buffers (e.g. NumPy arrays)
+ *  without copying them.
+ */
+
+#ifndef __ARRAY_VIEW__
+#define __ARRAY_VIEW__
+
+// STL includes
+#include <vector>
+#include <cstddef>
+
+namespace utl {
+
+  /**
+   *  @class array_view array_view.h "utilities/include/array_view.h"
+   *
+   *  @brief Read-only view on a contiguous array
+   *
+   *  The view does not own the data: the viewed array has to
+   *  outlive it. Implicitly constructible from a std::vector.
+   */
+  template < typename T >
+  class array_view {
+
+    /// first element
+    const T * ptr = nullptr;
+
+    /// number of elements
+    std::size_t len = 0;
+
+  public :
+
+    /// default constructor, empty view
+    array_view () = default;
+
+    /// view on len elements starting at ptr
+    array_view ( const T * ptr, const std::size_t len ) noexcept : ptr { ptr }, len { len } {}
+
+    /// view on the elements of a vector
+    array_view ( const std::vector< T > & vv ) noexcept : ptr { vv.data() }, len { vv.size() } {}
+
+    const T * data () const noexcept { return ptr; }
+
+    std::size_t size () const noexcept { return len; }
+
+    bool empty () const noexcept { return len == 0; }
+
+    const T & operator[] ( const std::size_t ii ) const noexcept { return ptr[ ii ]; }
+
+    const T & front () const noexcept { return ptr[ 0 ]; }
+
+    const T & back () const noexcept { return ptr[ len - 1 ]; }
+
+    const T * begin () const noexcept { return ptr; }
+
+    const T * end () const noexcept { return ptr + len; }
+
+  }; // endclass array_view
+
+} // endnamespace utl
+
+#endif //__ARRAY_VIEW__
@@ -0,0 +1,240 @@
+/**
+ *  @file utilities/include/binning.h
+ *
+ *  @brief Binning policies for the pair counters
+ *
+ *  A binning policy maps squared separations to bins. All policies
+ *  share the same table of squared bin edges: bin b contains the
+ *  squared separations d2 with edges2[ b ] <= d2 < edges2[ b + 1 ],
+ *  the last bin also contains d2 == edges2.back(). Policies only
+ *  differ in how the bin is located: log and lin compute it with one
+ *  arithmetic operation and then check it against the table, edges
+ *  runs a binary search on the table. Every counter returns the same
+ *  histogram whichever engine it is based on.
+ */
+
+#ifndef __BINNING__
+#define __BINNING__
+
+// STL includes
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+
+namespace utl::binning {
+
+  /// binning schemes selectable at runtime
+  enum class scheme {
+    log,   ///< rbin.size() logarithmic bins between rbin.front() and rbin.back()
+    lin,   ///< rbin.size() linear bins between rbin.front() and rbin.back()
+    edges  ///< rbin.size() - 1 bins with edges rbin (sorted in ascending order)
+  };
+
+  /**
+   *  @class edge_table binning.h "utilities/include/binning.h"
+   *
+   *  @brief Table of squared bin edges, common base of the policies
+   */
+  class edge_table {
+
+  protected :
+
+    /// squared bin edges
+    std::vector< float > e2;
+
+    /// number of bins
+    long nbin = 0;
+
+    /// moves guess ib to the bin containing d2, with rmin2 <= d2 <= rmax2
+    long refine ( long ib, const float d2 ) const noexcept {
+
+      ib = std::min( std::max( ib, 0l ), nbin - 1 );
+      while ( ib > 0 && d2 < e2[ ib ] ) --ib;
+      while ( ib + 1 < nbin && d2 >= e2[ ib + 1 ] ) ++ib;
+      return ib;
+
+    }
+
+    edge_table () = default;
+
+    explicit edge_table ( std::vector< float > && edges2 ) :
+      e2 { std::move( edges2 ) }, nbin { long( e2.size() ) - 1 } {}
+
+  public :
+
+    /// number of bins
+    std::size_t size () const noexcept { return nbin; }
+
+    /// squared bin edges (size() + 1 values)
+    const std::vector< float > & edges2 () const noexcept { return e2; }
+
+    /// lowest squared separation binned
+    float rmin2 () const noexcept { return e2.front(); }
+
+    /// highest squared separation binned
+    float rmax2 () const noexcept { return e2.back(); }
+
+    /// bin of squared separation d2 by binary search, -1 outside the histogram
+    long lookup ( const float d2 ) const noexcept {
+
+      if ( !( e2.front() <= d2 && d2 <= e2.back() ) ) return -1;
+      return refine( std::upper_bound( e2.begin(), e2.end(), d2 ) - e2.begin() - 1, d2 );
+
+    }
+
+  }; // endclass edge_table
+
+  /**
+   *  @brief Checks separation bins against a binning scheme
+   *
+   *  Every scheme needs at least two values. Log bins also need
+   *  0 < rbin.front() < rbin.back(), lin bins rbin.front() < rbin.back();
+   *  the order of the edges is checked by edge_bins itself.
+   *
+   *  @param sc the scheme
+   *
+   *  @param rbin separation bins, interpreted according to sc
+   *
+   *  @throws std::invalid_argument if rbin does not describe valid bins
+   */
+  inline void check ( const scheme sc, const std::vector< float > & rbin ) {
+
+    if ( rbin.size() < 2 )
+      throw std::invalid_argument( "binning needs at least two separations" );
+    if ( sc == scheme::edges ) return;
+    if ( sc == scheme::log && !( rbin.front() > 0.f ) )
+      throw std::invalid_argument( "log binning needs a positive lowest separation" );
+    if ( !( rbin.front() < rbin.back() ) )
+      throw std::invalid_argument( "the lowest separation should be smaller than the highest" );
+
+  }
+
+  /// logarithmic bins, the bin is guessed from the logarithm of d2
+  class log_bins : public edge_table {
+
+    float inv_delta;
+
+  public :
+
+    /// throws std::invalid_argument unless check( scheme::log, rbin ) passes
+    explicit log_bins ( const std::vector< float > & rbin ) {
+
+      check( scheme::log, rbin );
+      const std::size_t nn = rbin.size();
+      const double rmin = rbin.front(), rmax = rbin.back();
+      const double delta = std::log10( rmax / rmin ) / nn;
+      e2.resize( nn + 1 );
+      for ( std::size_t kk = 0; kk <= nn; ++kk ) {
+	double ee = kk == nn ? rmax : rmin * std::pow( 10., kk * delta );
+	e2[ kk ] = ee * ee;
+      }
+      nbin = nn;
+      inv_delta = 0.5 * nn / std::log( rmax / rmin );
+
+    }
+
+    /// bin of squared separation d2, -1 outside the histogram
+    long bin ( const float d2 ) const noexcept {
+
+      if ( !( e2.front() <= d2 && d2 <= e2.back() ) ) return -1;
+      return refine( long( std::log( d2 / e2.front() ) * inv_delta ), d2 );
+
+    }
+
+  }; // endclass log_bins
+
+  /// linear bins, the bin is guessed from the square root of d2
+  class lin_bins : public edge_table {
+
+    float rmin, inv_delta;
+
+  public :
+
+    /// throws std::invalid_argument unless check( scheme::lin, rbin ) passes
+    explicit lin_bins ( const std::vector< float > & rbin ) {
+
+      check( scheme::lin, rbin );
+      const std::size_t nn = rbin.size();
+      const double rmax = rbin.back(), delta = ( rmax - rbin.front() ) / nn;
+      rmin = rbin.front();
+      e2.resize( nn + 1 );
+      for ( std::size_t kk = 0; kk <= nn; ++kk ) {
+	double ee = kk == nn ? rmax : rmin + kk * delta;
+	e2[ kk ] = ee * ee;
+      }
+      nbin = nn;
+      inv_delta = 1. / delta;
+
+    }
+
+    /// bin of squared separation d2, -1 outside the histogram
+    long bin ( const float d2 ) const noexcept {
+
+      if ( !( e2.front() <= d2 && d2 <= e2.back() ) ) return -1;
+      return refine( long( ( std::sqrt( d2 ) - rmin ) * inv_delta ), d2 );
+
+    }
+
+  }; // endclass lin_bins
+
+  /// arbitrary sorted bin edges, the bin is found by binary search
+  class edge_bins : public edge_table {
+
+  public :
+
+    /// throws std::invalid_argument unless rbin holds at least two
+    /// non-negative edges, strictly increasing also once squared
+    explicit edge_bins ( const std::vector< float > & rbin ) {
+
+      if ( rbin.size() < 2 )
+	throw std::invalid_argument( "edge binning needs at least two bin edges" );
+      if ( !( rbin.front() >= 0.f ) )
+	throw std::invalid_argument( "bin edges should be non-negative" );
+      e2.resize( rbin.size() );
+      for ( std::size_t kk = 0; kk < rbin.size(); ++kk ) {
+	e2[ kk ] = rbin[ kk ] * rbin[ kk ];
+	if ( kk > 0 && !( e2[ kk ] > e2[ kk - 1 ] ) )
+	  throw std::invalid_argument( "bin edges should be strictly increasing" );
+      }
+      nbin = long( e2.size() ) - 1;
+
+    }
+
+    /// bin of squared separation d2, -1 outside the histogram
+    long bin ( const float d2 ) const noexcept { return lookup( d2 ); }
+
+  }; // endclass edge_bins
+
+  /**
+   *  @brief Calls a function with the policy selected by a scheme
+   *
+   *  The function is instantiated once per policy, so that the
+   *  binning is resolved at compile time in the counting loops.
+   *
+   *  @param sc the scheme
+   *
+   *  @param rbin separation bins, interpreted according to sc
+   *
+   *  @param fn generic callable, invoked as fn( policy )
+   *
+   *  @return the value returned by fn
+   */
+  template < typename F >
+  auto visit ( const scheme sc, const std::vector< float > & rbin, F && fn ) {
+
+    switch ( sc ) {
+    case scheme::lin :
+      return fn( lin_bins { rbin } );
+    case scheme::edges :
+      return fn( edge_bins { rbin } );
+    default :
+      return fn( log_bins { rbin } );
+    }
+
+  }
+
+} // endnamespace utl::binning
+
+#endif //__BINNING__
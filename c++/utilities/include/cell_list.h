@@ -0,0 +1,236 @@
+/**
+ *  @file utilities/include/cell_list.h
+ *
+ *  @brief The class cell_list
+ *
+ *  This file defines the interface of the class cell_list, a
+ *  uniform 3D grid (a.k.a. chaining mesh) used to restrict
+ *  pair searches to objects closer than a maximum separation.
+ */
+
+#ifndef __CELL_LIST__
+#define __CELL_LIST__
+
+// STL includes
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstddef>
+
+// Internal includes
+#include <array_view.h>
+
+namespace utl {
+
+  /**
+   *  @class grid_geometry cell_list.h "utilities/include/cell_list.h"
+   *
+   *  @brief Geometry of a uniform 3D grid.
+   *
+   *  Two cell_list objects built on the same grid_geometry share
+   *  cell indexing, which is what allows cross-catalogue (DR) searches.
+   */
+  struct grid_geometry {
+
+    /// lower corner of the grid
+    std::array< float, 3 > lo { 0., 0., 0. };
+
+    /// side of a cell along each direction
+    std::array< float, 3 > side { 1., 1., 1. };
+
+    /// number of cells along each direction
+    std::array< std::size_t, 3 > nc { 1, 1, 1 };
+
+    /// number of cells to visit in each direction around a given cell
+    std::size_t reach = 1;
+
+    /// maximum value of reach
+    static constexpr std::size_t max_reach = 2;
+
+    /// maximum separation searched
+    float rmax = 0.;
+
+    /// side of the periodic box (0 for open boundaries)
+    float box = 0.;
+
+    /// default constructor
+    grid_geometry () = default;
+
+    /**
+     *  @brief Build the geometry enclosing one or two catalogues.
+     *
+     *  The cell side is chosen automatically: cells are a fraction
+     *  \f$1/{\rm reach}\f$ of rmax, where reach is 2 when the
+     *  expected number of objects within a volume \f$r_{\rm max}^3\f$
+     *  is large enough to make smaller cells pay off, and 1 otherwise.
+     *  The total number of cells is capped to a few times the number
+     *  of objects in order to bound memory.
+     *  When box > 0 the grid tiles exactly the periodic box [0, box)^3
+     *  and neighbour searches wrap around its faces.
+     *
+     *  @param X1, Y1, Z1 coordinates of the first catalogue
+     *
+     *  @param X2, Y2, Z2 coordinates of the second catalogue (may be empty)
+     *
+     *  @param rmax maximum separation of interest
+     *
+     *  @param box side of the periodic box (default = 0, open boundaries)
+     */
+    grid_geometry ( const utl::array_view< float > & X1,
+		    const utl::array_view< float > & Y1,
+		    const utl::array_view< float > & Z1,
+		    const utl::array_view< float > & X2,
+		    const utl::array_view< float > & Y2,
+		    const utl::array_view< float > & Z2,
+		    const float rmax,
+		    const float box = 0. );
+
+    /// total number of cells
+    std::size_t size () const noexcept { return nc[ 0 ] * nc[ 1 ] * nc[ 2 ]; }
+
+    /// linear index of cell ( ix, iy, iz )
+    std::size_t index ( const std::size_t ix,
+			const std::size_t iy,
+			const std::size_t iz ) const noexcept {
+      return ( ix * nc[ 1 ] + iy ) * nc[ 2 ] + iz;
+    }
+
+    /// grid-coordinate of position xx along direction dd
+    std::size_t locate ( const float xx, const std::size_t dd ) const noexcept {
+      float ff = ( xx - lo[ dd ] ) / side[ dd ];
+      if ( ff < 0. ) return 0;
+      std::size_t ii = std::size_t( ff );
+      return ii < nc[ dd ] ? ii : nc[ dd ] - 1;
+    }
+
+    /**
+     *  @brief Neighbours of grid-coordinate ii along direction dd
+     *
+     *  @param ii grid-coordinate
+     *
+     *  @param dd direction
+     *
+     *  @param jj output, grid-coordinates of the neighbours (at most 2 * reach + 1)
+     *
+     *  @param gap output, lower bound on the separation between objects
+     *         in cell ii and objects in each neighbour
+     *
+     *  @return the number of neighbours
+     */
+    std::size_t axis_neighbours ( const std::size_t ii, const std::size_t dd,
+				  std::size_t * jj, float * gap ) const noexcept {
+
+      const long rr = reach, nd = nc[ dd ];
+      std::size_t nn = 0;
+      for ( long oo = -rr; oo <= rr; ++oo ) {
+	long kk = long( ii ) + oo;
+	float gg = std::max( std::labs( oo ) - 1l, 0l ) * side[ dd ];
+	if ( box > 0. ) kk = ( ( kk % nd ) + nd ) % nd;
+	else if ( kk < 0 || kk >= nd ) continue;
+	// on small periodic grids the same cell can be reached twice
+	std::size_t mm = 0;
+	while ( mm < nn && jj[ mm ] != std::size_t( kk ) ) ++mm;
+	if ( mm < nn ) { gap[ mm ] = std::min( gap[ mm ], gg ); continue; }
+	jj[ nn ] = kk;
+	gap[ nn ] = gg;
+	++nn;
+      }
+      return nn;
+
+    }
+
+  }; // endstruct grid_geometry
+
+  /**
+   *  @class cell_list cell_list.h "utilities/include/cell_list.h"
+   *
+   *  @brief The class cell_list
+   *
+   *  Stores a catalogue re-ordered by grid cell, in structure-of-arrays
+   *  layout, so that all the objects belonging to cell c are contiguous
+   *  in the range [ start[ c ], start[ c + 1 ] ).
+   */
+  class cell_list {
+
+  public :
+
+    /// grid geometry
+    grid_geometry geo;
+
+    /// coordinates, ordered by cell
+    std::vector< float > xx, yy, zz;
+
+    /// weights, ordered by cell (empty for unweighted catalogues)
+    std::vector< float > ww;
+
+    /// position of each ordered object in the input catalogue
+    std::vector< std::size_t > idx;
+
+    /// offset of the first object of each cell (size = number of cells + 1)
+    std::vector< std::size_t > start;
+
+    /// default constructor
+    cell_list () = default;
+
+    /**
+     *  @brief Constructor distributing a catalogue on a given grid
+     *
+     *  @param XX, YY, ZZ coordinates of the catalogue
+     *
+     *  @param geometry grid geometry
+     *
+     *  @param WW weights of the catalogue (default = none)
+     *
+     *  @throws std::length_error if YY, ZZ or non-empty WW do not
+     *          have the size of XX
+     */
+    cell_list ( const utl::array_view< float > & XX,
+		const utl::array_view< float > & YY,
+		const utl::array_view< float > & ZZ,
+		const grid_geometry & geometry,
+		const utl::array_view< float > & WW = {} );
+
+    /// number of objects in cell cc
+    std::size_t count ( const std::size_t cc ) const noexcept {
+      return start[ cc + 1 ] - start[ cc ];
+    }
+
+    /**
+     *  @brief Call fn( nn ) for each neighbour nn of cell cc (cc included)
+     *         whose minimum distance from cc is smaller than rmax.
+     *
+     *  @param cc linear index of the cell
+     *
+     *  @param fn callable with signature void( std::size_t )
+     */
+    template < typename Fn >
+    void for_each_neighbour ( const std::size_t cc, Fn && fn ) const {
+
+      constexpr std::size_t nmax = 2 * grid_geometry::max_reach + 1;
+      std::size_t jx[ nmax ], jy[ nmax ], jz[ nmax ];
+      float gx[ nmax ], gy[ nmax ], gz[ nmax ];
+      const std::size_t nx =
+	geo.axis_neighbours( cc / ( geo.nc[ 2 ] * geo.nc[ 1 ] ), 0, jx, gx );
+      const std::size_t ny =
+	geo.axis_neighbours( ( cc / geo.nc[ 2 ] ) % geo.nc[ 1 ], 1, jy, gy );
+      const std::size_t nz =
+	geo.axis_neighbours( cc % geo.nc[ 2 ], 2, jz, gz );
+      const float rmax2 = geo.rmax * geo.rmax;
+
+      for ( std::size_t ox = 0; ox < nx; ++ox )
+	for ( std::size_t oy = 0; oy < ny; ++oy )
+	  for ( std::size_t oz = 0; oz < nz; ++oz ) {
+	    if ( gx[ ox ] * gx[ ox ] + gy[ oy ] * gy[ oy ] + gz[ oz ] * gz[ oz ] > rmax2 )
+	      continue;
+	    fn( geo.index( jx[ ox ], jy[ oy ], jz[ oz ] ) );
+	  } // endfor oz, oy, ox
+
+    }
+
+  }; // endclass cell_list
+
+} // endnamespace utl
+
+#endif //__CELL_LIST__
@@ -6,50 +6,18 @@
 #include <vector>
 #include <cmath>
 #include <string>
+#include <cstdint>
 
-namespace utl {
-  
-  //==================================================================================
-  // Tentative templated implementation, W.I.P.
+// Internal includes
+#include <array_view.h>
+#include <separation.h>
+#include <binning.h>
+#include <cell_list.h>
+#include <kdtree.h>
+#include <fine_histogram.h>
 
-  // inline float dist ( const float d ) { return d; }
-
-  // inline float dist_periodic ( const float d, const float box ) {
-  //   return d < 0.5*box ? d : box-d;
-  // }
-
-  // template < typename fdist, typename ... Args >
-  // std::vector< std::size_t > d2D_DD_generic ( const std::vector< float > & XX,
-  // 					      const std::vector< float > & YY,
-  // 					      const std::vector< float > & rbin,
-  // 					      Args ... args ) {
-    
-  //   std::size_t size = XX.size();
-  
-  //   std::vector< std::size_t > NDD ( rbin.size() );
-  //   float rmin = rbin.front(), rmax = rbin.back();
-  //   float delta = std::log10(rmax/rmin)/rbin.size();
-
-  //   for ( std::size_t ii = 0; ii < size; ++ii ) {
-  //     float dx, dy, rr;
-  //     std::size_t ib;
-  //     for ( std::size_t jj = ii+1; jj < size; ++jj ) {
-  // 	dx = fdist( XX[ii]-XX[jj], args ... );
-  // 	dy = fdist( YY[ii]-YY[jj], args ... );
-  // 	rr = std::sqrt( dx*dx + dy*dy );
-
-  // 	if ( rmin <= rr && rr <= rmax ) {
-  // 	  ib = int( std::log10( rr / rmin ) / delta );
-  // 	  NDD[ ib ] += 1;
-  // 	}
-      
-  //     } // endfor jj
-  //   } // endfor ii
-  
-  //   return NDD;
+namespace utl {
   
-  // }
-
   inline float haversine_th ( const float & RA1, const float Dec1,
 			      const float & RA2, const float Dec2 ); 
   
@@ -57,79 +25,1357 @@ namespace utl {
   //======================================= 2D =======================================
   //==================================================================================
 
-  std::vector< std::size_t > d2D_DD ( const std::vector< float > & XX,
-				      const std::vector< float > & YY,
-				      const std::vector< float > & rbin );
+  // The Cartesian counters (2D, 3D, 3D cell-list and k-d tree) accept an optional side of a
+  // periodic box: when box > 0 coordinates are assumed to lie in [0, box) and
+  // separations follow the minimum-image convention, which requires bins up to
+  // box/2 (rbin.back(), and pimax for the rp-pi counters): larger ones throw
+  // std::invalid_argument. The default box = 0 selects open boundaries.
+  //
+  // All the counters accept a binning scheme (see binning.h): with the default
+  // log and with lin, rbin.size() bins span [rbin.front(), rbin.back()], which
+  // needs at least two values with rbin.front() < rbin.back() (and
+  // rbin.front() > 0 with log); with edges, rbin holds the edges of
+  // rbin.size() - 1 bins, which must be at least two, non-negative and
+  // strictly increasing. Invalid bins throw std::invalid_argument.
+  //
+  // Coordinates are read through utl::array_view: std::vector as well as
+  // external buffers (e.g. NumPy arrays) are accepted without copies.
+  //
+  // The wd* counters are the weighted versions of the d* counters: each
+  // catalogue comes with the per-object weights (WW, W1, W2) and every pair
+  // contributes w_i * w_j, accumulated in double precision. They share the
+  // kernels of the unweighted counters, which keep integer counts. Weights
+  // and coordinates of different sizes throw std::length_error.
 
-  std::vector< std::size_t > d2D_DD_omp ( const std::vector< float > & XX,
-					  const std::vector< float > & YY,
-					  const std::vector< float > & rbin );
+  std::vector< std::size_t > d2D_DD ( const utl::array_view< float > & XX,
+				      const utl::array_view< float > & YY,
+				      const std::vector< float > & rbin,
+				      const float box = 0.,
+				      const utl::binning::scheme binning = utl::binning::scheme::log );
 
-  std::vector< std::size_t > d2D_DR ( const std::vector< float > & X1,
-				      const std::vector< float > & Y1,
-				      const std::vector< float > & X2,
-				      const std::vector< float > & Y2,
-				      const std::vector< float > & rbin );
+  std::vector< std::size_t > d2D_DD_omp ( const utl::array_view< float > & XX,
+					  const utl::array_view< float > & YY,
+					  const std::vector< float > & rbin,
+					  const float box = 0.,
+					  const utl::binning::scheme binning = utl::binning::scheme::log );
 
-  std::vector< std::size_t > d2D_DR_omp ( const std::vector< float > & X1,
-					  const std::vector< float > & Y1,
-					  const std::vector< float > & X2,
-					  const std::vector< float > & Y2,
-					  const std::vector< float > & rbin );
+  std::vector< std::size_t > d2D_DR ( const utl::array_view< float > & X1,
+				      const utl::array_view< float > & Y1,
+				      const utl::array_view< float > & X2,
+				      const utl::array_view< float > & Y2,
+				      const std::vector< float > & rbin,
+				      const float box = 0.,
+				      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d2D_DR_omp ( const utl::array_view< float > & X1,
+					  const utl::array_view< float > & Y1,
+					  const utl::array_view< float > & X2,
+					  const utl::array_view< float > & Y2,
+					  const std::vector< float > & rbin,
+					  const float box = 0.,
+					  const utl::binning::scheme binning = utl::binning::scheme::log );
   
+  std::vector< double > wd2D_DD ( const utl::array_view< float > & XX,
+				  const utl::array_view< float > & YY,
+				  const utl::array_view< float > & WW,
+				  const std::vector< float > & rbin,
+				  const float box = 0.,
+				  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd2D_DD_omp ( const utl::array_view< float > & XX,
+				      const utl::array_view< float > & YY,
+				      const utl::array_view< float > & WW,
+				      const std::vector< float > & rbin,
+				      const float box = 0.,
+				      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd2D_DR ( const utl::array_view< float > & X1,
+				  const utl::array_view< float > & Y1,
+				  const utl::array_view< float > & W1,
+				  const utl::array_view< float > & X2,
+				  const utl::array_view< float > & Y2,
+				  const utl::array_view< float > & W2,
+				  const std::vector< float > & rbin,
+				  const float box = 0.,
+				  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd2D_DR_omp ( const utl::array_view< float > & X1,
+				      const utl::array_view< float > & Y1,
+				      const utl::array_view< float > & W1,
+				      const utl::array_view< float > & X2,
+				      const utl::array_view< float > & Y2,
+				      const utl::array_view< float > & W2,
+				      const std::vector< float > & rbin,
+				      const float box = 0.,
+				      const utl::binning::scheme binning = utl::binning::scheme::log );
+
   //==================================================================================
   //=================================== 2D-Angular ===================================
   //==================================================================================
 
-  std::vector< std::size_t > dA2D_DD ( const std::vector< float > & RA,
-				       const std::vector< float > & Dec,
-				       const std::vector< float > & thetabin );
+  std::vector< std::size_t > dA2D_DD ( const utl::array_view< float > & RA,
+				       const utl::array_view< float > & Dec,
+				       const std::vector< float > & thetabin,
+				       const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > dA2D_DD_omp ( const utl::array_view< float > & RA,
+					   const utl::array_view< float > & Dec,
+					   const std::vector< float > & thetabin,
+					   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > dA2D_DR ( const utl::array_view< float > & RA1,
+				       const utl::array_view< float > & Dec1,
+				       const utl::array_view< float > & RA2,
+				       const utl::array_view< float > & Dec2,
+				       const std::vector< float > & thetabin,
+				       const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > dA2D_DR_omp ( const utl::array_view< float > & RA1,
+					   const utl::array_view< float > & Dec1,
+					   const utl::array_view< float > & RA2,
+					   const utl::array_view< float > & Dec2,
+					   const std::vector< float > & thetabin,
+					   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wdA2D_DD ( const utl::array_view< float > & RA,
+				   const utl::array_view< float > & Dec,
+				   const utl::array_view< float > & WW,
+				   const std::vector< float > & thetabin,
+				   const utl::binning::scheme binning = utl::binning::scheme::log );
 
-  std::vector< std::size_t > dA2D_DD_omp ( const std::vector< float > & RA,
-					   const std::vector< float > & Dec,
-					   const std::vector< float > & thetabin );
+  std::vector< double > wdA2D_DD_omp ( const utl::array_view< float > & RA,
+				       const utl::array_view< float > & Dec,
+				       const utl::array_view< float > & WW,
+				       const std::vector< float > & thetabin,
+				       const utl::binning::scheme binning = utl::binning::scheme::log );
 
-  std::vector< std::size_t > dA2D_DR ( const std::vector< float > & RA1,
-				       const std::vector< float > & Dec1,
-				       const std::vector< float > & RA2,
-				       const std::vector< float > & Dec2,
-				       const std::vector< float > & thetabin );
+  std::vector< double > wdA2D_DR ( const utl::array_view< float > & RA1,
+				   const utl::array_view< float > & Dec1,
+				   const utl::array_view< float > & W1,
+				   const utl::array_view< float > & RA2,
+				   const utl::array_view< float > & Dec2,
+				   const utl::array_view< float > & W2,
+				   const std::vector< float > & thetabin,
+				   const utl::binning::scheme binning = utl::binning::scheme::log );
 
-  std::vector< std::size_t > dA2D_DR_omp ( const std::vector< float > & RA1,
-					   const std::vector< float > & Dec1,
-					   const std::vector< float > & RA2,
-					   const std::vector< float > & Dec2,
-					   const std::vector< float > & thetabin );
+  std::vector< double > wdA2D_DR_omp ( const utl::array_view< float > & RA1,
+				       const utl::array_view< float > & Dec1,
+				       const utl::array_view< float > & W1,
+				       const utl::array_view< float > & RA2,
+				       const utl::array_view< float > & Dec2,
+				       const utl::array_view< float > & W2,
+				       const std::vector< float > & thetabin,
+				       const utl::binning::scheme binning = utl::binning::scheme::log );
 
   //==================================================================================
   //======================================= 3D =======================================
   //==================================================================================
 
-  std::vector< std::size_t > d3D_DD ( const std::vector< float > & XX,
-				      const std::vector< float > & YY,
-				      const std::vector< float > & ZZ,
-				      const std::vector< float > & rbin );
-
-  std::vector< std::size_t > d3D_DD_omp ( const std::vector< float > & XX,
-					  const std::vector< float > & YY,
-					  const std::vector< float > & ZZ,
-					  const std::vector< float > & rbin );
-
-  std::vector< std::size_t > d3D_DR ( const std::vector< float > & X1,
-				      const std::vector< float > & Y1,
-				      const std::vector< float > & Z1,
-				      const std::vector< float > & X2,
-				      const std::vector< float > & Y2,
-				      const std::vector< float > & Z2,
-				      const std::vector< float > & rbin );
-
-  std::vector< std::size_t > d3D_DR_omp ( const std::vector< float > & X1,
-					  const std::vector< float > & Y1,
-					  const std::vector< float > & Z1,
-					  const std::vector< float > & X2,
-					  const std::vector< float > & Y2,
-					  const std::vector< float > & Z2,
-					  const std::vector< float > & rbin );
+  std::vector< std::size_t > d3D_DD ( const utl::array_view< float > & XX,
+				      const utl::array_view< float > & YY,
+				      const utl::array_view< float > & ZZ,
+				      const std::vector< float > & rbin,
+				      const float box = 0.,
+				      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DD_omp ( const utl::array_view< float > & XX,
+					  const utl::array_view< float > & YY,
+					  const utl::array_view< float > & ZZ,
+					  const std::vector< float > & rbin,
+					  const float box = 0.,
+					  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DR ( const utl::array_view< float > & X1,
+				      const utl::array_view< float > & Y1,
+				      const utl::array_view< float > & Z1,
+				      const utl::array_view< float > & X2,
+				      const utl::array_view< float > & Y2,
+				      const utl::array_view< float > & Z2,
+				      const std::vector< float > & rbin,
+				      const float box = 0.,
+				      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DR_omp ( const utl::array_view< float > & X1,
+					  const utl::array_view< float > & Y1,
+					  const utl::array_view< float > & Z1,
+					  const utl::array_view< float > & X2,
+					  const utl::array_view< float > & Y2,
+					  const utl::array_view< float > & Z2,
+					  const std::vector< float > & rbin,
+					  const float box = 0.,
+					  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DD ( const utl::array_view< float > & XX,
+				  const utl::array_view< float > & YY,
+				  const utl::array_view< float > & ZZ,
+				  const utl::array_view< float > & WW,
+				  const std::vector< float > & rbin,
+				  const float box = 0.,
+				  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DD_omp ( const utl::array_view< float > & XX,
+				      const utl::array_view< float > & YY,
+				      const utl::array_view< float > & ZZ,
+				      const utl::array_view< float > & WW,
+				      const std::vector< float > & rbin,
+				      const float box = 0.,
+				      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DR ( const utl::array_view< float > & X1,
+				  const utl::array_view< float > & Y1,
+				  const utl::array_view< float > & Z1,
+				  const utl::array_view< float > & W1,
+				  const utl::array_view< float > & X2,
+				  const utl::array_view< float > & Y2,
+				  const utl::array_view< float > & Z2,
+				  const utl::array_view< float > & W2,
+				  const std::vector< float > & rbin,
+				  const float box = 0.,
+				  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DR_omp ( const utl::array_view< float > & X1,
+				      const utl::array_view< float > & Y1,
+				      const utl::array_view< float > & Z1,
+				      const utl::array_view< float > & W1,
+				      const utl::array_view< float > & X2,
+				      const utl::array_view< float > & Y2,
+				      const utl::array_view< float > & Z2,
+				      const utl::array_view< float > & W2,
+				      const std::vector< float > & rbin,
+				      const float box = 0.,
+				      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  //==================================================================================
+  //================================== 3D cell-list ==================================
+  //==================================================================================
+
+  // Same histograms as d3D_DD/d3D_DR, but only pairs of objects in
+  // neighbouring cells of a grid with cell side ~ rbin.back() are visited.
+
+  std::vector< std::size_t > d3D_DD_grid ( const utl::array_view< float > & XX,
+					   const utl::array_view< float > & YY,
+					   const utl::array_view< float > & ZZ,
+					   const std::vector< float > & rbin,
+					   const float box = 0.,
+					   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DD_grid_omp ( const utl::array_view< float > & XX,
+					       const utl::array_view< float > & YY,
+					       const utl::array_view< float > & ZZ,
+					       const std::vector< float > & rbin,
+					       const float box = 0.,
+					       const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DR_grid ( const utl::array_view< float > & X1,
+					   const utl::array_view< float > & Y1,
+					   const utl::array_view< float > & Z1,
+					   const utl::array_view< float > & X2,
+					   const utl::array_view< float > & Y2,
+					   const utl::array_view< float > & Z2,
+					   const std::vector< float > & rbin,
+					   const float box = 0.,
+					   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DR_grid_omp ( const utl::array_view< float > & X1,
+					       const utl::array_view< float > & Y1,
+					       const utl::array_view< float > & Z1,
+					       const utl::array_view< float > & X2,
+					       const utl::array_view< float > & Y2,
+					       const utl::array_view< float > & Z2,
+					       const std::vector< float > & rbin,
+					       const float box = 0.,
+					       const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DD_grid ( const utl::array_view< float > & XX,
+				       const utl::array_view< float > & YY,
+				       const utl::array_view< float > & ZZ,
+				       const utl::array_view< float > & WW,
+				       const std::vector< float > & rbin,
+				       const float box = 0.,
+				       const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DD_grid_omp ( const utl::array_view< float > & XX,
+					   const utl::array_view< float > & YY,
+					   const utl::array_view< float > & ZZ,
+					   const utl::array_view< float > & WW,
+					   const std::vector< float > & rbin,
+					   const float box = 0.,
+					   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DR_grid ( const utl::array_view< float > & X1,
+				       const utl::array_view< float > & Y1,
+				       const utl::array_view< float > & Z1,
+				       const utl::array_view< float > & W1,
+				       const utl::array_view< float > & X2,
+				       const utl::array_view< float > & Y2,
+				       const utl::array_view< float > & Z2,
+				       const utl::array_view< float > & W2,
+				       const std::vector< float > & rbin,
+				       const float box = 0.,
+				       const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DR_grid_omp ( const utl::array_view< float > & X1,
+					   const utl::array_view< float > & Y1,
+					   const utl::array_view< float > & Z1,
+					   const utl::array_view< float > & W1,
+					   const utl::array_view< float > & X2,
+					   const utl::array_view< float > & Y2,
+					   const utl::array_view< float > & Z2,
+					   const utl::array_view< float > & W2,
+					   const std::vector< float > & rbin,
+					   const float box = 0.,
+					   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  //==================================================================================
+  //=================================== 3D k-d tree ==================================
+  //==================================================================================
+
+  // Same histograms as d3D_DD/d3D_DR, computed with a dual-tree traversal of
+  // k-d trees built on the catalogues: pairs of nodes whose separations all fall
+  // in the same bin are binned at once, nodes farther than rbin.back() are pruned.
+  // Suited for catalogues with strongly varying density (e.g. lightcones).
+
+  std::vector< std::size_t > d3D_DD_tree ( const utl::array_view< float > & XX,
+					   const utl::array_view< float > & YY,
+					   const utl::array_view< float > & ZZ,
+					   const std::vector< float > & rbin,
+					   const float box = 0.,
+					   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DD_tree_omp ( const utl::array_view< float > & XX,
+					       const utl::array_view< float > & YY,
+					       const utl::array_view< float > & ZZ,
+					       const std::vector< float > & rbin,
+					       const float box = 0.,
+					       const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DR_tree ( const utl::array_view< float > & X1,
+					   const utl::array_view< float > & Y1,
+					   const utl::array_view< float > & Z1,
+					   const utl::array_view< float > & X2,
+					   const utl::array_view< float > & Y2,
+					   const utl::array_view< float > & Z2,
+					   const std::vector< float > & rbin,
+					   const float box = 0.,
+					   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DR_tree_omp ( const utl::array_view< float > & X1,
+					       const utl::array_view< float > & Y1,
+					       const utl::array_view< float > & Z1,
+					       const utl::array_view< float > & X2,
+					       const utl::array_view< float > & Y2,
+					       const utl::array_view< float > & Z2,
+					       const std::vector< float > & rbin,
+					       const float box = 0.,
+					       const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DD_tree ( const utl::array_view< float > & XX,
+				       const utl::array_view< float > & YY,
+				       const utl::array_view< float > & ZZ,
+				       const utl::array_view< float > & WW,
+				       const std::vector< float > & rbin,
+				       const float box = 0.,
+				       const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DD_tree_omp ( const utl::array_view< float > & XX,
+					   const utl::array_view< float > & YY,
+					   const utl::array_view< float > & ZZ,
+					   const utl::array_view< float > & WW,
+					   const std::vector< float > & rbin,
+					   const float box = 0.,
+					   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DR_tree ( const utl::array_view< float > & X1,
+				       const utl::array_view< float > & Y1,
+				       const utl::array_view< float > & Z1,
+				       const utl::array_view< float > & W1,
+				       const utl::array_view< float > & X2,
+				       const utl::array_view< float > & Y2,
+				       const utl::array_view< float > & Z2,
+				       const utl::array_view< float > & W2,
+				       const std::vector< float > & rbin,
+				       const float box = 0.,
+				       const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DR_tree_omp ( const utl::array_view< float > & X1,
+					   const utl::array_view< float > & Y1,
+					   const utl::array_view< float > & Z1,
+					   const utl::array_view< float > & W1,
+					   const utl::array_view< float > & X2,
+					   const utl::array_view< float > & Y2,
+					   const utl::array_view< float > & Z2,
+					   const utl::array_view< float > & W2,
+					   const std::vector< float > & rbin,
+					   const float box = 0.,
+					   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  //==================================================================================
+  //==================================== 3D tiled ====================================
+  //==================================================================================
+
+  // Same histograms as d3D_DR, for second catalogues much larger than the
+  // caches (e.g. randoms 50 times denser than the data). Both catalogues are
+  // sorted along a Z-order curve and split in tiles, of 64 objects for the
+  // first catalogue and of 256 for the second; a tile of the second catalogue
+  // is compared with all the objects of a tile of the first while it sits in
+  // L1. The tiles of the second catalogue within rbin.back() of a tile of the
+  // first are found descending a binary tree over their bounding boxes, so
+  // that far tiles are skipped by whole subtrees. Input order is not preserved
+  // in the summation of weighted counts, which can differ from wd3D_DR by
+  // round-off. These counters are experimental: they are not faster than
+  // d3D_DR at every separation range, so the Python wrappers do not use them
+  // and they only run when called explicitly.
+
+  std::vector< std::size_t > d3D_DR_tiled ( const utl::array_view< float > & X1,
+					    const utl::array_view< float > & Y1,
+					    const utl::array_view< float > & Z1,
+					    const utl::array_view< float > & X2,
+					    const utl::array_view< float > & Y2,
+					    const utl::array_view< float > & Z2,
+					    const std::vector< float > & rbin,
+					    const float box = 0.,
+					    const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DR_tiled_omp ( const utl::array_view< float > & X1,
+						const utl::array_view< float > & Y1,
+						const utl::array_view< float > & Z1,
+						const utl::array_view< float > & X2,
+						const utl::array_view< float > & Y2,
+						const utl::array_view< float > & Z2,
+						const std::vector< float > & rbin,
+						const float box = 0.,
+						const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DR_tiled ( const utl::array_view< float > & X1,
+					const utl::array_view< float > & Y1,
+					const utl::array_view< float > & Z1,
+					const utl::array_view< float > & W1,
+					const utl::array_view< float > & X2,
+					const utl::array_view< float > & Y2,
+					const utl::array_view< float > & Z2,
+					const utl::array_view< float > & W2,
+					const std::vector< float > & rbin,
+					const float box = 0.,
+					const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DR_tiled_omp ( const utl::array_view< float > & X1,
+					    const utl::array_view< float > & Y1,
+					    const utl::array_view< float > & Z1,
+					    const utl::array_view< float > & W1,
+					    const utl::array_view< float > & X2,
+					    const utl::array_view< float > & Y2,
+					    const utl::array_view< float > & Z2,
+					    const utl::array_view< float > & W2,
+					    const std::vector< float > & rbin,
+					    const float box = 0.,
+					    const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  //==================================================================================
+  //=============================== 3D fine histogram ================================
+  //==================================================================================
+
+  // Pair counts on the cell-list engine recorded in a fine_histogram of the
+  // squared separations between rmin and rmax (see fine_histogram.h), to be
+  // re-binned afterwards into any set of bins within that range without
+  // counting again.
+
+  utl::fine_histogram< std::size_t > d3D_DD_fine ( const utl::array_view< float > & XX,
+						   const utl::array_view< float > & YY,
+						   const utl::array_view< float > & ZZ,
+						   const float rmin,
+						   const float rmax,
+						   const float box = 0. );
+
+  utl::fine_histogram< std::size_t > d3D_DD_fine_omp ( const utl::array_view< float > & XX,
+						       const utl::array_view< float > & YY,
+						       const utl::array_view< float > & ZZ,
+						       const float rmin,
+						       const float rmax,
+						       const float box = 0. );
+
+  utl::fine_histogram< std::size_t > d3D_DR_fine ( const utl::array_view< float > & X1,
+						   const utl::array_view< float > & Y1,
+						   const utl::array_view< float > & Z1,
+						   const utl::array_view< float > & X2,
+						   const utl::array_view< float > & Y2,
+						   const utl::array_view< float > & Z2,
+						   const float rmin,
+						   const float rmax,
+						   const float box = 0. );
+
+  utl::fine_histogram< std::size_t > d3D_DR_fine_omp ( const utl::array_view< float > & X1,
+						       const utl::array_view< float > & Y1,
+						       const utl::array_view< float > & Z1,
+						       const utl::array_view< float > & X2,
+						       const utl::array_view< float > & Y2,
+						       const utl::array_view< float > & Z2,
+						       const float rmin,
+						       const float rmax,
+						       const float box = 0. );
+
+  utl::fine_histogram< double > wd3D_DD_fine ( const utl::array_view< float > & XX,
+					       const utl::array_view< float > & YY,
+					       const utl::array_view< float > & ZZ,
+					       const utl::array_view< float > & WW,
+					       const float rmin,
+					       const float rmax,
+					       const float box = 0. );
+
+  utl::fine_histogram< double > wd3D_DD_fine_omp ( const utl::array_view< float > & XX,
+						   const utl::array_view< float > & YY,
+						   const utl::array_view< float > & ZZ,
+						   const utl::array_view< float > & WW,
+						   const float rmin,
+						   const float rmax,
+						   const float box = 0. );
+
+  utl::fine_histogram< double > wd3D_DR_fine ( const utl::array_view< float > & X1,
+					       const utl::array_view< float > & Y1,
+					       const utl::array_view< float > & Z1,
+					       const utl::array_view< float > & W1,
+					       const utl::array_view< float > & X2,
+					       const utl::array_view< float > & Y2,
+					       const utl::array_view< float > & Z2,
+					       const utl::array_view< float > & W2,
+					       const float rmin,
+					       const float rmax,
+					       const float box = 0. );
+
+  utl::fine_histogram< double > wd3D_DR_fine_omp ( const utl::array_view< float > & X1,
+						   const utl::array_view< float > & Y1,
+						   const utl::array_view< float > & Z1,
+						   const utl::array_view< float > & W1,
+						   const utl::array_view< float > & X2,
+						   const utl::array_view< float > & Y2,
+						   const utl::array_view< float > & Z2,
+						   const utl::array_view< float > & W2,
+						   const float rmin,
+						   const float rmax,
+						   const float box = 0. );
+
+  //==================================================================================
+  //================================ 3D Landy-Szalay =================================
+  //==================================================================================
+
+  /**
+   *  @brief Landy-Szalay correlation function with the pair counts it derives from
+   *
+   *  T is std::size_t for pair counts and double for weighted counts.
+   */
+  template < typename T >
+  struct landyszalay_result {
+
+    /// xi = ( DD - 2 DR ) / RR + 1 on the normalised counts (0 where RR = 0)
+    std::vector< double > xi;
+
+    /// raw data-data, data-random and random-random counts
+    std::vector< T > DD, DR, RR;
+
+    /// normalisations of the counts: 2 / ( N^2 - sum w^2 ) for the auto-counts
+    /// and 1 / ( N_d N_r ) for the cross-counts, N being the sums of weights
+    double normDD = 0., normDR = 0., normRR = 0.;
+
+  }; // endstruct landyszalay_result
+
+  // Fused estimator on the cell-list engine: catalogue 1 (data) and catalogue 2
+  // (randoms) are distributed once on a grid shared by the three counts, and DD,
+  // DR and RR are counted in a single parallel loop over the cells. Same counts
+  // as d3D_DD_grid and d3D_DR_grid (and their weighted versions).
+
+  landyszalay_result< std::size_t > d3D_landyszalay ( const utl::array_view< float > & X1,
+						      const utl::array_view< float > & Y1,
+						      const utl::array_view< float > & Z1,
+						      const utl::array_view< float > & X2,
+						      const utl::array_view< float > & Y2,
+						      const utl::array_view< float > & Z2,
+						      const std::vector< float > & rbin,
+						      const float box = 0.,
+						      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  landyszalay_result< std::size_t > d3D_landyszalay_omp ( const utl::array_view< float > & X1,
+							  const utl::array_view< float > & Y1,
+							  const utl::array_view< float > & Z1,
+							  const utl::array_view< float > & X2,
+							  const utl::array_view< float > & Y2,
+							  const utl::array_view< float > & Z2,
+							  const std::vector< float > & rbin,
+							  const float box = 0.,
+							  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  landyszalay_result< double > wd3D_landyszalay ( const utl::array_view< float > & X1,
+						  const utl::array_view< float > & Y1,
+						  const utl::array_view< float > & Z1,
+						  const utl::array_view< float > & W1,
+						  const utl::array_view< float > & X2,
+						  const utl::array_view< float > & Y2,
+						  const utl::array_view< float > & Z2,
+						  const utl::array_view< float > & W2,
+						  const std::vector< float > & rbin,
+						  const float box = 0.,
+						  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  landyszalay_result< double > wd3D_landyszalay_omp ( const utl::array_view< float > & X1,
+						      const utl::array_view< float > & Y1,
+						      const utl::array_view< float > & Z1,
+						      const utl::array_view< float > & W1,
+						      const utl::array_view< float > & X2,
+						      const utl::array_view< float > & Y2,
+						      const utl::array_view< float > & Z2,
+						      const utl::array_view< float > & W2,
+						      const std::vector< float > & rbin,
+						      const float box = 0.,
+						      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  //==================================================================================
+  //=============================== 2D-Angular, sphere ===============================
+  //==================================================================================
+
+  // Same histograms as dA2D_DD/dA2D_DR with the exact great-circle separation
+  // instead of the flat-sky one: positions ( RA, Dec ), in radians, are turned
+  // once into unit vectors and pairs are binned by chord length 2 sin( theta / 2 )
+  // against the transformed thetabin edges, with the dual-tree traversal of the
+  // 3D k-d tree (whose nodes follow the catalogue on the sphere).
+  // Separations up to pi are allowed.
+
+  std::vector< std::size_t > dA2D_DD_sphere ( const utl::array_view< float > & RA,
+					      const utl::array_view< float > & Dec,
+					      const std::vector< float > & thetabin,
+					      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > dA2D_DD_sphere_omp ( const utl::array_view< float > & RA,
+						  const utl::array_view< float > & Dec,
+						  const std::vector< float > & thetabin,
+						  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > dA2D_DR_sphere ( const utl::array_view< float > & RA1,
+					      const utl::array_view< float > & Dec1,
+					      const utl::array_view< float > & RA2,
+					      const utl::array_view< float > & Dec2,
+					      const std::vector< float > & thetabin,
+					      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > dA2D_DR_sphere_omp ( const utl::array_view< float > & RA1,
+						  const utl::array_view< float > & Dec1,
+						  const utl::array_view< float > & RA2,
+						  const utl::array_view< float > & Dec2,
+						  const std::vector< float > & thetabin,
+						  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wdA2D_DD_sphere ( const utl::array_view< float > & RA,
+					  const utl::array_view< float > & Dec,
+					  const utl::array_view< float > & WW,
+					  const std::vector< float > & thetabin,
+					  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wdA2D_DD_sphere_omp ( const utl::array_view< float > & RA,
+					      const utl::array_view< float > & Dec,
+					      const utl::array_view< float > & WW,
+					      const std::vector< float > & thetabin,
+					      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wdA2D_DR_sphere ( const utl::array_view< float > & RA1,
+					  const utl::array_view< float > & Dec1,
+					  const utl::array_view< float > & W1,
+					  const utl::array_view< float > & RA2,
+					  const utl::array_view< float > & Dec2,
+					  const utl::array_view< float > & W2,
+					  const std::vector< float > & thetabin,
+					  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wdA2D_DR_sphere_omp ( const utl::array_view< float > & RA1,
+					      const utl::array_view< float > & Dec1,
+					      const utl::array_view< float > & W1,
+					      const utl::array_view< float > & RA2,
+					      const utl::array_view< float > & Dec2,
+					      const utl::array_view< float > & W2,
+					      const std::vector< float > & thetabin,
+					      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  //==================================================================================
+  //============================= 3D projected ( rp, pi ) ============================
+  //==================================================================================
+
+  /// line of sight of the projected counters
+  enum class line_of_sight {
+    z,        ///< plane-parallel, along the z axis (simulation boxes)
+    midpoint  ///< direction of the pair midpoint seen from the origin (lightcones)
+  };
+
+  // Pairs counted in bins of separation perpendicular (rp) and parallel (pi) to
+  // the line of sight: rp is binned as the separations of the other counters
+  // (rpbin, binning), |pi| in npi linear bins spanning [0, pimax).
+  // The histogram is flattened, bin ( irp, ipi ) is element irp * npi + ipi.
+  // The midpoint line of sight requires open boundaries (box = 0). Pairs are
+  // searched on a cell list of range hypot( rp_max, pimax ).
+
+  std::vector< std::size_t > d3D_DD_rppi ( const utl::array_view< float > & XX,
+					   const utl::array_view< float > & YY,
+					   const utl::array_view< float > & ZZ,
+					   const std::vector< float > & rpbin,
+					   const float pimax,
+					   const std::size_t npi,
+					   const float box = 0.,
+					   const line_of_sight los = line_of_sight::z,
+					   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DD_rppi_omp ( const utl::array_view< float > & XX,
+					       const utl::array_view< float > & YY,
+					       const utl::array_view< float > & ZZ,
+					       const std::vector< float > & rpbin,
+					       const float pimax,
+					       const std::size_t npi,
+					       const float box = 0.,
+					       const line_of_sight los = line_of_sight::z,
+					       const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DR_rppi ( const utl::array_view< float > & X1,
+					   const utl::array_view< float > & Y1,
+					   const utl::array_view< float > & Z1,
+					   const utl::array_view< float > & X2,
+					   const utl::array_view< float > & Y2,
+					   const utl::array_view< float > & Z2,
+					   const std::vector< float > & rpbin,
+					   const float pimax,
+					   const std::size_t npi,
+					   const float box = 0.,
+					   const line_of_sight los = line_of_sight::z,
+					   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DR_rppi_omp ( const utl::array_view< float > & X1,
+					       const utl::array_view< float > & Y1,
+					       const utl::array_view< float > & Z1,
+					       const utl::array_view< float > & X2,
+					       const utl::array_view< float > & Y2,
+					       const utl::array_view< float > & Z2,
+					       const std::vector< float > & rpbin,
+					       const float pimax,
+					       const std::size_t npi,
+					       const float box = 0.,
+					       const line_of_sight los = line_of_sight::z,
+					       const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  // Projected correlation function wp( rp ) = 2 sum_pi xi( rp, pi ) dpi, with
+  // xi( rp, pi ) = ( DD - 2 DR + RR ) / RR (zero where RR = 0) and DD, DR, RR the
+  // normalised counts of the *_rppi counters, e.g. DD / ( ND ( ND - 1 ) / 2 ).
+
+  std::vector< double > wp_landy_szalay ( const std::vector< double > & DD,
+					  const std::vector< double > & DR,
+					  const std::vector< double > & RR,
+					  const std::size_t npi,
+					  const float pimax );
+
+  //==================================================================================
+  //============================ 3D redshift-space ( s, mu ) =========================
+  //==================================================================================
+
+  // Pairs binned in separation s (sbin, binning) and |mu|, the cosine of the
+  // angle between separation and line of sight (see line_of_sight above).
+  // The *_smu counters return the flattened ( s, mu ) histogram with nmu linear
+  // bins of |mu| in [0, 1], bin ( is, imu ) is element is * nmu + imu.
+  // The *_multipoles counters return instead, for each s bin, the sums over
+  // pairs of the even Legendre polynomials L_0( mu ), L_2( mu ), ..., L_lmax( mu )
+  // (lmax even), element is * ( lmax / 2 + 1 ) + ell / 2: multipoles are obtained
+  // without storing fine mu histograms. Pairs are searched on a cell list of
+  // range sbin.back().
+
+  std::vector< std::size_t > d3D_DD_smu ( const utl::array_view< float > & XX,
+					  const utl::array_view< float > & YY,
+					  const utl::array_view< float > & ZZ,
+					  const std::vector< float > & sbin,
+					  const std::size_t nmu,
+					  const float box = 0.,
+					  const line_of_sight los = line_of_sight::z,
+					  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DD_smu_omp ( const utl::array_view< float > & XX,
+					      const utl::array_view< float > & YY,
+					      const utl::array_view< float > & ZZ,
+					      const std::vector< float > & sbin,
+					      const std::size_t nmu,
+					      const float box = 0.,
+					      const line_of_sight los = line_of_sight::z,
+					      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DR_smu ( const utl::array_view< float > & X1,
+					  const utl::array_view< float > & Y1,
+					  const utl::array_view< float > & Z1,
+					  const utl::array_view< float > & X2,
+					  const utl::array_view< float > & Y2,
+					  const utl::array_view< float > & Z2,
+					  const std::vector< float > & sbin,
+					  const std::size_t nmu,
+					  const float box = 0.,
+					  const line_of_sight los = line_of_sight::z,
+					  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DR_smu_omp ( const utl::array_view< float > & X1,
+					      const utl::array_view< float > & Y1,
+					      const utl::array_view< float > & Z1,
+					      const utl::array_view< float > & X2,
+					      const utl::array_view< float > & Y2,
+					      const utl::array_view< float > & Z2,
+					      const std::vector< float > & sbin,
+					      const std::size_t nmu,
+					      const float box = 0.,
+					      const line_of_sight los = line_of_sight::z,
+					      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > d3D_DD_multipoles ( const utl::array_view< float > & XX,
+					    const utl::array_view< float > & YY,
+					    const utl::array_view< float > & ZZ,
+					    const std::vector< float > & sbin,
+					    const std::size_t lmax = 4,
+					    const float box = 0.,
+					    const line_of_sight los = line_of_sight::z,
+					    const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > d3D_DD_multipoles_omp ( const utl::array_view< float > & XX,
+						const utl::array_view< float > & YY,
+						const utl::array_view< float > & ZZ,
+						const std::vector< float > & sbin,
+						const std::size_t lmax = 4,
+						const float box = 0.,
+						const line_of_sight los = line_of_sight::z,
+						const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > d3D_DR_multipoles ( const utl::array_view< float > & X1,
+					    const utl::array_view< float > & Y1,
+					    const utl::array_view< float > & Z1,
+					    const utl::array_view< float > & X2,
+					    const utl::array_view< float > & Y2,
+					    const utl::array_view< float > & Z2,
+					    const std::vector< float > & sbin,
+					    const std::size_t lmax = 4,
+					    const float box = 0.,
+					    const line_of_sight los = line_of_sight::z,
+					    const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > d3D_DR_multipoles_omp ( const utl::array_view< float > & X1,
+						const utl::array_view< float > & Y1,
+						const utl::array_view< float > & Z1,
+						const utl::array_view< float > & X2,
+						const utl::array_view< float > & Y2,
+						const utl::array_view< float > & Z2,
+						const std::vector< float > & sbin,
+						const std::size_t lmax = 4,
+						const float box = 0.,
+						const line_of_sight los = line_of_sight::z,
+						const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  //==================================================================================
+  //=================================== Jackknife ====================================
+  //==================================================================================
+
+  // Jackknife versions of the 2D, angular and 3D counters: each object carries
+  // a region label in [0, nreg) (RR, or R1 and R2 for cross-pairs) and a single
+  // traversal returns nreg + 1 histograms, flattened: histogram k < nreg counts
+  // the pairs with no object in region k, histogram nreg counts all pairs.
+  // The angular ones bin the great-circle separation as dA2D_*_sphere, through
+  // the 3D counters on unit vectors.
+
+  std::vector< std::size_t > d2D_DD_jk ( const utl::array_view< float > & XX,
+					 const utl::array_view< float > & YY,
+					 const utl::array_view< int > & RR,
+					 const std::size_t nreg,
+					 const std::vector< float > & rbin,
+					 const float box = 0.,
+					 const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d2D_DD_jk_omp ( const utl::array_view< float > & XX,
+					     const utl::array_view< float > & YY,
+					     const utl::array_view< int > & RR,
+					     const std::size_t nreg,
+					     const std::vector< float > & rbin,
+					     const float box = 0.,
+					     const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d2D_DR_jk ( const utl::array_view< float > & X1,
+					 const utl::array_view< float > & Y1,
+					 const utl::array_view< int > & R1,
+					 const utl::array_view< float > & X2,
+					 const utl::array_view< float > & Y2,
+					 const utl::array_view< int > & R2,
+					 const std::size_t nreg,
+					 const std::vector< float > & rbin,
+					 const float box = 0.,
+					 const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d2D_DR_jk_omp ( const utl::array_view< float > & X1,
+					     const utl::array_view< float > & Y1,
+					     const utl::array_view< int > & R1,
+					     const utl::array_view< float > & X2,
+					     const utl::array_view< float > & Y2,
+					     const utl::array_view< int > & R2,
+					     const std::size_t nreg,
+					     const std::vector< float > & rbin,
+					     const float box = 0.,
+					     const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > dA2D_DD_jk ( const utl::array_view< float > & RA,
+					  const utl::array_view< float > & Dec,
+					  const utl::array_view< int > & RR,
+					  const std::size_t nreg,
+					  const std::vector< float > & thetabin,
+					  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > dA2D_DD_jk_omp ( const utl::array_view< float > & RA,
+					      const utl::array_view< float > & Dec,
+					      const utl::array_view< int > & RR,
+					      const std::size_t nreg,
+					      const std::vector< float > & thetabin,
+					      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > dA2D_DR_jk ( const utl::array_view< float > & RA1,
+					  const utl::array_view< float > & Dec1,
+					  const utl::array_view< int > & R1,
+					  const utl::array_view< float > & RA2,
+					  const utl::array_view< float > & Dec2,
+					  const utl::array_view< int > & R2,
+					  const std::size_t nreg,
+					  const std::vector< float > & thetabin,
+					  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > dA2D_DR_jk_omp ( const utl::array_view< float > & RA1,
+					      const utl::array_view< float > & Dec1,
+					      const utl::array_view< int > & R1,
+					      const utl::array_view< float > & RA2,
+					      const utl::array_view< float > & Dec2,
+					      const utl::array_view< int > & R2,
+					      const std::size_t nreg,
+					      const std::vector< float > & thetabin,
+					      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DD_jk ( const utl::array_view< float > & XX,
+					 const utl::array_view< float > & YY,
+					 const utl::array_view< float > & ZZ,
+					 const utl::array_view< int > & RR,
+					 const std::size_t nreg,
+					 const std::vector< float > & rbin,
+					 const float box = 0.,
+					 const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DD_jk_omp ( const utl::array_view< float > & XX,
+					     const utl::array_view< float > & YY,
+					     const utl::array_view< float > & ZZ,
+					     const utl::array_view< int > & RR,
+					     const std::size_t nreg,
+					     const std::vector< float > & rbin,
+					     const float box = 0.,
+					     const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DR_jk ( const utl::array_view< float > & X1,
+					 const utl::array_view< float > & Y1,
+					 const utl::array_view< float > & Z1,
+					 const utl::array_view< int > & R1,
+					 const utl::array_view< float > & X2,
+					 const utl::array_view< float > & Y2,
+					 const utl::array_view< float > & Z2,
+					 const utl::array_view< int > & R2,
+					 const std::size_t nreg,
+					 const std::vector< float > & rbin,
+					 const float box = 0.,
+					 const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DR_jk_omp ( const utl::array_view< float > & X1,
+					     const utl::array_view< float > & Y1,
+					     const utl::array_view< float > & Z1,
+					     const utl::array_view< int > & R1,
+					     const utl::array_view< float > & X2,
+					     const utl::array_view< float > & Y2,
+					     const utl::array_view< float > & Z2,
+					     const utl::array_view< int > & R2,
+					     const std::size_t nreg,
+					     const std::vector< float > & rbin,
+					     const float box = 0.,
+					     const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  //==================================================================================
+  //=================================== Bootstrap ====================================
+  //==================================================================================
+
+  /// resampling of the bootstrap counters
+  enum class resampling {
+    poisson,     ///< independent Poisson( 1 ) multiplicities
+    multinomial  ///< size draws with replacement, as the classical bootstrap
+  };
+
+  // Bootstrap versions of the 2D, angular and 3D counters: each object of the
+  // (first) catalogue carries nboot multiplicities, drawn from a counter-based
+  // generator keyed by seed, and each pair adds the product of the multiplicities
+  // of its objects to the histogram of every resample. The second catalogue of
+  // the cross-pair counters is not resampled. A single traversal returns nboot + 1
+  // histograms, flattened: histogram b < nboot is resample b, histogram nboot
+  // counts all pairs once. Multiplicities only depend on seed, on the index of
+  // the object and on the catalogue size, so DD and DR counters called with the
+  // same seed resample the same objects. As for the jackknife, the angular
+  // counters bin the great-circle separation as dA2D_*_sphere.
+
+  // Multiplicities drawn by the bootstrap counters for a catalogue of size
+  // objects, element ii * nboot + b is the multiplicity of object ii in resample b
+  std::vector< std::uint16_t > bootstrap_multiplicities ( const std::size_t size,
+							  const std::size_t nboot,
+							  const std::uint64_t seed,
+							  const resampling scheme = resampling::poisson );
+
+  std::vector< std::size_t > d2D_DD_boot ( const utl::array_view< float > & XX,
+					   const utl::array_view< float > & YY,
+					   const std::size_t nboot,
+					   const std::uint64_t seed,
+					   const std::vector< float > & rbin,
+					   const float box = 0.,
+					   const utl::binning::scheme binning = utl::binning::scheme::log,
+					   const resampling scheme = resampling::poisson );
+
+  std::vector< std::size_t > d2D_DD_boot_omp ( const utl::array_view< float > & XX,
+					       const utl::array_view< float > & YY,
+					       const std::size_t nboot,
+					       const std::uint64_t seed,
+					       const std::vector< float > & rbin,
+					       const float box = 0.,
+					       const utl::binning::scheme binning = utl::binning::scheme::log,
+					       const resampling scheme = resampling::poisson );
+
+  std::vector< std::size_t > d2D_DR_boot ( const utl::array_view< float > & X1,
+					   const utl::array_view< float > & Y1,
+					   const utl::array_view< float > & X2,
+					   const utl::array_view< float > & Y2,
+					   const std::size_t nboot,
+					   const std::uint64_t seed,
+					   const std::vector< float > & rbin,
+					   const float box = 0.,
+					   const utl::binning::scheme binning = utl::binning::scheme::log,
+					   const resampling scheme = resampling::poisson );
+
+  std::vector< std::size_t > d2D_DR_boot_omp ( const utl::array_view< float > & X1,
+					       const utl::array_view< float > & Y1,
+					       const utl::array_view< float > & X2,
+					       const utl::array_view< float > & Y2,
+					       const std::size_t nboot,
+					       const std::uint64_t seed,
+					       const std::vector< float > & rbin,
+					       const float box = 0.,
+					       const utl::binning::scheme binning = utl::binning::scheme::log,
+					       const resampling scheme = resampling::poisson );
+
+  std::vector< std::size_t > dA2D_DD_boot ( const utl::array_view< float > & RA,
+					    const utl::array_view< float > & Dec,
+					    const std::size_t nboot,
+					    const std::uint64_t seed,
+					    const std::vector< float > & thetabin,
+					    const utl::binning::scheme binning = utl::binning::scheme::log,
+					    const resampling scheme = resampling::poisson );
+
+  std::vector< std::size_t > dA2D_DD_boot_omp ( const utl::array_view< float > & RA,
+						const utl::array_view< float > & Dec,
+						const std::size_t nboot,
+						const std::uint64_t seed,
+						const std::vector< float > & thetabin,
+						const utl::binning::scheme binning = utl::binning::scheme::log,
+						const resampling scheme = resampling::poisson );
+
+  std::vector< std::size_t > dA2D_DR_boot ( const utl::array_view< float > & RA1,
+					    const utl::array_view< float > & Dec1,
+					    const utl::array_view< float > & RA2,
+					    const utl::array_view< float > & Dec2,
+					    const std::size_t nboot,
+					    const std::uint64_t seed,
+					    const std::vector< float > & thetabin,
+					    const utl::binning::scheme binning = utl::binning::scheme::log,
+					    const resampling scheme = resampling::poisson );
+
+  std::vector< std::size_t > dA2D_DR_boot_omp ( const utl::array_view< float > & RA1,
+						const utl::array_view< float > & Dec1,
+						const utl::array_view< float > & RA2,
+						const utl::array_view< float > & Dec2,
+						const std::size_t nboot,
+						const std::uint64_t seed,
+						const std::vector< float > & thetabin,
+						const utl::binning::scheme binning = utl::binning::scheme::log,
+						const resampling scheme = resampling::poisson );
+
+  std::vector< std::size_t > d3D_DD_boot ( const utl::array_view< float > & XX,
+					   const utl::array_view< float > & YY,
+					   const utl::array_view< float > & ZZ,
+					   const std::size_t nboot,
+					   const std::uint64_t seed,
+					   const std::vector< float > & rbin,
+					   const float box = 0.,
+					   const utl::binning::scheme binning = utl::binning::scheme::log,
+					   const resampling scheme = resampling::poisson );
+
+  std::vector< std::size_t > d3D_DD_boot_omp ( const utl::array_view< float > & XX,
+					       const utl::array_view< float > & YY,
+					       const utl::array_view< float > & ZZ,
+					       const std::size_t nboot,
+					       const std::uint64_t seed,
+					       const std::vector< float > & rbin,
+					       const float box = 0.,
+					       const utl::binning::scheme binning = utl::binning::scheme::log,
+					       const resampling scheme = resampling::poisson );
+
+  std::vector< std::size_t > d3D_DR_boot ( const utl::array_view< float > & X1,
+					   const utl::array_view< float > & Y1,
+					   const utl::array_view< float > & Z1,
+					   const utl::array_view< float > & X2,
+					   const utl::array_view< float > & Y2,
+					   const utl::array_view< float > & Z2,
+					   const std::size_t nboot,
+					   const std::uint64_t seed,
+					   const std::vector< float > & rbin,
+					   const float box = 0.,
+					   const utl::binning::scheme binning = utl::binning::scheme::log,
+					   const resampling scheme = resampling::poisson );
+
+  std::vector< std::size_t > d3D_DR_boot_omp ( const utl::array_view< float > & X1,
+					       const utl::array_view< float > & Y1,
+					       const utl::array_view< float > & Z1,
+					       const utl::array_view< float > & X2,
+					       const utl::array_view< float > & Y2,
+					       const utl::array_view< float > & Z2,
+					       const std::size_t nboot,
+					       const std::uint64_t seed,
+					       const std::vector< float > & rbin,
+					       const float box = 0.,
+					       const utl::binning::scheme binning = utl::binning::scheme::log,
+					       const resampling scheme = resampling::poisson );
+
+  //==================================================================================
+  //============================= Periodic box, analytic RR ==========================
+  //==================================================================================
+
+  // In a periodic box the minimum-image separations of a uniform catalogue are
+  // uniform in [ -box / 2, box / 2 )^D: the RR_periodic_* functions return the
+  // fraction of pairs in each bin, i.e. the normalised RR counts of an infinite
+  // random catalogue, as the volume of the bin over box^D. Bins have to fit in
+  // the box (rbin.back() <= box / 2, in the rppi geometry also pimax <= box / 2).
+
+  std::vector< double > RR_periodic_2D ( const std::vector< float > & rbin,
+					 const float box,
+					 const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > RR_periodic_3D ( const std::vector< float > & rbin,
+					 const float box,
+					 const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  // same layout as d3D_DD_rppi, with the line of sight along z
+  std::vector< double > RR_periodic_rppi ( const std::vector< float > & rpbin,
+					   const float pimax,
+					   const std::size_t npi,
+					   const float box,
+					   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  // Correlation function of a catalogue in a periodic box from its DD counts
+  // alone, with the natural estimator DD / RR - 1 and the analytic RR above:
+  // no random catalogue is needed. wp_periodic integrates xi( rp, pi ) along z
+  // as wp_landy_szalay.
+
+  std::vector< double > xi_periodic_2D ( const utl::array_view< float > & XX,
+					 const utl::array_view< float > & YY,
+					 const std::vector< float > & rbin,
+					 const float box,
+					 const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > xi_periodic_2D_omp ( const utl::array_view< float > & XX,
+					     const utl::array_view< float > & YY,
+					     const std::vector< float > & rbin,
+					     const float box,
+					     const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > xi_periodic_3D ( const utl::array_view< float > & XX,
+					 const utl::array_view< float > & YY,
+					 const utl::array_view< float > & ZZ,
+					 const std::vector< float > & rbin,
+					 const float box,
+					 const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > xi_periodic_3D_omp ( const utl::array_view< float > & XX,
+					     const utl::array_view< float > & YY,
+					     const utl::array_view< float > & ZZ,
+					     const std::vector< float > & rbin,
+					     const float box,
+					     const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wp_periodic ( const utl::array_view< float > & XX,
+				      const utl::array_view< float > & YY,
+				      const utl::array_view< float > & ZZ,
+				      const std::vector< float > & rpbin,
+				      const float pimax,
+				      const std::size_t npi,
+				      const float box,
+				      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wp_periodic_omp ( const utl::array_view< float > & XX,
+					  const utl::array_view< float > & YY,
+					  const utl::array_view< float > & ZZ,
+					  const std::vector< float > & rpbin,
+					  const float pimax,
+					  const std::size_t npi,
+					  const float box,
+					  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  //==================================================================================
+  //=============================== Marked correlation ===============================
+  //==================================================================================
+
+  // Marked counts on the 3D cell-list engine: MM holds nmark marks per object,
+  // mark-major (mark k of object ii is MM[ k * size + ii ]). Each pair in bin ib
+  // adds 1 to element ib * ( nmark + 1 ) and the product of its k-th marks to
+  // element ib * ( nmark + 1 ) + 1 + k: the plain count and the nmark marked
+  // counts WW_k come out of the same traversal, M_k( r ) = WW_k / DD once both
+  // are normalised. For DR the two catalogues carry the same marks.
+
+  std::vector< double > d3D_DD_marked ( const utl::array_view< float > & XX,
+					const utl::array_view< float > & YY,
+					const utl::array_view< float > & ZZ,
+					const utl::array_view< float > & MM,
+					const std::size_t nmark,
+					const std::vector< float > & rbin,
+					const float box = 0.,
+					const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > d3D_DD_marked_omp ( const utl::array_view< float > & XX,
+					    const utl::array_view< float > & YY,
+					    const utl::array_view< float > & ZZ,
+					    const utl::array_view< float > & MM,
+					    const std::size_t nmark,
+					    const std::vector< float > & rbin,
+					    const float box = 0.,
+					    const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > d3D_DR_marked ( const utl::array_view< float > & X1,
+					const utl::array_view< float > & Y1,
+					const utl::array_view< float > & Z1,
+					const utl::array_view< float > & M1,
+					const utl::array_view< float > & X2,
+					const utl::array_view< float > & Y2,
+					const utl::array_view< float > & Z2,
+					const utl::array_view< float > & M2,
+					const std::size_t nmark,
+					const std::vector< float > & rbin,
+					const float box = 0.,
+					const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > d3D_DR_marked_omp ( const utl::array_view< float > & X1,
+					    const utl::array_view< float > & Y1,
+					    const utl::array_view< float > & Z1,
+					    const utl::array_view< float > & M1,
+					    const utl::array_view< float > & X2,
+					    const utl::array_view< float > & Y2,
+					    const utl::array_view< float > & Z2,
+					    const utl::array_view< float > & M2,
+					    const std::size_t nmark,
+					    const std::vector< float > & rbin,
+					    const float box = 0.,
+					    const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  //==================================================================================
+  //=========================== Three-point, Legendre multipoles =====================
+  //==================================================================================
+
+  // Multipoles of the three-point counts, following the spherical-harmonic
+  // decomposition of Slepian & Eisenstein (2015): the neighbours j of each
+  // primary i within rbin.back() (found on the 3D cell list) are binned in
+  // separation and their directions projected on the real harmonics up to lmax,
+  // the addition theorem then gives, for every pair of bins, the sum of
+  // P_ell( cos theta_jk ) over the pairs of neighbours ( j, k ) without visiting
+  // them: the cost is O( N n_neigh lmax^2 ) instead of O( N n_neigh^2 ).
+  //
+  // Element ( ell * nbin + b1 ) * nbin + b2 (symmetric in b1, b2) is the sum over
+  // primaries i and ordered pairs of distinct neighbours ( j, k ), r_ij in bin b1
+  // and r_ik in bin b2, of P_ell of the cosine of the angle between them (times
+  // w_i w_j w_k for the weighted version, weights may be negative, e.g. for the
+  // D - R field of the edge-corrected estimator). Coincident objects (r = 0) are
+  // skipped, the angle being undefined.
+
+  std::vector< double > d3D_3pcf_multipoles ( const utl::array_view< float > & XX,
+					      const utl::array_view< float > & YY,
+					      const utl::array_view< float > & ZZ,
+					      const std::vector< float > & rbin,
+					      const std::size_t lmax,
+					      const float box = 0.,
+					      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > d3D_3pcf_multipoles_omp ( const utl::array_view< float > & XX,
+						  const utl::array_view< float > & YY,
+						  const utl::array_view< float > & ZZ,
+						  const std::vector< float > & rbin,
+						  const std::size_t lmax,
+						  const float box = 0.,
+						  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_3pcf_multipoles ( const utl::array_view< float > & XX,
+					       const utl::array_view< float > & YY,
+					       const utl::array_view< float > & ZZ,
+					       const utl::array_view< float > & WW,
+					       const std::vector< float > & rbin,
+					       const std::size_t lmax,
+					       const float box = 0.,
+					       const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_3pcf_multipoles_omp ( const utl::array_view< float > & XX,
+						   const utl::array_view< float > & YY,
+						   const utl::array_view< float > & ZZ,
+						   const utl::array_view< float > & WW,
+						   const std::vector< float > & rbin,
+						   const std::size_t lmax,
+						   const float box = 0.,
+						   const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  //==================================================================================
+  //================================== Multi-tracer ==================================
+  //==================================================================================
+
+  // Auto- and cross-pair counts of the ntracer samples of a catalogue in a single
+  // traversal of the cell list: each object carries a tracer label in
+  // [0, ntracer) in TT, and every pair is counted once, in the histogram of its
+  // pair of labels. The ntracer * ( ntracer + 1 ) / 2 histograms are flattened,
+  // the one of labels ( a, b ), a <= b, starting at element
+  // tracer_pair( a, b, ntracer ) * nbin: ( a, a ) is the auto-count of sample a,
+  // ( a, b ) the cross-count of samples a and b (each cross pair once, as d3D_DR).
+
+  /// index of the histogram of tracer labels ( a, b ), a <= b < ntracer
+  inline std::size_t tracer_pair ( const std::size_t a, const std::size_t b,
+				   const std::size_t ntracer ) noexcept {
+    return a * ntracer - a * ( a + 1 ) / 2 + b;
+  }
+
+  std::vector< std::size_t > d3D_DD_tracers ( const utl::array_view< float > & XX,
+					      const utl::array_view< float > & YY,
+					      const utl::array_view< float > & ZZ,
+					      const utl::array_view< int > & TT,
+					      const std::size_t ntracer,
+					      const std::vector< float > & rbin,
+					      const float box = 0.,
+					      const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< std::size_t > d3D_DD_tracers_omp ( const utl::array_view< float > & XX,
+						  const utl::array_view< float > & YY,
+						  const utl::array_view< float > & ZZ,
+						  const utl::array_view< int > & TT,
+						  const std::size_t ntracer,
+						  const std::vector< float > & rbin,
+						  const float box = 0.,
+						  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DD_tracers ( const utl::array_view< float > & XX,
+					  const utl::array_view< float > & YY,
+					  const utl::array_view< float > & ZZ,
+					  const utl::array_view< float > & WW,
+					  const utl::array_view< int > & TT,
+					  const std::size_t ntracer,
+					  const std::vector< float > & rbin,
+					  const float box = 0.,
+					  const utl::binning::scheme binning = utl::binning::scheme::log );
+
+  std::vector< double > wd3D_DD_tracers_omp ( const utl::array_view< float > & XX,
+					      const utl::array_view< float > & YY,
+					      const utl::array_view< float > & ZZ,
+					      const utl::array_view< float > & WW,
+					      const utl::array_view< int > & TT,
+					      const std::size_t ntracer,
+					      const std::vector< float > & rbin,
+					      const float box = 0.,
+					      const utl::binning::scheme binning = utl::binning::scheme::log );
 
 } //endnamespace utl
 
@@ -0,0 +1,83 @@
+/**
+ *  @file utilities/include/counts_in_cells.h
+ *
+ *  @brief The counts-in-cells engine
+ *
+ *  This file defines the counts of objects in spheres of given radii
+ *  around many centres (e.g. random points), on the cell list of the
+ *  catalogue built once: the distribution P_N(R) of the counts, whose
+ *  N = 0 term is the void probability function, and its low-order
+ *  moments.
+ */
+
+#ifndef __COUNTS_IN_CELLS__
+#define __COUNTS_IN_CELLS__
+
+// STL includes
+#include <vector>
+#include <cstddef>
+
+// Internal includes
+#include <array_view.h>
+
+namespace utl {
+
+  /**
+   *  @brief Distribution and moments of the counts in spheres
+   *
+   *  For nradius radii, with nmax + 1 count bins per radius.
+   */
+  struct counts_in_cells_result {
+
+    /// number of spheres
+    std::size_t nsphere = 0;
+
+    /// number of count bins per radius
+    std::size_t nmax = 0;
+
+    /// element ir * ( nmax + 1 ) + N: spheres of radius ir holding N objects,
+    /// element N = nmax collecting the spheres with N >= nmax
+    std::vector< std::size_t > PN;
+
+    /// element ir * 4 + k: mean ( k = 0 ) and central moments of order
+    /// k + 1 = 2, 3, 4 of the counts in the spheres of radius ir (not truncated)
+    std::vector< double > moments;
+
+  }; // endstruct counts_in_cells_result
+
+  //==================================================================================
+  //================================ Counts in cells =================================
+  //==================================================================================
+
+  // Counts of the objects of the catalogue ( XX, YY, ZZ ) within distance r < R of
+  // each centre ( CX, CY, CZ ), for every radius R in radii (positive and strictly
+  // increasing). The catalogue is distributed on a cell list for the largest radius
+  // and the centres are visited cell by cell, cells lying entirely within a sphere
+  // being counted as a whole. With box > 0, coordinates and centres lie in
+  // [0, box) and distances follow the minimum-image convention (requires
+  // radii.back() <= box/2); with open boundaries spheres crossing the edges of the
+  // catalogue are not corrected. Throws std::invalid_argument on invalid radii.
+
+  counts_in_cells_result counts_in_cells ( const utl::array_view< float > & XX,
+					   const utl::array_view< float > & YY,
+					   const utl::array_view< float > & ZZ,
+					   const utl::array_view< float > & CX,
+					   const utl::array_view< float > & CY,
+					   const utl::array_view< float > & CZ,
+					   const std::vector< float > & radii,
+					   const std::size_t nmax,
+					   const float box = 0. );
+
+  counts_in_cells_result counts_in_cells_omp ( const utl::array_view< float > & XX,
+					       const utl::array_view< float > & YY,
+					       const utl::array_view< float > & ZZ,
+					       const utl::array_view< float > & CX,
+					       const utl::array_view< float > & CY,
+					       const utl::array_view< float > & CZ,
+					       const std::vector< float > & radii,
+					       const std::size_t nmax,
+					       const float box = 0. );
+
+} // endnamespace utl
+
+#endif //__COUNTS_IN_CELLS__
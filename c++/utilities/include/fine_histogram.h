@@ -0,0 +1,227 @@
+/**
+ *  @file utilities/include/fine_histogram.h
+ *
+ *  @brief The class fine_histogram
+ *
+ *  This file defines a histogram of squared separations fine enough to
+ *  be re-binned into any coarser set of bins: pair counts are recorded
+ *  once and binning studies cost a sum over the fine bins instead of a
+ *  new count.
+ */
+
+#ifndef __FINE_HISTOGRAM__
+#define __FINE_HISTOGRAM__
+
+// STL includes
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+// Internal includes
+#include <binning.h>
+#include <serialize.h>
+
+namespace utl {
+
+  /**
+   *  @class fine_histogram fine_histogram.h "utilities/include/fine_histogram.h"
+   *
+   *  @brief Histogram of squared separations on the float32 grid
+   *
+   *  Fine bins are the intervals of squared separations sharing the
+   *  exponent and the mantissa_bits leading bits of the mantissa of
+   *  their float32 representation, so that the bin of a squared
+   *  separation is a shift of its bits. Bins have a relative width of
+   *  at most 2^-13 in r^2 (6e-5 in r) on the whole range, and the
+   *  counters compute separations with the same float32 operations as
+   *  the binned counters.
+   *
+   *  Re-binning snaps every coarse edge to the nearest fine edge:
+   *  coarse edges that are themselves fine edges are kept exactly,
+   *  the others move by at most 3e-5 in relative terms (see edges()).
+   *  Coarse edges must lie within the recorded range [rmin, rmax], up
+   *  to this rounding: re-binning beyond it throws std::invalid_argument
+   *  instead of silently clamping the bins. Unlike the binned counters,
+   *  the upper edge of the last coarse bin is excluded.
+   *
+   *  T is std::size_t for pair counts and double for weighted counts.
+   */
+  template < typename T >
+  class fine_histogram : public Serializable {
+
+  public :
+
+    /// leading mantissa bits of the squared separation that select the bin
+    static constexpr unsigned mantissa_bits = 13;
+
+    /// entries written by a different layout are not read
+    static constexpr std::uint32_t version = 1;
+
+    /// type tag: 'u' for std::size_t, 'f' for double
+    static constexpr char tag = std::is_floating_point< T >::value ? 'f' : 'u';
+
+  private :
+
+    static constexpr unsigned shift = 23 - mantissa_bits;
+
+    /// key of the first fine bin
+    std::uint32_t first = 0;
+
+    std::vector< T > hist;
+
+    static std::uint32_t bits ( const float ff ) noexcept {
+      std::uint32_t uu;
+      std::memcpy( &uu, &ff, sizeof( uu ) );
+      return uu;
+    }
+
+    /// fine edge nearest to squared separation e2, throws std::invalid_argument
+    /// if it is not an edge of the histogram (e2 outside the recorded range)
+    std::size_t snap ( const float e2 ) const {
+      const std::uint32_t bb = bits( e2 ), half = std::uint32_t( 1 ) << ( shift - 1 );
+      const std::uint32_t key = ( bb >> shift ) + ( ( bb & ( 2 * half - 1 ) ) >= half );
+      if ( !( e2 > 0.f && std::isfinite( e2 ) ) || key < first || key - first > hist.size() )
+	throw std::invalid_argument( "coarse bins should lie within [rmin, rmax] of the fine histogram" );
+      return key - first;
+    }
+
+  public :
+
+    /// default constructor, empty histogram
+    fine_histogram () = default;
+
+    /**
+     *  @brief Constructor of an empty histogram on a range of separations
+     *
+     *  @param rmin, rmax range of separations recorded, 0 < rmin < rmax
+     */
+    fine_histogram ( const float rmin, const float rmax ) {
+
+      if ( !( rmin > 0.f && rmax > rmin && std::isfinite( rmax ) ) )
+	throw std::invalid_argument( "fine histograms need 0 < rmin < rmax" );
+      first = bits( rmin * rmin ) >> shift;
+      hist.assign( ( bits( rmax * rmax ) >> shift ) - first + 1, T( 0 ) );
+
+    }
+
+    /// number of fine bins
+    std::size_t size () const noexcept { return hist.size(); }
+
+    /// fine bin of squared separation d2, -1 outside the histogram
+    long bin ( const float d2 ) const noexcept {
+      const std::uint32_t key = bits( d2 ) >> shift;
+      return key >= first && key - first < hist.size() ? long( key - first ) : -1;
+    }
+
+    /// lower squared edge of fine bin kk (kk == size() for the upper edge of the last)
+    float edge2 ( const std::size_t kk ) const noexcept {
+      const std::uint32_t bb = std::uint32_t( first + kk ) << shift;
+      float ff;
+      std::memcpy( &ff, &bb, sizeof( ff ) );
+      return ff;
+    }
+
+    /// fine counts
+    const std::vector< T > & counts () const noexcept { return hist; }
+
+    /// fine counts, filled by the counters
+    std::vector< T > & counts () noexcept { return hist; }
+
+    /// merges the counts of a histogram on the same range
+    fine_histogram & operator+= ( const fine_histogram & other ) {
+      if ( other.first != first || other.hist.size() != hist.size() )
+	throw std::invalid_argument( "cannot merge fine histograms on different ranges" );
+      for ( std::size_t kk = 0; kk < hist.size(); ++kk ) hist[ kk ] += other.hist[ kk ];
+      return *this;
+    }
+
+    /**
+     *  @brief Coarse bin edges actually used by rebin
+     *
+     *  @param rbin, binning coarse bins, as for the binned counters
+     *
+     *  @return the separations of the fine edges nearest to the coarse ones
+     *
+     *  Throws std::invalid_argument if a coarse edge is outside [rmin, rmax].
+     */
+    std::vector< float > edges ( const std::vector< float > & rbin,
+				 const utl::binning::scheme binning ) const {
+
+      return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+	std::vector< float > ee;
+	for ( const float e2 : bins.edges2() ) ee.push_back( std::sqrt( edge2( snap( e2 ) ) ) );
+	return ee;
+      } );
+
+    }
+
+    /**
+     *  @brief Counts in coarse bins
+     *
+     *  @param rbin, binning coarse bins, as for the binned counters
+     *
+     *  @return the sums of the fine counts between consecutive snapped edges
+     *
+     *  Throws std::invalid_argument if a coarse edge is outside [rmin, rmax].
+     */
+    std::vector< T > rebin ( const std::vector< float > & rbin,
+			     const utl::binning::scheme binning ) const {
+
+      return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+	const std::vector< float > & e2 = bins.edges2();
+	std::vector< T > NN ( bins.size(), T( 0 ) );
+	std::size_t kk = snap( e2.front() );
+	for ( std::size_t ib = 0; ib < NN.size(); ++ib )
+	  for ( const std::size_t end = snap( e2[ ib + 1 ] ); kk < end; ++kk ) NN[ ib ] += hist[ kk ];
+	return NN;
+      } );
+
+    }
+
+    virtual std::size_t serialize_size () const {
+
+      return
+	SerialPOD< std::uint32_t >::serialize_size( version ) +
+	SerialPOD< char >::serialize_size( tag ) +
+	SerialPOD< std::uint32_t >::serialize_size( mantissa_bits ) +
+	SerialPOD< std::uint32_t >::serialize_size( first ) +
+	SerialVecPOD< T >::serialize_size( hist );
+
+    }
+
+    virtual char * serialize ( char * data ) const {
+
+      data = SerialPOD< std::uint32_t >::serialize( data, version );
+      data = SerialPOD< char >::serialize( data, tag );
+      data = SerialPOD< std::uint32_t >::serialize( data, mantissa_bits );
+      data = SerialPOD< std::uint32_t >::serialize( data, first );
+      data = SerialVecPOD< T >::serialize( data, hist );
+      return data;
+
+    }
+
+    /// throws std::invalid_argument on buffers of a different type or layout
+    virtual const char * deserialize ( const char * data ) {
+
+      std::uint32_t vv, mb;
+      char tt;
+      data = SerialPOD< std::uint32_t >::deserialize( data, vv );
+      data = SerialPOD< char >::deserialize( data, tt );
+      data = SerialPOD< std::uint32_t >::deserialize( data, mb );
+      if ( vv != version || tt != tag || mb != mantissa_bits )
+	throw std::invalid_argument( "incompatible serialised fine histogram" );
+      data = SerialPOD< std::uint32_t >::deserialize( data, first );
+      data = SerialVecPOD< T >::deserialize( data, hist );
+      return data;
+
+    }
+
+  }; // endclass fine_histogram
+
+} // endnamespace utl
+
+#endif //__FINE_HISTOGRAM__
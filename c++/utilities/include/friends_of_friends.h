@@ -0,0 +1,65 @@
+/**
+ *  @file utilities/include/friends_of_friends.h
+ *
+ *  @brief The friends-of-friends group finder
+ *
+ *  This file defines the friends-of-friends (FoF) groups of a catalogue:
+ *  the connected components of the graph linking every pair of objects
+ *  closer than a linking length, found by a parallel union-find over the
+ *  pairs of the cell list of the catalogue.
+ */
+
+#ifndef __FRIENDS_OF_FRIENDS__
+#define __FRIENDS_OF_FRIENDS__
+
+// STL includes
+#include <vector>
+#include <cstddef>
+
+// Internal includes
+#include <array_view.h>
+
+namespace utl {
+
+  /**
+   *  @brief Friends-of-friends groups of a catalogue
+   *
+   *  Groups are numbered from 0 in the order of their first object in the
+   *  input catalogue, so that the numbering does not depend on the number
+   *  of threads. Isolated objects are groups of multiplicity 1.
+   */
+  struct fof_result {
+
+    /// group of each object of the input catalogue
+    std::vector< std::size_t > group;
+
+    /// number of objects in each group
+    std::vector< std::size_t > multiplicity;
+
+  }; // endstruct fof_result
+
+  //==================================================================================
+  //=============================== Friends of friends ===============================
+  //==================================================================================
+
+  // Groups of the catalogue ( XX, YY, ZZ ) whose objects are linked by chains of
+  // pairs at separation r <= linking_length (positive). With box > 0, coordinates
+  // lie in [0, box), distances follow the minimum-image convention and groups
+  // extend across the faces of the box (requires linking_length < box/2).
+  // Throws std::invalid_argument on an invalid linking length.
+
+  fof_result friends_of_friends ( const utl::array_view< float > & XX,
+				  const utl::array_view< float > & YY,
+				  const utl::array_view< float > & ZZ,
+				  const float linking_length,
+				  const float box = 0. );
+
+  fof_result friends_of_friends_omp ( const utl::array_view< float > & XX,
+				      const utl::array_view< float > & YY,
+				      const utl::array_view< float > & ZZ,
+				      const float linking_length,
+				      const float box = 0. );
+
+} // endnamespace utl
+
+#endif //__FRIENDS_OF_FRIENDS__
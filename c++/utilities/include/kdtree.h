@@ -0,0 +1,161 @@
+/**
+ *  @file utilities/include/kdtree.h
+ *
+ *  @brief The class kdtree
+ *
+ *  This file defines the interface of the class kdtree, a balanced
+ *  3D k-d tree with axis-aligned bounding boxes on every node, suited
+ *  for single- and dual-tree range searches on catalogues with strongly
+ *  varying density.
+ */
+
+#ifndef __KDTREE__
+#define __KDTREE__
+
+// STL includes
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// Internal includes
+#include <array_view.h>
+
+namespace utl {
+
+  /**
+   *  @class kdtree kdtree.h "utilities/include/kdtree.h"
+   *
+   *  @brief The class kdtree
+   *
+   *  The catalogue is re-ordered so that the objects of each node are
+   *  contiguous in the range [ node.begin, node.end ) of the coordinate
+   *  arrays. Nodes are stored in a flat vector, the root is nodes[ 0 ]
+   *  and leaves have left == right == 0.
+   */
+  class kdtree {
+
+  public :
+
+    /// node of the tree
+    struct node {
+
+      /// bounding box of the objects in the node
+      std::array< float, 3 > lo, hi;
+
+      /// range of objects in the node
+      std::size_t begin = 0, end = 0;
+
+      /// position of the children in the node vector
+      std::size_t left = 0, right = 0;
+
+      /// sum of the weights and of the squared weights of the objects
+      /// in the node (weighted trees only)
+      double wsum = 0., w2sum = 0.;
+
+      /// whether the node is a leaf
+      bool leaf () const noexcept { return left == 0; }
+
+      /// number of objects in the node
+      std::size_t size () const noexcept { return end - begin; }
+
+    }; // endstruct node
+
+    /// nodes of the tree, root first
+    std::vector< node > nodes;
+
+    /// coordinates, ordered by node
+    std::vector< float > xx, yy, zz;
+
+    /// weights, ordered by node (empty for unweighted catalogues)
+    std::vector< float > ww;
+
+    /// position of each ordered object in the input catalogue
+    std::vector< std::size_t > idx;
+
+    /// default constructor
+    kdtree () = default;
+
+    /**
+     *  @brief Constructor building the tree on a catalogue
+     *
+     *  Nodes are split at the median of their widest dimension
+     *  until they contain at most leaf_size objects.
+     *
+     *  @param XX, YY, ZZ coordinates of the catalogue
+     *
+     *  @param leaf_size maximum number of objects in a leaf (default = 32)
+     *
+     *  @param WW weights of the catalogue (default = none)
+     *
+     *  @throws std::length_error if YY, ZZ or non-empty WW do not
+     *          have the size of XX
+     */
+    kdtree ( const utl::array_view< float > & XX,
+	     const utl::array_view< float > & YY,
+	     const utl::array_view< float > & ZZ,
+	     const std::size_t leaf_size = 32,
+	     const utl::array_view< float > & WW = {} );
+
+    /**
+     *  @brief Minimum squared separation between objects of two nodes
+     *
+     *  @param n1, n2 the nodes (possibly of different trees)
+     *
+     *  @param box side of the periodic box, used only when periodic = true
+     *
+     *  @return a lower bound on the squared separation, taking the
+     *          minimum-image convention into account when periodic = true
+     */
+    template < bool periodic = false >
+    static float min_dist2 ( const node & n1, const node & n2,
+			     const float box = 0. ) noexcept {
+
+      float d2 = 0.;
+      for ( std::size_t dd = 0; dd < 3; ++dd ) {
+	float gg = std::max( { n2.lo[ dd ] - n1.hi[ dd ], n1.lo[ dd ] - n2.hi[ dd ], 0.f } );
+	if constexpr ( periodic ) {
+	  float gmax = std::max( n2.hi[ dd ] - n1.lo[ dd ], n1.hi[ dd ] - n2.lo[ dd ] );
+	  gg = std::max( std::min( gg, box - gmax ), 0.f );
+	}
+	d2 += gg * gg;
+      }
+      return d2;
+
+    }
+
+    /**
+     *  @brief Maximum squared separation between objects of two nodes
+     *
+     *  @param n1, n2 the nodes (possibly of different trees)
+     *
+     *  @param box side of the periodic box, used only when periodic = true
+     *
+     *  @return an upper bound on the squared separation, taking the
+     *          minimum-image convention into account when periodic = true
+     */
+    template < bool periodic = false >
+    static float max_dist2 ( const node & n1, const node & n2,
+			     const float box = 0. ) noexcept {
+
+      float d2 = 0.;
+      for ( std::size_t dd = 0; dd < 3; ++dd ) {
+	float gg = std::max( n2.hi[ dd ] - n1.lo[ dd ], n1.hi[ dd ] - n2.lo[ dd ] );
+	if constexpr ( periodic ) gg = std::min( gg, 0.5f * box );
+	d2 += gg * gg;
+      }
+      return d2;
+
+    }
+
+  private :
+
+    /// recursively splits node nn
+    void split ( const std::size_t nn, const std::size_t leaf_size );
+
+  }; // endclass kdtree
+
+} // endnamespace utl
+
+#endif //__KDTREE__
@@ -0,0 +1,75 @@
+/**
+ *  @file utilities/include/knn_cdf.h
+ *
+ *  @brief The k-nearest-neighbour distribution engine
+ *
+ *  This file defines the distributions of the distances from many query
+ *  points (e.g. volume-filling randoms) to their k-th nearest neighbours
+ *  in a catalogue, for a list of k: the kNN-CDF statistics. Distances are
+ *  searched on a k-d tree of the catalogue and binned on the fly, so that
+ *  memory does not grow with the number of query points.
+ */
+
+#ifndef __KNN_CDF__
+#define __KNN_CDF__
+
+// STL includes
+#include <vector>
+#include <cstddef>
+
+// Internal includes
+#include <array_view.h>
+
+namespace utl {
+
+  /**
+   *  @brief Cumulative distributions of the k-th neighbour distances
+   *
+   *  For nk values of k and nradius radii.
+   */
+  struct knn_cdf_result {
+
+    /// number of query points
+    std::size_t nquery = 0;
+
+    /// element ik * nradius + ir: query points whose k[ ik ]-th
+    /// nearest neighbour lies at distance r <= radii[ ir ]
+    std::vector< std::size_t > CDF;
+
+  }; // endstruct knn_cdf_result
+
+  //==================================================================================
+  //=================================== kNN-CDF ======================================
+  //==================================================================================
+
+  // Distances from each query point ( QX, QY, QZ ) to its k-th nearest object of the
+  // catalogue ( XX, YY, ZZ ), for every k in kk (positive and strictly increasing),
+  // accumulated in cumulative counts on radii (positive and strictly increasing).
+  // Searches are pruned at radii.back(): neighbours beyond it are never sorted
+  // out. With box > 0, coordinates and queries lie in [0, box) and distances
+  // follow the minimum-image convention (requires radii.back() <= box/2).
+  // Throws std::invalid_argument on invalid k or radii.
+
+  knn_cdf_result knn_cdf ( const utl::array_view< float > & XX,
+			   const utl::array_view< float > & YY,
+			   const utl::array_view< float > & ZZ,
+			   const utl::array_view< float > & QX,
+			   const utl::array_view< float > & QY,
+			   const utl::array_view< float > & QZ,
+			   const std::vector< std::size_t > & kk,
+			   const std::vector< float > & radii,
+			   const float box = 0. );
+
+  knn_cdf_result knn_cdf_omp ( const utl::array_view< float > & XX,
+			       const utl::array_view< float > & YY,
+			       const utl::array_view< float > & ZZ,
+			       const utl::array_view< float > & QX,
+			       const utl::array_view< float > & QY,
+			       const utl::array_view< float > & QZ,
+			       const std::vector< std::size_t > & kk,
+			       const std::vector< float > & radii,
+			       const float box = 0. );
+
+} // endnamespace utl
+
+#endif //__KNN_CDF__
@@ -0,0 +1,245 @@
+/**
+ *  @file utilities/include/pair_cache.h
+ *
+ *  @brief The classes pair_hash and pair_cache
+ *
+ *  This file defines a content-addressed, on-disk cache of pair counts.
+ *  Histograms are stored in small binary files named after a 128-bit
+ *  hash of everything they depend on (coordinates, weights, binning,
+ *  counting mode), so that counts on a catalogue already seen, e.g. the
+ *  RR of a random catalogue re-used across many runs, cost one pass of
+ *  hashing on the catalogue and a file read.
+ */
+
+#ifndef __PAIR_CACHE__
+#define __PAIR_CACHE__
+
+// STL includes
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Internal includes
+#include <array_view.h>
+#include <serialize.h>
+
+namespace utl {
+
+  /// 128-bit key of a cache entry
+  struct pair_key {
+
+    std::uint64_t lo = 0, hi = 0;
+
+    /// 32 hexadecimal digits, used as file name
+    std::string hex () const;
+
+    bool operator== ( const pair_key & other ) const noexcept {
+      return lo == other.lo && hi == other.hi;
+    }
+
+  }; // endstruct pair_key
+
+  /**
+   *  @class pair_hash pair_cache.h "utilities/include/pair_cache.h"
+   *
+   *  @brief Incremental hash of the inputs of a pair count
+   *
+   *  Each update hashes one field and folds its digest in the running
+   *  state together with the field size, so that the key depends on how
+   *  the inputs are split in fields and not only on their concatenation.
+   *  Large buffers are hashed in fixed-size blocks, in parallel: the key
+   *  does not depend on the number of threads. Keys are computed on the
+   *  raw bytes, they are not portable between architectures with
+   *  different endianness.
+   *
+   *  @code
+   *  utl::pair_key key = utl::pair_hash {}
+   *    .update( "d3D_DD" ).update( XX ).update( YY ).update( ZZ )
+   *    .update( rbin ).update_value( box ).update_value( binning ).digest();
+   *  @endcode
+   */
+  class pair_hash {
+
+    std::uint64_t state_lo, state_hi;
+
+  public :
+
+    /// constructor, different seeds give independent keys
+    explicit pair_hash ( const std::uint64_t seed = 0 );
+
+    /// hashes nbytes bytes starting at data
+    pair_hash & update ( const void * data, const std::size_t nbytes );
+
+    /// hashes a string, e.g. the name of the counter
+    pair_hash & update ( const std::string & str ) { return update( str.data(), str.size() ); }
+
+    /// hashes a null-terminated string
+    pair_hash & update ( const char * str ) { return update( std::string { str } ); }
+
+    /// hashes the elements of a viewed array
+    template < typename T >
+    pair_hash & update ( const utl::array_view< T > & vv ) {
+      return update( vv.data(), vv.size() * sizeof( T ) );
+    }
+
+    /// hashes the elements of a vector
+    template < typename T >
+    pair_hash & update ( const std::vector< T > & vv ) {
+      return update( vv.data(), vv.size() * sizeof( T ) );
+    }
+
+    /// hashes the bytes of a trivially-copyable value (a float, an enum, ...)
+    template < typename POD >
+    pair_hash & update_value ( const POD & value ) { return update( &value, sizeof( POD ) ); }
+
+    /// key of the fields hashed so far
+    pair_key digest () const noexcept;
+
+  }; // endclass pair_hash
+
+  /**
+   *  @class pair_counts pair_cache.h "utilities/include/pair_cache.h"
+   *
+   *  @brief Cache entry: the key, the shape and the values of a histogram
+   *
+   *  Serialised with the SerialPOD / SerialVecPOD helpers. T is
+   *  std::size_t for pair counts and double for weighted counts, the
+   *  type is recorded in the entry and checked on reading.
+   */
+  template < typename T >
+  class pair_counts : public Serializable {
+
+  public :
+
+    /// entries written by a different layout are ignored
+    static constexpr std::uint32_t version = 1;
+
+    /// type tag: 'u' for std::size_t, 'f' for double
+    static constexpr char tag = std::is_floating_point< T >::value ? 'f' : 'u';
+
+    pair_key key;
+
+    std::vector< std::size_t > shape;
+
+    std::vector< T > values;
+
+    pair_counts () = default;
+
+    pair_counts ( const pair_key & key,
+		  const std::vector< std::size_t > & shape,
+		  const std::vector< T > & values ) :
+      key { key }, shape { shape }, values { values } {}
+
+    virtual std::size_t serialize_size () const {
+
+      return
+	SerialPOD< std::uint32_t >::serialize_size( version ) +
+	SerialPOD< char >::serialize_size( tag ) +
+	SerialPOD< std::uint64_t >::serialize_size( key.lo ) +
+	SerialPOD< std::uint64_t >::serialize_size( key.hi ) +
+	SerialVecPOD< std::size_t >::serialize_size( shape ) +
+	SerialVecPOD< T >::serialize_size( values );
+
+    }
+
+    virtual char * serialize ( char * data ) const {
+
+      data = SerialPOD< std::uint32_t >::serialize( data, version );
+      data = SerialPOD< char >::serialize( data, tag );
+      data = SerialPOD< std::uint64_t >::serialize( data, key.lo );
+      data = SerialPOD< std::uint64_t >::serialize( data, key.hi );
+      data = SerialVecPOD< std::size_t >::serialize( data, shape );
+      data = SerialVecPOD< T >::serialize( data, values );
+      return data;
+
+    }
+
+    // the caller checks the integrity of the buffer before (see pair_cache::load)
+    virtual const char * deserialize ( const char * data ) {
+
+      std::uint32_t vv;
+      char tt;
+      data = SerialPOD< std::uint32_t >::deserialize( data, vv );
+      data = SerialPOD< char >::deserialize( data, tt );
+      if ( vv != version || tt != tag ) { values.clear(); shape.clear(); return data; }
+      data = SerialPOD< std::uint64_t >::deserialize( data, key.lo );
+      data = SerialPOD< std::uint64_t >::deserialize( data, key.hi );
+      data = SerialVecPOD< std::size_t >::deserialize( data, shape );
+      data = SerialVecPOD< T >::deserialize( data, values );
+      return data;
+
+    }
+
+  }; // endclass pair_counts
+
+  /**
+   *  @class pair_cache pair_cache.h "utilities/include/pair_cache.h"
+   *
+   *  @brief Directory of cached histograms, one file per key
+   *
+   *  Each file holds a serialised pair_counts followed by a checksum of
+   *  its bytes: truncated or corrupted files, and files of a different
+   *  type or layout version, are treated as missing. Files are written
+   *  to a temporary name and renamed, so that concurrent jobs sharing
+   *  the directory never read a partially written entry.
+   */
+  class pair_cache {
+
+    std::string dir;
+
+  public :
+
+    /// cache in directory (created if it does not exist)
+    explicit pair_cache ( const std::string & directory );
+
+    const std::string & directory () const noexcept { return dir; }
+
+    /// file holding the entry of key
+    std::string path ( const pair_key & key ) const;
+
+    /**
+     *  @brief Reads an entry
+     *
+     *  @return false, leaving shape and values untouched, if there is no
+     *          valid entry of type T for key
+     */
+    template < typename T >
+    bool load ( const pair_key & key,
+		std::vector< std::size_t > & shape,
+		std::vector< T > & values ) const;
+
+    /// writes an entry, throws std::runtime_error if the file cannot be written
+    template < typename T >
+    void store ( const pair_key & key,
+		 const std::vector< std::size_t > & shape,
+		 const std::vector< T > & values ) const;
+
+    /**
+     *  @brief Cached evaluation of a counter
+     *
+     *  @param key key of the inputs of the counter
+     *
+     *  @param count callable returning the std::vector< T > histogram,
+     *         only invoked if the entry is missing
+     *
+     *  @return the histogram
+     */
+    template < typename T, typename F >
+    std::vector< T > fetch ( const pair_key & key, F && count ) const {
+
+      std::vector< std::size_t > shape;
+      std::vector< T > values;
+      if ( load( key, shape, values ) ) return values;
+      values = count();
+      store( key, { values.size() }, values );
+      return values;
+
+    }
+
+  }; // endclass pair_cache
+
+} // endnamespace utl
+
+#endif //__PAIR_CACHE__
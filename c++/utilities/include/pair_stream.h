@@ -0,0 +1,172 @@
+/**
+ *  @file utilities/include/pair_stream.h
+ *
+ *  @brief The class coordinate_file and the out-of-core pair counters
+ *
+ *  This file defines the pair counters of catalogues too large to be
+ *  held in memory as coordinate vectors: catalogues are memory-mapped
+ *  from flat binary files and counted in chunks, one pair of chunks at
+ *  a time, with a memory footprint bounded by the chunk size. Partial
+ *  histograms are checkpointed on disk, so that interrupted jobs resume
+ *  from the last pair of chunks completed.
+ */
+
+#ifndef __PAIR_STREAM__
+#define __PAIR_STREAM__
+
+// STL includes
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// Internal includes
+#include <binning.h>
+#include <pair_cache.h>
+
+namespace utl {
+
+  /**
+   *  @class coordinate_file pair_stream.h "utilities/include/pair_stream.h"
+   *
+   *  @brief Read-only memory map of a flat binary catalogue
+   *
+   *  The file holds native-endian float32 records of ncol values per
+   *  object, ( x, y, z ) or ( x, y, z, w ), with no header: the layout
+   *  written by numpy.ndarray.tofile on a C-ordered array of shape
+   *  ( N, ncol ) and dtype float32. Chunks are copied to the
+   *  structure-of-arrays layout of the counters and their pages are
+   *  released after reading, so that resident memory stays bounded.
+   */
+  class coordinate_file {
+
+    std::string fname;
+
+    std::size_t ncol = 3, nobj = 0;
+
+    /// mapped records, nullptr for empty files
+    const float * base = nullptr;
+
+    std::size_t nbytes = 0;
+
+  public :
+
+    /// maps the file at path, throws std::runtime_error if it cannot be mapped
+    /// and std::invalid_argument if its size is not a multiple of the record size
+    coordinate_file ( const std::string & path, const std::size_t ncol = 3 );
+
+    ~coordinate_file ();
+
+    coordinate_file ( const coordinate_file & ) = delete;
+
+    coordinate_file & operator= ( const coordinate_file & ) = delete;
+
+    const std::string & path () const noexcept { return fname; }
+
+    /// number of objects
+    std::size_t size () const noexcept { return nobj; }
+
+    /// values per object, 3 or 4
+    std::size_t columns () const noexcept { return ncol; }
+
+    /// whether the records carry a weight
+    bool weighted () const noexcept { return ncol == 4; }
+
+    /**
+     *  @brief Copies the objects in [ begin, end )
+     *
+     *  @param xx, yy, zz output coordinates
+     *
+     *  @param ww output weights, left empty for files without weights
+     */
+    void read ( const std::size_t begin, const std::size_t end,
+		std::vector< float > & xx,
+		std::vector< float > & yy,
+		std::vector< float > & zz,
+		std::vector< float > & ww ) const;
+
+    /// hashes the identity of the file (path, size, modification time) in hh
+    void hash ( utl::pair_hash & hh ) const;
+
+  }; // endclass coordinate_file
+
+  /// default objects per chunk, 2^24 (256 MiB of coordinates and weights)
+  constexpr std::size_t default_chunk_size = std::size_t( 1 ) << 24;
+
+  //==================================================================================
+  //============================== Out-of-core counters ==============================
+  //==================================================================================
+
+  // Same histograms as d3D_DD/d3D_DR on the catalogues of the files. Catalogues
+  // are split in chunks of chunk_size objects and each pair of chunks is counted
+  // with the cell-list counters, so that at most two chunks (and their cell lists)
+  // are in memory at once. When checkpoint_dir is not empty, the partial histogram
+  // is stored there (see utl::pair_cache) after each pair of chunks, keyed by the
+  // files, the binning and the chunk size: a count interrupted and started again
+  // with the same arguments resumes from the last pair of chunks completed, and a
+  // count already completed is read back. Files are identified by path, size and
+  // modification time, not by content. The weighted versions require files with
+  // weights, the unweighted ones ignore them.
+
+  std::vector< std::size_t > d3D_DD_stream ( const coordinate_file & file,
+					     const std::vector< float > & rbin,
+					     const float box = 0.,
+					     const utl::binning::scheme binning = utl::binning::scheme::log,
+					     const std::size_t chunk_size = default_chunk_size,
+					     const std::string & checkpoint_dir = "" );
+
+  std::vector< std::size_t > d3D_DD_stream_omp ( const coordinate_file & file,
+						 const std::vector< float > & rbin,
+						 const float box = 0.,
+						 const utl::binning::scheme binning = utl::binning::scheme::log,
+						 const std::size_t chunk_size = default_chunk_size,
+						 const std::string & checkpoint_dir = "" );
+
+  std::vector< std::size_t > d3D_DR_stream ( const coordinate_file & file1,
+					     const coordinate_file & file2,
+					     const std::vector< float > & rbin,
+					     const float box = 0.,
+					     const utl::binning::scheme binning = utl::binning::scheme::log,
+					     const std::size_t chunk_size = default_chunk_size,
+					     const std::string & checkpoint_dir = "" );
+
+  std::vector< std::size_t > d3D_DR_stream_omp ( const coordinate_file & file1,
+						 const coordinate_file & file2,
+						 const std::vector< float > & rbin,
+						 const float box = 0.,
+						 const utl::binning::scheme binning = utl::binning::scheme::log,
+						 const std::size_t chunk_size = default_chunk_size,
+						 const std::string & checkpoint_dir = "" );
+
+  std::vector< double > wd3D_DD_stream ( const coordinate_file & file,
+					 const std::vector< float > & rbin,
+					 const float box = 0.,
+					 const utl::binning::scheme binning = utl::binning::scheme::log,
+					 const std::size_t chunk_size = default_chunk_size,
+					 const std::string & checkpoint_dir = "" );
+
+  std::vector< double > wd3D_DD_stream_omp ( const coordinate_file & file,
+					     const std::vector< float > & rbin,
+					     const float box = 0.,
+					     const utl::binning::scheme binning = utl::binning::scheme::log,
+					     const std::size_t chunk_size = default_chunk_size,
+					     const std::string & checkpoint_dir = "" );
+
+  std::vector< double > wd3D_DR_stream ( const coordinate_file & file1,
+					 const coordinate_file & file2,
+					 const std::vector< float > & rbin,
+					 const float box = 0.,
+					 const utl::binning::scheme binning = utl::binning::scheme::log,
+					 const std::size_t chunk_size = default_chunk_size,
+					 const std::string & checkpoint_dir = "" );
+
+  std::vector< double > wd3D_DR_stream_omp ( const coordinate_file & file1,
+					     const coordinate_file & file2,
+					     const std::vector< float > & rbin,
+					     const float box = 0.,
+					     const utl::binning::scheme binning = utl::binning::scheme::log,
+					     const std::size_t chunk_size = default_chunk_size,
+					     const std::string & checkpoint_dir = "" );
+
+} // endnamespace utl
+
+#endif //__PAIR_STREAM__
@@ -0,0 +1,64 @@
+/**
+ *  @file utilities/include/separation.h
+ *
+ *  @brief Separation between coordinates, with open or periodic boundaries
+ */
+
+#ifndef __SEPARATION__
+#define __SEPARATION__
+
+// STL includes
+#include <cmath>
+
+namespace utl {
+
+  /**
+   *  @brief Separation along one axis between two coordinates.
+   *
+   *  With periodic = true the minimum-image convention is applied,
+   *  assuming both coordinates lie in the interval [0, box).
+   *  With periodic = false the difference is returned as is, the
+   *  box argument is ignored and the open-boundary path costs nothing.
+   *
+   *  @param dd difference between the two coordinates
+   *
+   *  @param box side of the periodic box
+   *
+   *  @return the (signed if open, absolute if periodic) separation
+   */
+  template < bool periodic >
+  inline float separation ( const float dd, const float box ) noexcept {
+
+    if constexpr ( periodic ) {
+      float ad = std::fabs( dd );
+      return ad < 0.5f * box ? ad : box - ad;
+    }
+    else return dd;
+
+  }
+
+  /**
+   *  @brief Signed separation along one axis between two coordinates.
+   *
+   *  As separation, but the minimum image keeps its sign: needed when
+   *  the direction of the separation matters (e.g. the angles of the
+   *  three-point counters), not only its modulus.
+   *
+   *  @param dd difference between the two coordinates
+   *
+   *  @param box side of the periodic box
+   *
+   *  @return the signed separation
+   */
+  template < bool periodic >
+  inline float signed_separation ( const float dd, const float box ) noexcept {
+
+    if constexpr ( periodic )
+      return dd > 0.5f * box ? dd - box : ( dd < -0.5f * box ? dd + box : dd );
+    else return dd;
+
+  }
+
+} // endnamespace utl
+
+#endif //__SEPARATION__
@@ -0,0 +1,91 @@
+/**
+ *  @file utilities/include/simd_kernel.h
+ *
+ *  @brief Vectorised distance-and-bin kernel for the pair counters
+ *
+ *  The kernel bins the separations between one object and a block of
+ *  objects stored in structure-of-arrays layout, comparing squared
+ *  separations with squared bin edges (no sqrt nor log per pair).
+ *  The instruction set (AVX-512, AVX2, SSE2 or plain scalar code) is
+ *  chosen at runtime, on first use, depending on the host CPU.
+ */
+
+#ifndef __SIMD_KERNEL__
+#define __SIMD_KERNEL__
+
+// STL includes
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace utl::simd {
+
+  /**
+   *  @brief Cumulative counts of the separations from one object
+   *
+   *  Adds to cum[ k ], for k = 0, ..., nedge - 2, the number of objects jj
+   *  in [0, nn) such that edges2[ k ] <= d2 <= edges2[ nedge - 1 ], where d2
+   *  is the squared separation between ( xi, yi, zi ) and ( xx[jj], yy[jj], zz[jj] ).
+   *  The histogram of the pairs is then obtained with cumulative_to_histogram().
+   *
+   *  @param xi, yi, zi coordinates of the first object
+   *
+   *  @param xx, yy, zz coordinates of the block of objects
+   *
+   *  @param nn number of objects in the block
+   *
+   *  @param edges2 squared bin edges, sorted in ascending order
+   *         (see utl::binning::edge_table::edges2())
+   *
+   *  @param nedge number of edges (number of bins + 1)
+   *
+   *  @param box side of the periodic box (0 for open boundaries)
+   *
+   *  @param cum cumulative counts (size nedge - 1)
+   */
+  void count_cumulative ( const float xi, const float yi, const float zi,
+			  const float * xx, const float * yy, const float * zz,
+			  const std::size_t nn,
+			  const float * edges2, const std::size_t nedge,
+			  const float box,
+			  std::size_t * cum );
+
+  /**
+   *  @brief Weighted cumulative counts of the separations from one object
+   *
+   *  As the unweighted version, but adds to cum[ k ] the products
+   *  wi * ww[ jj ] of the weights instead of one per pair, in double
+   *  precision. The vector kernels sum the weights of a block before
+   *  adding them, in an order that depends on the instruction set:
+   *  results agree across instruction sets to rounding (relative
+   *  differences ~1e-14), not bit by bit as the unweighted counts do.
+   *
+   *  @param wi weight of the first object
+   *
+   *  @param ww weights of the block of objects
+   *
+   *  (see the unweighted version for the other parameters)
+   */
+  void count_cumulative ( const float xi, const float yi, const float zi, const float wi,
+			  const float * xx, const float * yy, const float * zz,
+			  const float * ww,
+			  const std::size_t nn,
+			  const float * edges2, const std::size_t nedge,
+			  const float box,
+			  double * cum );
+
+  /// converts in place cumulative counts from count_cumulative() to a histogram
+  template < typename T >
+  inline void cumulative_to_histogram ( std::vector< T > & cum ) noexcept {
+
+    for ( std::size_t ib = 0; ib + 1 < cum.size(); ++ib )
+      cum[ ib ] -= cum[ ib + 1 ];
+
+  }
+
+  /// name of the instruction set selected at runtime
+  std::string isa_name ();
+
+} // endnamespace utl::simd
+
+#endif //__SIMD_KERNEL__
@@ -0,0 +1,136 @@
+/**
+ *  @file utilities/include/thread_histogram.h
+ *
+ *  @brief Per-thread histograms and load balancing for the parallel pair counters
+ *
+ *  Each thread accumulates in its own copy of the histogram, padded to a
+ *  whole number of cache lines so that no two threads ever write on the same
+ *  line; copies are summed once at the end of the parallel region.
+ */
+
+#ifndef __THREAD_HISTOGRAM__
+#define __THREAD_HISTOGRAM__
+
+// STL includes
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace utl {
+
+  /**
+   *  @class thread_histogram thread_histogram.h "utilities/include/thread_histogram.h"
+   *
+   *  @brief Set of cache-line padded histograms, one per thread
+   *
+   *  Typical use:
+   *  @code
+   *  utl::thread_histogram< std::size_t > hist ( nbin, omp_get_max_threads() );
+   *  #pragma omp parallel
+   *  {
+   *    std::size_t * local = hist.local( omp_get_thread_num() );
+   *    // ... local[ ib ] += 1 ...
+   *  }
+   *  std::vector< std::size_t > NN = hist.reduce();
+   *  @endcode
+   */
+  template < typename T >
+  class thread_histogram {
+
+    /// size of a cache line in bytes
+    static constexpr std::size_t line = 64;
+
+    /// number of bins
+    std::size_t nbin;
+
+    /// distance, in elements, between the histograms of two threads
+    std::size_t stride;
+
+    /// number of histograms
+    std::size_t nthreads;
+
+    /// storage, over-allocated by one line to allow alignment
+    std::vector< T > buffer;
+
+    /// first cache-line aligned element of buffer
+    T * base;
+
+  public :
+
+    /**
+     *  @brief Constructor
+     *
+     *  @param nbin number of bins of each histogram
+     *
+     *  @param nthreads number of histograms
+     */
+    thread_histogram ( const std::size_t nbin, const std::size_t nthreads ) :
+      nbin { nbin },
+      stride { ( ( nbin * sizeof( T ) + line - 1 ) / line ) * line / sizeof( T ) },
+      nthreads { nthreads > 0 ? nthreads : 1 } {
+
+      const std::size_t pad = line / sizeof( T );
+      buffer.assign( this->nthreads * stride + pad, T() );
+      std::uintptr_t addr = reinterpret_cast< std::uintptr_t >( buffer.data() );
+      base = buffer.data() + ( ( line - addr % line ) % line ) / sizeof( T );
+
+    }
+
+    // the base pointer refers to the owned buffer
+    thread_histogram ( const thread_histogram & ) = delete;
+    thread_histogram & operator= ( const thread_histogram & ) = delete;
+
+    /// histogram of thread tid
+    T * local ( const std::size_t tid ) noexcept { return base + tid * stride; }
+
+    /// sum of the histograms of all the threads
+    std::vector< T > reduce () const {
+
+      std::vector< T > out ( nbin );
+      for ( std::size_t tt = 0; tt < nthreads; ++tt )
+	for ( std::size_t ib = 0; ib < nbin; ++ib )
+	  out[ ib ] += base[ tt * stride + ib ];
+      return out;
+
+    }
+
+  }; // endclass thread_histogram
+
+  /**
+   *  @brief Balanced partition of a triangular loop
+   *
+   *  Splits the outer loop of
+   *  for ( ii = 0; ii < size; ++ii ) for ( jj = ii + 1; jj < size; ++jj )
+   *  in nparts contiguous ranges [ bounds[ p ], bounds[ p + 1 ] ) containing
+   *  approximately the same number of ( ii, jj ) pairs.
+   *
+   *  @param size number of objects
+   *
+   *  @param nparts number of ranges
+   *
+   *  @return vector of nparts + 1 bounds
+   */
+  inline std::vector< std::size_t > triangular_partition ( const std::size_t size,
+							   const std::size_t nparts ) {
+
+    std::vector< std::size_t > bounds ( nparts + 1, size );
+    bounds[ 0 ] = 0;
+    // pairs with outer index < ii: P( ii ) = ii * size - ii * ( ii + 1 ) / 2,
+    // bounds[ pp ] solves P( ii ) = pp / nparts * P( size )
+    const double nn = size, total = 0.5 * nn * ( nn - 1 );
+    for ( std::size_t pp = 1; pp < nparts; ++pp ) {
+      double target = total * pp / nparts;
+      double bb = 2. * nn - 1.;
+      double ii = 0.5 * ( bb - std::sqrt( std::max( bb * bb - 8. * target, 0. ) ) );
+      std::size_t ib = std::size_t( std::llround( ii ) );
+      bounds[ pp ] = std::min( std::max( ib, bounds[ pp - 1 ] ), size );
+    }
+    return bounds;
+
+  }
+
+} // endnamespace utl
+
+#endif //__THREAD_HISTOGRAM__
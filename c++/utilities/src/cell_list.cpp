@@ -0,0 +1,109 @@
+#include <cell_list.h>
+#include <limits>
+#include <stdexcept>
+
+//==================================================================================
+
+utl::grid_geometry::grid_geometry ( const utl::array_view< float > & X1,
+				    const utl::array_view< float > & Y1,
+				    const utl::array_view< float > & Z1,
+				    const utl::array_view< float > & X2,
+				    const utl::array_view< float > & Y2,
+				    const utl::array_view< float > & Z2,
+				    const float rmax,
+				    const float box ) : rmax { rmax }, box { box } {
+
+  // bounding box of the two catalogues
+  std::array< float, 3 > hi;
+  lo.fill( std::numeric_limits< float >::max() );
+  hi.fill( std::numeric_limits< float >::lowest() );
+  auto extend = [ & ] ( const utl::array_view< float > & VV, const std::size_t dd ) {
+    for ( auto && vv : VV ) {
+      lo[ dd ] = std::min( lo[ dd ], vv );
+      hi[ dd ] = std::max( hi[ dd ], vv );
+    }
+  };
+  extend( X1, 0 ); extend( Y1, 1 ); extend( Z1, 2 );
+  extend( X2, 0 ); extend( Y2, 1 ); extend( Z2, 2 );
+
+  std::size_t nobj = X1.size() + X2.size();
+  if ( nobj == 0 ) { lo.fill( 0. ); hi.fill( 0. ); }
+  if ( box > 0. ) { lo.fill( 0. ); hi.fill( box ); }
+
+  // expected number of objects in a volume rmax^3
+  double volume = 1.;
+  for ( std::size_t dd = 0; dd < 3; ++dd )
+    volume *= std::max( double( hi[ dd ] - lo[ dd ] ), double( rmax ) );
+  double occupancy = nobj * double( rmax ) * rmax * rmax / volume;
+  reach = occupancy > 64. ? 2 : 1;
+
+  // cell side, enlarged when needed to keep the number of cells
+  // below a few times the number of objects
+  double cell = rmax / reach;
+  if ( !( cell > 0. ) ) cell = 1.;
+  const double max_cells = std::max( 8. * nobj, 1. );
+  while ( true ) {
+    double ncells = 1.;
+    for ( std::size_t dd = 0; dd < 3; ++dd )
+      ncells *= std::max( std::ceil( ( hi[ dd ] - lo[ dd ] ) / cell ), 1. );
+    if ( ncells <= max_cells ) break;
+    cell *= std::cbrt( ncells / max_cells ) * 1.001;
+  }
+
+  // in a periodic box cells have to tile the box exactly
+  for ( std::size_t dd = 0; dd < 3; ++dd ) {
+    if ( box > 0. ) {
+      nc[ dd ] = std::size_t( std::max( std::floor( box / cell ), 1. ) );
+      side[ dd ] = box / nc[ dd ];
+    }
+    else {
+      nc[ dd ] = std::size_t( std::max( std::ceil( ( hi[ dd ] - lo[ dd ] ) / cell ), 1. ) );
+      side[ dd ] = cell;
+    }
+  }
+
+}
+
+//==================================================================================
+
+utl::cell_list::cell_list ( const utl::array_view< float > & XX,
+			    const utl::array_view< float > & YY,
+			    const utl::array_view< float > & ZZ,
+			    const grid_geometry & geometry,
+			    const utl::array_view< float > & WW ) : geo { geometry } {
+
+  const std::size_t size = XX.size();
+  const std::size_t ncells = geo.size();
+  if ( YY.size() != size || ZZ.size() != size || ( !WW.empty() && WW.size() != size ) )
+    throw std::length_error( "coordinates and weights should have the same size." );
+
+  // cell of each object
+  std::vector< std::size_t > cell ( size );
+  start.assign( ncells + 1, 0 );
+  for ( std::size_t ii = 0; ii < size; ++ii ) {
+    cell[ ii ] = geo.index( geo.locate( XX[ ii ], 0 ),
+			    geo.locate( YY[ ii ], 1 ),
+			    geo.locate( ZZ[ ii ], 2 ) );
+    ++start[ cell[ ii ] + 1 ];
+  }
+
+  // counting-sort by cell
+  for ( std::size_t cc = 0; cc < ncells; ++cc )
+    start[ cc + 1 ] += start[ cc ];
+  std::vector< std::size_t > pos { start.begin(), start.end() - 1 };
+  xx.resize( size ); yy.resize( size ); zz.resize( size ); idx.resize( size );
+  for ( std::size_t ii = 0; ii < size; ++ii ) {
+    std::size_t jj = pos[ cell[ ii ] ]++;
+    xx[ jj ] = XX[ ii ];
+    yy[ jj ] = YY[ ii ];
+    zz[ jj ] = ZZ[ ii ];
+    idx[ jj ] = ii;
+  }
+  if ( !WW.empty() ) {
+    ww.resize( size );
+    for ( std::size_t jj = 0; jj < size; ++jj ) ww[ jj ] = WW[ idx[ jj ] ];
+  }
+
+}
+
+//==================================================================================
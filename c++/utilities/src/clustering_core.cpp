@@ -1,5 +1,63 @@
 #include <clustering_core.h>
 #include <omp.h>
+#include <simd_kernel.h>
+#include <thread_histogram.h>
+#include <type_traits>
+#include <stdexcept>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+//==================================================================================
+
+namespace {
+
+  // The parallel counters accumulate in per-thread padded histograms (no atomics);
+  // triangular (DD) loops are split in chunks_per_thread * nthreads chunks holding
+  // the same number of pairs, scheduled dynamically.
+  constexpr std::size_t chunks_per_thread = 8;
+
+  // number of threads of a parallel region opened with if(omp)
+  inline std::size_t nthreads ( const bool omp ) {
+    return omp ? omp_get_max_threads() : 1;
+  }
+
+  // Weighted counters sum the products w_i * w_j of the pair weights in
+  // double precision, unweighted counters count the pairs
+  template < bool weighted >
+  using count_t = std::conditional_t< weighted, double, std::size_t >;
+
+  // contribution of pair ( ii, jj ) to the histogram
+  template < bool weighted >
+  inline count_t< weighted > pair_weight ( const utl::array_view< float > & W1, const std::size_t ii,
+					   const utl::array_view< float > & W2, const std::size_t jj ) {
+    if constexpr ( weighted ) return double( W1[ ii ] ) * W2[ jj ];
+    else return 1;
+  }
+
+  // The minimum image is the only image of a pair closer than half the box:
+  // beyond box / 2 the periodic counters would miss the other images
+  inline void check_periodic ( const float rmax, const float box ) {
+    if ( box > 0. && rmax > 0.5f * box )
+      throw std::invalid_argument( "periodic counts require separations up to box / 2." );
+  }
+
+  // empty bins are left to the binning policy, which rejects them
+  inline void check_periodic ( const std::vector< float > & bins, const float box ) {
+    if ( !bins.empty() ) check_periodic( bins.back(), box );
+  }
+
+  // the arrays of a catalogue, coordinates and weights, are read with the same
+  // indices: a shorter one would be read past its end
+  template < typename... V >
+  inline void check_sizes ( const utl::array_view< float > & XX, const V &... VV ) {
+    if ( ( ( VV.size() != XX.size() ) || ... ) )
+      throw std::length_error( "coordinates and weights should have the same size." );
+  }
+
+} // endnamespace
+
+//==================================================================================
 
 float utl::haversine_th ( const float & RA1, const float Dec1,
 			  const float & RA2, const float Dec2 ) {
@@ -27,133 +85,226 @@ float utl::haversine_th ( const float & RA1, const float Dec1,
 //======================================= 2D =======================================
 //==================================================================================
 
-std::vector< std::size_t > utl::d2D_DD ( const std::vector< float > & XX,
-					 const std::vector< float > & YY,
-					 const std::vector< float > & rbin ) {
+namespace {
+
+  // the periodic flag selects at compile time the minimum-image separation,
+  // the weighted flag the pair weights (WW is ignored when false),
+  // bins_t is one of the policies of binning.h
+
+  template < bool periodic, bool weighted, typename bins_t >
+  std::vector< count_t< weighted > > kernel_2D_DD ( const utl::array_view< float > & XX,
+						    const utl::array_view< float > & YY,
+						    const utl::array_view< float > & WW,
+						    const bins_t & bins,
+					    const float box,
+					    const bool omp ) {
   
-  std::size_t size = XX.size();
+    std::size_t size = XX.size();
   
-  std::vector< std::size_t > NDD ( rbin.size() );
-  float rmin = rbin.front(), rmax = rbin.back();
-  float delta = std::log10(rmax/rmin)/rbin.size();
+    const std::vector< std::size_t > chunks =
+      utl::triangular_partition( size, chunks_per_thread * nthreads( omp ) );
+    utl::thread_histogram< count_t< weighted > > NDD ( bins.size(), nthreads( omp ) );
 
-  for ( std::size_t ii = 0; ii < size; ++ii ) {
-    float dx, dy, rr;
-    std::size_t ib;
-    for ( std::size_t jj = ii+1; jj < size; ++jj ) {
-      dx = XX[ii]-XX[jj];
-      dy = YY[ii]-YY[jj];
-      rr = std::sqrt( dx*dx + dy*dy );
+#pragma omp parallel if(omp)
+    {
+      count_t< weighted > * local = NDD.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 1)
+      for ( std::size_t ic = 0; ic < chunks.size() - 1; ++ic )
+	for ( std::size_t ii = chunks[ ic ]; ii < chunks[ ic + 1 ]; ++ii ) {
+	  float dx, dy;
+	  long ib;
+	  for ( std::size_t jj = ii+1; jj < size; ++jj ) {
+	    dx = utl::separation< periodic >( XX[ii]-XX[jj], box );
+	    dy = utl::separation< periodic >( YY[ii]-YY[jj], box );
 
-      if ( rmin <= rr && rr <= rmax ) {
-	ib = int( std::log10( rr / rmin ) / delta );
-	NDD[ ib ] += 1;
-      }
+	    ib = bins.bin( dx*dx + dy*dy );
+	    if ( ib >= 0 ) local[ ib ] += pair_weight< weighted >( WW, ii, WW, jj );
       
-    } // endfor jj
-  } // endfor ii
+	  } // endfor jj
+	} // endfor ii, ic
+    } // end parallel
   
-  return NDD;
+    return NDD.reduce();
   
-}
+  }
 
-std::vector< std::size_t > utl::d2D_DD_omp ( const std::vector< float > & XX,
-					     const std::vector< float > & YY,
-					     const std::vector< float > & rbin ) {
+  template < bool periodic, bool weighted, typename bins_t >
+  std::vector< count_t< weighted > > kernel_2D_DR ( const utl::array_view< float > & X1,
+						    const utl::array_view< float > & Y1,
+						    const utl::array_view< float > & W1,
+						    const utl::array_view< float > & X2,
+						    const utl::array_view< float > & Y2,
+						    const utl::array_view< float > & W2,
+						    const bins_t & bins,
+					    const float box,
+					    const bool omp ) {
   
-  std::size_t size = XX.size();
+    std::size_t size1 = X1.size();
+    std::size_t size2 = X2.size();
   
-  std::vector< std::size_t > NDD ( rbin.size() );
-  float rmin = rbin.front(), rmax = rbin.back();
-  float delta = std::log10(rmax/rmin)/rbin.size();
+    utl::thread_histogram< count_t< weighted > > NDR ( bins.size(), nthreads( omp ) );
 
-#pragma omp parallel for shared(NDD)
-  for ( std::size_t ii = 0; ii < size; ++ii ) {
-    float dx, dy, rr;
-    std::size_t ib;
-    for ( std::size_t jj = ii+1; jj < size; ++jj ) {
-      dx = XX[ii]-XX[jj];
-      dy = YY[ii]-YY[jj];
-      rr = std::sqrt( dx*dx + dy*dy );
+#pragma omp parallel if(omp)
+    {
+      count_t< weighted > * local = NDR.local( omp_get_thread_num() );
+#pragma omp for schedule(static)
+      for ( std::size_t ii = 0; ii < size1; ++ii ) {
+	float dx, dy;
+	long ib;
+	for ( std::size_t jj = 0; jj < size2; ++jj ) {
+	  dx = utl::separation< periodic >( X1[ii]-X2[jj], box );
+	  dy = utl::separation< periodic >( Y1[ii]-Y2[jj], box );
 
-      if ( rmin <= rr && rr <= rmax ) {
-	ib = int( std::log10( rr / rmin ) / delta );
-#pragma omp atomic
-	NDD[ ib ] += 1;
-      }
+	  ib = bins.bin( dx*dx + dy*dy );
+	  if ( ib >= 0 ) local[ ib ] += pair_weight< weighted >( W1, ii, W2, jj );
       
-    } // endfor jj
-  } // endfor ii
+	} // endfor jj
+      } // endfor ii
+    } // end parallel
   
-  return NDD;
+    return NDR.reduce();
   
-}
+  }
+
+} // endnamespace
 
-std::vector< std::size_t > utl::d2D_DR ( const std::vector< float > & X1,
-					 const std::vector< float > & Y1,
-					 const std::vector< float > & X2,
-					 const std::vector< float > & Y2,
-					 const std::vector< float > & rbin ) {
+std::vector< std::size_t > utl::d2D_DD ( const utl::array_view< float > & XX,
+					 const utl::array_view< float > & YY,
+					 const std::vector< float > & rbin,
+					 const float box,
+					 const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_2D_DD< true, false >( XX, YY, {}, bins, box, false ) :
+      kernel_2D_DD< false, false >( XX, YY, {}, bins, box, false );
+  } );
   
-  std::size_t size1 = X1.size();
-  std::size_t size2 = X2.size();
+}
+
+std::vector< std::size_t > utl::d2D_DD_omp ( const utl::array_view< float > & XX,
+					     const utl::array_view< float > & YY,
+					     const std::vector< float > & rbin,
+					     const float box,
+					     const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_2D_DD< true, false >( XX, YY, {}, bins, box, true ) :
+      kernel_2D_DD< false, false >( XX, YY, {}, bins, box, true );
+  } );
   
-  std::vector< std::size_t > NDR ( rbin.size() );
-  float rmin = rbin.front(), rmax = rbin.back();
-  float delta = std::log10(rmax/rmin)/rbin.size();
+}
 
-  for ( std::size_t ii = 0; ii < size1; ++ii ) {
-    float dx, dy, rr;
-    std::size_t ib;
-    for ( std::size_t jj = 0; jj < size2; ++jj ) {
-      dx = X1[ii]-X2[jj];
-      dy = Y1[ii]-Y2[jj];
-      rr = std::sqrt( dx*dx + dy*dy );
+std::vector< std::size_t > utl::d2D_DR ( const utl::array_view< float > & X1,
+					 const utl::array_view< float > & Y1,
+					 const utl::array_view< float > & X2,
+					 const utl::array_view< float > & Y2,
+					 const std::vector< float > & rbin,
+					 const float box,
+					 const utl::binning::scheme binning ) {
 
-      if ( rmin <= rr && rr <= rmax ) {
-	ib = int( std::log10( rr / rmin ) / delta );
-	NDR[ ib ] += 1;
-      }
-      
-    } // endfor jj
-  } // endfor ii
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_2D_DR< true, false >( X1, Y1, {}, X2, Y2, {}, bins, box, false ) :
+      kernel_2D_DR< false, false >( X1, Y1, {}, X2, Y2, {}, bins, box, false );
+  } );
   
-  return NDR;
+}
+
+std::vector< std::size_t > utl::d2D_DR_omp ( const utl::array_view< float > & X1,
+					     const utl::array_view< float > & Y1,
+					     const utl::array_view< float > & X2,
+					     const utl::array_view< float > & Y2,
+					     const std::vector< float > & rbin,
+					     const float box,
+					     const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_2D_DR< true, false >( X1, Y1, {}, X2, Y2, {}, bins, box, true ) :
+      kernel_2D_DR< false, false >( X1, Y1, {}, X2, Y2, {}, bins, box, true );
+  } );
   
 }
 
-std::vector< std::size_t > utl::d2D_DR_omp ( const std::vector< float > & X1,
-					     const std::vector< float > & Y1,
-					     const std::vector< float > & X2,
-					     const std::vector< float > & Y2,
-					     const std::vector< float > & rbin ) {
+std::vector< double > utl::wd2D_DD ( const utl::array_view< float > & XX,
+				     const utl::array_view< float > & YY,
+				     const utl::array_view< float > & WW,
+				     const std::vector< float > & rbin,
+				     const float box,
+				     const utl::binning::scheme binning ) {
+
+  check_sizes( XX, YY, WW );
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_2D_DD< true, true >( XX, YY, WW, bins, box, false ) :
+      kernel_2D_DD< false, true >( XX, YY, WW, bins, box, false );
+  } );
   
-  std::size_t size1 = X1.size();
-  std::size_t size2 = X2.size();
+}
+
+std::vector< double > utl::wd2D_DD_omp ( const utl::array_view< float > & XX,
+					 const utl::array_view< float > & YY,
+					 const utl::array_view< float > & WW,
+					 const std::vector< float > & rbin,
+					 const float box,
+					 const utl::binning::scheme binning ) {
+
+  check_sizes( XX, YY, WW );
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_2D_DD< true, true >( XX, YY, WW, bins, box, true ) :
+      kernel_2D_DD< false, true >( XX, YY, WW, bins, box, true );
+  } );
   
-  std::vector< std::size_t > NDR ( rbin.size() );
-  float rmin = rbin.front(), rmax = rbin.back();
-  float delta = std::log10(rmax/rmin)/rbin.size();
+}
 
-#pragma omp parallel for shared(NDR)
-  for ( std::size_t ii = 0; ii < size1; ++ii ) {
-    float dx, dy, rr;
-    std::size_t ib;
-    for ( std::size_t jj = 0; jj < size2; ++jj ) {
-      dx = X1[ii]-X2[jj];
-      dy = Y1[ii]-Y2[jj];
-      rr = std::sqrt( dx*dx + dy*dy );
+std::vector< double > utl::wd2D_DR ( const utl::array_view< float > & X1,
+				     const utl::array_view< float > & Y1,
+				     const utl::array_view< float > & W1,
+				     const utl::array_view< float > & X2,
+				     const utl::array_view< float > & Y2,
+				     const utl::array_view< float > & W2,
+				     const std::vector< float > & rbin,
+				     const float box,
+				     const utl::binning::scheme binning ) {
 
-      if ( rmin <= rr && rr <= rmax ) {
-	ib = int( std::log10( rr / rmin ) / delta );
-#pragma omp atomic
-	NDR[ ib ] += 1;
-      }
-      
-    } // endfor jj
-  } // endfor ii
+  check_sizes( X1, Y1, W1 );
+  check_sizes( X2, Y2, W2 );
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_2D_DR< true, true >( X1, Y1, W1, X2, Y2, W2, bins, box, false ) :
+      kernel_2D_DR< false, true >( X1, Y1, W1, X2, Y2, W2, bins, box, false );
+  } );
   
-  return NDR;
+}
+
+std::vector< double > utl::wd2D_DR_omp ( const utl::array_view< float > & X1,
+					 const utl::array_view< float > & Y1,
+					 const utl::array_view< float > & W1,
+					 const utl::array_view< float > & X2,
+					 const utl::array_view< float > & Y2,
+					 const utl::array_view< float > & W2,
+					 const std::vector< float > & rbin,
+					 const float box,
+					 const utl::binning::scheme binning ) {
+
+  check_sizes( X1, Y1, W1 );
+  check_sizes( X2, Y2, W2 );
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_2D_DR< true, true >( X1, Y1, W1, X2, Y2, W2, bins, box, true ) :
+      kernel_2D_DR< false, true >( X1, Y1, W1, X2, Y2, W2, bins, box, true );
+  } );
   
 }
 
@@ -161,141 +312,185 @@ std::vector< std::size_t > utl::d2D_DR_omp ( const std::vector< float > & X1,
 //=================================== 2D-Angular ===================================
 //==================================================================================
 
-std::vector< std::size_t > utl::dA2D_DD ( const std::vector< float > & RA,
-					  const std::vector< float > & Dec,
-					  const std::vector< float > & thetabin ) {
+namespace {
+
+  // flat-sky angular separation, squared
+  inline float angular_sep2 ( const float RA1, const float Dec1,
+			      const float RA2, const float Dec2 ) {
+
+    float dra = ( RA1-RA2 ) * std::cos( 0.5 * (Dec1+Dec2) );
+    float ddec = Dec1-Dec2;
+    return dra*dra + ddec*ddec;
+    // tt = utl::haversine_th( RA1, Dec1, RA2, Dec2 );
+
+  }
+
+  template < bool weighted, typename bins_t >
+  std::vector< count_t< weighted > > kernel_A2D_DD ( const utl::array_view< float > & RA,
+						     const utl::array_view< float > & Dec,
+						     const utl::array_view< float > & WW,
+						     const bins_t & bins,
+					     const bool omp ) {
   
-  std::size_t size = RA.size();
+    std::size_t size = RA.size();
   
-  std::vector< std::size_t > NDD ( thetabin.size() );
-  float thetamin = thetabin.front(), thetamax = thetabin.back();
-  float delta = std::log10(thetamax/thetamin)/thetabin.size();
+    const std::vector< std::size_t > chunks =
+      utl::triangular_partition( size, chunks_per_thread * nthreads( omp ) );
+    utl::thread_histogram< count_t< weighted > > NDD ( bins.size(), nthreads( omp ) );
 
-  for ( std::size_t ii = 0; ii < size; ++ii ) {
-    float dra, ddec, tt;
-    std::size_t ib;
-    for ( std::size_t jj = ii+1; jj < size; ++jj ) {
-      dra = ( RA[ii]-RA[jj] ) * std::cos( 0.5 * (Dec[ii]+Dec[jj]) );
-      ddec = Dec[ii]-Dec[jj];
-      // tt = std::sqrt( dra*dra + ddec*ddec );
-      // tt = utl::haversine_th( RA[ ii ], Dec[ ii ],
-      // 			      RA[ jj ], Dec[ jj ] );
+#pragma omp parallel if(omp)
+    {
+      count_t< weighted > * local = NDD.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 1)
+      for ( std::size_t ic = 0; ic < chunks.size() - 1; ++ic )
+	for ( std::size_t ii = chunks[ ic ]; ii < chunks[ ic + 1 ]; ++ii )
+	  for ( std::size_t jj = ii+1; jj < size; ++jj ) {
+	    long ib = bins.bin( angular_sep2( RA[ii], Dec[ii], RA[jj], Dec[jj] ) );
+	    if ( ib >= 0 ) local[ ib ] += pair_weight< weighted >( WW, ii, WW, jj );
+	  } // endfor jj, ii, ic
+    } // end parallel
+  
+    return NDD.reduce();
+  
+  }
 
-      if ( thetamin <= tt && tt <= thetamax ) {
-	ib = int( std::log10( tt / thetamin ) / delta );
-	NDD[ ib ] += 1;
-      }
-      
-    } // endfor jj
-  } // endfor ii
+  template < bool weighted, typename bins_t >
+  std::vector< count_t< weighted > > kernel_A2D_DR ( const utl::array_view< float > & RA1,
+						     const utl::array_view< float > & Dec1,
+						     const utl::array_view< float > & W1,
+						     const utl::array_view< float > & RA2,
+						     const utl::array_view< float > & Dec2,
+						     const utl::array_view< float > & W2,
+						     const bins_t & bins,
+					     const bool omp ) {
   
-  return NDD;
+    std::size_t size1 = RA1.size();
+    std::size_t size2 = RA2.size();
   
-}
+    utl::thread_histogram< count_t< weighted > > NDR ( bins.size(), nthreads( omp ) );
 
-std::vector< std::size_t > utl::dA2D_DD_omp ( const std::vector< float > & RA,
-					      const std::vector< float > & Dec,
-					      const std::vector< float > & thetabin ) {
+#pragma omp parallel if(omp)
+    {
+      count_t< weighted > * local = NDR.local( omp_get_thread_num() );
+#pragma omp for schedule(static)
+      for ( std::size_t ii = 0; ii < size1; ++ii )
+	for ( std::size_t jj = 0; jj < size2; ++jj ) {
+	  long ib = bins.bin( angular_sep2( RA1[ii], Dec1[ii], RA2[jj], Dec2[jj] ) );
+	  if ( ib >= 0 ) local[ ib ] += pair_weight< weighted >( W1, ii, W2, jj );
+	} // endfor jj, ii
+    } // end parallel
   
-  std::size_t size = RA.size();
+    return NDR.reduce();
   
-  std::vector< std::size_t > NDD ( thetabin.size() );
-  float thetamin = thetabin.front(), thetamax = thetabin.back();
-  float delta = std::log10(thetamax/thetamin)/thetabin.size();
+  }
 
-#pragma omp parallel for shared(NDD)
-  for ( std::size_t ii = 0; ii < size; ++ii ) {
-    float dra, ddec, tt;
-    std::size_t ib;
-    for ( std::size_t jj = ii+1; jj < size; ++jj ) {
-      dra = ( RA[ii]-RA[jj] ) * std::cos( 0.5 * (Dec[ii]+Dec[jj]) );
-      ddec = Dec[ii]-Dec[jj];
-      tt = std::sqrt( dra*dra + ddec*ddec );
-      // tt = utl::haversine_th( RA[ ii ], Dec[ ii ],
-      // 			      RA[ jj ], Dec[ jj ] );
+} // endnamespace
 
-      if ( thetamin <= tt && tt <= thetamax ) {
-	ib = int( std::log10( tt / thetamin ) / delta );
-#pragma omp atomic
-	NDD[ ib ] += 1;
-      }
-      
-    } // endfor jj
-  } // endfor ii
-  
-  return NDD;
+std::vector< std::size_t > utl::dA2D_DD ( const utl::array_view< float > & RA,
+					  const utl::array_view< float > & Dec,
+					  const std::vector< float > & thetabin,
+					  const utl::binning::scheme binning ) {
+
+  return utl::binning::visit( binning, thetabin, [ & ] ( const auto & bins ) {
+    return kernel_A2D_DD< false >( RA, Dec, {}, bins, false );
+  } );
   
 }
 
-std::vector< std::size_t > utl::dA2D_DR ( const std::vector< float > & RA1,
-					  const std::vector< float > & Dec1,
-					  const std::vector< float > & RA2,
-					  const std::vector< float > & Dec2,
-					  const std::vector< float > & thetabin ) {
-  
-  std::size_t size1 = RA1.size();
-  std::size_t size2 = RA2.size();
+std::vector< std::size_t > utl::dA2D_DD_omp ( const utl::array_view< float > & RA,
+					      const utl::array_view< float > & Dec,
+					      const std::vector< float > & thetabin,
+					      const utl::binning::scheme binning ) {
+
+  return utl::binning::visit( binning, thetabin, [ & ] ( const auto & bins ) {
+    return kernel_A2D_DD< false >( RA, Dec, {}, bins, true );
+  } );
   
-  std::vector< std::size_t > NDR ( thetabin.size() );
-  float thetamin = thetabin.front(), thetamax = thetabin.back();
-  float delta = std::log10(thetamax/thetamin)/thetabin.size();
+}
 
-  for ( std::size_t ii = 0; ii < size1; ++ii ) {
-    float dra, ddec, tt;
-    std::size_t ib;
-    for ( std::size_t jj = 0; jj < size2; ++jj ) {
-      dra = ( RA1[ii]-RA2[jj] ) * std::cos( 0.5*(Dec1[ii]+Dec2[jj]) );
-      ddec = Dec1[ii]-Dec2[jj];
-      tt = std::sqrt( dra*dra + ddec*ddec );
-      // tt = utl::haversine_th( RA1[ ii ], Dec1[ ii ],
-      // 			      RA2[ jj ], Dec2[ jj ] );
+std::vector< std::size_t > utl::dA2D_DR ( const utl::array_view< float > & RA1,
+					  const utl::array_view< float > & Dec1,
+					  const utl::array_view< float > & RA2,
+					  const utl::array_view< float > & Dec2,
+					  const std::vector< float > & thetabin,
+					  const utl::binning::scheme binning ) {
 
-      if ( thetamin <= tt && tt <= thetamax ) {
-	ib = int( std::log10( tt / thetamin ) / delta );
-	NDR[ ib ] += 1;
-      }
-      
-    } // endfor jj
-  } // endfor ii
+  return utl::binning::visit( binning, thetabin, [ & ] ( const auto & bins ) {
+    return kernel_A2D_DR< false >( RA1, Dec1, {}, RA2, Dec2, {}, bins, false );
+  } );
   
-  return NDR;
+}
+
+std::vector< std::size_t > utl::dA2D_DR_omp ( const utl::array_view< float > & RA1,
+					      const utl::array_view< float > & Dec1,
+					      const utl::array_view< float > & RA2,
+					      const utl::array_view< float > & Dec2,
+					      const std::vector< float > & thetabin,
+					      const utl::binning::scheme binning ) {
+
+  return utl::binning::visit( binning, thetabin, [ & ] ( const auto & bins ) {
+    return kernel_A2D_DR< false >( RA1, Dec1, {}, RA2, Dec2, {}, bins, true );
+  } );
   
 }
 
-std::vector< std::size_t > utl::dA2D_DR_omp ( const std::vector< float > & RA1,
-					      const std::vector< float > & Dec1,
-					      const std::vector< float > & RA2,
-					      const std::vector< float > & Dec2,
-					      const std::vector< float > & thetabin ) {
+std::vector< double > utl::wdA2D_DD ( const utl::array_view< float > & RA,
+				      const utl::array_view< float > & Dec,
+				      const utl::array_view< float > & WW,
+				      const std::vector< float > & thetabin,
+				      const utl::binning::scheme binning ) {
+
+  check_sizes( RA, Dec, WW );
+  return utl::binning::visit( binning, thetabin, [ & ] ( const auto & bins ) {
+    return kernel_A2D_DD< true >( RA, Dec, WW, bins, false );
+  } );
   
-  std::size_t size1 = RA1.size();
-  std::size_t size2 = RA2.size();
+}
+
+std::vector< double > utl::wdA2D_DD_omp ( const utl::array_view< float > & RA,
+					  const utl::array_view< float > & Dec,
+					  const utl::array_view< float > & WW,
+					  const std::vector< float > & thetabin,
+					  const utl::binning::scheme binning ) {
+
+  check_sizes( RA, Dec, WW );
+  return utl::binning::visit( binning, thetabin, [ & ] ( const auto & bins ) {
+    return kernel_A2D_DD< true >( RA, Dec, WW, bins, true );
+  } );
   
-  std::vector< std::size_t > NDR ( thetabin.size() );
-  float thetamin = thetabin.front(), thetamax = thetabin.back();
-  float delta = std::log10(thetamax/thetamin)/thetabin.size();
+}
 
-#pragma omp parallel for shared(NDR)
-  for ( std::size_t ii = 0; ii < size1; ++ii ) {
-    float dra, ddec, tt;
-    std::size_t ib;
-    for ( std::size_t jj = 0; jj < size2; ++jj ) {
-      dra = ( RA1[ii]-RA2[jj] ) * std::cos( 0.5*(Dec1[ii]+Dec2[jj]) );
-      ddec = Dec1[ii]-Dec2[jj];
-      tt = std::sqrt( dra*dra + ddec*ddec );
-      // tt = utl::haversine_th( RA1[ ii ], Dec1[ ii ],
-      // 			      RA2[ jj ], Dec2[ jj ] );
+std::vector< double > utl::wdA2D_DR ( const utl::array_view< float > & RA1,
+				      const utl::array_view< float > & Dec1,
+				      const utl::array_view< float > & W1,
+				      const utl::array_view< float > & RA2,
+				      const utl::array_view< float > & Dec2,
+				      const utl::array_view< float > & W2,
+				      const std::vector< float > & thetabin,
+				      const utl::binning::scheme binning ) {
 
-      if ( thetamin <= tt && tt <= thetamax ) {
-	ib = int( std::log10( tt / thetamin ) / delta );
-#pragma omp atomic
-	NDR[ ib ] += 1;
-      }
-      
-    } // endfor jj
-  } // endfor ii
+  check_sizes( RA1, Dec1, W1 );
+  check_sizes( RA2, Dec2, W2 );
+  return utl::binning::visit( binning, thetabin, [ & ] ( const auto & bins ) {
+    return kernel_A2D_DR< true >( RA1, Dec1, W1, RA2, Dec2, W2, bins, false );
+  } );
   
-  return NDR;
+}
+
+std::vector< double > utl::wdA2D_DR_omp ( const utl::array_view< float > & RA1,
+					  const utl::array_view< float > & Dec1,
+					  const utl::array_view< float > & W1,
+					  const utl::array_view< float > & RA2,
+					  const utl::array_view< float > & Dec2,
+					  const utl::array_view< float > & W2,
+					  const std::vector< float > & thetabin,
+					  const utl::binning::scheme binning ) {
+
+  check_sizes( RA1, Dec1, W1 );
+  check_sizes( RA2, Dec2, W2 );
+  return utl::binning::visit( binning, thetabin, [ & ] ( const auto & bins ) {
+    return kernel_A2D_DR< true >( RA1, Dec1, W1, RA2, Dec2, W2, bins, true );
+  } );
   
 }
 
@@ -303,145 +498,3952 @@ std::vector< std::size_t > utl::dA2D_DR_omp ( const std::vector< float > & RA1,
 //======================================= 3D =======================================
 //==================================================================================
 
-std::vector< std::size_t > utl::d3D_DD ( const std::vector< float > & XX,
-					 const std::vector< float > & YY,
-					 const std::vector< float > & ZZ,
-					 const std::vector< float > & rbin ) {
+namespace {
+
+  // The 3D counters compare squared separations with the squared bin edges of
+  // the binning policy through the vectorised kernel of simd_kernel.h, which
+  // also handles the periodic box
+
+  // Cumulative counts of the pairs between object ii of catalogue 1 and the
+  // nn objects of catalogue 2 starting from jj, unweighted ...
+  inline void count_block ( const float * x1, const float * y1, const float * z1,
+			    const float *, const std::size_t ii,
+			    const float * x2, const float * y2, const float * z2,
+			    const float *, const std::size_t jj, const std::size_t nn,
+			    const std::vector< float > & edges2, const float box,
+			    std::size_t * cum ) {
+    utl::simd::count_cumulative( x1[ii], y1[ii], z1[ii], x2 + jj, y2 + jj, z2 + jj, nn,
+				 edges2.data(), edges2.size(), box, cum );
+  }
+
+  // ... and weighted by w1 and w2
+  inline void count_block ( const float * x1, const float * y1, const float * z1,
+			    const float * w1, const std::size_t ii,
+			    const float * x2, const float * y2, const float * z2,
+			    const float * w2, const std::size_t jj, const std::size_t nn,
+			    const std::vector< float > & edges2, const float box,
+			    double * cum ) {
+    utl::simd::count_cumulative( x1[ii], y1[ii], z1[ii], w1[ii],
+				 x2 + jj, y2 + jj, z2 + jj, w2 + jj, nn,
+				 edges2.data(), edges2.size(), box, cum );
+  }
+
+  template < bool weighted >
+  std::vector< count_t< weighted > > kernel_3D_DD ( const utl::array_view< float > & XX,
+						    const utl::array_view< float > & YY,
+						    const utl::array_view< float > & ZZ,
+						    const utl::array_view< float > & WW,
+						    const std::vector< float > & edges2,
+					    const float box,
+					    const bool omp ) {
   
-  std::size_t size = XX.size();
+    std::size_t size = XX.size();
   
-  std::vector< std::size_t > NDD ( rbin.size() );
-  float rmin = rbin.front(), rmax = rbin.back();
-  float delta = std::log10(rmax/rmin)/rbin.size();
+    const std::vector< std::size_t > chunks =
+      utl::triangular_partition( size, chunks_per_thread * nthreads( omp ) );
+    utl::thread_histogram< count_t< weighted > > cum ( edges2.size() - 1, nthreads( omp ) );
 
-  for ( std::size_t ii = 0; ii < size; ++ii ) {
-    float dx, dy, dz, rr;
-    std::size_t ib;
-    for ( std::size_t jj = ii+1; jj < size; ++jj ) {
-      dx = XX[ii]-XX[jj];
-      dy = YY[ii]-YY[jj];
-      dz = ZZ[ii]-ZZ[jj];
-      rr = std::sqrt( dx*dx + dy*dy + dz*dz );
+#pragma omp parallel if(omp)
+    {
+      count_t< weighted > * local = cum.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 1)
+      for ( std::size_t ic = 0; ic < chunks.size() - 1; ++ic )
+	for ( std::size_t ii = chunks[ ic ]; ii < chunks[ ic + 1 ]; ++ii )
+	  count_block( XX.data(), YY.data(), ZZ.data(), WW.data(), ii,
+		       XX.data(), YY.data(), ZZ.data(), WW.data(), ii + 1, size - ii - 1,
+		       edges2, box, local );
+    } // end parallel
 
-      if ( rmin <= rr && rr <= rmax ) {
-	ib = int( std::log10( rr / rmin ) / delta );
-	NDD[ ib ] += 1;
-      }
-      
-    } // endfor jj
-  } // endfor ii
+    std::vector< count_t< weighted > > NDD = cum.reduce();
+    utl::simd::cumulative_to_histogram( NDD );
+    return NDD;
+  
+  }
+
+  template < bool weighted >
+  std::vector< count_t< weighted > > kernel_3D_DR ( const utl::array_view< float > & X1,
+						    const utl::array_view< float > & Y1,
+						    const utl::array_view< float > & Z1,
+						    const utl::array_view< float > & W1,
+						    const utl::array_view< float > & X2,
+						    const utl::array_view< float > & Y2,
+						    const utl::array_view< float > & Z2,
+						    const utl::array_view< float > & W2,
+						    const std::vector< float > & edges2,
+					    const float box,
+					    const bool omp ) {
+  
+    std::size_t size1 = X1.size();
+    std::size_t size2 = X2.size();
   
-  return NDD;
+    utl::thread_histogram< count_t< weighted > > cum ( edges2.size() - 1, nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      count_t< weighted > * local = cum.local( omp_get_thread_num() );
+#pragma omp for schedule(static)
+      for ( std::size_t ii = 0; ii < size1; ++ii )
+	count_block( X1.data(), Y1.data(), Z1.data(), W1.data(), ii,
+		     X2.data(), Y2.data(), Z2.data(), W2.data(), 0, size2,
+		     edges2, box, local );
+    } // end parallel
+
+    std::vector< count_t< weighted > > NDR = cum.reduce();
+    utl::simd::cumulative_to_histogram( NDR );
+    return NDR;
+  
+  }
+
+} // endnamespace
+
+std::vector< std::size_t > utl::d3D_DD ( const utl::array_view< float > & XX,
+					 const utl::array_view< float > & YY,
+					 const utl::array_view< float > & ZZ,
+					 const std::vector< float > & rbin,
+					 const float box,
+					 const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_3D_DD< false >( XX, YY, ZZ, {}, bins.edges2(), box, false );
+  } );
   
 }
 
-std::vector< std::size_t > utl::d3D_DD_omp ( const std::vector< float > & XX,
-					     const std::vector< float > & YY,
-					     const std::vector< float > & ZZ,
-					     const std::vector< float > & rbin ) {
+std::vector< std::size_t > utl::d3D_DD_omp ( const utl::array_view< float > & XX,
+					     const utl::array_view< float > & YY,
+					     const utl::array_view< float > & ZZ,
+					     const std::vector< float > & rbin,
+					     const float box,
+					     const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_3D_DD< false >( XX, YY, ZZ, {}, bins.edges2(), box, true );
+  } );
   
-  std::size_t size = XX.size();
+}
+
+std::vector< std::size_t > utl::d3D_DR ( const utl::array_view< float > & X1,
+					 const utl::array_view< float > & Y1,
+					 const utl::array_view< float > & Z1,
+					 const utl::array_view< float > & X2,
+					 const utl::array_view< float > & Y2,
+					 const utl::array_view< float > & Z2,
+					 const std::vector< float > & rbin,
+					 const float box,
+					 const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_3D_DR< false >( X1, Y1, Z1, {}, X2, Y2, Z2, {}, bins.edges2(), box, false );
+  } );
   
-  std::vector< std::size_t > NDD ( rbin.size() );
-  float rmin = rbin.front(), rmax = rbin.back();
-  float delta = std::log10(rmax/rmin)/rbin.size();
+}
 
-#pragma omp parallel for shared(NDD)
-  for ( std::size_t ii = 0; ii < size; ++ii ) {
-    float dx, dy, dz, rr;
-    std::size_t ib;
-    for ( std::size_t jj = ii+1; jj < size; ++jj ) {
-      dx = XX[ii]-XX[jj];
-      dy = YY[ii]-YY[jj];
-      dz = ZZ[ii]-ZZ[jj];
-      rr = std::sqrt( dx*dx + dy*dy + dz*dz );
+std::vector< std::size_t > utl::d3D_DR_omp ( const utl::array_view< float > & X1,
+					     const utl::array_view< float > & Y1,
+					     const utl::array_view< float > & Z1,
+					     const utl::array_view< float > & X2,
+					     const utl::array_view< float > & Y2,
+					     const utl::array_view< float > & Z2,
+					     const std::vector< float > & rbin,
+					     const float box,
+					     const utl::binning::scheme binning ) {
 
-      if ( rmin <= rr && rr <= rmax ) {
-	ib = int( std::log10( rr / rmin ) / delta );
-#pragma omp atomic
-	NDD[ ib ] += 1;
-      }
-      
-    } // endfor jj
-  } // endfor ii
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_3D_DR< false >( X1, Y1, Z1, {}, X2, Y2, Z2, {}, bins.edges2(), box, true );
+  } );
+  
+}
+
+std::vector< double > utl::wd3D_DD ( const utl::array_view< float > & XX,
+				     const utl::array_view< float > & YY,
+				     const utl::array_view< float > & ZZ,
+				     const utl::array_view< float > & WW,
+				     const std::vector< float > & rbin,
+				     const float box,
+				     const utl::binning::scheme binning ) {
+
+  check_sizes( XX, YY, ZZ, WW );
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_3D_DD< true >( XX, YY, ZZ, WW, bins.edges2(), box, false );
+  } );
   
-  return NDD;
+}
+
+std::vector< double > utl::wd3D_DD_omp ( const utl::array_view< float > & XX,
+					 const utl::array_view< float > & YY,
+					 const utl::array_view< float > & ZZ,
+					 const utl::array_view< float > & WW,
+					 const std::vector< float > & rbin,
+					 const float box,
+					 const utl::binning::scheme binning ) {
+
+  check_sizes( XX, YY, ZZ, WW );
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_3D_DD< true >( XX, YY, ZZ, WW, bins.edges2(), box, true );
+  } );
   
 }
 
-std::vector< std::size_t > utl::d3D_DR ( const std::vector< float > & X1,
-					 const std::vector< float > & Y1,
-					 const std::vector< float > & Z1,
-					 const std::vector< float > & X2,
-					 const std::vector< float > & Y2,
-					 const std::vector< float > & Z2,
-					 const std::vector< float > & rbin ) {
+std::vector< double > utl::wd3D_DR ( const utl::array_view< float > & X1,
+				     const utl::array_view< float > & Y1,
+				     const utl::array_view< float > & Z1,
+				     const utl::array_view< float > & W1,
+				     const utl::array_view< float > & X2,
+				     const utl::array_view< float > & Y2,
+				     const utl::array_view< float > & Z2,
+				     const utl::array_view< float > & W2,
+				     const std::vector< float > & rbin,
+				     const float box,
+				     const utl::binning::scheme binning ) {
+
+  check_sizes( X1, Y1, Z1, W1 );
+  check_sizes( X2, Y2, Z2, W2 );
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_3D_DR< true >( X1, Y1, Z1, W1, X2, Y2, Z2, W2, bins.edges2(), box, false );
+  } );
   
-  std::size_t size1 = X1.size();
-  std::size_t size2 = X2.size();
+}
+
+std::vector< double > utl::wd3D_DR_omp ( const utl::array_view< float > & X1,
+					 const utl::array_view< float > & Y1,
+					 const utl::array_view< float > & Z1,
+					 const utl::array_view< float > & W1,
+					 const utl::array_view< float > & X2,
+					 const utl::array_view< float > & Y2,
+					 const utl::array_view< float > & Z2,
+					 const utl::array_view< float > & W2,
+					 const std::vector< float > & rbin,
+					 const float box,
+					 const utl::binning::scheme binning ) {
+
+  check_sizes( X1, Y1, Z1, W1 );
+  check_sizes( X2, Y2, Z2, W2 );
+  check_periodic( rbin, box );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_3D_DR< true >( X1, Y1, Z1, W1, X2, Y2, Z2, W2, bins.edges2(), box, true );
+  } );
   
-  std::vector< std::size_t > NDR ( rbin.size() );
-  float rmin = rbin.front(), rmax = rbin.back();
-  float delta = std::log10(rmax/rmin)/rbin.size();
+}
 
-  for ( std::size_t ii = 0; ii < size1; ++ii ) {
-    float dx, dy, dz, rr;
-    std::size_t ib;
-    for ( std::size_t jj = 0; jj < size2; ++jj ) {
-      dx = X1[ii]-X2[jj];
-      dy = Y1[ii]-Y2[jj];
-      dz = Z1[ii]-Z2[jj];
-      rr = std::sqrt( dx*dx + dy*dy + dz*dz );
+//==================================================================================
+//================================== 3D cell-list ==================================
+//==================================================================================
 
-      if ( rmin <= rr && rr <= rmax ) {
-	ib = int( std::log10( rr / rmin ) / delta );
-	NDR[ ib ] += 1;
-      }
-      
-    } // endfor jj
-  } // endfor ii
-  
-  return NDR;
-  
-}
-
-std::vector< std::size_t > utl::d3D_DR_omp ( const std::vector< float > & X1,
-					     const std::vector< float > & Y1,
-					     const std::vector< float > & Z1,
-					     const std::vector< float > & X2,
-					     const std::vector< float > & Y2,
-					     const std::vector< float > & Z2,
-					     const std::vector< float > & rbin ) {
-  
-  std::size_t size1 = X1.size();
-  std::size_t size2 = X2.size();
-  
-  std::vector< std::size_t > NDR ( rbin.size() );
-  float rmin = rbin.front(), rmax = rbin.back();
-  float delta = std::log10(rmax/rmin)/rbin.size();
-
-#pragma omp parallel for shared(NDR)
-  for ( std::size_t ii = 0; ii < size1; ++ii ) {
-    float dx, dy, dz, rr;
-    std::size_t ib;
-    for ( std::size_t jj = 0; jj < size2; ++jj ) {
-      dx = X1[ii]-X2[jj];
-      dy = Y1[ii]-Y2[jj];
-      dz = Z1[ii]-Z2[jj];
-      rr = std::sqrt( dx*dx + dy*dy + dz*dz );
-
-      if ( rmin <= rr && rr <= rmax ) {
-	ib = int( std::log10( rr / rmin ) / delta );
-#pragma omp atomic
-	NDR[ ib ] += 1;
-      }
-      
-    } // endfor jj
-  } // endfor ii
+namespace {
+
+  // Cumulative counts (see utl::simd::count_cumulative) of the pairs between
+  // cell c1 of l1 and cell c2 of l2, when same == true only pairs with jj > ii
+  template < typename T >
+  inline void count_cell_pair ( const utl::cell_list & l1, const std::size_t c1,
+				const utl::cell_list & l2, const std::size_t c2,
+				const bool same,
+				const std::vector< float > & edges2,
+				T * cum ) {
+
+    const std::size_t end = l2.start[ c2 + 1 ];
+    for ( std::size_t ii = l1.start[ c1 ]; ii < l1.start[ c1 + 1 ]; ++ii ) {
+      const std::size_t jj = same ? ii+1 : l2.start[ c2 ];
+      count_block( l1.xx.data(), l1.yy.data(), l1.zz.data(), l1.ww.data(), ii,
+		   l2.xx.data(), l2.yy.data(), l2.zz.data(), l2.ww.data(), jj, end - jj,
+		   edges2, l1.geo.box, cum );
+    } // endfor ii
+
+  }
+
+  template < bool weighted >
+  std::vector< count_t< weighted > > grid_DD ( const utl::cell_list & grid,
+					       const std::vector< float > & edges2,
+					       const bool omp ) {
+
+    const std::size_t ncells = grid.geo.size();
+    utl::thread_histogram< count_t< weighted > > cum ( edges2.size() - 1, nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      count_t< weighted > * local = cum.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 16)
+      for ( std::size_t cc = 0; cc < ncells; ++cc ) {
+	if ( grid.count( cc ) == 0 ) continue;
+	grid.for_each_neighbour( cc, [ & ] ( const std::size_t nn ) {
+	  if ( nn >= cc ) count_cell_pair( grid, cc, grid, nn, nn == cc, edges2, local );
+	} );
+      } // endfor cc
+    } // end parallel
+
+    std::vector< count_t< weighted > > NDD = cum.reduce();
+    utl::simd::cumulative_to_histogram( NDD );
+    return NDD;
+
+  }
+
+  template < bool weighted >
+  std::vector< count_t< weighted > > grid_DR ( const utl::cell_list & grid1,
+					       const utl::cell_list & grid2,
+					       const std::vector< float > & edges2,
+					       const bool omp ) {
+
+    const std::size_t ncells = grid1.geo.size();
+    utl::thread_histogram< count_t< weighted > > cum ( edges2.size() - 1, nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      count_t< weighted > * local = cum.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 16)
+      for ( std::size_t cc = 0; cc < ncells; ++cc ) {
+	if ( grid1.count( cc ) == 0 ) continue;
+	grid1.for_each_neighbour( cc, [ & ] ( const std::size_t nn ) {
+	  count_cell_pair( grid1, cc, grid2, nn, false, edges2, local );
+	} );
+      } // endfor cc
+    } // end parallel
+
+    std::vector< count_t< weighted > > NDR = cum.reduce();
+    utl::simd::cumulative_to_histogram( NDR );
+    return NDR;
+
+  }
+
+} // endnamespace
+
+std::vector< std::size_t > utl::d3D_DD_grid ( const utl::array_view< float > & XX,
+					      const utl::array_view< float > & YY,
+					      const utl::array_view< float > & ZZ,
+					      const std::vector< float > & rbin,
+					      const float box,
+					      const utl::binning::scheme binning ) {
+
+  utl::binning::check( binning, rbin );
+  check_periodic( rbin, box );
+  utl::grid_geometry geo { XX, YY, ZZ, {}, {}, {}, rbin.back(), box };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return grid_DD< false >( utl::cell_list{ XX, YY, ZZ, geo }, bins.edges2(), false );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d3D_DD_grid_omp ( const utl::array_view< float > & XX,
+						  const utl::array_view< float > & YY,
+						  const utl::array_view< float > & ZZ,
+						  const std::vector< float > & rbin,
+						  const float box,
+						  const utl::binning::scheme binning ) {
+
+  utl::binning::check( binning, rbin );
+  check_periodic( rbin, box );
+  utl::grid_geometry geo { XX, YY, ZZ, {}, {}, {}, rbin.back(), box };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return grid_DD< false >( utl::cell_list{ XX, YY, ZZ, geo }, bins.edges2(), true );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_grid ( const utl::array_view< float > & X1,
+					      const utl::array_view< float > & Y1,
+					      const utl::array_view< float > & Z1,
+					      const utl::array_view< float > & X2,
+					      const utl::array_view< float > & Y2,
+					      const utl::array_view< float > & Z2,
+					      const std::vector< float > & rbin,
+					      const float box,
+					      const utl::binning::scheme binning ) {
+
+  utl::binning::check( binning, rbin );
+  check_periodic( rbin, box );
+  utl::grid_geometry geo { X1, Y1, Z1, X2, Y2, Z2, rbin.back(), box };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return grid_DR< false >( utl::cell_list{ X1, Y1, Z1, geo },
+		    utl::cell_list{ X2, Y2, Z2, geo },
+		    bins.edges2(), false );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_grid_omp ( const utl::array_view< float > & X1,
+						  const utl::array_view< float > & Y1,
+						  const utl::array_view< float > & Z1,
+						  const utl::array_view< float > & X2,
+						  const utl::array_view< float > & Y2,
+						  const utl::array_view< float > & Z2,
+						  const std::vector< float > & rbin,
+						  const float box,
+						  const utl::binning::scheme binning ) {
+
+  utl::binning::check( binning, rbin );
+  check_periodic( rbin, box );
+  utl::grid_geometry geo { X1, Y1, Z1, X2, Y2, Z2, rbin.back(), box };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return grid_DR< false >( utl::cell_list{ X1, Y1, Z1, geo },
+		    utl::cell_list{ X2, Y2, Z2, geo },
+		    bins.edges2(), true );
+  } );
+
+}
+
+std::vector< double > utl::wd3D_DD_grid ( const utl::array_view< float > & XX,
+					  const utl::array_view< float > & YY,
+					  const utl::array_view< float > & ZZ,
+					  const utl::array_view< float > & WW,
+					  const std::vector< float > & rbin,
+					  const float box,
+					  const utl::binning::scheme binning ) {
+
+  check_sizes( XX, YY, ZZ, WW );
+  utl::binning::check( binning, rbin );
+  check_periodic( rbin, box );
+  utl::grid_geometry geo { XX, YY, ZZ, {}, {}, {}, rbin.back(), box };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return grid_DD< true >( utl::cell_list{ XX, YY, ZZ, geo, WW }, bins.edges2(), false );
+  } );
+  
+}
+
+std::vector< double > utl::wd3D_DD_grid_omp ( const utl::array_view< float > & XX,
+					      const utl::array_view< float > & YY,
+					      const utl::array_view< float > & ZZ,
+					      const utl::array_view< float > & WW,
+					      const std::vector< float > & rbin,
+					      const float box,
+					      const utl::binning::scheme binning ) {
+
+  check_sizes( XX, YY, ZZ, WW );
+  utl::binning::check( binning, rbin );
+  check_periodic( rbin, box );
+  utl::grid_geometry geo { XX, YY, ZZ, {}, {}, {}, rbin.back(), box };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return grid_DD< true >( utl::cell_list{ XX, YY, ZZ, geo, WW }, bins.edges2(), true );
+  } );
+  
+}
+
+std::vector< double > utl::wd3D_DR_grid ( const utl::array_view< float > & X1,
+					  const utl::array_view< float > & Y1,
+					  const utl::array_view< float > & Z1,
+					  const utl::array_view< float > & W1,
+					  const utl::array_view< float > & X2,
+					  const utl::array_view< float > & Y2,
+					  const utl::array_view< float > & Z2,
+					  const utl::array_view< float > & W2,
+					  const std::vector< float > & rbin,
+					  const float box,
+					  const utl::binning::scheme binning ) {
+
+  check_sizes( X1, Y1, Z1, W1 );
+  check_sizes( X2, Y2, Z2, W2 );
+  utl::binning::check( binning, rbin );
+  check_periodic( rbin, box );
+  utl::grid_geometry geo { X1, Y1, Z1, X2, Y2, Z2, rbin.back(), box };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return grid_DR< true >( utl::cell_list{ X1, Y1, Z1, geo, W1 },
+			    utl::cell_list{ X2, Y2, Z2, geo, W2 },
+			    bins.edges2(), false );
+  } );
+  
+}
+
+std::vector< double > utl::wd3D_DR_grid_omp ( const utl::array_view< float > & X1,
+					      const utl::array_view< float > & Y1,
+					      const utl::array_view< float > & Z1,
+					      const utl::array_view< float > & W1,
+					      const utl::array_view< float > & X2,
+					      const utl::array_view< float > & Y2,
+					      const utl::array_view< float > & Z2,
+					      const utl::array_view< float > & W2,
+					      const std::vector< float > & rbin,
+					      const float box,
+					      const utl::binning::scheme binning ) {
+
+  check_sizes( X1, Y1, Z1, W1 );
+  check_sizes( X2, Y2, Z2, W2 );
+  utl::binning::check( binning, rbin );
+  check_periodic( rbin, box );
+  utl::grid_geometry geo { X1, Y1, Z1, X2, Y2, Z2, rbin.back(), box };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return grid_DR< true >( utl::cell_list{ X1, Y1, Z1, geo, W1 },
+			    utl::cell_list{ X2, Y2, Z2, geo, W2 },
+			    bins.edges2(), true );
+  } );
+  
+}
+
+//==================================================================================
+//=================================== 3D k-d tree ==================================
+//==================================================================================
+
+namespace {
+
+  // relative tolerance on node-node separations, protects whole-node
+  // binning from round-off differences with the pair-by-pair separations
+  constexpr float tree_eps = 1.e-5;
+
+  // Cumulative counts (see utl::simd::count_cumulative) of all pairs between
+  // node a of t1 and node b of t2.
+  // same == true when t1 and t2 are the same tree: for a == b only pairs
+  // with ii < jj are counted.
+  // Weighted counts use the node sums of the weights for whole-node binning:
+  // sum_ij w_i w_j = W_a W_b, or ( W_a^2 - sum_i w_i^2 ) / 2 for a node with itself.
+  template < bool periodic, bool weighted >
+  void dual_tree ( const utl::kdtree & t1, const std::size_t a,
+		   const utl::kdtree & t2, const std::size_t b,
+		   const bool same, const utl::binning::edge_table & bins, const float box,
+		   count_t< weighted > * cum ) {
+
+    const utl::kdtree::node & n1 = t1.nodes[ a ], & n2 = t2.nodes[ b ];
+    const bool self = same && a == b;
+    const float dmin2 = utl::kdtree::min_dist2< periodic >( n1, n2, box );
+    const float dmax2 = utl::kdtree::max_dist2< periodic >( n1, n2, box );
+
+    // no pair of the two nodes can be binned
+    if ( dmin2 > bins.rmax2() * ( 1 + tree_eps ) || dmax2 < bins.rmin2() * ( 1 - tree_eps ) ) return;
+
+    // all the pairs of the two nodes fall in the same bin
+    long ib = bins.lookup( dmin2 * ( 1 - tree_eps ) );
+    if ( ib >= 0 && ib == bins.lookup( dmax2 * ( 1 + tree_eps ) ) ) {
+      count_t< weighted > npairs;
+      if constexpr ( weighted )
+	npairs = self ? 0.5 * ( n1.wsum * n1.wsum - n1.w2sum ) : n1.wsum * n2.wsum;
+      else
+	npairs = self ? n1.size() * ( n1.size() - 1 ) / 2 : n1.size() * n2.size();
+      for ( long kk = 0; kk <= ib; ++kk ) cum[ kk ] += npairs;
+      return;
+    }
+
+    // vectorised brute-force on pairs of leaves
+    if ( n1.leaf() && n2.leaf() ) {
+      for ( std::size_t ii = n1.begin; ii < n1.end; ++ii ) {
+	const std::size_t jj = self ? ii+1 : n2.begin;
+	count_block( t1.xx.data(), t1.yy.data(), t1.zz.data(), t1.ww.data(), ii,
+		     t2.xx.data(), t2.yy.data(), t2.zz.data(), t2.ww.data(), jj, n2.end - jj,
+		     bins.edges2(), box, cum );
+      } // endfor ii
+      return;
+    }
+
+  // otherwise open the largest node
+    if ( self ) {
+      dual_tree< periodic, weighted >( t1, n1.left, t2, n1.left, same, bins, box, cum );
+      dual_tree< periodic, weighted >( t1, n1.left, t2, n1.right, same, bins, box, cum );
+      dual_tree< periodic, weighted >( t1, n1.right, t2, n1.right, same, bins, box, cum );
+    }
+    else if ( n2.leaf() || ( !n1.leaf() && n1.size() >= n2.size() ) ) {
+      dual_tree< periodic, weighted >( t1, n1.left, t2, b, same, bins, box, cum );
+      dual_tree< periodic, weighted >( t1, n1.right, t2, b, same, bins, box, cum );
+    }
+    else {
+      dual_tree< periodic, weighted >( t1, a, t2, n2.left, same, bins, box, cum );
+      dual_tree< periodic, weighted >( t1, a, t2, n2.right, same, bins, box, cum );
+    }
+
+  }
+
+  // Splits the root-root traversal into independent node-pair tasks,
+  // opening nodes as dual_tree would for depth levels
+  template < bool periodic >
+  void dual_tree_tasks ( const utl::kdtree & t1, const std::size_t a,
+			 const utl::kdtree & t2, const std::size_t b,
+			 const bool same, const utl::binning::edge_table & bins, const float box,
+			 const std::size_t depth,
+			 std::vector< std::pair< std::size_t, std::size_t > > & tasks ) {
+
+    const utl::kdtree::node & n1 = t1.nodes[ a ], & n2 = t2.nodes[ b ];
+    if ( utl::kdtree::min_dist2< periodic >( n1, n2, box ) > bins.rmax2() * ( 1 + tree_eps ) ) return;
+    if ( depth == 0 || ( n1.leaf() && n2.leaf() ) ) {
+      tasks.emplace_back( a, b );
+      return;
+    }
+    if ( same && a == b ) {
+      dual_tree_tasks< periodic >( t1, n1.left, t2, n1.left, same, bins, box, depth - 1, tasks );
+      dual_tree_tasks< periodic >( t1, n1.left, t2, n1.right, same, bins, box, depth - 1, tasks );
+      dual_tree_tasks< periodic >( t1, n1.right, t2, n1.right, same, bins, box, depth - 1, tasks );
+    }
+    else if ( n2.leaf() || ( !n1.leaf() && n1.size() >= n2.size() ) ) {
+      dual_tree_tasks< periodic >( t1, n1.left, t2, b, same, bins, box, depth - 1, tasks );
+      dual_tree_tasks< periodic >( t1, n1.right, t2, b, same, bins, box, depth - 1, tasks );
+    }
+    else {
+      dual_tree_tasks< periodic >( t1, a, t2, n2.left, same, bins, box, depth - 1, tasks );
+      dual_tree_tasks< periodic >( t1, a, t2, n2.right, same, bins, box, depth - 1, tasks );
+    }
+
+  }
+
+  template < bool periodic, bool weighted >
+  std::vector< count_t< weighted > > tree_count ( const utl::kdtree & t1,
+					  const utl::kdtree & t2,
+					  const bool same,
+					  const utl::binning::edge_table & bins,
+					  const float box,
+					  const bool omp ) {
+
+    // enough tasks to balance the load across threads
+    std::size_t depth = 0;
+    if ( omp )
+      for ( std::size_t nt = 8 * chunks_per_thread * nthreads( omp ); nt > 1; nt >>= 1 ) ++depth;
+    std::vector< std::pair< std::size_t, std::size_t > > tasks;
+    dual_tree_tasks< periodic >( t1, 0, t2, 0, same, bins, box, depth, tasks );
+
+    utl::thread_histogram< count_t< weighted > > cum ( bins.size(), nthreads( omp ) );
+#pragma omp parallel if(omp)
+    {
+      count_t< weighted > * local = cum.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 1)
+      for ( std::size_t tt = 0; tt < tasks.size(); ++tt )
+	dual_tree< periodic, weighted >( t1, tasks[ tt ].first, t2, tasks[ tt ].second,
+				 same, bins, box, local );
+    } // end parallel
+
+    std::vector< count_t< weighted > > NN = cum.reduce();
+    utl::simd::cumulative_to_histogram( NN );
+    return NN;
+
+  }
+
+  template < bool weighted >
+  std::vector< count_t< weighted > > tree_count ( const utl::kdtree & t1,
+					  const utl::kdtree & t2,
+					  const bool same,
+					  const utl::binning::edge_table & bins,
+					  const float box,
+					  const bool omp ) {
+
+    return box > 0. ?
+      tree_count< true, weighted >( t1, t2, same, bins, box, omp ) :
+      tree_count< false, weighted >( t1, t2, same, bins, box, omp );
+
+  }
+
+} // endnamespace
+
+std::vector< std::size_t > utl::d3D_DD_tree ( const utl::array_view< float > & XX,
+					      const utl::array_view< float > & YY,
+					      const utl::array_view< float > & ZZ,
+					      const std::vector< float > & rbin,
+					      const float box,
+					      const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  utl::kdtree tree { XX, YY, ZZ };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return tree_count< false >( tree, tree, true, bins, box, false );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d3D_DD_tree_omp ( const utl::array_view< float > & XX,
+						  const utl::array_view< float > & YY,
+						  const utl::array_view< float > & ZZ,
+						  const std::vector< float > & rbin,
+						  const float box,
+						  const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  utl::kdtree tree { XX, YY, ZZ };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return tree_count< false >( tree, tree, true, bins, box, true );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_tree ( const utl::array_view< float > & X1,
+					      const utl::array_view< float > & Y1,
+					      const utl::array_view< float > & Z1,
+					      const utl::array_view< float > & X2,
+					      const utl::array_view< float > & Y2,
+					      const utl::array_view< float > & Z2,
+					      const std::vector< float > & rbin,
+					      const float box,
+					      const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  utl::kdtree t1 { X1, Y1, Z1 }, t2 { X2, Y2, Z2 };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return tree_count< false >( t1, t2, false, bins, box, false );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_tree_omp ( const utl::array_view< float > & X1,
+						  const utl::array_view< float > & Y1,
+						  const utl::array_view< float > & Z1,
+						  const utl::array_view< float > & X2,
+						  const utl::array_view< float > & Y2,
+						  const utl::array_view< float > & Z2,
+						  const std::vector< float > & rbin,
+						  const float box,
+						  const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  utl::kdtree t1 { X1, Y1, Z1 }, t2 { X2, Y2, Z2 };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return tree_count< false >( t1, t2, false, bins, box, true );
+  } );
+
+}
+
+std::vector< double > utl::wd3D_DD_tree ( const utl::array_view< float > & XX,
+					  const utl::array_view< float > & YY,
+					  const utl::array_view< float > & ZZ,
+					  const utl::array_view< float > & WW,
+					  const std::vector< float > & rbin,
+					  const float box,
+					  const utl::binning::scheme binning ) {
+
+  check_sizes( XX, YY, ZZ, WW );
+  check_periodic( rbin, box );
+  utl::kdtree tree { XX, YY, ZZ, 32, WW };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return tree_count< true >( tree, tree, true, bins, box, false );
+  } );
+  
+}
+
+std::vector< double > utl::wd3D_DD_tree_omp ( const utl::array_view< float > & XX,
+					      const utl::array_view< float > & YY,
+					      const utl::array_view< float > & ZZ,
+					      const utl::array_view< float > & WW,
+					      const std::vector< float > & rbin,
+					      const float box,
+					      const utl::binning::scheme binning ) {
+
+  check_sizes( XX, YY, ZZ, WW );
+  check_periodic( rbin, box );
+  utl::kdtree tree { XX, YY, ZZ, 32, WW };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return tree_count< true >( tree, tree, true, bins, box, true );
+  } );
+  
+}
+
+std::vector< double > utl::wd3D_DR_tree ( const utl::array_view< float > & X1,
+					  const utl::array_view< float > & Y1,
+					  const utl::array_view< float > & Z1,
+					  const utl::array_view< float > & W1,
+					  const utl::array_view< float > & X2,
+					  const utl::array_view< float > & Y2,
+					  const utl::array_view< float > & Z2,
+					  const utl::array_view< float > & W2,
+					  const std::vector< float > & rbin,
+					  const float box,
+					  const utl::binning::scheme binning ) {
+
+  check_sizes( X1, Y1, Z1, W1 );
+  check_sizes( X2, Y2, Z2, W2 );
+  check_periodic( rbin, box );
+  utl::kdtree t1 { X1, Y1, Z1, 32, W1 }, t2 { X2, Y2, Z2, 32, W2 };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return tree_count< true >( t1, t2, false, bins, box, false );
+  } );
   
-  return NDR;
+}
+
+std::vector< double > utl::wd3D_DR_tree_omp ( const utl::array_view< float > & X1,
+					      const utl::array_view< float > & Y1,
+					      const utl::array_view< float > & Z1,
+					      const utl::array_view< float > & W1,
+					      const utl::array_view< float > & X2,
+					      const utl::array_view< float > & Y2,
+					      const utl::array_view< float > & Z2,
+					      const utl::array_view< float > & W2,
+					      const std::vector< float > & rbin,
+					      const float box,
+					      const utl::binning::scheme binning ) {
+
+  check_sizes( X1, Y1, Z1, W1 );
+  check_sizes( X2, Y2, Z2, W2 );
+  check_periodic( rbin, box );
+  utl::kdtree t1 { X1, Y1, Z1, 32, W1 }, t2 { X2, Y2, Z2, 32, W2 };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return tree_count< true >( t1, t2, false, bins, box, true );
+  } );
   
 }
 
+//==================================================================================
+//==================================== 3D tiled ====================================
+//==================================================================================
+
+namespace {
+
+  // Objects per tile: the coordinates and weights of a tile of the second
+  // catalogue (4 KiB) stay in L1 while all the objects of a tile of the first
+  // catalogue are compared with it, so that each is read from memory once
+  // every tile_size_1 objects instead of once per object. Small tiles keep
+  // the bounding boxes tight, and the pruning effective, on sparse catalogues.
+  constexpr std::size_t tile_size_1 = 64, tile_size_2 = 256;
+
+  // spreads the 10 lowest bits of vv to every third bit
+  inline std::uint32_t spread_bits ( std::uint32_t vv ) noexcept {
+    vv &= 0x3ff;
+    vv = ( vv | ( vv << 16 ) ) & 0x30000ff;
+    vv = ( vv | ( vv << 8 ) ) & 0x300f00f;
+    vv = ( vv | ( vv << 4 ) ) & 0x30c30c3;
+    vv = ( vv | ( vv << 2 ) ) & 0x9249249;
+    return vv;
+  }
+
+  // Catalogue re-ordered along a Z-order (Morton) curve on a 1024^3 grid
+  // spanning its bounding box, and split in tiles of tile_size consecutive
+  // objects: tiles are spatially compact, their bounding boxes are stored
+  // as k-d tree nodes to re-use the node-node separation bounds. A binary
+  // tree over the tiles bounds runs of consecutive tiles, which are compact
+  // as well along the curve, so that far tiles are skipped by whole subtrees
+  struct tiled_catalogue {
+
+    std::vector< float > xx, yy, zz, ww;
+
+    std::vector< utl::kdtree::node > tiles;
+
+    /// tree over the tiles, root first, whose leaves are copies of the tiles
+    std::vector< utl::kdtree::node > tree;
+
+    // builds the subtree on tiles [ t0, t1 ), returns the position of its root
+    std::size_t build ( const std::size_t t0, const std::size_t t1 ) {
+
+      const std::size_t id = tree.size();
+      if ( t1 - t0 == 1 ) {
+	tree.push_back( tiles[ t0 ] );
+	return id;
+      }
+      tree.emplace_back();
+      const std::size_t tm = t0 + ( t1 - t0 ) / 2;
+      const std::size_t ll = build( t0, tm ), rr = build( tm, t1 );
+      utl::kdtree::node & nn = tree[ id ];
+      nn.left = ll; nn.right = rr;
+      nn.begin = tree[ ll ].begin; nn.end = tree[ rr ].end;
+      for ( std::size_t dd = 0; dd < 3; ++dd ) {
+	nn.lo[ dd ] = std::min( tree[ ll ].lo[ dd ], tree[ rr ].lo[ dd ] );
+	nn.hi[ dd ] = std::max( tree[ ll ].hi[ dd ], tree[ rr ].hi[ dd ] );
+      }
+      return id;
+
+    }
+
+    tiled_catalogue ( const utl::array_view< float > & XX,
+		      const utl::array_view< float > & YY,
+		      const utl::array_view< float > & ZZ,
+		      const utl::array_view< float > & WW,
+		      const std::size_t tile_size,
+		      const bool omp ) {
+
+      const std::size_t size = XX.size();
+      const utl::array_view< float > * coord[ 3 ] = { &XX, &YY, &ZZ };
+      std::array< float, 3 > lo, scale;
+      for ( std::size_t dd = 0; dd < 3; ++dd ) {
+	const auto [ mn, mx ] = std::minmax_element( coord[ dd ]->begin(), coord[ dd ]->end() );
+	lo[ dd ] = size > 0 ? *mn : 0.f;
+	scale[ dd ] = size > 0 && *mx > *mn ? 1023.f / ( *mx - *mn ) : 0.f;
+      }
+
+      std::vector< std::pair< std::uint32_t, std::size_t > > keys ( size );
+#pragma omp parallel for schedule(static) if(omp)
+      for ( std::size_t ii = 0; ii < size; ++ii ) {
+	std::uint32_t kk = 0;
+	for ( std::size_t dd = 0; dd < 3; ++dd )
+	  kk |= spread_bits( std::uint32_t( ( ( *coord[ dd ] )[ ii ] - lo[ dd ] ) * scale[ dd ] ) ) << dd;
+	keys[ ii ] = { kk, ii };
+      }
+      std::sort( keys.begin(), keys.end() );
+
+      xx.resize( size ); yy.resize( size ); zz.resize( size );
+      ww.resize( WW.empty() ? 0 : size );
+      tiles.resize( ( size + tile_size - 1 ) / tile_size );
+#pragma omp parallel for schedule(static) if(omp)
+      for ( std::size_t tt = 0; tt < tiles.size(); ++tt ) {
+	utl::kdtree::node & nn = tiles[ tt ];
+	nn.begin = tt * tile_size;
+	nn.end = std::min( nn.begin + tile_size, size );
+	nn.lo.fill( std::numeric_limits< float >::max() );
+	nn.hi.fill( std::numeric_limits< float >::lowest() );
+	for ( std::size_t ii = nn.begin; ii < nn.end; ++ii ) {
+	  const std::size_t jj = keys[ ii ].second;
+	  xx[ ii ] = XX[ jj ]; yy[ ii ] = YY[ jj ]; zz[ ii ] = ZZ[ jj ];
+	  if ( !ww.empty() ) ww[ ii ] = WW[ jj ];
+	  const float pos[ 3 ] = { xx[ ii ], yy[ ii ], zz[ ii ] };
+	  for ( std::size_t dd = 0; dd < 3; ++dd ) {
+	    nn.lo[ dd ] = std::min( nn.lo[ dd ], pos[ dd ] );
+	    nn.hi[ dd ] = std::max( nn.hi[ dd ], pos[ dd ] );
+	  }
+	}
+      } // endfor tt
+
+      if ( !tiles.empty() ) {
+	tree.reserve( 2 * tiles.size() - 1 );
+	build( 0, tiles.size() );
+      }
+
+    }
+
+  }; // endstruct tiled_catalogue
+
+  // Pairs tile n1 of c1 with the tiles below node b of the tree of c2,
+  // skipping the subtrees farther than the binning range (or all closer
+  // than its lower edge)
+  template < bool periodic, bool weighted >
+  void tile_descend ( const tiled_catalogue & c1, const utl::kdtree::node & n1,
+		      const tiled_catalogue & c2, const std::size_t b,
+		      const utl::binning::edge_table & bins,
+		      const float rmin2, const float rmax2,
+		      const float box, count_t< weighted > * cum ) {
+
+    const utl::kdtree::node & n2 = c2.tree[ b ];
+    if ( utl::kdtree::min_dist2< periodic >( n1, n2, box ) > rmax2 ||
+	 utl::kdtree::max_dist2< periodic >( n1, n2, box ) < rmin2 ) return;
+    if ( n2.leaf() ) {
+      for ( std::size_t ii = n1.begin; ii < n1.end; ++ii )
+	count_block( c1.xx.data(), c1.yy.data(), c1.zz.data(), c1.ww.data(), ii,
+		     c2.xx.data(), c2.yy.data(), c2.zz.data(), c2.ww.data(), n2.begin, n2.size(),
+		     bins.edges2(), box, cum );
+      return;
+    }
+    tile_descend< periodic, weighted >( c1, n1, c2, n2.left, bins, rmin2, rmax2, box, cum );
+    tile_descend< periodic, weighted >( c1, n1, c2, n2.right, bins, rmin2, rmax2, box, cum );
+
+  }
+
+  // Each task pairs one tile of c1 with the tiles of c2 that are not
+  // farther than the binning range, found descending the tree of c2:
+  // every tile of c2 is read from memory once per tile of c1 instead of
+  // once per object, and the search costs O( log ) per tile of c1 plus
+  // the tiles actually in range
+  template < bool periodic, bool weighted >
+  std::vector< count_t< weighted > > tiled_count ( const tiled_catalogue & c1,
+					   const tiled_catalogue & c2,
+					   const utl::binning::edge_table & bins,
+					   const float box,
+					   const bool omp ) {
+
+    const float rmax2 = bins.rmax2() * ( 1 + tree_eps ), rmin2 = bins.rmin2() * ( 1 - tree_eps );
+    utl::thread_histogram< count_t< weighted > > cum ( bins.size(), nthreads( omp ) );
+    if ( !c2.tree.empty() ) {
+#pragma omp parallel if(omp)
+      {
+	count_t< weighted > * local = cum.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 1)
+	for ( std::size_t t1 = 0; t1 < c1.tiles.size(); ++t1 )
+	  tile_descend< periodic, weighted >( c1, c1.tiles[ t1 ], c2, 0, bins, rmin2, rmax2, box, local );
+      } // end parallel
+    }
+
+    std::vector< count_t< weighted > > NN = cum.reduce();
+    utl::simd::cumulative_to_histogram( NN );
+    return NN;
+
+  }
+
+  template < bool weighted >
+  std::vector< count_t< weighted > > tiled_DR ( const utl::array_view< float > & X1,
+						const utl::array_view< float > & Y1,
+						const utl::array_view< float > & Z1,
+						const utl::array_view< float > & W1,
+						const utl::array_view< float > & X2,
+						const utl::array_view< float > & Y2,
+						const utl::array_view< float > & Z2,
+						const utl::array_view< float > & W2,
+						const std::vector< float > & rbin,
+						const float box,
+						const utl::binning::scheme binning,
+						const bool omp ) {
+
+    const tiled_catalogue c1 { X1, Y1, Z1, W1, tile_size_1, omp };
+    const tiled_catalogue c2 { X2, Y2, Z2, W2, tile_size_2, omp };
+    return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+      return box > 0. ?
+	tiled_count< true, weighted >( c1, c2, bins, box, omp ) :
+	tiled_count< false, weighted >( c1, c2, bins, box, omp );
+    } );
+
+  }
+
+} // endnamespace
+
+std::vector< std::size_t > utl::d3D_DR_tiled ( const utl::array_view< float > & X1,
+					       const utl::array_view< float > & Y1,
+					       const utl::array_view< float > & Z1,
+					       const utl::array_view< float > & X2,
+					       const utl::array_view< float > & Y2,
+					       const utl::array_view< float > & Z2,
+					       const std::vector< float > & rbin,
+					       const float box,
+					       const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return tiled_DR< false >( X1, Y1, Z1, {}, X2, Y2, Z2, {}, rbin, box, binning, false );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_tiled_omp ( const utl::array_view< float > & X1,
+						   const utl::array_view< float > & Y1,
+						   const utl::array_view< float > & Z1,
+						   const utl::array_view< float > & X2,
+						   const utl::array_view< float > & Y2,
+						   const utl::array_view< float > & Z2,
+						   const std::vector< float > & rbin,
+						   const float box,
+						   const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return tiled_DR< false >( X1, Y1, Z1, {}, X2, Y2, Z2, {}, rbin, box, binning, true );
+
+}
+
+std::vector< double > utl::wd3D_DR_tiled ( const utl::array_view< float > & X1,
+					   const utl::array_view< float > & Y1,
+					   const utl::array_view< float > & Z1,
+					   const utl::array_view< float > & W1,
+					   const utl::array_view< float > & X2,
+					   const utl::array_view< float > & Y2,
+					   const utl::array_view< float > & Z2,
+					   const utl::array_view< float > & W2,
+					   const std::vector< float > & rbin,
+					   const float box,
+					   const utl::binning::scheme binning ) {
+
+  check_sizes( X1, Y1, Z1, W1 );
+  check_sizes( X2, Y2, Z2, W2 );
+  check_periodic( rbin, box );
+  return tiled_DR< true >( X1, Y1, Z1, W1, X2, Y2, Z2, W2, rbin, box, binning, false );
+
+}
+
+std::vector< double > utl::wd3D_DR_tiled_omp ( const utl::array_view< float > & X1,
+					       const utl::array_view< float > & Y1,
+					       const utl::array_view< float > & Z1,
+					       const utl::array_view< float > & W1,
+					       const utl::array_view< float > & X2,
+					       const utl::array_view< float > & Y2,
+					       const utl::array_view< float > & Z2,
+					       const utl::array_view< float > & W2,
+					       const std::vector< float > & rbin,
+					       const float box,
+					       const utl::binning::scheme binning ) {
+
+  check_sizes( X1, Y1, Z1, W1 );
+  check_sizes( X2, Y2, Z2, W2 );
+  check_periodic( rbin, box );
+  return tiled_DR< true >( X1, Y1, Z1, W1, X2, Y2, Z2, W2, rbin, box, binning, true );
+
+}
+
+//==================================================================================
+//=============================== 3D fine histogram ================================
+//==================================================================================
+
+namespace {
+
+  // pairs between cell c1 of l1 and cell c2 of l2 (jj > ii when same == true)
+  // in the bins of the fine histogram
+  template < bool periodic, bool weighted >
+  inline void fine_cell_pair ( const utl::cell_list & l1, const std::size_t c1,
+			       const utl::cell_list & l2, const std::size_t c2,
+			       const bool same, const utl::fine_histogram< count_t< weighted > > & fine,
+			       count_t< weighted > * local ) {
+
+    // separations are computed in blocks, in a loop the compiler vectorises
+    constexpr std::size_t block = 256;
+    float d2[ block ];
+    const float box = l1.geo.box;
+    const std::size_t end = l2.start[ c2 + 1 ];
+    for ( std::size_t ii = l1.start[ c1 ]; ii < l1.start[ c1 + 1 ]; ++ii ) {
+      const float xi = l1.xx[ ii ], yi = l1.yy[ ii ], zi = l1.zz[ ii ];
+      for ( std::size_t j0 = same ? ii+1 : l2.start[ c2 ]; j0 < end; j0 += block ) {
+	const std::size_t nn = std::min( block, end - j0 );
+	const float * xj = l2.xx.data() + j0, * yj = l2.yy.data() + j0, * zj = l2.zz.data() + j0;
+	for ( std::size_t kk = 0; kk < nn; ++kk ) {
+	  const float dx = utl::separation< periodic >( xi - xj[ kk ], box );
+	  const float dy = utl::separation< periodic >( yi - yj[ kk ], box );
+	  const float dz = utl::separation< periodic >( zi - zj[ kk ], box );
+	  d2[ kk ] = dx*dx + dy*dy + dz*dz;
+	}
+	for ( std::size_t kk = 0; kk < nn; ++kk ) {
+	  const long ib = fine.bin( d2[ kk ] );
+	  if ( ib < 0 ) continue;
+	  if constexpr ( weighted ) local[ ib ] += double( l1.ww[ ii ] ) * l2.ww[ j0 + kk ];
+	  else ++local[ ib ];
+	}
+      } // endfor j0
+    } // endfor ii
+
+  }
+
+  // same == true when l1 and l2 are the same list: cell pairs are visited once
+  template < bool periodic, bool weighted >
+  void grid_fine ( const utl::cell_list & l1, const utl::cell_list & l2, const bool same,
+		   utl::fine_histogram< count_t< weighted > > & fine, const bool omp ) {
+
+    const std::size_t ncells = l1.geo.size();
+    utl::thread_histogram< count_t< weighted > > NN ( fine.size(), nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      count_t< weighted > * local = NN.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 16)
+      for ( std::size_t cc = 0; cc < ncells; ++cc ) {
+	if ( l1.count( cc ) == 0 ) continue;
+	l1.for_each_neighbour( cc, [ & ] ( const std::size_t nn ) {
+	  if ( !same || nn >= cc )
+	    fine_cell_pair< periodic, weighted >( l1, cc, l2, nn, same && nn == cc, fine, local );
+	} );
+      } // endfor cc
+    } // end parallel
+
+    fine.counts() = NN.reduce();
+
+  }
+
+  // the grid reaches the upper edge of the last fine bin, slightly beyond rmax
+  template < bool weighted >
+  utl::fine_histogram< count_t< weighted > > fine_DD ( const utl::array_view< float > & XX,
+						       const utl::array_view< float > & YY,
+						       const utl::array_view< float > & ZZ,
+						       const utl::array_view< float > & WW,
+						       const float rmin,
+						       const float rmax,
+						       const float box,
+						       const bool omp ) {
+
+    utl::fine_histogram< count_t< weighted > > fine { rmin, rmax };
+    utl::grid_geometry geo { XX, YY, ZZ, {}, {}, {}, std::sqrt( fine.edge2( fine.size() ) ), box };
+    const utl::cell_list grid { XX, YY, ZZ, geo, WW };
+    if ( box > 0. ) grid_fine< true, weighted >( grid, grid, true, fine, omp );
+    else grid_fine< false, weighted >( grid, grid, true, fine, omp );
+    return fine;
+
+  }
+
+  template < bool weighted >
+  utl::fine_histogram< count_t< weighted > > fine_DR ( const utl::array_view< float > & X1,
+						       const utl::array_view< float > & Y1,
+						       const utl::array_view< float > & Z1,
+						       const utl::array_view< float > & W1,
+						       const utl::array_view< float > & X2,
+						       const utl::array_view< float > & Y2,
+						       const utl::array_view< float > & Z2,
+						       const utl::array_view< float > & W2,
+						       const float rmin,
+						       const float rmax,
+						       const float box,
+						       const bool omp ) {
+
+    utl::fine_histogram< count_t< weighted > > fine { rmin, rmax };
+    utl::grid_geometry geo { X1, Y1, Z1, X2, Y2, Z2, std::sqrt( fine.edge2( fine.size() ) ), box };
+    const utl::cell_list grid1 { X1, Y1, Z1, geo, W1 }, grid2 { X2, Y2, Z2, geo, W2 };
+    if ( box > 0. ) grid_fine< true, weighted >( grid1, grid2, false, fine, omp );
+    else grid_fine< false, weighted >( grid1, grid2, false, fine, omp );
+    return fine;
+
+  }
+
+} // endnamespace
+
+utl::fine_histogram< std::size_t > utl::d3D_DD_fine ( const utl::array_view< float > & XX,
+						      const utl::array_view< float > & YY,
+						      const utl::array_view< float > & ZZ,
+						      const float rmin,
+						      const float rmax,
+						      const float box ) {
+
+  check_periodic( rmax, box );
+  return fine_DD< false >( XX, YY, ZZ, {}, rmin, rmax, box, false );
+
+}
+
+utl::fine_histogram< std::size_t > utl::d3D_DD_fine_omp ( const utl::array_view< float > & XX,
+							  const utl::array_view< float > & YY,
+							  const utl::array_view< float > & ZZ,
+							  const float rmin,
+							  const float rmax,
+							  const float box ) {
+
+  check_periodic( rmax, box );
+  return fine_DD< false >( XX, YY, ZZ, {}, rmin, rmax, box, true );
+
+}
+
+utl::fine_histogram< std::size_t > utl::d3D_DR_fine ( const utl::array_view< float > & X1,
+						      const utl::array_view< float > & Y1,
+						      const utl::array_view< float > & Z1,
+						      const utl::array_view< float > & X2,
+						      const utl::array_view< float > & Y2,
+						      const utl::array_view< float > & Z2,
+						      const float rmin,
+						      const float rmax,
+						      const float box ) {
+
+  check_periodic( rmax, box );
+  return fine_DR< false >( X1, Y1, Z1, {}, X2, Y2, Z2, {}, rmin, rmax, box, false );
+
+}
+
+utl::fine_histogram< std::size_t > utl::d3D_DR_fine_omp ( const utl::array_view< float > & X1,
+							  const utl::array_view< float > & Y1,
+							  const utl::array_view< float > & Z1,
+							  const utl::array_view< float > & X2,
+							  const utl::array_view< float > & Y2,
+							  const utl::array_view< float > & Z2,
+							  const float rmin,
+							  const float rmax,
+							  const float box ) {
+
+  check_periodic( rmax, box );
+  return fine_DR< false >( X1, Y1, Z1, {}, X2, Y2, Z2, {}, rmin, rmax, box, true );
+
+}
+
+utl::fine_histogram< double > utl::wd3D_DD_fine ( const utl::array_view< float > & XX,
+						  const utl::array_view< float > & YY,
+						  const utl::array_view< float > & ZZ,
+						  const utl::array_view< float > & WW,
+						  const float rmin,
+						  const float rmax,
+						  const float box ) {
+
+  check_sizes( XX, YY, ZZ, WW );
+  check_periodic( rmax, box );
+  return fine_DD< true >( XX, YY, ZZ, WW, rmin, rmax, box, false );
+
+}
+
+utl::fine_histogram< double > utl::wd3D_DD_fine_omp ( const utl::array_view< float > & XX,
+						      const utl::array_view< float > & YY,
+						      const utl::array_view< float > & ZZ,
+						      const utl::array_view< float > & WW,
+						      const float rmin,
+						      const float rmax,
+						      const float box ) {
+
+  check_sizes( XX, YY, ZZ, WW );
+  check_periodic( rmax, box );
+  return fine_DD< true >( XX, YY, ZZ, WW, rmin, rmax, box, true );
+
+}
+
+utl::fine_histogram< double > utl::wd3D_DR_fine ( const utl::array_view< float > & X1,
+						  const utl::array_view< float > & Y1,
+						  const utl::array_view< float > & Z1,
+						  const utl::array_view< float > & W1,
+						  const utl::array_view< float > & X2,
+						  const utl::array_view< float > & Y2,
+						  const utl::array_view< float > & Z2,
+						  const utl::array_view< float > & W2,
+						  const float rmin,
+						  const float rmax,
+						  const float box ) {
+
+  check_sizes( X1, Y1, Z1, W1 );
+  check_sizes( X2, Y2, Z2, W2 );
+  check_periodic( rmax, box );
+  return fine_DR< true >( X1, Y1, Z1, W1, X2, Y2, Z2, W2, rmin, rmax, box, false );
+
+}
+
+utl::fine_histogram< double > utl::wd3D_DR_fine_omp ( const utl::array_view< float > & X1,
+						      const utl::array_view< float > & Y1,
+						      const utl::array_view< float > & Z1,
+						      const utl::array_view< float > & W1,
+						      const utl::array_view< float > & X2,
+						      const utl::array_view< float > & Y2,
+						      const utl::array_view< float > & Z2,
+						      const utl::array_view< float > & W2,
+						      const float rmin,
+						      const float rmax,
+						      const float box ) {
+
+  check_sizes( X1, Y1, Z1, W1 );
+  check_sizes( X2, Y2, Z2, W2 );
+  check_periodic( rmax, box );
+  return fine_DR< true >( X1, Y1, Z1, W1, X2, Y2, Z2, W2, rmin, rmax, box, true );
+
+}
+
+//==================================================================================
+//================================ 3D Landy-Szalay =================================
+//==================================================================================
+
+namespace {
+
+  // sum of the weights and of their squares, the number of objects without weights
+  std::pair< double, double > weight_sums ( const utl::array_view< float > & WW,
+					    const std::size_t size ) {
+
+    if ( WW.size() == 0 ) return { double( size ), double( size ) };
+    double sum = 0., sum2 = 0.;
+    for ( std::size_t ii = 0; ii < WW.size(); ++ii ) {
+      sum += WW[ ii ];
+      sum2 += double( WW[ ii ] ) * WW[ ii ];
+    }
+    return { sum, sum2 };
+
+  }
+
+  // The three counts share one thread pool: tasks are the cells of the three
+  // counts in a single dynamically scheduled loop, and each thread accumulates
+  // the three cumulative histograms in consecutive segments of its local buffer.
+  template < bool weighted >
+  utl::landyszalay_result< count_t< weighted > >
+  grid_landyszalay ( const utl::array_view< float > & X1,
+		     const utl::array_view< float > & Y1,
+		     const utl::array_view< float > & Z1,
+		     const utl::array_view< float > & W1,
+		     const utl::array_view< float > & X2,
+		     const utl::array_view< float > & Y2,
+		     const utl::array_view< float > & Z2,
+		     const utl::array_view< float > & W2,
+		     const std::vector< float > & rbin,
+		     const float box,
+		     const utl::binning::scheme binning,
+		     const bool omp ) {
+
+    if ( X1.size() < 2 || X2.size() < 2 )
+      throw std::invalid_argument( "the Landy-Szalay estimator needs at least 2 data and 2 random objects" );
+
+    utl::binning::check( binning, rbin );
+
+    // DR and RR share the grid of the two catalogues; DD moves to a coarser grid
+    // of its own when the data alone are too sparse for the shared one to pay off
+    const utl::grid_geometry geo { X1, Y1, Z1, X2, Y2, Z2, rbin.back(), box };
+    const utl::grid_geometry dgeo { X1, Y1, Z1, {}, {}, {}, rbin.back(), box };
+    const bool coarse = dgeo.reach < geo.reach;
+    utl::cell_list data, rand, sparse;
+#pragma omp parallel sections if(omp)
+    {
+#pragma omp section
+      data = utl::cell_list{ X1, Y1, Z1, geo, W1 };
+#pragma omp section
+      rand = utl::cell_list{ X2, Y2, Z2, geo, W2 };
+#pragma omp section
+      if ( coarse ) sparse = utl::cell_list{ X1, Y1, Z1, dgeo, W1 };
+    }
+
+    // the three counts in order RR, DR, DD, the heaviest first
+    struct pass { const utl::cell_list & l1, & l2; bool same; std::size_t begin; };
+    const utl::cell_list & dd = coarse ? sparse : data;
+    const std::array< pass, 3 > passes { {
+	{ rand, rand, true, 0 },
+	{ data, rand, false, geo.size() },
+	{ dd, dd, true, 2 * geo.size() } } };
+    const std::size_t ntask = 2 * geo.size() + dd.geo.size();
+
+    utl::landyszalay_result< count_t< weighted > > res;
+    utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+
+      const std::vector< float > & edges2 = bins.edges2();
+      const std::size_t nbin = edges2.size() - 1;
+      utl::thread_histogram< count_t< weighted > > cum ( 3 * nbin, nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+      {
+	count_t< weighted > * local = cum.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 16)
+	for ( std::size_t task = 0; task < ntask; ++task ) {
+	  const std::size_t kk = task < passes[ 1 ].begin ? 0 : task < passes[ 2 ].begin ? 1 : 2;
+	  const pass & pp = passes[ kk ];
+	  const std::size_t cc = task - pp.begin;
+	  if ( pp.l1.count( cc ) == 0 ) continue;
+	  count_t< weighted > * seg = local + kk * nbin;
+	  pp.l1.for_each_neighbour( cc, [ & ] ( const std::size_t nn ) {
+	    if ( !pp.same ) count_cell_pair( pp.l1, cc, pp.l2, nn, false, edges2, seg );
+	    else if ( nn >= cc ) count_cell_pair( pp.l1, cc, pp.l2, nn, nn == cc, edges2, seg );
+	  } );
+	} // endfor task
+      } // end parallel
+
+      const std::vector< count_t< weighted > > NN = cum.reduce();
+      res.RR.assign( NN.begin(), NN.begin() + nbin );
+      res.DR.assign( NN.begin() + nbin, NN.begin() + 2 * nbin );
+      res.DD.assign( NN.begin() + 2 * nbin, NN.end() );
+      utl::simd::cumulative_to_histogram( res.DD );
+      utl::simd::cumulative_to_histogram( res.DR );
+      utl::simd::cumulative_to_histogram( res.RR );
+
+    } );
+
+    const auto [ sumD, sumD2 ] = weight_sums( W1, X1.size() );
+    const auto [ sumR, sumR2 ] = weight_sums( W2, X2.size() );
+    res.normDD = 2. / ( sumD * sumD - sumD2 );
+    res.normRR = 2. / ( sumR * sumR - sumR2 );
+    res.normDR = 1. / ( sumD * sumR );
+    res.xi.assign( res.DD.size(), 0. );
+    for ( std::size_t ib = 0; ib < res.xi.size(); ++ib )
+      if ( res.RR[ ib ] > 0 )
+	res.xi[ ib ] = ( res.DD[ ib ] * res.normDD - 2. * res.DR[ ib ] * res.normDR ) /
+	  ( res.RR[ ib ] * res.normRR ) + 1.;
+    return res;
+
+  }
+
+} // endnamespace
+
+utl::landyszalay_result< std::size_t > utl::d3D_landyszalay ( const utl::array_view< float > & X1,
+							      const utl::array_view< float > & Y1,
+							      const utl::array_view< float > & Z1,
+							      const utl::array_view< float > & X2,
+							      const utl::array_view< float > & Y2,
+							      const utl::array_view< float > & Z2,
+							      const std::vector< float > & rbin,
+							      const float box,
+							      const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return grid_landyszalay< false >( X1, Y1, Z1, {}, X2, Y2, Z2, {}, rbin, box, binning, false );
+
+}
+
+utl::landyszalay_result< std::size_t > utl::d3D_landyszalay_omp ( const utl::array_view< float > & X1,
+								  const utl::array_view< float > & Y1,
+								  const utl::array_view< float > & Z1,
+								  const utl::array_view< float > & X2,
+								  const utl::array_view< float > & Y2,
+								  const utl::array_view< float > & Z2,
+								  const std::vector< float > & rbin,
+								  const float box,
+								  const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return grid_landyszalay< false >( X1, Y1, Z1, {}, X2, Y2, Z2, {}, rbin, box, binning, true );
+
+}
+
+utl::landyszalay_result< double > utl::wd3D_landyszalay ( const utl::array_view< float > & X1,
+							  const utl::array_view< float > & Y1,
+							  const utl::array_view< float > & Z1,
+							  const utl::array_view< float > & W1,
+							  const utl::array_view< float > & X2,
+							  const utl::array_view< float > & Y2,
+							  const utl::array_view< float > & Z2,
+							  const utl::array_view< float > & W2,
+							  const std::vector< float > & rbin,
+							  const float box,
+							  const utl::binning::scheme binning ) {
+
+  check_sizes( X1, Y1, Z1, W1 );
+  check_sizes( X2, Y2, Z2, W2 );
+  check_periodic( rbin, box );
+  return grid_landyszalay< true >( X1, Y1, Z1, W1, X2, Y2, Z2, W2, rbin, box, binning, false );
+
+}
+
+utl::landyszalay_result< double > utl::wd3D_landyszalay_omp ( const utl::array_view< float > & X1,
+							      const utl::array_view< float > & Y1,
+							      const utl::array_view< float > & Z1,
+							      const utl::array_view< float > & W1,
+							      const utl::array_view< float > & X2,
+							      const utl::array_view< float > & Y2,
+							      const utl::array_view< float > & Z2,
+							      const utl::array_view< float > & W2,
+							      const std::vector< float > & rbin,
+							      const float box,
+							      const utl::binning::scheme binning ) {
+
+  check_sizes( X1, Y1, Z1, W1 );
+  check_sizes( X2, Y2, Z2, W2 );
+  check_periodic( rbin, box );
+  return grid_landyszalay< true >( X1, Y1, Z1, W1, X2, Y2, Z2, W2, rbin, box, binning, true );
+
+}
+
+//==================================================================================
+//=============================== 2D-Angular, sphere ===============================
+//==================================================================================
+
+namespace {
+
+  // unit vectors of positions ( RA, Dec ), computed in double precision
+  struct unit_vectors {
+
+    std::vector< float > xx, yy, zz;
+
+    unit_vectors ( const utl::array_view< float > & RA,
+		   const utl::array_view< float > & Dec ) :
+      xx ( RA.size() ), yy ( RA.size() ), zz ( RA.size() ) {
+
+      check_sizes( RA, Dec );
+      for ( std::size_t ii = 0; ii < RA.size(); ++ii ) {
+	const double cd = std::cos( double( Dec[ ii ] ) );
+	xx[ ii ] = cd * std::cos( double( RA[ ii ] ) );
+	yy[ ii ] = cd * std::sin( double( RA[ ii ] ) );
+	zz[ ii ] = std::sin( double( Dec[ ii ] ) );
+      }
+
+    }
+
+  };
+
+  // chord lengths of the edges of the angular bins, to be binned with
+  // utl::binning::scheme::edges
+  std::vector< float > chord_edges ( const std::vector< float > & thetabin,
+				     const utl::binning::scheme binning ) {
+
+    if ( thetabin.empty() || thetabin.back() > M_PI )
+      throw std::invalid_argument( "angular bins should lie in [0, pi]." );
+    return utl::binning::visit( binning, thetabin, [] ( const auto & bins ) {
+      std::vector< float > chord;
+      chord.reserve( bins.edges2().size() );
+      for ( const float ee : bins.edges2() )
+	chord.push_back( 2. * std::sin( 0.5 * std::sqrt( double( ee ) ) ) );
+      return chord;
+    } );
+
+  }
+
+} // endnamespace
+
+std::vector< std::size_t > utl::dA2D_DD_sphere ( const utl::array_view< float > & RA,
+						 const utl::array_view< float > & Dec,
+						 const std::vector< float > & thetabin,
+						 const utl::binning::scheme binning ) {
+
+  const unit_vectors uv { RA, Dec };
+  return utl::d3D_DD_tree( uv.xx, uv.yy, uv.zz, chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges );
+
+}
+
+std::vector< std::size_t > utl::dA2D_DD_sphere_omp ( const utl::array_view< float > & RA,
+						     const utl::array_view< float > & Dec,
+						     const std::vector< float > & thetabin,
+						     const utl::binning::scheme binning ) {
+
+  const unit_vectors uv { RA, Dec };
+  return utl::d3D_DD_tree_omp( uv.xx, uv.yy, uv.zz, chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges );
+
+}
+
+std::vector< std::size_t > utl::dA2D_DR_sphere ( const utl::array_view< float > & RA1,
+						 const utl::array_view< float > & Dec1,
+						 const utl::array_view< float > & RA2,
+						 const utl::array_view< float > & Dec2,
+						 const std::vector< float > & thetabin,
+						 const utl::binning::scheme binning ) {
+
+  const unit_vectors uv1 { RA1, Dec1 }, uv2 { RA2, Dec2 };
+  return utl::d3D_DR_tree( uv1.xx, uv1.yy, uv1.zz, uv2.xx, uv2.yy, uv2.zz,
+			    chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges );
+
+}
+
+std::vector< std::size_t > utl::dA2D_DR_sphere_omp ( const utl::array_view< float > & RA1,
+						     const utl::array_view< float > & Dec1,
+						     const utl::array_view< float > & RA2,
+						     const utl::array_view< float > & Dec2,
+						     const std::vector< float > & thetabin,
+						     const utl::binning::scheme binning ) {
+
+  const unit_vectors uv1 { RA1, Dec1 }, uv2 { RA2, Dec2 };
+  return utl::d3D_DR_tree_omp( uv1.xx, uv1.yy, uv1.zz, uv2.xx, uv2.yy, uv2.zz,
+			    chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges );
+
+}
+
+std::vector< double > utl::wdA2D_DD_sphere ( const utl::array_view< float > & RA,
+					     const utl::array_view< float > & Dec,
+					     const utl::array_view< float > & WW,
+					     const std::vector< float > & thetabin,
+					     const utl::binning::scheme binning ) {
+
+  check_sizes( RA, Dec, WW );
+  const unit_vectors uv { RA, Dec };
+  return utl::wd3D_DD_tree( uv.xx, uv.yy, uv.zz, WW, chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges );
+
+}
+
+std::vector< double > utl::wdA2D_DD_sphere_omp ( const utl::array_view< float > & RA,
+						 const utl::array_view< float > & Dec,
+						 const utl::array_view< float > & WW,
+						 const std::vector< float > & thetabin,
+						 const utl::binning::scheme binning ) {
+
+  check_sizes( RA, Dec, WW );
+  const unit_vectors uv { RA, Dec };
+  return utl::wd3D_DD_tree_omp( uv.xx, uv.yy, uv.zz, WW, chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges );
+
+}
+
+std::vector< double > utl::wdA2D_DR_sphere ( const utl::array_view< float > & RA1,
+					     const utl::array_view< float > & Dec1,
+					     const utl::array_view< float > & W1,
+					     const utl::array_view< float > & RA2,
+					     const utl::array_view< float > & Dec2,
+					     const utl::array_view< float > & W2,
+					     const std::vector< float > & thetabin,
+					     const utl::binning::scheme binning ) {
+
+  check_sizes( RA1, Dec1, W1 );
+  check_sizes( RA2, Dec2, W2 );
+  const unit_vectors uv1 { RA1, Dec1 }, uv2 { RA2, Dec2 };
+  return utl::wd3D_DR_tree( uv1.xx, uv1.yy, uv1.zz, W1, uv2.xx, uv2.yy, uv2.zz, W2,
+			    chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges );
+
+}
+
+std::vector< double > utl::wdA2D_DR_sphere_omp ( const utl::array_view< float > & RA1,
+						 const utl::array_view< float > & Dec1,
+						 const utl::array_view< float > & W1,
+						 const utl::array_view< float > & RA2,
+						 const utl::array_view< float > & Dec2,
+						 const utl::array_view< float > & W2,
+						 const std::vector< float > & thetabin,
+						 const utl::binning::scheme binning ) {
+
+  check_sizes( RA1, Dec1, W1 );
+  check_sizes( RA2, Dec2, W2 );
+  const unit_vectors uv1 { RA1, Dec1 }, uv2 { RA2, Dec2 };
+  return utl::wd3D_DR_tree_omp( uv1.xx, uv1.yy, uv1.zz, W1, uv2.xx, uv2.yy, uv2.zz, W2,
+			    chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges );
+
+}
+
+//==================================================================================
+//============================= 3D projected ( rp, pi ) ============================
+//==================================================================================
+
+namespace {
+
+  // Bin of the flattened ( rp, pi ) histogram of a pair with separation
+  // ( dx, dy, dz ) and midpoint ( mx, my, mz ), -1 if out of the histogram.
+  // The midpoint is only used by the midpoint line of sight.
+  template < utl::line_of_sight los, typename bins_t >
+  inline long bin_rppi ( const float dx, const float dy, const float dz,
+			 const double mx, const double my, const double mz,
+			 const bins_t & bins, const float pimax,
+			 const float inv_dpi, const long npi ) {
+
+    float rp2, pi;
+    if constexpr ( los == utl::line_of_sight::z ) {
+      pi = std::fabs( dz );
+      rp2 = dx*dx + dy*dy;
+    }
+    else {
+      // double precision limits the cancellation in s^2 - pi^2
+      const double m2 = mx*mx + my*my + mz*mz;
+      const double sl = dx*mx + dy*my + dz*mz;
+      const double s2 = double( dx )*dx + double( dy )*dy + double( dz )*dz;
+      const double pl = m2 > 0. ? std::fabs( sl ) / std::sqrt( m2 ) : 0.;
+      pi = pl;
+      rp2 = std::max( s2 - pl*pl, 0. );
+    }
+    if ( !( pi < pimax ) ) return -1;
+    const long irp = bins.bin( rp2 );
+    if ( irp < 0 ) return -1;
+    return irp * npi + std::min( long( pi * inv_dpi ), npi - 1 );
+
+  }
+
+  // Histogram of nbin entries filled by fn( local, ii, jj ) for the pairs of
+  // objects ii of l1 and jj of l2 in neighbouring cells, i.e. all the pairs
+  // closer than the search range of the grid and some farther ones, which
+  // fn has to reject. When same == true l1 and l2 are the same list and each
+  // pair is visited once. local is the histogram of the calling thread.
+  template < typename T, typename F >
+  std::vector< T > grid_pairs ( const utl::cell_list & l1, const utl::cell_list & l2,
+				const bool same, const std::size_t nbin,
+				const bool omp, F && fn ) {
+
+    const std::size_t ncells = l1.geo.size();
+    utl::thread_histogram< T > hist ( nbin, nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      T * local = hist.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 16)
+      for ( std::size_t cc = 0; cc < ncells; ++cc ) {
+	if ( l1.count( cc ) == 0 ) continue;
+	l1.for_each_neighbour( cc, [ & ] ( const std::size_t nn ) {
+	  if ( same && nn < cc ) return;
+	  for ( std::size_t ii = l1.start[ cc ]; ii < l1.start[ cc + 1 ]; ++ii )
+	    for ( std::size_t jj = same && nn == cc ? ii+1 : l2.start[ nn ];
+		  jj < l2.start[ nn + 1 ]; ++jj )
+	      fn( local, ii, jj );
+	} );
+      } // endfor cc
+    } // end parallel
+
+    return hist.reduce();
+
+  }
+
+  // The ( rp, pi ) counters search the cell list up to the largest
+  // separation binned, rmax = hypot( rp_max, pi_max ), widened by tree_eps
+  // against the round-off of the square root of the squared edge
+  inline float rppi_rmax ( const float rmax2, const float pimax ) {
+    return std::hypot( std::sqrt( rmax2 ), pimax ) * ( 1 + tree_eps );
+  }
+
+  template < bool periodic, utl::line_of_sight los, typename bins_t >
+  std::vector< std::size_t > kernel_rppi_DD ( const utl::array_view< float > & XX,
+					      const utl::array_view< float > & YY,
+					      const utl::array_view< float > & ZZ,
+					      const bins_t & bins,
+					      const float pimax,
+					      const std::size_t npi,
+					      const float box,
+					      const bool omp ) {
+
+    const float inv_dpi = npi / pimax;
+    const utl::grid_geometry geo { XX, YY, ZZ, {}, {}, {}, rppi_rmax( bins.rmax2(), pimax ), box };
+    const utl::cell_list ll { XX, YY, ZZ, geo };
+    const float * xx = ll.xx.data(), * yy = ll.yy.data(), * zz = ll.zz.data();
+
+    return grid_pairs< std::size_t >( ll, ll, true, bins.size() * npi, omp,
+      [ & ] ( std::size_t * local, const std::size_t ii, const std::size_t jj ) {
+	long ib = bin_rppi< los >( utl::separation< periodic >( xx[ii]-xx[jj], box ),
+				   utl::separation< periodic >( yy[ii]-yy[jj], box ),
+				   utl::separation< periodic >( zz[ii]-zz[jj], box ),
+				   0.5 * ( double( xx[ii] ) + xx[jj] ),
+				   0.5 * ( double( yy[ii] ) + yy[jj] ),
+				   0.5 * ( double( zz[ii] ) + zz[jj] ),
+				   bins, pimax, inv_dpi, npi );
+	if ( ib >= 0 ) local[ ib ] += 1;
+      } );
+
+  }
+
+  template < bool periodic, utl::line_of_sight los, typename bins_t >
+  std::vector< std::size_t > kernel_rppi_DR ( const utl::array_view< float > & X1,
+					      const utl::array_view< float > & Y1,
+					      const utl::array_view< float > & Z1,
+					      const utl::array_view< float > & X2,
+					      const utl::array_view< float > & Y2,
+					      const utl::array_view< float > & Z2,
+					      const bins_t & bins,
+					      const float pimax,
+					      const std::size_t npi,
+					      const float box,
+					      const bool omp ) {
+
+    const float inv_dpi = npi / pimax;
+    const utl::grid_geometry geo { X1, Y1, Z1, X2, Y2, Z2, rppi_rmax( bins.rmax2(), pimax ), box };
+    const utl::cell_list l1 { X1, Y1, Z1, geo }, l2 { X2, Y2, Z2, geo };
+    const float * x1 = l1.xx.data(), * y1 = l1.yy.data(), * z1 = l1.zz.data();
+    const float * x2 = l2.xx.data(), * y2 = l2.yy.data(), * z2 = l2.zz.data();
+
+    return grid_pairs< std::size_t >( l1, l2, false, bins.size() * npi, omp,
+      [ & ] ( std::size_t * local, const std::size_t ii, const std::size_t jj ) {
+	long ib = bin_rppi< los >( utl::separation< periodic >( x1[ii]-x2[jj], box ),
+				   utl::separation< periodic >( y1[ii]-y2[jj], box ),
+				   utl::separation< periodic >( z1[ii]-z2[jj], box ),
+				   0.5 * ( double( x1[ii] ) + x2[jj] ),
+				   0.5 * ( double( y1[ii] ) + y2[jj] ),
+				   0.5 * ( double( z1[ii] ) + z2[jj] ),
+				   bins, pimax, inv_dpi, npi );
+	if ( ib >= 0 ) local[ ib ] += 1;
+      } );
+
+  }
+
+  void check_los ( const float box, const utl::line_of_sight los ) {
+
+    if ( box > 0. && los == utl::line_of_sight::midpoint )
+      throw std::invalid_argument( "the midpoint line of sight requires open boundaries (box = 0)." );
+
+  }
+
+  void check_rppi ( const float pimax, const std::size_t npi,
+		    const float box, const utl::line_of_sight los ) {
+
+    if ( !( pimax > 0. ) || npi == 0 )
+      throw std::invalid_argument( "pimax and npi should be positive." );
+    check_los( box, los );
+
+  }
+
+  std::vector< std::size_t > rppi_DD ( const utl::array_view< float > & XX,
+				       const utl::array_view< float > & YY,
+				       const utl::array_view< float > & ZZ,
+				       const std::vector< float > & rpbin,
+				       const float pimax,
+				       const std::size_t npi,
+				       const float box,
+				       const utl::line_of_sight los,
+				       const utl::binning::scheme binning,
+				       const bool omp ) {
+
+    check_rppi( pimax, npi, box, los );
+    return utl::binning::visit( binning, rpbin, [ & ] ( const auto & bins ) {
+      using utl::line_of_sight;
+      if ( box > 0. )
+	return kernel_rppi_DD< true, line_of_sight::z >( XX, YY, ZZ, bins, pimax, npi, box, omp );
+      return los == line_of_sight::z ?
+	kernel_rppi_DD< false, line_of_sight::z >( XX, YY, ZZ, bins, pimax, npi, box, omp ) :
+	kernel_rppi_DD< false, line_of_sight::midpoint >( XX, YY, ZZ, bins, pimax, npi, box, omp );
+    } );
+
+  }
+
+  std::vector< std::size_t > rppi_DR ( const utl::array_view< float > & X1,
+				       const utl::array_view< float > & Y1,
+				       const utl::array_view< float > & Z1,
+				       const utl::array_view< float > & X2,
+				       const utl::array_view< float > & Y2,
+				       const utl::array_view< float > & Z2,
+				       const std::vector< float > & rpbin,
+				       const float pimax,
+				       const std::size_t npi,
+				       const float box,
+				       const utl::line_of_sight los,
+				       const utl::binning::scheme binning,
+				       const bool omp ) {
+
+    check_rppi( pimax, npi, box, los );
+    return utl::binning::visit( binning, rpbin, [ & ] ( const auto & bins ) {
+      using utl::line_of_sight;
+      if ( box > 0. )
+	return kernel_rppi_DR< true, line_of_sight::z >( X1, Y1, Z1, X2, Y2, Z2,
+							 bins, pimax, npi, box, omp );
+      return los == line_of_sight::z ?
+	kernel_rppi_DR< false, line_of_sight::z >( X1, Y1, Z1, X2, Y2, Z2,
+						   bins, pimax, npi, box, omp ) :
+	kernel_rppi_DR< false, line_of_sight::midpoint >( X1, Y1, Z1, X2, Y2, Z2,
+							  bins, pimax, npi, box, omp );
+    } );
+
+  }
+
+} // endnamespace
+
+std::vector< std::size_t > utl::d3D_DD_rppi ( const utl::array_view< float > & XX,
+					      const utl::array_view< float > & YY,
+					      const utl::array_view< float > & ZZ,
+					      const std::vector< float > & rpbin,
+					      const float pimax,
+					      const std::size_t npi,
+					      const float box,
+					      const utl::line_of_sight los,
+					      const utl::binning::scheme binning ) {
+
+  check_periodic( rpbin, box ); check_periodic( pimax, box );
+  return rppi_DD( XX, YY, ZZ, rpbin, pimax, npi, box, los, binning, false );
+
+}
+
+std::vector< std::size_t > utl::d3D_DD_rppi_omp ( const utl::array_view< float > & XX,
+						  const utl::array_view< float > & YY,
+						  const utl::array_view< float > & ZZ,
+						  const std::vector< float > & rpbin,
+						  const float pimax,
+						  const std::size_t npi,
+						  const float box,
+						  const utl::line_of_sight los,
+						  const utl::binning::scheme binning ) {
+
+  check_periodic( rpbin, box ); check_periodic( pimax, box );
+  return rppi_DD( XX, YY, ZZ, rpbin, pimax, npi, box, los, binning, true );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_rppi ( const utl::array_view< float > & X1,
+					      const utl::array_view< float > & Y1,
+					      const utl::array_view< float > & Z1,
+					      const utl::array_view< float > & X2,
+					      const utl::array_view< float > & Y2,
+					      const utl::array_view< float > & Z2,
+					      const std::vector< float > & rpbin,
+					      const float pimax,
+					      const std::size_t npi,
+					      const float box,
+					      const utl::line_of_sight los,
+					      const utl::binning::scheme binning ) {
+
+  check_periodic( rpbin, box ); check_periodic( pimax, box );
+  return rppi_DR( X1, Y1, Z1, X2, Y2, Z2, rpbin, pimax, npi, box, los, binning, false );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_rppi_omp ( const utl::array_view< float > & X1,
+						  const utl::array_view< float > & Y1,
+						  const utl::array_view< float > & Z1,
+						  const utl::array_view< float > & X2,
+						  const utl::array_view< float > & Y2,
+						  const utl::array_view< float > & Z2,
+						  const std::vector< float > & rpbin,
+						  const float pimax,
+						  const std::size_t npi,
+						  const float box,
+						  const utl::line_of_sight los,
+						  const utl::binning::scheme binning ) {
+
+  check_periodic( rpbin, box ); check_periodic( pimax, box );
+  return rppi_DR( X1, Y1, Z1, X2, Y2, Z2, rpbin, pimax, npi, box, los, binning, true );
+
+}
+
+std::vector< double > utl::wp_landy_szalay ( const std::vector< double > & DD,
+					     const std::vector< double > & DR,
+					     const std::vector< double > & RR,
+					     const std::size_t npi,
+					     const float pimax ) {
+
+  if ( npi == 0 || DD.size() != RR.size() || DR.size() != RR.size() || RR.size() % npi != 0 )
+    throw std::length_error( "DD, DR and RR should have the same size, multiple of npi." );
+
+  const double dpi = double( pimax ) / npi;
+  std::vector< double > wp ( RR.size() / npi, 0. );
+  for ( std::size_t irp = 0; irp < wp.size(); ++irp )
+    for ( std::size_t ib = irp * npi; ib < ( irp + 1 ) * npi; ++ib )
+      if ( RR[ ib ] > 0. )
+	wp[ irp ] += 2. * dpi * ( DD[ ib ] - 2. * DR[ ib ] + RR[ ib ] ) / RR[ ib ];
+  return wp;
+
+}
+
+//==================================================================================
+//============================ 3D redshift-space ( s, mu ) =========================
+//==================================================================================
+
+namespace {
+
+  // |mu| = |cos| of the angle between the separation ( dx, dy, dz ), of squared
+  // modulus s2, and the line of sight, 0 for coincident objects
+  template < utl::line_of_sight los >
+  inline float pair_mu ( const float dx, const float dy, const float dz,
+			 const double mx, const double my, const double mz,
+			 const float s2 ) {
+
+    if ( !( s2 > 0. ) ) return 0.;
+    if constexpr ( los == utl::line_of_sight::z )
+      return std::min( std::fabs( dz ) / std::sqrt( s2 ), 1.f );
+    else {
+      const double m2 = mx*mx + my*my + mz*mz;
+      if ( !( m2 > 0. ) ) return 0.;
+      const double sl = dx*mx + dy*my + dz*mz;
+      return std::min( std::fabs( sl ) / std::sqrt( m2 * s2 ), 1. );
+    }
+
+  }
+
+  // Shared by the ( s, mu ) histograms and the multipole sums: for each pair
+  // with s in the histogram, fill( row, mu ) updates the ncol elements of the
+  // row of the s bin. Pairs are searched on a cell list of range s_max.
+  template < bool periodic, utl::line_of_sight los, typename T, typename bins_t, typename F >
+  std::vector< T > kernel_smu_DD ( const utl::array_view< float > & XX,
+				   const utl::array_view< float > & YY,
+				   const utl::array_view< float > & ZZ,
+				   const bins_t & bins,
+				   const std::size_t ncol,
+				   const F & fill,
+				   const float box,
+				   const bool omp ) {
+
+    const utl::grid_geometry geo { XX, YY, ZZ, {}, {}, {},
+				   std::sqrt( bins.rmax2() ) * ( 1 + tree_eps ), box };
+    const utl::cell_list ll { XX, YY, ZZ, geo };
+    const float * xx = ll.xx.data(), * yy = ll.yy.data(), * zz = ll.zz.data();
+
+    return grid_pairs< T >( ll, ll, true, bins.size() * ncol, omp,
+      [ & ] ( T * local, const std::size_t ii, const std::size_t jj ) {
+	const float dx = utl::separation< periodic >( xx[ii]-xx[jj], box );
+	const float dy = utl::separation< periodic >( yy[ii]-yy[jj], box );
+	const float dz = utl::separation< periodic >( zz[ii]-zz[jj], box );
+	const float s2 = dx*dx + dy*dy + dz*dz;
+	const long ib = bins.bin( s2 );
+	if ( ib >= 0 )
+	  fill( local + ib * ncol,
+		pair_mu< los >( dx, dy, dz,
+				0.5 * ( double( xx[ii] ) + xx[jj] ),
+				0.5 * ( double( yy[ii] ) + yy[jj] ),
+				0.5 * ( double( zz[ii] ) + zz[jj] ), s2 ) );
+      } );
+
+  }
+
+  template < bool periodic, utl::line_of_sight los, typename T, typename bins_t, typename F >
+  std::vector< T > kernel_smu_DR ( const utl::array_view< float > & X1,
+				   const utl::array_view< float > & Y1,
+				   const utl::array_view< float > & Z1,
+				   const utl::array_view< float > & X2,
+				   const utl::array_view< float > & Y2,
+				   const utl::array_view< float > & Z2,
+				   const bins_t & bins,
+				   const std::size_t ncol,
+				   const F & fill,
+				   const float box,
+				   const bool omp ) {
+
+    const utl::grid_geometry geo { X1, Y1, Z1, X2, Y2, Z2,
+				   std::sqrt( bins.rmax2() ) * ( 1 + tree_eps ), box };
+    const utl::cell_list l1 { X1, Y1, Z1, geo }, l2 { X2, Y2, Z2, geo };
+    const float * x1 = l1.xx.data(), * y1 = l1.yy.data(), * z1 = l1.zz.data();
+    const float * x2 = l2.xx.data(), * y2 = l2.yy.data(), * z2 = l2.zz.data();
+
+    return grid_pairs< T >( l1, l2, false, bins.size() * ncol, omp,
+      [ & ] ( T * local, const std::size_t ii, const std::size_t jj ) {
+	const float dx = utl::separation< periodic >( x1[ii]-x2[jj], box );
+	const float dy = utl::separation< periodic >( y1[ii]-y2[jj], box );
+	const float dz = utl::separation< periodic >( z1[ii]-z2[jj], box );
+	const float s2 = dx*dx + dy*dy + dz*dz;
+	const long ib = bins.bin( s2 );
+	if ( ib >= 0 )
+	  fill( local + ib * ncol,
+		pair_mu< los >( dx, dy, dz,
+				0.5 * ( double( x1[ii] ) + x2[jj] ),
+				0.5 * ( double( y1[ii] ) + y2[jj] ),
+				0.5 * ( double( z1[ii] ) + z2[jj] ), s2 ) );
+      } );
+
+  }
+
+  // counts in nmu linear bins of |mu| in [0, 1]
+  struct mu_bins {
+
+    long nmu;
+
+    void operator() ( std::size_t * row, const float mu ) const noexcept {
+      row[ std::min( long( mu * nmu ), nmu - 1 ) ] += 1;
+    }
+
+  };
+
+  // sums of the even Legendre polynomials L_0, L_2, ..., L_lmax of mu,
+  // by the Bonnet recursion
+  struct legendre_sums {
+
+    std::size_t lmax;
+
+    void operator() ( double * row, const float mu ) const noexcept {
+      double lm1 = 1., ll = mu, lp1;
+      row[ 0 ] += 1.;
+      for ( std::size_t ell = 1; ell < lmax; ++ell ) {
+	lp1 = ( ( 2 * ell + 1 ) * mu * ll - ell * lm1 ) / ( ell + 1 );
+	lm1 = ll; ll = lp1;
+	if ( ell % 2 ) row[ ( ell + 1 ) / 2 ] += ll;
+      }
+    }
+
+  };
+
+  // selects the kernel instance for box, line of sight and binning
+  template < typename T, typename F >
+  std::vector< T > smu_DD ( const utl::array_view< float > & XX,
+			    const utl::array_view< float > & YY,
+			    const utl::array_view< float > & ZZ,
+			    const std::vector< float > & sbin,
+			    const std::size_t ncol,
+			    const F & fill,
+			    const float box,
+			    const utl::line_of_sight los,
+			    const utl::binning::scheme binning,
+			    const bool omp ) {
+
+    check_los( box, los );
+    return utl::binning::visit( binning, sbin, [ & ] ( const auto & bins ) {
+      using utl::line_of_sight;
+      if ( box > 0. )
+	return kernel_smu_DD< true, line_of_sight::z, T >( XX, YY, ZZ, bins, ncol, fill, box, omp );
+      return los == line_of_sight::z ?
+	kernel_smu_DD< false, line_of_sight::z, T >( XX, YY, ZZ, bins, ncol, fill, box, omp ) :
+	kernel_smu_DD< false, line_of_sight::midpoint, T >( XX, YY, ZZ, bins, ncol, fill, box, omp );
+    } );
+
+  }
+
+  template < typename T, typename F >
+  std::vector< T > smu_DR ( const utl::array_view< float > & X1,
+			    const utl::array_view< float > & Y1,
+			    const utl::array_view< float > & Z1,
+			    const utl::array_view< float > & X2,
+			    const utl::array_view< float > & Y2,
+			    const utl::array_view< float > & Z2,
+			    const std::vector< float > & sbin,
+			    const std::size_t ncol,
+			    const F & fill,
+			    const float box,
+			    const utl::line_of_sight los,
+			    const utl::binning::scheme binning,
+			    const bool omp ) {
+
+    check_los( box, los );
+    return utl::binning::visit( binning, sbin, [ & ] ( const auto & bins ) {
+      using utl::line_of_sight;
+      if ( box > 0. )
+	return kernel_smu_DR< true, line_of_sight::z, T >( X1, Y1, Z1, X2, Y2, Z2,
+							   bins, ncol, fill, box, omp );
+      return los == line_of_sight::z ?
+	kernel_smu_DR< false, line_of_sight::z, T >( X1, Y1, Z1, X2, Y2, Z2,
+						     bins, ncol, fill, box, omp ) :
+	kernel_smu_DR< false, line_of_sight::midpoint, T >( X1, Y1, Z1, X2, Y2, Z2,
+							    bins, ncol, fill, box, omp );
+    } );
+
+  }
+
+  void check_nmu ( const std::size_t nmu ) {
+    if ( nmu == 0 ) throw std::invalid_argument( "nmu should be positive." );
+  }
+
+  void check_lmax ( const std::size_t lmax ) {
+    if ( lmax % 2 ) throw std::invalid_argument( "lmax should be even." );
+  }
+
+} // endnamespace
+
+std::vector< std::size_t > utl::d3D_DD_smu ( const utl::array_view< float > & XX,
+					     const utl::array_view< float > & YY,
+					     const utl::array_view< float > & ZZ,
+					     const std::vector< float > & sbin,
+					     const std::size_t nmu,
+					     const float box,
+					     const utl::line_of_sight los,
+					     const utl::binning::scheme binning ) {
+
+  check_periodic( sbin, box );
+  check_nmu( nmu );
+  return smu_DD< std::size_t >( XX, YY, ZZ, sbin, nmu, mu_bins { long( nmu ) },
+				 box, los, binning, false );
+
+}
+
+std::vector< std::size_t > utl::d3D_DD_smu_omp ( const utl::array_view< float > & XX,
+						 const utl::array_view< float > & YY,
+						 const utl::array_view< float > & ZZ,
+						 const std::vector< float > & sbin,
+						 const std::size_t nmu,
+						 const float box,
+						 const utl::line_of_sight los,
+						 const utl::binning::scheme binning ) {
+
+  check_periodic( sbin, box );
+  check_nmu( nmu );
+  return smu_DD< std::size_t >( XX, YY, ZZ, sbin, nmu, mu_bins { long( nmu ) },
+				 box, los, binning, true );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_smu ( const utl::array_view< float > & X1,
+					     const utl::array_view< float > & Y1,
+					     const utl::array_view< float > & Z1,
+					     const utl::array_view< float > & X2,
+					     const utl::array_view< float > & Y2,
+					     const utl::array_view< float > & Z2,
+					     const std::vector< float > & sbin,
+					     const std::size_t nmu,
+					     const float box,
+					     const utl::line_of_sight los,
+					     const utl::binning::scheme binning ) {
+
+  check_periodic( sbin, box );
+  check_nmu( nmu );
+  return smu_DR< std::size_t >( X1, Y1, Z1, X2, Y2, Z2, sbin, nmu, mu_bins { long( nmu ) },
+				 box, los, binning, false );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_smu_omp ( const utl::array_view< float > & X1,
+						 const utl::array_view< float > & Y1,
+						 const utl::array_view< float > & Z1,
+						 const utl::array_view< float > & X2,
+						 const utl::array_view< float > & Y2,
+						 const utl::array_view< float > & Z2,
+						 const std::vector< float > & sbin,
+						 const std::size_t nmu,
+						 const float box,
+						 const utl::line_of_sight los,
+						 const utl::binning::scheme binning ) {
+
+  check_periodic( sbin, box );
+  check_nmu( nmu );
+  return smu_DR< std::size_t >( X1, Y1, Z1, X2, Y2, Z2, sbin, nmu, mu_bins { long( nmu ) },
+				 box, los, binning, true );
+
+}
+
+std::vector< double > utl::d3D_DD_multipoles ( const utl::array_view< float > & XX,
+					       const utl::array_view< float > & YY,
+					       const utl::array_view< float > & ZZ,
+					       const std::vector< float > & sbin,
+					       const std::size_t lmax,
+					       const float box,
+					       const utl::line_of_sight los,
+					       const utl::binning::scheme binning ) {
+
+  check_periodic( sbin, box );
+  check_lmax( lmax );
+  return smu_DD< double >( XX, YY, ZZ, sbin, lmax / 2 + 1, legendre_sums { lmax },
+			    box, los, binning, false );
+
+}
+
+std::vector< double > utl::d3D_DD_multipoles_omp ( const utl::array_view< float > & XX,
+						   const utl::array_view< float > & YY,
+						   const utl::array_view< float > & ZZ,
+						   const std::vector< float > & sbin,
+						   const std::size_t lmax,
+						   const float box,
+						   const utl::line_of_sight los,
+						   const utl::binning::scheme binning ) {
+
+  check_periodic( sbin, box );
+  check_lmax( lmax );
+  return smu_DD< double >( XX, YY, ZZ, sbin, lmax / 2 + 1, legendre_sums { lmax },
+			    box, los, binning, true );
+
+}
+
+std::vector< double > utl::d3D_DR_multipoles ( const utl::array_view< float > & X1,
+					       const utl::array_view< float > & Y1,
+					       const utl::array_view< float > & Z1,
+					       const utl::array_view< float > & X2,
+					       const utl::array_view< float > & Y2,
+					       const utl::array_view< float > & Z2,
+					       const std::vector< float > & sbin,
+					       const std::size_t lmax,
+					       const float box,
+					       const utl::line_of_sight los,
+					       const utl::binning::scheme binning ) {
+
+  check_periodic( sbin, box );
+  check_lmax( lmax );
+  return smu_DR< double >( X1, Y1, Z1, X2, Y2, Z2, sbin, lmax / 2 + 1, legendre_sums { lmax },
+			    box, los, binning, false );
+
+}
+
+std::vector< double > utl::d3D_DR_multipoles_omp ( const utl::array_view< float > & X1,
+						   const utl::array_view< float > & Y1,
+						   const utl::array_view< float > & Z1,
+						   const utl::array_view< float > & X2,
+						   const utl::array_view< float > & Y2,
+						   const utl::array_view< float > & Z2,
+						   const std::vector< float > & sbin,
+						   const std::size_t lmax,
+						   const float box,
+						   const utl::line_of_sight los,
+						   const utl::binning::scheme binning ) {
+
+  check_periodic( sbin, box );
+  check_lmax( lmax );
+  return smu_DR< double >( X1, Y1, Z1, X2, Y2, Z2, sbin, lmax / 2 + 1, legendre_sums { lmax },
+			    box, los, binning, true );
+
+}
+
+//==================================================================================
+//=================================== Jackknife ====================================
+//==================================================================================
+
+namespace {
+
+  // Leave-one-region-out histograms from the counts of the pairs between regions
+  // r1 and r2, CC[ ( r1 * nreg + r2 ) * nbin + ib ] (each pair in one orientation):
+  // a pair touches region k if it is in row k or column k of the region matrix
+  std::vector< std::size_t > jackknife_histograms ( const std::vector< std::size_t > & CC,
+						    const std::size_t nreg,
+						    const std::size_t nbin ) {
+
+    std::vector< std::size_t > out ( ( nreg + 1 ) * nbin, 0 );
+    std::size_t * total = out.data() + nreg * nbin;
+    for ( std::size_t rr = 0; rr < nreg * nreg; ++rr )
+      for ( std::size_t ib = 0; ib < nbin; ++ib )
+	total[ ib ] += CC[ rr * nbin + ib ];
+    for ( std::size_t kk = 0; kk < nreg; ++kk )
+      for ( std::size_t ib = 0; ib < nbin; ++ib ) {
+	std::size_t touch = 0;
+	for ( std::size_t rr = 0; rr < nreg; ++rr )
+	  touch += CC[ ( kk * nreg + rr ) * nbin + ib ] + CC[ ( rr * nreg + kk ) * nbin + ib ];
+	touch -= CC[ ( kk * nreg + kk ) * nbin + ib ];
+	out[ kk * nbin + ib ] = total[ ib ] - touch;
+      }
+    return out;
+
+  }
+
+  void check_regions ( const utl::array_view< int > & RR, const std::size_t size,
+		       const std::size_t nreg ) {
+
+    if ( RR.size() != size )
+      throw std::length_error( "region labels and coordinates should have the same size." );
+    for ( const int rr : RR )
+      if ( rr < 0 || std::size_t( rr ) >= nreg )
+	throw std::invalid_argument( "region labels should lie in [0, nreg)." );
+
+  }
+
+  // squared separations of pairs in the 2D and angular catalogues
+  template < bool periodic >
+  struct sep2_2D {
+    const utl::array_view< float > & X1, & Y1, & X2, & Y2;
+    const float box;
+    float operator() ( const std::size_t ii, const std::size_t jj ) const noexcept {
+      float dx = utl::separation< periodic >( X1[ii]-X2[jj], box );
+      float dy = utl::separation< periodic >( Y1[ii]-Y2[jj], box );
+      return dx*dx + dy*dy;
+    }
+  };
+
+  template < typename S, typename bins_t >
+  std::vector< std::size_t > kernel_jk_DD ( const std::size_t size,
+					    const S & sep2,
+					    const utl::array_view< int > & RR,
+					    const std::size_t nreg,
+					    const bins_t & bins,
+					    const bool omp ) {
+
+    const std::size_t nbin = bins.size();
+    const std::vector< std::size_t > chunks =
+      utl::triangular_partition( size, chunks_per_thread * nthreads( omp ) );
+    utl::thread_histogram< std::size_t > CC ( nreg * nreg * nbin, nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      std::size_t * local = CC.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 1)
+      for ( std::size_t ic = 0; ic < chunks.size() - 1; ++ic )
+	for ( std::size_t ii = chunks[ ic ]; ii < chunks[ ic + 1 ]; ++ii ) {
+	  std::size_t * row = local + RR[ ii ] * nreg * nbin;
+	  for ( std::size_t jj = ii+1; jj < size; ++jj ) {
+	    long ib = bins.bin( sep2( ii, jj ) );
+	    if ( ib >= 0 ) row[ RR[ jj ] * nbin + ib ] += 1;
+	  } // endfor jj
+	} // endfor ii, ic
+    } // end parallel
+
+    return jackknife_histograms( CC.reduce(), nreg, nbin );
+
+  }
+
+  template < typename S, typename bins_t >
+  std::vector< std::size_t > kernel_jk_DR ( const std::size_t size1,
+					    const std::size_t size2,
+					    const S & sep2,
+					    const utl::array_view< int > & R1,
+					    const utl::array_view< int > & R2,
+					    const std::size_t nreg,
+					    const bins_t & bins,
+					    const bool omp ) {
+
+    const std::size_t nbin = bins.size();
+    utl::thread_histogram< std::size_t > CC ( nreg * nreg * nbin, nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      std::size_t * local = CC.local( omp_get_thread_num() );
+#pragma omp for schedule(static)
+      for ( std::size_t ii = 0; ii < size1; ++ii ) {
+	std::size_t * row = local + R1[ ii ] * nreg * nbin;
+	for ( std::size_t jj = 0; jj < size2; ++jj ) {
+	  long ib = bins.bin( sep2( ii, jj ) );
+	  if ( ib >= 0 ) row[ R2[ jj ] * nbin + ib ] += 1;
+	} // endfor jj
+      } // endfor ii
+    } // end parallel
+
+    return jackknife_histograms( CC.reduce(), nreg, nbin );
+
+  }
+
+  // 3D catalogue sorted by region label, for the vectorised kernel to run
+  // on contiguous blocks of objects of the same region
+  struct region_sorted {
+
+    std::vector< float > xx, yy, zz;
+
+    /// region label of each object, in sorted order
+    std::vector< int > reg;
+
+    /// objects of region r are in [ start[ r ], start[ r + 1 ] )
+    std::vector< std::size_t > start;
+
+    region_sorted ( const utl::array_view< float > & XX,
+		    const utl::array_view< float > & YY,
+		    const utl::array_view< float > & ZZ,
+		    const utl::array_view< int > & RR,
+		    const std::size_t nreg ) : start ( nreg + 1, 0 ) {
+
+      const std::size_t size = XX.size();
+      for ( const int rr : RR ) ++start[ rr + 1 ];
+      for ( std::size_t rr = 0; rr < nreg; ++rr ) start[ rr + 1 ] += start[ rr ];
+      std::vector< std::size_t > pos ( start.begin(), start.end() - 1 );
+      xx.resize( size ); yy.resize( size ); zz.resize( size ); reg.resize( size );
+      for ( std::size_t ii = 0; ii < size; ++ii ) {
+	std::size_t jj = pos[ RR[ ii ] ]++;
+	xx[ jj ] = XX[ ii ];
+	yy[ jj ] = YY[ ii ];
+	zz[ jj ] = ZZ[ ii ];
+	reg[ jj ] = RR[ ii ];
+      }
+
+    }
+
+  };
+
+  // region-pair histograms from cumulative counts
+  std::vector< std::size_t > jackknife_cumulative ( std::vector< std::size_t > && CC,
+						    const std::size_t nreg,
+						    const std::size_t nbin ) {
+
+    for ( std::size_t rr = 0; rr < nreg * nreg; ++rr )
+      for ( std::size_t ib = 0; ib + 1 < nbin; ++ib )
+	CC[ rr * nbin + ib ] -= CC[ rr * nbin + ib + 1 ];
+    return jackknife_histograms( CC, nreg, nbin );
+
+  }
+
+  std::vector< std::size_t > kernel_jk_3D_DD ( const region_sorted & cat,
+					       const std::size_t nreg,
+					       const std::vector< float > & edges2,
+					       const float box,
+					       const bool omp ) {
+
+    const std::size_t size = cat.xx.size(), nbin = edges2.size() - 1;
+    const std::vector< std::size_t > chunks =
+      utl::triangular_partition( size, chunks_per_thread * nthreads( omp ) );
+    utl::thread_histogram< std::size_t > CC ( nreg * nreg * nbin, nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      std::size_t * local = CC.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 1)
+      for ( std::size_t ic = 0; ic < chunks.size() - 1; ++ic )
+	for ( std::size_t ii = chunks[ ic ]; ii < chunks[ ic + 1 ]; ++ii )
+	  for ( std::size_t r2 = cat.reg[ ii ]; r2 < nreg; ++r2 ) {
+	    const std::size_t jj = std::max( ii + 1, cat.start[ r2 ] ), end = cat.start[ r2 + 1 ];
+	    if ( jj < end )
+	      count_block( cat.xx.data(), cat.yy.data(), cat.zz.data(), nullptr, ii,
+			   cat.xx.data(), cat.yy.data(), cat.zz.data(), nullptr, jj, end - jj,
+			   edges2, box, local + ( cat.reg[ ii ] * nreg + r2 ) * nbin );
+	  } // endfor r2, ii, ic
+    } // end parallel
+
+    return jackknife_cumulative( CC.reduce(), nreg, nbin );
+
+  }
+
+  std::vector< std::size_t > kernel_jk_3D_DR ( const region_sorted & cat1,
+					       const region_sorted & cat2,
+					       const std::size_t nreg,
+					       const std::vector< float > & edges2,
+					       const float box,
+					       const bool omp ) {
+
+    const std::size_t size1 = cat1.xx.size(), nbin = edges2.size() - 1;
+    utl::thread_histogram< std::size_t > CC ( nreg * nreg * nbin, nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      std::size_t * local = CC.local( omp_get_thread_num() );
+#pragma omp for schedule(static)
+      for ( std::size_t ii = 0; ii < size1; ++ii )
+	for ( std::size_t r2 = 0; r2 < nreg; ++r2 ) {
+	  const std::size_t jj = cat2.start[ r2 ], end = cat2.start[ r2 + 1 ];
+	  if ( jj < end )
+	    count_block( cat1.xx.data(), cat1.yy.data(), cat1.zz.data(), nullptr, ii,
+			 cat2.xx.data(), cat2.yy.data(), cat2.zz.data(), nullptr, jj, end - jj,
+			 edges2, box, local + ( cat1.reg[ ii ] * nreg + r2 ) * nbin );
+	} // endfor r2, ii
+    } // end parallel
+
+    return jackknife_cumulative( CC.reduce(), nreg, nbin );
+
+  }
+
+} // endnamespace
+
+std::vector< std::size_t > utl::d2D_DD_jk ( const utl::array_view< float > & XX,
+					    const utl::array_view< float > & YY,
+					    const utl::array_view< int > & RR,
+					    const std::size_t nreg,
+					    const std::vector< float > & rbin,
+					    const float box,
+					    const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  check_regions( RR, XX.size(), nreg );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_jk_DD( XX.size(), sep2_2D< true >{ XX, YY, XX, YY, box }, RR, nreg, bins, false ) :
+      kernel_jk_DD( XX.size(), sep2_2D< false >{ XX, YY, XX, YY, box }, RR, nreg, bins, false );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d2D_DD_jk_omp ( const utl::array_view< float > & XX,
+						const utl::array_view< float > & YY,
+						const utl::array_view< int > & RR,
+						const std::size_t nreg,
+						const std::vector< float > & rbin,
+						const float box,
+						const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  check_regions( RR, XX.size(), nreg );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_jk_DD( XX.size(), sep2_2D< true >{ XX, YY, XX, YY, box }, RR, nreg, bins, true ) :
+      kernel_jk_DD( XX.size(), sep2_2D< false >{ XX, YY, XX, YY, box }, RR, nreg, bins, true );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d2D_DR_jk ( const utl::array_view< float > & X1,
+					    const utl::array_view< float > & Y1,
+					    const utl::array_view< int > & R1,
+					    const utl::array_view< float > & X2,
+					    const utl::array_view< float > & Y2,
+					    const utl::array_view< int > & R2,
+					    const std::size_t nreg,
+					    const std::vector< float > & rbin,
+					    const float box,
+					    const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  check_regions( R1, X1.size(), nreg );
+  check_regions( R2, X2.size(), nreg );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_jk_DR( X1.size(), X2.size(), sep2_2D< true >{ X1, Y1, X2, Y2, box },
+		    R1, R2, nreg, bins, false ) :
+      kernel_jk_DR( X1.size(), X2.size(), sep2_2D< false >{ X1, Y1, X2, Y2, box },
+		    R1, R2, nreg, bins, false );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d2D_DR_jk_omp ( const utl::array_view< float > & X1,
+						const utl::array_view< float > & Y1,
+						const utl::array_view< int > & R1,
+						const utl::array_view< float > & X2,
+						const utl::array_view< float > & Y2,
+						const utl::array_view< int > & R2,
+						const std::size_t nreg,
+						const std::vector< float > & rbin,
+						const float box,
+						const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  check_regions( R1, X1.size(), nreg );
+  check_regions( R2, X2.size(), nreg );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_jk_DR( X1.size(), X2.size(), sep2_2D< true >{ X1, Y1, X2, Y2, box },
+		    R1, R2, nreg, bins, true ) :
+      kernel_jk_DR( X1.size(), X2.size(), sep2_2D< false >{ X1, Y1, X2, Y2, box },
+		    R1, R2, nreg, bins, true );
+  } );
+
+}
+
+std::vector< std::size_t > utl::dA2D_DD_jk ( const utl::array_view< float > & RA,
+					     const utl::array_view< float > & Dec,
+					     const utl::array_view< int > & RR,
+					     const std::size_t nreg,
+					     const std::vector< float > & thetabin,
+					     const utl::binning::scheme binning ) {
+
+  const unit_vectors uv { RA, Dec };
+  return utl::d3D_DD_jk( uv.xx, uv.yy, uv.zz, RR, nreg,
+			   chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges );
+
+}
+
+std::vector< std::size_t > utl::dA2D_DD_jk_omp ( const utl::array_view< float > & RA,
+						 const utl::array_view< float > & Dec,
+						 const utl::array_view< int > & RR,
+						 const std::size_t nreg,
+						 const std::vector< float > & thetabin,
+						 const utl::binning::scheme binning ) {
+
+  const unit_vectors uv { RA, Dec };
+  return utl::d3D_DD_jk_omp( uv.xx, uv.yy, uv.zz, RR, nreg,
+			   chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges );
+
+}
+
+std::vector< std::size_t > utl::dA2D_DR_jk ( const utl::array_view< float > & RA1,
+					     const utl::array_view< float > & Dec1,
+					     const utl::array_view< int > & R1,
+					     const utl::array_view< float > & RA2,
+					     const utl::array_view< float > & Dec2,
+					     const utl::array_view< int > & R2,
+					     const std::size_t nreg,
+					     const std::vector< float > & thetabin,
+					     const utl::binning::scheme binning ) {
+
+  const unit_vectors uv1 { RA1, Dec1 }, uv2 { RA2, Dec2 };
+  return utl::d3D_DR_jk( uv1.xx, uv1.yy, uv1.zz, R1, uv2.xx, uv2.yy, uv2.zz, R2, nreg,
+			   chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges );
+
+}
+
+std::vector< std::size_t > utl::dA2D_DR_jk_omp ( const utl::array_view< float > & RA1,
+						 const utl::array_view< float > & Dec1,
+						 const utl::array_view< int > & R1,
+						 const utl::array_view< float > & RA2,
+						 const utl::array_view< float > & Dec2,
+						 const utl::array_view< int > & R2,
+						 const std::size_t nreg,
+						 const std::vector< float > & thetabin,
+						 const utl::binning::scheme binning ) {
+
+  const unit_vectors uv1 { RA1, Dec1 }, uv2 { RA2, Dec2 };
+  return utl::d3D_DR_jk_omp( uv1.xx, uv1.yy, uv1.zz, R1, uv2.xx, uv2.yy, uv2.zz, R2, nreg,
+			   chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges );
+
+}
+
+std::vector< std::size_t > utl::d3D_DD_jk ( const utl::array_view< float > & XX,
+					    const utl::array_view< float > & YY,
+					    const utl::array_view< float > & ZZ,
+					    const utl::array_view< int > & RR,
+					    const std::size_t nreg,
+					    const std::vector< float > & rbin,
+					    const float box,
+					    const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  check_regions( RR, XX.size(), nreg );
+  region_sorted cat { XX, YY, ZZ, RR, nreg };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_jk_3D_DD( cat, nreg, bins.edges2(), box, false );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d3D_DD_jk_omp ( const utl::array_view< float > & XX,
+						const utl::array_view< float > & YY,
+						const utl::array_view< float > & ZZ,
+						const utl::array_view< int > & RR,
+						const std::size_t nreg,
+						const std::vector< float > & rbin,
+						const float box,
+						const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  check_regions( RR, XX.size(), nreg );
+  region_sorted cat { XX, YY, ZZ, RR, nreg };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_jk_3D_DD( cat, nreg, bins.edges2(), box, true );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_jk ( const utl::array_view< float > & X1,
+					    const utl::array_view< float > & Y1,
+					    const utl::array_view< float > & Z1,
+					    const utl::array_view< int > & R1,
+					    const utl::array_view< float > & X2,
+					    const utl::array_view< float > & Y2,
+					    const utl::array_view< float > & Z2,
+					    const utl::array_view< int > & R2,
+					    const std::size_t nreg,
+					    const std::vector< float > & rbin,
+					    const float box,
+					    const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  check_regions( R1, X1.size(), nreg );
+  check_regions( R2, X2.size(), nreg );
+  region_sorted cat1 { X1, Y1, Z1, R1, nreg }, cat2 { X2, Y2, Z2, R2, nreg };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_jk_3D_DR( cat1, cat2, nreg, bins.edges2(), box, false );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_jk_omp ( const utl::array_view< float > & X1,
+						const utl::array_view< float > & Y1,
+						const utl::array_view< float > & Z1,
+						const utl::array_view< int > & R1,
+						const utl::array_view< float > & X2,
+						const utl::array_view< float > & Y2,
+						const utl::array_view< float > & Z2,
+						const utl::array_view< int > & R2,
+						const std::size_t nreg,
+						const std::vector< float > & rbin,
+						const float box,
+						const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  check_regions( R1, X1.size(), nreg );
+  check_regions( R2, X2.size(), nreg );
+  region_sorted cat1 { X1, Y1, Z1, R1, nreg }, cat2 { X2, Y2, Z2, R2, nreg };
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_jk_3D_DR( cat1, cat2, nreg, bins.edges2(), box, true );
+  } );
+
+}
+
+//==================================================================================
+//=================================== Bootstrap ====================================
+//==================================================================================
+
+namespace {
+
+  // Counter-based generator: the bits of draw counter of stream are a hash
+  // (SplitMix64 finaliser) of seed, stream and counter, so multiplicities do not
+  // depend on the order, nor on the thread, in which they are drawn
+  inline std::uint64_t mix64 ( std::uint64_t xx ) noexcept {
+    xx = ( xx ^ ( xx >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+    xx = ( xx ^ ( xx >> 27 ) ) * 0x94d049bb133111ebull;
+    return xx ^ ( xx >> 31 );
+  }
+
+  inline std::uint64_t counter_bits ( const std::uint64_t seed,
+				      const std::uint64_t stream,
+				      const std::uint64_t counter ) noexcept {
+    constexpr std::uint64_t gamma = 0x9e3779b97f4a7c15ull;
+    return mix64( mix64( seed + gamma * ( stream + 1 ) ) + gamma * ( counter + 1 ) );
+  }
+
+  using multiplicity_t = std::uint16_t;
+
+  // Multiplicities of the objects of a catalogue in nboot resamples,
+  // MM[ ii * nboot + bb ] is the multiplicity of object ii in resample bb
+  std::vector< multiplicity_t > multiplicities ( const std::size_t size,
+						 const std::size_t nboot,
+						 const std::uint64_t seed,
+						 const utl::resampling scheme,
+						 const bool omp ) {
+
+    std::vector< multiplicity_t > MM ( size * nboot, 0 );
+    if ( scheme == utl::resampling::poisson ) {
+      // inverse transform sampling of P( k ) = e^-1 / k!
+      const double p0 = std::exp( -1. );
+#pragma omp parallel for schedule(static) if(omp)
+      for ( std::size_t ii = 0; ii < size; ++ii )
+	for ( std::size_t bb = 0; bb < nboot; ++bb ) {
+	  const double uu = ( counter_bits( seed, bb, ii ) >> 11 ) * 0x1.0p-53;
+	  double pk = p0, cdf = p0;
+	  multiplicity_t kk = 0;
+	  while ( uu >= cdf && kk < UINT16_MAX ) { pk /= ++kk; cdf += pk; }
+	  MM[ ii * nboot + bb ] = kk;
+	}
+    }
+    else {
+      // size draws with replacement per resample, resamples shared among threads
+#pragma omp parallel if(omp)
+      {
+	std::vector< multiplicity_t > col ( size );
+#pragma omp for schedule(static)
+	for ( std::size_t bb = 0; bb < nboot; ++bb ) {
+	  std::fill( col.begin(), col.end(), 0 );
+	  for ( std::size_t tt = 0; tt < size; ++tt )
+	    ++col[ counter_bits( seed, bb, tt ) % size ];
+	  for ( std::size_t ii = 0; ii < size; ++ii )
+	    MM[ ii * nboot + bb ] = col[ ii ];
+	}
+      } // end parallel
+    }
+    return MM;
+
+  }
+
+  // Histograms are accumulated bin-major, HH[ ib * ( nboot + 1 ) + bb ], for the
+  // loop on the resamples to run on contiguous memory; output is resample-major
+  std::vector< std::size_t > bootstrap_histograms ( const std::vector< std::size_t > & HH,
+						    const std::size_t nboot,
+						    const std::size_t nbin ) {
+
+    std::vector< std::size_t > out ( ( nboot + 1 ) * nbin );
+    for ( std::size_t ib = 0; ib < nbin; ++ib )
+      for ( std::size_t bb = 0; bb <= nboot; ++bb )
+	out[ bb * nbin + ib ] = HH[ ib * ( nboot + 1 ) + bb ];
+    return out;
+
+  }
+
+  void check_nboot ( const std::size_t nboot ) {
+
+    if ( nboot == 0 )
+      throw std::invalid_argument( "the number of resamples should be positive." );
+
+  }
+
+  template < bool periodic >
+  struct sep2_3D {
+    const utl::array_view< float > & XX, & YY, & ZZ;
+    const float box;
+    float operator() ( const std::size_t ii, const std::size_t jj ) const noexcept {
+      float dx = utl::separation< periodic >( XX[ii]-XX[jj], box );
+      float dy = utl::separation< periodic >( YY[ii]-YY[jj], box );
+      float dz = utl::separation< periodic >( ZZ[ii]-ZZ[jj], box );
+      return dx*dx + dy*dy + dz*dz;
+    }
+  };
+
+  // each pair adds the product of the multiplicities of its objects
+  template < typename S, typename bins_t >
+  std::vector< std::size_t > kernel_boot_DD ( const std::size_t size,
+					      const S & sep2,
+					      const std::vector< multiplicity_t > & MM,
+					      const std::size_t nboot,
+					      const bins_t & bins,
+					      const bool omp ) {
+
+    const std::size_t nbin = bins.size(), ncol = nboot + 1;
+    const std::vector< std::size_t > chunks =
+      utl::triangular_partition( size, chunks_per_thread * nthreads( omp ) );
+    utl::thread_histogram< std::size_t > HH ( nbin * ncol, nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      std::size_t * local = HH.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 1)
+      for ( std::size_t ic = 0; ic < chunks.size() - 1; ++ic )
+	for ( std::size_t ii = chunks[ ic ]; ii < chunks[ ic + 1 ]; ++ii ) {
+	  const multiplicity_t * mi = MM.data() + ii * nboot;
+	  for ( std::size_t jj = ii+1; jj < size; ++jj ) {
+	    long ib = bins.bin( sep2( ii, jj ) );
+	    if ( ib < 0 ) continue;
+	    const multiplicity_t * mj = MM.data() + jj * nboot;
+	    std::size_t * hh = local + ib * ncol;
+	    for ( std::size_t bb = 0; bb < nboot; ++bb )
+	      hh[ bb ] += std::size_t( mi[ bb ] ) * mj[ bb ];
+	    hh[ nboot ] += 1;
+	  } // endfor jj
+	} // endfor ii, ic
+    } // end parallel
+
+    return bootstrap_histograms( HH.reduce(), nboot, nbin );
+
+  }
+
+  // Cross-pairs, only catalogue 1 is resampled: the pairs of object ii are
+  // binned first, row( ii, cnt ), then added to every resample with the
+  // multiplicity of ii, so that the cost per pair does not grow with nboot
+  template < typename F >
+  std::vector< std::size_t > kernel_boot_DR ( const std::size_t size1,
+					      const F & row,
+					      const std::vector< multiplicity_t > & MM,
+					      const std::size_t nboot,
+					      const std::size_t nbin,
+					      const bool omp ) {
+
+    const std::size_t ncol = nboot + 1;
+    utl::thread_histogram< std::size_t > HH ( nbin * ncol, nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      std::size_t * local = HH.local( omp_get_thread_num() );
+      std::vector< std::size_t > cnt ( nbin );
+#pragma omp for schedule(static)
+      for ( std::size_t ii = 0; ii < size1; ++ii ) {
+	std::fill( cnt.begin(), cnt.end(), 0 );
+	row( ii, cnt.data() );
+	const multiplicity_t * mi = MM.data() + ii * nboot;
+	for ( std::size_t ib = 0; ib < nbin; ++ib ) {
+	  if ( cnt[ ib ] == 0 ) continue;
+	  std::size_t * hh = local + ib * ncol;
+	  for ( std::size_t bb = 0; bb < nboot; ++bb )
+	    hh[ bb ] += mi[ bb ] * cnt[ ib ];
+	  hh[ nboot ] += cnt[ ib ];
+	} // endfor ib
+      } // endfor ii
+    } // end parallel
+
+    return bootstrap_histograms( HH.reduce(), nboot, nbin );
+
+  }
+
+  // pairs of object ii of catalogue 1 with catalogue 2, binned one at a time ...
+  template < typename S, typename bins_t >
+  struct row_pairs {
+    const std::size_t size2;
+    const S & sep2;
+    const bins_t & bins;
+    void operator() ( const std::size_t ii, std::size_t * cnt ) const noexcept {
+      for ( std::size_t jj = 0; jj < size2; ++jj ) {
+	long ib = bins.bin( sep2( ii, jj ) );
+	if ( ib >= 0 ) ++cnt[ ib ];
+      }
+    }
+  };
+
+  // ... and by the vectorised kernel in 3D
+  struct row_pairs_3D {
+    const utl::array_view< float > & X1, & Y1, & Z1, & X2, & Y2, & Z2;
+    const std::vector< float > & edges2;
+    const float box;
+    void operator() ( const std::size_t ii, std::size_t * cnt ) const noexcept {
+      count_block( X1.data(), Y1.data(), Z1.data(), nullptr, ii,
+		   X2.data(), Y2.data(), Z2.data(), nullptr, 0, X2.size(),
+		   edges2, box, cnt );
+      for ( std::size_t ib = 0; ib + 2 < edges2.size(); ++ib ) cnt[ ib ] -= cnt[ ib + 1 ];
+    }
+  };
+
+} // endnamespace
+
+std::vector< std::uint16_t > utl::bootstrap_multiplicities ( const std::size_t size,
+							     const std::size_t nboot,
+							     const std::uint64_t seed,
+							     const utl::resampling scheme ) {
+
+  return multiplicities( size, nboot, seed, scheme, true );
+
+}
+
+std::vector< std::size_t > utl::d2D_DD_boot ( const utl::array_view< float > & XX,
+					      const utl::array_view< float > & YY,
+					      const std::size_t nboot,
+					      const std::uint64_t seed,
+					      const std::vector< float > & rbin,
+					      const float box,
+					      const utl::binning::scheme binning,
+					      const utl::resampling scheme ) {
+
+  check_periodic( rbin, box );
+  check_nboot( nboot );
+  const auto MM = multiplicities( XX.size(), nboot, seed, scheme, false );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_boot_DD( XX.size(), sep2_2D< true >{ XX, YY, XX, YY, box }, MM, nboot, bins, false ) :
+      kernel_boot_DD( XX.size(), sep2_2D< false >{ XX, YY, XX, YY, box }, MM, nboot, bins, false );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d2D_DD_boot_omp ( const utl::array_view< float > & XX,
+						  const utl::array_view< float > & YY,
+						  const std::size_t nboot,
+						  const std::uint64_t seed,
+						  const std::vector< float > & rbin,
+						  const float box,
+						  const utl::binning::scheme binning,
+						  const utl::resampling scheme ) {
+
+  check_periodic( rbin, box );
+  check_nboot( nboot );
+  const auto MM = multiplicities( XX.size(), nboot, seed, scheme, true );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_boot_DD( XX.size(), sep2_2D< true >{ XX, YY, XX, YY, box }, MM, nboot, bins, true ) :
+      kernel_boot_DD( XX.size(), sep2_2D< false >{ XX, YY, XX, YY, box }, MM, nboot, bins, true );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d2D_DR_boot ( const utl::array_view< float > & X1,
+					      const utl::array_view< float > & Y1,
+					      const utl::array_view< float > & X2,
+					      const utl::array_view< float > & Y2,
+					      const std::size_t nboot,
+					      const std::uint64_t seed,
+					      const std::vector< float > & rbin,
+					      const float box,
+					      const utl::binning::scheme binning,
+					      const utl::resampling scheme ) {
+
+  check_periodic( rbin, box );
+  check_nboot( nboot );
+  const auto MM = multiplicities( X1.size(), nboot, seed, scheme, false );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    using bins_t = std::decay_t< decltype( bins ) >;
+    if ( box > 0. ) {
+      sep2_2D< true > sep2 { X1, Y1, X2, Y2, box };
+      return kernel_boot_DR( X1.size(), row_pairs< decltype( sep2 ), bins_t >{ X2.size(), sep2, bins },
+			     MM, nboot, bins.size(), false );
+    }
+    sep2_2D< false > sep2 { X1, Y1, X2, Y2, box };
+    return kernel_boot_DR( X1.size(), row_pairs< decltype( sep2 ), bins_t >{ X2.size(), sep2, bins },
+			   MM, nboot, bins.size(), false );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d2D_DR_boot_omp ( const utl::array_view< float > & X1,
+						  const utl::array_view< float > & Y1,
+						  const utl::array_view< float > & X2,
+						  const utl::array_view< float > & Y2,
+						  const std::size_t nboot,
+						  const std::uint64_t seed,
+						  const std::vector< float > & rbin,
+						  const float box,
+						  const utl::binning::scheme binning,
+						  const utl::resampling scheme ) {
+
+  check_periodic( rbin, box );
+  check_nboot( nboot );
+  const auto MM = multiplicities( X1.size(), nboot, seed, scheme, true );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    using bins_t = std::decay_t< decltype( bins ) >;
+    if ( box > 0. ) {
+      sep2_2D< true > sep2 { X1, Y1, X2, Y2, box };
+      return kernel_boot_DR( X1.size(), row_pairs< decltype( sep2 ), bins_t >{ X2.size(), sep2, bins },
+			     MM, nboot, bins.size(), true );
+    }
+    sep2_2D< false > sep2 { X1, Y1, X2, Y2, box };
+    return kernel_boot_DR( X1.size(), row_pairs< decltype( sep2 ), bins_t >{ X2.size(), sep2, bins },
+			   MM, nboot, bins.size(), true );
+  } );
+
+}
+
+std::vector< std::size_t > utl::dA2D_DD_boot ( const utl::array_view< float > & RA,
+					       const utl::array_view< float > & Dec,
+					       const std::size_t nboot,
+					       const std::uint64_t seed,
+					       const std::vector< float > & thetabin,
+					       const utl::binning::scheme binning,
+					       const utl::resampling scheme ) {
+
+  const unit_vectors uv { RA, Dec };
+  return utl::d3D_DD_boot( uv.xx, uv.yy, uv.zz, nboot, seed,
+			     chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges, scheme );
+
+}
+
+std::vector< std::size_t > utl::dA2D_DD_boot_omp ( const utl::array_view< float > & RA,
+						   const utl::array_view< float > & Dec,
+						   const std::size_t nboot,
+						   const std::uint64_t seed,
+						   const std::vector< float > & thetabin,
+						   const utl::binning::scheme binning,
+						   const utl::resampling scheme ) {
+
+  const unit_vectors uv { RA, Dec };
+  return utl::d3D_DD_boot_omp( uv.xx, uv.yy, uv.zz, nboot, seed,
+			     chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges, scheme );
+
+}
+
+std::vector< std::size_t > utl::dA2D_DR_boot ( const utl::array_view< float > & RA1,
+					       const utl::array_view< float > & Dec1,
+					       const utl::array_view< float > & RA2,
+					       const utl::array_view< float > & Dec2,
+					       const std::size_t nboot,
+					       const std::uint64_t seed,
+					       const std::vector< float > & thetabin,
+					       const utl::binning::scheme binning,
+					       const utl::resampling scheme ) {
+
+  const unit_vectors uv1 { RA1, Dec1 }, uv2 { RA2, Dec2 };
+  return utl::d3D_DR_boot( uv1.xx, uv1.yy, uv1.zz, uv2.xx, uv2.yy, uv2.zz, nboot, seed,
+			     chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges, scheme );
+
+}
+
+std::vector< std::size_t > utl::dA2D_DR_boot_omp ( const utl::array_view< float > & RA1,
+						   const utl::array_view< float > & Dec1,
+						   const utl::array_view< float > & RA2,
+						   const utl::array_view< float > & Dec2,
+						   const std::size_t nboot,
+						   const std::uint64_t seed,
+						   const std::vector< float > & thetabin,
+						   const utl::binning::scheme binning,
+						   const utl::resampling scheme ) {
+
+  const unit_vectors uv1 { RA1, Dec1 }, uv2 { RA2, Dec2 };
+  return utl::d3D_DR_boot_omp( uv1.xx, uv1.yy, uv1.zz, uv2.xx, uv2.yy, uv2.zz, nboot, seed,
+			     chord_edges( thetabin, binning ), 0., utl::binning::scheme::edges, scheme );
+
+}
+
+std::vector< std::size_t > utl::d3D_DD_boot ( const utl::array_view< float > & XX,
+					      const utl::array_view< float > & YY,
+					      const utl::array_view< float > & ZZ,
+					      const std::size_t nboot,
+					      const std::uint64_t seed,
+					      const std::vector< float > & rbin,
+					      const float box,
+					      const utl::binning::scheme binning,
+					      const utl::resampling scheme ) {
+
+  check_periodic( rbin, box );
+  check_nboot( nboot );
+  const auto MM = multiplicities( XX.size(), nboot, seed, scheme, false );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_boot_DD( XX.size(), sep2_3D< true >{ XX, YY, ZZ, box }, MM, nboot, bins, false ) :
+      kernel_boot_DD( XX.size(), sep2_3D< false >{ XX, YY, ZZ, box }, MM, nboot, bins, false );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d3D_DD_boot_omp ( const utl::array_view< float > & XX,
+						  const utl::array_view< float > & YY,
+						  const utl::array_view< float > & ZZ,
+						  const std::size_t nboot,
+						  const std::uint64_t seed,
+						  const std::vector< float > & rbin,
+						  const float box,
+						  const utl::binning::scheme binning,
+						  const utl::resampling scheme ) {
+
+  check_periodic( rbin, box );
+  check_nboot( nboot );
+  const auto MM = multiplicities( XX.size(), nboot, seed, scheme, true );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return box > 0. ?
+      kernel_boot_DD( XX.size(), sep2_3D< true >{ XX, YY, ZZ, box }, MM, nboot, bins, true ) :
+      kernel_boot_DD( XX.size(), sep2_3D< false >{ XX, YY, ZZ, box }, MM, nboot, bins, true );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_boot ( const utl::array_view< float > & X1,
+					      const utl::array_view< float > & Y1,
+					      const utl::array_view< float > & Z1,
+					      const utl::array_view< float > & X2,
+					      const utl::array_view< float > & Y2,
+					      const utl::array_view< float > & Z2,
+					      const std::size_t nboot,
+					      const std::uint64_t seed,
+					      const std::vector< float > & rbin,
+					      const float box,
+					      const utl::binning::scheme binning,
+					      const utl::resampling scheme ) {
+
+  check_periodic( rbin, box );
+  check_nboot( nboot );
+  const auto MM = multiplicities( X1.size(), nboot, seed, scheme, false );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_boot_DR( X1.size(), row_pairs_3D{ X1, Y1, Z1, X2, Y2, Z2, bins.edges2(), box },
+			   MM, nboot, bins.size(), false );
+  } );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_boot_omp ( const utl::array_view< float > & X1,
+						  const utl::array_view< float > & Y1,
+						  const utl::array_view< float > & Z1,
+						  const utl::array_view< float > & X2,
+						  const utl::array_view< float > & Y2,
+						  const utl::array_view< float > & Z2,
+						  const std::size_t nboot,
+						  const std::uint64_t seed,
+						  const std::vector< float > & rbin,
+						  const float box,
+						  const utl::binning::scheme binning,
+						  const utl::resampling scheme ) {
+
+  check_periodic( rbin, box );
+  check_nboot( nboot );
+  const auto MM = multiplicities( X1.size(), nboot, seed, scheme, true );
+  return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+    return kernel_boot_DR( X1.size(), row_pairs_3D{ X1, Y1, Z1, X2, Y2, Z2, bins.edges2(), box },
+			   MM, nboot, bins.size(), true );
+  } );
+
+}
+
+//==================================================================================
+//============================= Periodic box, analytic RR ==========================
+//==================================================================================
+
+namespace {
+
+  // bin edges of the binning policy (not squared), rmax checked against the box
+  std::vector< double > periodic_edges ( const std::vector< float > & rbin,
+					 const float box,
+					 const utl::binning::scheme binning ) {
+
+    if ( !( box > 0. ) )
+      throw std::invalid_argument( "the analytic RR requires a periodic box (box > 0)." );
+    std::vector< double > edges = utl::binning::visit( binning, rbin, [] ( const auto & bins ) {
+      std::vector< double > ee;
+      for ( const float e2 : bins.edges2() ) ee.push_back( std::sqrt( double( e2 ) ) );
+      return ee;
+    } );
+    if ( edges.back() > 0.5 * box )
+      throw std::invalid_argument( "the analytic RR requires bins up to box / 2." );
+    return edges;
+
+  }
+
+  // natural estimator from the DD counts of size objects and the analytic RR
+  template < typename T >
+  std::vector< double > natural_estimator ( const std::vector< T > & DD,
+					    const std::vector< double > & RR,
+					    const std::size_t size ) {
+
+    if ( size < 2 )
+      throw std::length_error( "the catalogue should contain at least 2 objects." );
+    const double norm = 2. / ( double( size ) * ( size - 1 ) );
+    std::vector< double > xi ( RR.size(), 0. );
+    for ( std::size_t ib = 0; ib < RR.size(); ++ib )
+      if ( RR[ ib ] > 0. ) xi[ ib ] = DD[ ib ] * norm / RR[ ib ] - 1.;
+    return xi;
+
+  }
+
+} // endnamespace
+
+std::vector< double > utl::RR_periodic_2D ( const std::vector< float > & rbin,
+					    const float box,
+					    const utl::binning::scheme binning ) {
+
+  const std::vector< double > ee = periodic_edges( rbin, box, binning );
+  const double area = double( box ) * box;
+  std::vector< double > RR ( ee.size() - 1 );
+  for ( std::size_t ib = 0; ib < RR.size(); ++ib )
+    RR[ ib ] = M_PI * ( ee[ ib + 1 ] * ee[ ib + 1 ] - ee[ ib ] * ee[ ib ] ) / area;
+  return RR;
+
+}
+
+std::vector< double > utl::RR_periodic_3D ( const std::vector< float > & rbin,
+					    const float box,
+					    const utl::binning::scheme binning ) {
+
+  const std::vector< double > ee = periodic_edges( rbin, box, binning );
+  const double volume = double( box ) * box * box;
+  std::vector< double > RR ( ee.size() - 1 );
+  for ( std::size_t ib = 0; ib < RR.size(); ++ib )
+    RR[ ib ] = 4. / 3. * M_PI *
+      ( ee[ ib + 1 ] * ee[ ib + 1 ] * ee[ ib + 1 ] - ee[ ib ] * ee[ ib ] * ee[ ib ] ) / volume;
+  return RR;
+
+}
+
+std::vector< double > utl::RR_periodic_rppi ( const std::vector< float > & rpbin,
+					      const float pimax,
+					      const std::size_t npi,
+					      const float box,
+					      const utl::binning::scheme binning ) {
+
+  check_rppi( pimax, npi, box, utl::line_of_sight::z );
+  const std::vector< double > ee = periodic_edges( rpbin, box, binning );
+  if ( pimax > 0.5 * box )
+    throw std::invalid_argument( "the analytic RR requires pimax up to box / 2." );
+  // pairs with pi in [ -pimax, pimax ) are folded on |pi|
+  const double volume = double( box ) * box * box, dpi = 2. * pimax / npi;
+  std::vector< double > RR ( ( ee.size() - 1 ) * npi );
+  for ( std::size_t irp = 0; irp + 1 < ee.size(); ++irp )
+    for ( std::size_t ipi = 0; ipi < npi; ++ipi )
+      RR[ irp * npi + ipi ] =
+	M_PI * ( ee[ irp + 1 ] * ee[ irp + 1 ] - ee[ irp ] * ee[ irp ] ) * dpi / volume;
+  return RR;
+
+}
+
+std::vector< double > utl::xi_periodic_2D ( const utl::array_view< float > & XX,
+					    const utl::array_view< float > & YY,
+					    const std::vector< float > & rbin,
+					    const float box,
+					    const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  const std::vector< double > RR = utl::RR_periodic_2D( rbin, box, binning );
+  return natural_estimator( utl::d2D_DD( XX, YY, rbin, box, binning ), RR, XX.size() );
+
+}
+
+std::vector< double > utl::xi_periodic_2D_omp ( const utl::array_view< float > & XX,
+						const utl::array_view< float > & YY,
+						const std::vector< float > & rbin,
+						const float box,
+						const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  const std::vector< double > RR = utl::RR_periodic_2D( rbin, box, binning );
+  return natural_estimator( utl::d2D_DD_omp( XX, YY, rbin, box, binning ), RR, XX.size() );
+
+}
+
+std::vector< double > utl::xi_periodic_3D ( const utl::array_view< float > & XX,
+					    const utl::array_view< float > & YY,
+					    const utl::array_view< float > & ZZ,
+					    const std::vector< float > & rbin,
+					    const float box,
+					    const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  const std::vector< double > RR = utl::RR_periodic_3D( rbin, box, binning );
+  return natural_estimator( utl::d3D_DD_grid( XX, YY, ZZ, rbin, box, binning ), RR, XX.size() );
+
+}
+
+std::vector< double > utl::xi_periodic_3D_omp ( const utl::array_view< float > & XX,
+						const utl::array_view< float > & YY,
+						const utl::array_view< float > & ZZ,
+						const std::vector< float > & rbin,
+						const float box,
+						const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  const std::vector< double > RR = utl::RR_periodic_3D( rbin, box, binning );
+  return natural_estimator( utl::d3D_DD_grid_omp( XX, YY, ZZ, rbin, box, binning ), RR, XX.size() );
+
+}
+
+std::vector< double > utl::wp_periodic ( const utl::array_view< float > & XX,
+					 const utl::array_view< float > & YY,
+					 const utl::array_view< float > & ZZ,
+					 const std::vector< float > & rpbin,
+					 const float pimax,
+					 const std::size_t npi,
+					 const float box,
+					 const utl::binning::scheme binning ) {
+
+  check_periodic( rpbin, box ); check_periodic( pimax, box );
+  const std::vector< double > RR = utl::RR_periodic_rppi( rpbin, pimax, npi, box, binning );
+  const std::vector< std::size_t > DD =
+    utl::d3D_DD_rppi( XX, YY, ZZ, rpbin, pimax, npi, box, utl::line_of_sight::z, binning );
+  const std::vector< double > xi = natural_estimator( DD, RR, XX.size() );
+  const double dpi = double( pimax ) / npi;
+  std::vector< double > wp ( RR.size() / npi, 0. );
+  for ( std::size_t ib = 0; ib < RR.size(); ++ib )
+    wp[ ib / npi ] += 2. * dpi * xi[ ib ];
+  return wp;
+
+}
+
+std::vector< double > utl::wp_periodic_omp ( const utl::array_view< float > & XX,
+					     const utl::array_view< float > & YY,
+					     const utl::array_view< float > & ZZ,
+					     const std::vector< float > & rpbin,
+					     const float pimax,
+					     const std::size_t npi,
+					     const float box,
+					     const utl::binning::scheme binning ) {
+
+  check_periodic( rpbin, box ); check_periodic( pimax, box );
+  const std::vector< double > RR = utl::RR_periodic_rppi( rpbin, pimax, npi, box, binning );
+  const std::vector< std::size_t > DD =
+    utl::d3D_DD_rppi_omp( XX, YY, ZZ, rpbin, pimax, npi, box, utl::line_of_sight::z, binning );
+  const std::vector< double > xi = natural_estimator( DD, RR, XX.size() );
+  const double dpi = double( pimax ) / npi;
+  std::vector< double > wp ( RR.size() / npi, 0. );
+  for ( std::size_t ib = 0; ib < RR.size(); ++ib )
+    wp[ ib / npi ] += 2. * dpi * xi[ ib ];
+  return wp;
+
+}
+
+//==================================================================================
+//=============================== Marked correlation ===============================
+//==================================================================================
+
+namespace {
+
+  // marks of a catalogue re-ordered as its cell list, object-major, so that the
+  // nmark marks of an object are contiguous
+  std::vector< float > marks_by_cell ( const utl::cell_list & grid,
+				       const utl::array_view< float > & MM,
+				       const std::size_t nmark ) {
+
+    const std::size_t size = grid.idx.size();
+    if ( MM.size() != nmark * size )
+      throw std::length_error( "marks should hold nmark values per object." );
+    std::vector< float > mm ( MM.size() );
+    for ( std::size_t ii = 0; ii < size; ++ii )
+      for ( std::size_t kk = 0; kk < nmark; ++kk )
+	mm[ ii * nmark + kk ] = MM[ kk * size + grid.idx[ ii ] ];
+    return mm;
+
+  }
+
+  // pairs between cell c1 of l1 and cell c2 of l2 (jj > ii when same == true):
+  // the pair count and the nmark mark products, in rows of nmark + 1 elements
+  template < bool periodic, typename bins_t >
+  inline void marked_cell_pair ( const utl::cell_list & l1, const float * m1, const std::size_t c1,
+				 const utl::cell_list & l2, const float * m2, const std::size_t c2,
+				 const bool same, const std::size_t nmark,
+				 const bins_t & bins, double * local ) {
+
+    const float box = l1.geo.box;
+    const std::size_t end = l2.start[ c2 + 1 ];
+    for ( std::size_t ii = l1.start[ c1 ]; ii < l1.start[ c1 + 1 ]; ++ii ) {
+      const float * mi = m1 + ii * nmark;
+      for ( std::size_t jj = same ? ii+1 : l2.start[ c2 ]; jj < end; ++jj ) {
+	const float dx = utl::separation< periodic >( l1.xx[ii]-l2.xx[jj], box );
+	const float dy = utl::separation< periodic >( l1.yy[ii]-l2.yy[jj], box );
+	const float dz = utl::separation< periodic >( l1.zz[ii]-l2.zz[jj], box );
+	const long ib = bins.bin( dx*dx + dy*dy + dz*dz );
+	if ( ib < 0 ) continue;
+	double * row = local + ib * ( nmark + 1 );
+	const float * mj = m2 + jj * nmark;
+	row[ 0 ] += 1.;
+	for ( std::size_t kk = 0; kk < nmark; ++kk )
+	  row[ 1 + kk ] += double( mi[ kk ] ) * mj[ kk ];
+      } // endfor jj
+    } // endfor ii
+
+  }
+
+  template < bool periodic, typename bins_t >
+  std::vector< double > grid_marked_DD ( const utl::cell_list & grid,
+					 const std::vector< float > & mm,
+					 const std::size_t nmark,
+					 const bins_t & bins,
+					 const bool omp ) {
+
+    const std::size_t ncells = grid.geo.size();
+    utl::thread_histogram< double > NDD ( bins.size() * ( nmark + 1 ), nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      double * local = NDD.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 16)
+      for ( std::size_t cc = 0; cc < ncells; ++cc ) {
+	if ( grid.count( cc ) == 0 ) continue;
+	grid.for_each_neighbour( cc, [ & ] ( const std::size_t nn ) {
+	  if ( nn >= cc )
+	    marked_cell_pair< periodic >( grid, mm.data(), cc, grid, mm.data(), nn, nn == cc,
+					  nmark, bins, local );
+	} );
+      } // endfor cc
+    } // end parallel
+
+    return NDD.reduce();
+
+  }
+
+  template < bool periodic, typename bins_t >
+  std::vector< double > grid_marked_DR ( const utl::cell_list & grid1,
+					 const std::vector< float > & mm1,
+					 const utl::cell_list & grid2,
+					 const std::vector< float > & mm2,
+					 const std::size_t nmark,
+					 const bins_t & bins,
+					 const bool omp ) {
+
+    const std::size_t ncells = grid1.geo.size();
+    utl::thread_histogram< double > NDR ( bins.size() * ( nmark + 1 ), nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      double * local = NDR.local( omp_get_thread_num() );
+#pragma omp for schedule(dynamic, 16)
+      for ( std::size_t cc = 0; cc < ncells; ++cc ) {
+	if ( grid1.count( cc ) == 0 ) continue;
+	grid1.for_each_neighbour( cc, [ & ] ( const std::size_t nn ) {
+	  marked_cell_pair< periodic >( grid1, mm1.data(), cc, grid2, mm2.data(), nn, false,
+					nmark, bins, local );
+	} );
+      } // endfor cc
+    } // end parallel
+
+    return NDR.reduce();
+
+  }
+
+  std::vector< double > marked_DD ( const utl::array_view< float > & XX,
+				    const utl::array_view< float > & YY,
+				    const utl::array_view< float > & ZZ,
+				    const utl::array_view< float > & MM,
+				    const std::size_t nmark,
+				    const std::vector< float > & rbin,
+				    const float box,
+				    const utl::binning::scheme binning,
+				    const bool omp ) {
+
+    utl::binning::check( binning, rbin );
+    utl::grid_geometry geo { XX, YY, ZZ, {}, {}, {}, rbin.back(), box };
+    const utl::cell_list grid { XX, YY, ZZ, geo };
+    const std::vector< float > mm = marks_by_cell( grid, MM, nmark );
+    return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+      return box > 0. ?
+	grid_marked_DD< true >( grid, mm, nmark, bins, omp ) :
+	grid_marked_DD< false >( grid, mm, nmark, bins, omp );
+    } );
+
+  }
+
+  std::vector< double > marked_DR ( const utl::array_view< float > & X1,
+				    const utl::array_view< float > & Y1,
+				    const utl::array_view< float > & Z1,
+				    const utl::array_view< float > & M1,
+				    const utl::array_view< float > & X2,
+				    const utl::array_view< float > & Y2,
+				    const utl::array_view< float > & Z2,
+				    const utl::array_view< float > & M2,
+				    const std::size_t nmark,
+				    const std::vector< float > & rbin,
+				    const float box,
+				    const utl::binning::scheme binning,
+				    const bool omp ) {
+
+    utl::binning::check( binning, rbin );
+    utl::grid_geometry geo { X1, Y1, Z1, X2, Y2, Z2, rbin.back(), box };
+    const utl::cell_list grid1 { X1, Y1, Z1, geo }, grid2 { X2, Y2, Z2, geo };
+    const std::vector< float > mm1 = marks_by_cell( grid1, M1, nmark );
+    const std::vector< float > mm2 = marks_by_cell( grid2, M2, nmark );
+    return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+      return box > 0. ?
+	grid_marked_DR< true >( grid1, mm1, grid2, mm2, nmark, bins, omp ) :
+	grid_marked_DR< false >( grid1, mm1, grid2, mm2, nmark, bins, omp );
+    } );
+
+  }
+
+} // endnamespace
+
+std::vector< double > utl::d3D_DD_marked ( const utl::array_view< float > & XX,
+					   const utl::array_view< float > & YY,
+					   const utl::array_view< float > & ZZ,
+					   const utl::array_view< float > & MM,
+					   const std::size_t nmark,
+					   const std::vector< float > & rbin,
+					   const float box,
+					   const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return marked_DD( XX, YY, ZZ, MM, nmark, rbin, box, binning, false );
+
+}
+
+std::vector< double > utl::d3D_DD_marked_omp ( const utl::array_view< float > & XX,
+					       const utl::array_view< float > & YY,
+					       const utl::array_view< float > & ZZ,
+					       const utl::array_view< float > & MM,
+					       const std::size_t nmark,
+					       const std::vector< float > & rbin,
+					       const float box,
+					       const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return marked_DD( XX, YY, ZZ, MM, nmark, rbin, box, binning, true );
+
+}
+
+std::vector< double > utl::d3D_DR_marked ( const utl::array_view< float > & X1,
+					   const utl::array_view< float > & Y1,
+					   const utl::array_view< float > & Z1,
+					   const utl::array_view< float > & M1,
+					   const utl::array_view< float > & X2,
+					   const utl::array_view< float > & Y2,
+					   const utl::array_view< float > & Z2,
+					   const utl::array_view< float > & M2,
+					   const std::size_t nmark,
+					   const std::vector< float > & rbin,
+					   const float box,
+					   const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return marked_DR( X1, Y1, Z1, M1, X2, Y2, Z2, M2, nmark, rbin, box, binning, false );
+
+}
+
+std::vector< double > utl::d3D_DR_marked_omp ( const utl::array_view< float > & X1,
+					       const utl::array_view< float > & Y1,
+					       const utl::array_view< float > & Z1,
+					       const utl::array_view< float > & M1,
+					       const utl::array_view< float > & X2,
+					       const utl::array_view< float > & Y2,
+					       const utl::array_view< float > & Z2,
+					       const utl::array_view< float > & M2,
+					       const std::size_t nmark,
+					       const std::vector< float > & rbin,
+					       const float box,
+					       const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return marked_DR( X1, Y1, Z1, M1, X2, Y2, Z2, M2, nmark, rbin, box, binning, true );
+
+}
+
+//==================================================================================
+//=========================== Three-point, Legendre multipoles =====================
+//==================================================================================
+
+namespace {
+
+  // Real harmonics normalised so that P_ell( a . b ) = sum_m Q_ell,m( a ) Q_ell,m( b )
+  // for unit vectors a, b (Schmidt semi-normalisation): Q_ell,0 = P_ell( z ) and
+  // Q_ell,m = sqrt( 2 ( ell - m )! / ( ell + m )! ) P_ell^m( z ) { cos, sin }( m phi ).
+  // The 2 ell + 1 harmonics of order ell are stored from element ell^2, cos and
+  // sin alternating. P_ell^m( z ) / sin^m( theta ) is a polynomial in z and
+  // sin^m( theta ) { cos, sin }( m phi ) = { Re, Im }( x + i y )^m, so that no
+  // trigonometric function is evaluated.
+  class legendre_harmonics {
+
+    std::size_t lmax;
+
+    // normalisation of order ( ell, m ), element ell * ( lmax + 1 ) + m
+    std::vector< double > norm;
+
+  public :
+
+    explicit legendre_harmonics ( const std::size_t lmax ) :
+      lmax { lmax }, norm ( ( lmax + 1 ) * ( lmax + 1 ), 1. ) {
+
+      for ( std::size_t ell = 0; ell <= lmax; ++ell )
+	for ( std::size_t mm = 1; mm <= ell; ++mm ) {
+	  double ratio = 2.;
+	  for ( std::size_t kk = ell - mm + 1; kk <= ell + mm; ++kk ) ratio /= kk;
+	  norm[ ell * ( lmax + 1 ) + mm ] = std::sqrt( ratio );
+	}
+
+    }
+
+    std::size_t size () const noexcept { return ( lmax + 1 ) * ( lmax + 1 ); }
+
+    void operator() ( const double xx, const double yy, const double zz, double * qlm ) const {
+
+      double cm = 1., sm = 0., pmm = 1.;
+      for ( std::size_t mm = 0; mm <= lmax; ++mm ) {
+	if ( mm > 0 ) {
+	  const double tmp = cm * xx - sm * yy;
+	  sm = cm * yy + sm * xx;
+	  cm = tmp;
+	  pmm *= 2 * mm - 1;
+	}
+	// upward recursion in ell of the polynomial part of P_ell^m
+	double p2 = 0., p1 = pmm;
+	for ( std::size_t ell = mm; ell <= lmax; ++ell ) {
+	  if ( ell > mm ) {
+	    const double pp = ( ( 2 * ell - 1 ) * zz * p1 - ( ell + mm - 1 ) * p2 ) / ( ell - mm );
+	    p2 = p1; p1 = pp;
+	  }
+	  const double qq = norm[ ell * ( lmax + 1 ) + mm ] * p1;
+	  if ( mm == 0 ) qlm[ ell * ell ] = qq;
+	  else {
+	    qlm[ ell * ell + 2 * mm - 1 ] = qq * cm;
+	    qlm[ ell * ell + 2 * mm ] = qq * sm;
+	  }
+	}
+      }
+
+    }
+
+  }; // endclass legendre_harmonics
+
+  // For each primary the harmonic coefficients a_ell,m( b ) of its neighbours in
+  // each bin are accumulated, then sum_m a_ell,m( b1 ) a_ell,m( b2 ) is the sum of
+  // P_ell over the pairs of neighbours, the j == k terms (P_ell( 1 ) = 1 times the
+  // squared weight) being removed from the diagonal b1 == b2
+  template < bool periodic, bool weighted, typename bins_t >
+  std::vector< double > kernel_3pcf ( const utl::cell_list & grid,
+				      const bins_t & bins,
+				      const std::size_t lmax,
+				      const bool omp ) {
+
+    const std::size_t nbin = bins.size(), ncells = grid.geo.size();
+    const float box = grid.geo.box;
+    const legendre_harmonics harmonics { lmax };
+    const std::size_t nlm = harmonics.size();
+    utl::thread_histogram< double > NNN ( ( lmax + 1 ) * nbin * nbin, nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+    {
+      double * local = NNN.local( omp_get_thread_num() );
+      std::vector< double > alm ( nbin * nlm ), w2 ( nbin ), qlm ( nlm );
+#pragma omp for schedule(dynamic, 16)
+      for ( std::size_t cc = 0; cc < ncells; ++cc )
+	for ( std::size_t ii = grid.start[ cc ]; ii < grid.start[ cc + 1 ]; ++ii ) {
+	  std::fill( alm.begin(), alm.end(), 0. );
+	  std::fill( w2.begin(), w2.end(), 0. );
+	  grid.for_each_neighbour( cc, [ & ] ( const std::size_t nn ) {
+	    for ( std::size_t jj = grid.start[ nn ]; jj < grid.start[ nn + 1 ]; ++jj ) {
+	      const float dx = utl::signed_separation< periodic >( grid.xx[jj]-grid.xx[ii], box );
+	      const float dy = utl::signed_separation< periodic >( grid.yy[jj]-grid.yy[ii], box );
+	      const float dz = utl::signed_separation< periodic >( grid.zz[jj]-grid.zz[ii], box );
+	      const float d2 = dx*dx + dy*dy + dz*dz;
+	      if ( !( d2 > 0. ) ) continue;
+	      const long ib = bins.bin( d2 );
+	      if ( ib < 0 ) continue;
+	      const double inv = 1. / std::sqrt( double( d2 ) );
+	      harmonics( dx * inv, dy * inv, dz * inv, qlm.data() );
+	      const double wj = weighted ? grid.ww[ jj ] : 1.;
+	      double * aa = alm.data() + ib * nlm;
+	      for ( std::size_t tt = 0; tt < nlm; ++tt ) aa[ tt ] += wj * qlm[ tt ];
+	      w2[ ib ] += wj * wj;
+	    } // endfor jj
+	  } );
+
+	  const double wi = weighted ? grid.ww[ ii ] : 1.;
+	  for ( std::size_t b1 = 0; b1 < nbin; ++b1 ) {
+	    if ( w2[ b1 ] == 0. ) continue;
+	    for ( std::size_t b2 = b1; b2 < nbin; ++b2 ) {
+	      if ( w2[ b2 ] == 0. ) continue;
+	      const double * a1 = alm.data() + b1 * nlm, * a2 = alm.data() + b2 * nlm;
+	      for ( std::size_t ell = 0; ell <= lmax; ++ell ) {
+		double sum = b1 == b2 ? - w2[ b1 ] : 0.;
+		for ( std::size_t tt = ell * ell; tt < ( ell + 1 ) * ( ell + 1 ); ++tt )
+		  sum += a1[ tt ] * a2[ tt ];
+		local[ ( ell * nbin + b1 ) * nbin + b2 ] += wi * sum;
+	      }
+	    }
+	  }
+	} // endfor ii, cc
+    } // end parallel
+
+    std::vector< double > out = NNN.reduce();
+    for ( std::size_t ell = 0; ell <= lmax; ++ell )
+      for ( std::size_t b1 = 0; b1 < nbin; ++b1 )
+	for ( std::size_t b2 = b1 + 1; b2 < nbin; ++b2 )
+	  out[ ( ell * nbin + b2 ) * nbin + b1 ] = out[ ( ell * nbin + b1 ) * nbin + b2 ];
+    return out;
+
+  }
+
+  // largest multipole: the polynomial parts of P_ell^m grow as ( 2 ell - 1 )!!
+  constexpr std::size_t max_lmax_3pcf = 32;
+
+  template < bool weighted >
+  std::vector< double > multipoles_3pcf ( const utl::array_view< float > & XX,
+					  const utl::array_view< float > & YY,
+					  const utl::array_view< float > & ZZ,
+					  const utl::array_view< float > & WW,
+					  const std::vector< float > & rbin,
+					  const std::size_t lmax,
+					  const float box,
+					  const utl::binning::scheme binning,
+					  const bool omp ) {
+
+    if ( lmax > max_lmax_3pcf )
+      throw std::invalid_argument( "lmax should not exceed " + std::to_string( max_lmax_3pcf ) + "." );
+    if ( weighted && WW.size() != XX.size() )
+      throw std::length_error( "weights should have the same size as the coordinates." );
+    utl::binning::check( binning, rbin );
+    utl::grid_geometry geo { XX, YY, ZZ, {}, {}, {}, rbin.back(), box };
+    const utl::cell_list grid { XX, YY, ZZ, geo, WW };
+    return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+      return box > 0. ?
+	kernel_3pcf< true, weighted >( grid, bins, lmax, omp ) :
+	kernel_3pcf< false, weighted >( grid, bins, lmax, omp );
+    } );
+
+  }
+
+} // endnamespace
+
+std::vector< double > utl::d3D_3pcf_multipoles ( const utl::array_view< float > & XX,
+						 const utl::array_view< float > & YY,
+						 const utl::array_view< float > & ZZ,
+						 const std::vector< float > & rbin,
+						 const std::size_t lmax,
+						 const float box,
+						 const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return multipoles_3pcf< false >( XX, YY, ZZ, {}, rbin, lmax, box, binning, false );
+
+}
+
+std::vector< double > utl::d3D_3pcf_multipoles_omp ( const utl::array_view< float > & XX,
+						     const utl::array_view< float > & YY,
+						     const utl::array_view< float > & ZZ,
+						     const std::vector< float > & rbin,
+						     const std::size_t lmax,
+						     const float box,
+						     const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return multipoles_3pcf< false >( XX, YY, ZZ, {}, rbin, lmax, box, binning, true );
+
+}
+
+std::vector< double > utl::wd3D_3pcf_multipoles ( const utl::array_view< float > & XX,
+						  const utl::array_view< float > & YY,
+						  const utl::array_view< float > & ZZ,
+						  const utl::array_view< float > & WW,
+						  const std::vector< float > & rbin,
+						  const std::size_t lmax,
+						  const float box,
+						  const utl::binning::scheme binning ) {
+
+  check_sizes( XX, YY, ZZ, WW );
+  check_periodic( rbin, box );
+  return multipoles_3pcf< true >( XX, YY, ZZ, WW, rbin, lmax, box, binning, false );
+
+}
+
+std::vector< double > utl::wd3D_3pcf_multipoles_omp ( const utl::array_view< float > & XX,
+						      const utl::array_view< float > & YY,
+						      const utl::array_view< float > & ZZ,
+						      const utl::array_view< float > & WW,
+						      const std::vector< float > & rbin,
+						      const std::size_t lmax,
+						      const float box,
+						      const utl::binning::scheme binning ) {
+
+  check_sizes( XX, YY, ZZ, WW );
+  check_periodic( rbin, box );
+  return multipoles_3pcf< true >( XX, YY, ZZ, WW, rbin, lmax, box, binning, true );
+
+}
+
+//==================================================================================
+//================================== Multi-tracer ==================================
+//==================================================================================
+
+namespace {
+
+  // Cell list whose objects are sorted by tracer label within each cell, so that
+  // the objects of a cell with the same label are a contiguous block for the
+  // vectorised kernel
+  struct tracer_cells {
+
+    utl::cell_list grid;
+
+    /// tracer label of each object, in cell order
+    std::vector< int > lab;
+
+    tracer_cells ( const utl::array_view< float > & XX,
+		   const utl::array_view< float > & YY,
+		   const utl::array_view< float > & ZZ,
+		   const utl::array_view< float > & WW,
+		   const utl::array_view< int > & TT,
+		   const std::size_t ntracer,
+		   const utl::grid_geometry & geo ) : grid { XX, YY, ZZ, geo, WW } {
+
+      if ( TT.size() != XX.size() )
+	throw std::length_error( "tracer labels and coordinates should have the same size." );
+      for ( const int tt : TT )
+	if ( tt < 0 || std::size_t( tt ) >= ntracer )
+	  throw std::invalid_argument( "tracer labels should lie in [0, ntracer)." );
+
+      const std::size_t size = grid.idx.size();
+      std::vector< std::size_t > perm ( size );
+      for ( std::size_t ii = 0; ii < size; ++ii ) perm[ ii ] = ii;
+      for ( std::size_t cc = 0; cc < geo.size(); ++cc )
+	if ( grid.count( cc ) > 1 )
+	  std::stable_sort( perm.begin() + grid.start[ cc ], perm.begin() + grid.start[ cc + 1 ],
+			    [ & ] ( const std::size_t ii, const std::size_t jj ) {
+			      return TT[ grid.idx[ ii ] ] < TT[ grid.idx[ jj ] ];
+			    } );
+
+      auto permute = [ & ] ( auto & vv ) {
+	if ( vv.empty() ) return;
+	auto tmp = vv;
+	for ( std::size_t ii = 0; ii < size; ++ii ) vv[ ii ] = tmp[ perm[ ii ] ];
+      };
+      permute( grid.xx ); permute( grid.yy ); permute( grid.zz );
+      permute( grid.ww ); permute( grid.idx );
+      lab.resize( size );
+      for ( std::size_t ii = 0; ii < size; ++ii ) lab[ ii ] = TT[ grid.idx[ ii ] ];
+
+    }
+
+  }; // endstruct tracer_cells
+
+  // Cumulative counts of the pairs between cell c1 and cell c2 (jj > ii when
+  // same == true), in the histogram of their pair of labels. runs holds
+  // ntracer + 1 offsets, filled with the label blocks of cell c2.
+  template < typename T >
+  inline void tracer_cell_pair ( const tracer_cells & cat,
+				 const std::size_t c1, const std::size_t c2,
+				 const bool same, const std::size_t ntracer,
+				 const std::vector< float > & edges2,
+				 std::size_t * runs, T * cum ) {
+
+    const utl::cell_list & grid = cat.grid;
+    const std::size_t nbin = edges2.size() - 1;
+    std::size_t kk = grid.start[ c2 ];
+    for ( std::size_t tt = 0; tt <= ntracer; ++tt ) {
+      while ( kk < grid.start[ c2 + 1 ] && std::size_t( cat.lab[ kk ] ) < tt ) ++kk;
+      runs[ tt ] = kk;
+    }
+    runs[ ntracer ] = grid.start[ c2 + 1 ];
+
+    for ( std::size_t ii = grid.start[ c1 ]; ii < grid.start[ c1 + 1 ]; ++ii ) {
+      const std::size_t aa = cat.lab[ ii ];
+      for ( std::size_t bb = 0; bb < ntracer; ++bb ) {
+	const std::size_t jj = same ? std::max( ii + 1, runs[ bb ] ) : runs[ bb ], end = runs[ bb + 1 ];
+	if ( jj < end )
+	  count_block( grid.xx.data(), grid.yy.data(), grid.zz.data(), grid.ww.data(), ii,
+		       grid.xx.data(), grid.yy.data(), grid.zz.data(), grid.ww.data(), jj, end - jj,
+		       edges2, grid.geo.box,
+		       cum + utl::tracer_pair( std::min( aa, bb ), std::max( aa, bb ), ntracer ) * nbin );
+      } // endfor bb
+    } // endfor ii
+
+  }
+
+  template < bool weighted >
+  std::vector< count_t< weighted > > tracers_DD ( const utl::array_view< float > & XX,
+						  const utl::array_view< float > & YY,
+						  const utl::array_view< float > & ZZ,
+						  const utl::array_view< float > & WW,
+						  const utl::array_view< int > & TT,
+						  const std::size_t ntracer,
+						  const std::vector< float > & rbin,
+						  const float box,
+						  const utl::binning::scheme binning,
+						  const bool omp ) {
+
+    if ( ntracer == 0 ) throw std::invalid_argument( "ntracer should be positive." );
+    const std::size_t npair = ntracer * ( ntracer + 1 ) / 2;
+    utl::binning::check( binning, rbin );
+    utl::grid_geometry geo { XX, YY, ZZ, {}, {}, {}, rbin.back(), box };
+    const tracer_cells cat { XX, YY, ZZ, WW, TT, ntracer, geo };
+
+    return utl::binning::visit( binning, rbin, [ & ] ( const auto & bins ) {
+
+      const std::vector< float > & edges2 = bins.edges2();
+      const std::size_t nbin = edges2.size() - 1, ncells = geo.size();
+      utl::thread_histogram< count_t< weighted > > cum ( npair * nbin, nthreads( omp ) );
+
+#pragma omp parallel if(omp)
+      {
+	count_t< weighted > * local = cum.local( omp_get_thread_num() );
+	std::vector< std::size_t > runs ( ntracer + 1 );
+#pragma omp for schedule(dynamic, 16)
+	for ( std::size_t cc = 0; cc < ncells; ++cc ) {
+	  if ( cat.grid.count( cc ) == 0 ) continue;
+	  cat.grid.for_each_neighbour( cc, [ & ] ( const std::size_t nn ) {
+	    if ( nn >= cc )
+	      tracer_cell_pair( cat, cc, nn, nn == cc, ntracer, edges2, runs.data(), local );
+	  } );
+	} // endfor cc
+      } // end parallel
+
+      std::vector< count_t< weighted > > NN = cum.reduce();
+      for ( std::size_t pp = 0; pp < npair; ++pp )
+	for ( std::size_t ib = 0; ib + 1 < nbin; ++ib )
+	  NN[ pp * nbin + ib ] -= NN[ pp * nbin + ib + 1 ];
+      return NN;
+
+    } );
+
+  }
+
+} // endnamespace
+
+std::vector< std::size_t > utl::d3D_DD_tracers ( const utl::array_view< float > & XX,
+						 const utl::array_view< float > & YY,
+						 const utl::array_view< float > & ZZ,
+						 const utl::array_view< int > & TT,
+						 const std::size_t ntracer,
+						 const std::vector< float > & rbin,
+						 const float box,
+						 const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return tracers_DD< false >( XX, YY, ZZ, {}, TT, ntracer, rbin, box, binning, false );
+
+}
+
+std::vector< std::size_t > utl::d3D_DD_tracers_omp ( const utl::array_view< float > & XX,
+						     const utl::array_view< float > & YY,
+						     const utl::array_view< float > & ZZ,
+						     const utl::array_view< int > & TT,
+						     const std::size_t ntracer,
+						     const std::vector< float > & rbin,
+						     const float box,
+						     const utl::binning::scheme binning ) {
+
+  check_periodic( rbin, box );
+  return tracers_DD< false >( XX, YY, ZZ, {}, TT, ntracer, rbin, box, binning, true );
+
+}
+
+std::vector< double > utl::wd3D_DD_tracers ( const utl::array_view< float > & XX,
+					     const utl::array_view< float > & YY,
+					     const utl::array_view< float > & ZZ,
+					     const utl::array_view< float > & WW,
+					     const utl::array_view< int > & TT,
+					     const std::size_t ntracer,
+					     const std::vector< float > & rbin,
+					     const float box,
+					     const utl::binning::scheme binning ) {
+
+  check_sizes( XX, YY, ZZ, WW );
+  check_periodic( rbin, box );
+  return tracers_DD< true >( XX, YY, ZZ, WW, TT, ntracer, rbin, box, binning, false );
+
+}
+
+std::vector< double > utl::wd3D_DD_tracers_omp ( const utl::array_view< float > & XX,
+						 const utl::array_view< float > & YY,
+						 const utl::array_view< float > & ZZ,
+						 const utl::array_view< float > & WW,
+						 const utl::array_view< int > & TT,
+						 const std::size_t ntracer,
+						 const std::vector< float > & rbin,
+						 const float box,
+						 const utl::binning::scheme binning ) {
+
+  check_sizes( XX, YY, ZZ, WW );
+  check_periodic( rbin, box );
+  return tracers_DD< true >( XX, YY, ZZ, WW, TT, ntracer, rbin, box, binning, true );
+
+}
+
 //==================================================================================
 //==================================================================================
@@ -0,0 +1,192 @@
+#include <counts_in_cells.h>
+#include <cell_list.h>
+#include <separation.h>
+#include <thread_histogram.h>
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+//==================================================================================
+
+namespace {
+
+  // distance between x and the points of the interval [ lo, lo + side ]:
+  // lower bound and upper bound (exact with open boundaries, conservative
+  // with periodic ones)
+  template < bool periodic >
+  inline void interval_distance ( const float xx, const float lo, const float side, const float box,
+				  float & dmin, float & dmax ) noexcept {
+    const float dd = std::fabs( utl::separation< periodic >( lo + 0.5f * side - xx, box ) );
+    dmin = std::max( dd - 0.5f * side, 0.f );
+    dmax = dd + 0.5f * side;
+  }
+
+  // Counts around the centres of each cell of the centre list: the neighbour
+  // cells of the data list are gathered once per cell of centres. inc holds,
+  // per sphere, the number of objects whose smallest enclosing radius is ir
+  // (ir == nrad beyond the largest); the counts are its cumulative sums.
+  // Sums of the powers of the counts are accumulated around the expected count
+  // shift, to avoid cancellations in the central moments.
+  template < bool periodic >
+  utl::counts_in_cells_result cic_kernel ( const utl::cell_list & data,
+					   const utl::cell_list & cen,
+					   const std::vector< float > & radii,
+					   const std::vector< double > & shift,
+					   const std::size_t nmax,
+					   const bool omp ) {
+
+    const utl::grid_geometry & geo = data.geo;
+    const std::size_t nrad = radii.size(), ncells = geo.size(), nn1 = nmax + 1;
+    std::vector< float > r2 ( nrad );
+    for ( std::size_t ir = 0; ir < nrad; ++ir ) r2[ ir ] = radii[ ir ] * radii[ ir ];
+    const std::size_t nth = omp ? omp_get_max_threads() : 1;
+    utl::thread_histogram< std::size_t > PN ( nrad * nn1, nth );
+    utl::thread_histogram< double > SS ( nrad * 4, nth );
+
+#pragma omp parallel if(omp)
+    {
+      std::size_t * hist = PN.local( omp_get_thread_num() );
+      double * sums = SS.local( omp_get_thread_num() );
+      std::vector< std::size_t > neigh, inc ( nrad + 1 );
+#pragma omp for schedule(dynamic, 16)
+      for ( std::size_t cc = 0; cc < ncells; ++cc ) {
+	if ( cen.count( cc ) == 0 ) continue;
+	neigh.clear();
+	data.for_each_neighbour( cc, [ & ] ( const std::size_t nb ) {
+	  if ( data.count( nb ) > 0 ) neigh.push_back( nb );
+	} );
+
+	for ( std::size_t kk = cen.start[ cc ]; kk < cen.start[ cc + 1 ]; ++kk ) {
+	  const float cx = cen.xx[ kk ], cy = cen.yy[ kk ], cz = cen.zz[ kk ];
+	  std::fill( inc.begin(), inc.end(), 0 );
+	  for ( const std::size_t nb : neigh ) {
+	    const std::size_t ix = nb / ( geo.nc[ 2 ] * geo.nc[ 1 ] );
+	    const std::size_t iy = ( nb / geo.nc[ 2 ] ) % geo.nc[ 1 ], iz = nb % geo.nc[ 2 ];
+	    float lx, hx, ly, hy, lz, hz;
+	    interval_distance< periodic >( cx, geo.lo[ 0 ] + ix * geo.side[ 0 ], geo.side[ 0 ], geo.box, lx, hx );
+	    interval_distance< periodic >( cy, geo.lo[ 1 ] + iy * geo.side[ 1 ], geo.side[ 1 ], geo.box, ly, hy );
+	    interval_distance< periodic >( cz, geo.lo[ 2 ] + iz * geo.side[ 2 ], geo.side[ 2 ], geo.box, lz, hz );
+	    // the objects of the cell have their smallest enclosing radius in [ lo, hi ]
+	    // (hi == nrad: beyond the largest), the whole cell is counted at once
+	    // when lo == hi
+	    const float dmin2 = lx * lx + ly * ly + lz * lz, dmax2 = hx * hx + hy * hy + hz * hz;
+	    const std::size_t lo = std::upper_bound( r2.begin(), r2.end(), dmin2 ) - r2.begin();
+	    if ( lo == nrad ) continue;
+	    const std::size_t hi = std::upper_bound( r2.begin() + lo, r2.end(), dmax2 ) - r2.begin();
+	    if ( lo == hi ) { inc[ lo ] += data.count( nb ); continue; }
+	    for ( std::size_t jj = data.start[ nb ]; jj < data.start[ nb + 1 ]; ++jj ) {
+	      const float dx = utl::separation< periodic >( data.xx[ jj ] - cx, geo.box );
+	      const float dy = utl::separation< periodic >( data.yy[ jj ] - cy, geo.box );
+	      const float dz = utl::separation< periodic >( data.zz[ jj ] - cz, geo.box );
+	      const float d2 = dx * dx + dy * dy + dz * dz;
+	      std::size_t ir = lo;
+	      for ( std::size_t kk = lo; kk < hi; ++kk ) ir += d2 >= r2[ kk ];
+	      ++inc[ ir ];
+	    } // endfor jj
+	  } // endfor nb
+
+	  std::size_t NN = 0;
+	  for ( std::size_t ir = 0; ir < nrad; ++ir ) {
+	    NN += inc[ ir ];
+	    ++hist[ ir * nn1 + std::min( NN, nmax ) ];
+	    const double dd = double( NN ) - shift[ ir ], d2 = dd * dd;
+	    sums[ ir * 4 ] += dd;
+	    sums[ ir * 4 + 1 ] += d2;
+	    sums[ ir * 4 + 2 ] += d2 * dd;
+	    sums[ ir * 4 + 3 ] += d2 * d2;
+	  } // endfor ir
+	} // endfor kk
+      } // endfor cc
+    } // end parallel
+
+    utl::counts_in_cells_result res;
+    res.nsphere = cen.xx.size();
+    res.nmax = nmax;
+    res.PN = PN.reduce();
+    const std::vector< double > sums = SS.reduce();
+    res.moments.assign( nrad * 4, 0. );
+    if ( res.nsphere == 0 ) return res;
+    for ( std::size_t ir = 0; ir < nrad; ++ir ) {
+      const double m1 = sums[ ir * 4 ] / res.nsphere, m2 = sums[ ir * 4 + 1 ] / res.nsphere;
+      const double m3 = sums[ ir * 4 + 2 ] / res.nsphere, m4 = sums[ ir * 4 + 3 ] / res.nsphere;
+      res.moments[ ir * 4 ] = shift[ ir ] + m1;
+      res.moments[ ir * 4 + 1 ] = m2 - m1 * m1;
+      res.moments[ ir * 4 + 2 ] = m3 - 3. * m1 * m2 + 2. * m1 * m1 * m1;
+      res.moments[ ir * 4 + 3 ] = m4 - 4. * m1 * m3 + 6. * m1 * m1 * m2 - 3. * m1 * m1 * m1 * m1;
+    }
+    return res;
+
+  }
+
+  utl::counts_in_cells_result cic ( const utl::array_view< float > & XX,
+				    const utl::array_view< float > & YY,
+				    const utl::array_view< float > & ZZ,
+				    const utl::array_view< float > & CX,
+				    const utl::array_view< float > & CY,
+				    const utl::array_view< float > & CZ,
+				    const std::vector< float > & radii,
+				    const std::size_t nmax,
+				    const float box,
+				    const bool omp ) {
+
+    if ( radii.empty() || !( radii.front() > 0.f ) )
+      throw std::invalid_argument( "counts in cells need positive radii" );
+    for ( std::size_t ir = 1; ir < radii.size(); ++ir )
+      if ( !( radii[ ir ] > radii[ ir - 1 ] ) )
+	throw std::invalid_argument( "radii should be strictly increasing" );
+    if ( box > 0. && radii.back() > 0.5f * box )
+      throw std::invalid_argument( "radii in a periodic box should not exceed box/2" );
+    if ( YY.size() != XX.size() || ZZ.size() != XX.size() ||
+	 CY.size() != CX.size() || CZ.size() != CX.size() )
+      throw std::length_error( "coordinate arrays should have the same size." );
+
+    const utl::grid_geometry geo { XX, YY, ZZ, {}, {}, {}, radii.back(), box };
+    const utl::cell_list data { XX, YY, ZZ, geo }, cen { CX, CY, CZ, geo };
+
+    // expected count in each sphere: mean density of the grid volume
+    double volume = 1.;
+    for ( std::size_t dd = 0; dd < 3; ++dd ) volume *= geo.nc[ dd ] * double( geo.side[ dd ] );
+    std::vector< double > shift ( radii.size() );
+    for ( std::size_t ir = 0; ir < radii.size(); ++ir )
+      shift[ ir ] = std::round( XX.size() / volume * 4. / 3. * M_PI * std::pow( double( radii[ ir ] ), 3 ) );
+
+    return box > 0. ?
+      cic_kernel< true >( data, cen, radii, shift, nmax, omp ) :
+      cic_kernel< false >( data, cen, radii, shift, nmax, omp );
+
+  }
+
+} // endnamespace
+
+//==================================================================================
+
+utl::counts_in_cells_result utl::counts_in_cells ( const utl::array_view< float > & XX,
+						   const utl::array_view< float > & YY,
+						   const utl::array_view< float > & ZZ,
+						   const utl::array_view< float > & CX,
+						   const utl::array_view< float > & CY,
+						   const utl::array_view< float > & CZ,
+						   const std::vector< float > & radii,
+						   const std::size_t nmax,
+						   const float box ) {
+
+  return cic( XX, YY, ZZ, CX, CY, CZ, radii, nmax, box, false );
+
+}
+
+utl::counts_in_cells_result utl::counts_in_cells_omp ( const utl::array_view< float > & XX,
+						       const utl::array_view< float > & YY,
+						       const utl::array_view< float > & ZZ,
+						       const utl::array_view< float > & CX,
+						       const utl::array_view< float > & CY,
+						       const utl::array_view< float > & CZ,
+						       const std::vector< float > & radii,
+						       const std::size_t nmax,
+						       const float box ) {
+
+  return cic( XX, YY, ZZ, CX, CY, CZ, radii, nmax, box, true );
+
+}
+
+//==================================================================================
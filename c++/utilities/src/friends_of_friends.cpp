@@ -0,0 +1,149 @@
+#include <friends_of_friends.h>
+#include <cell_list.h>
+#include <separation.h>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+//==================================================================================
+
+namespace {
+
+  // parent of each object of the cell list in the union-find forest: parents only
+  // ever move to smaller indices, which keeps the forest consistent under
+  // concurrent links and path halvings
+  using forest = std::vector< std::atomic< std::size_t > >;
+
+  // root of ii, halving the path on the way
+  inline std::size_t find ( forest & parent, std::size_t ii ) noexcept {
+    while ( true ) {
+      std::size_t pp = parent[ ii ].load( std::memory_order_relaxed );
+      if ( pp == ii ) return ii;
+      const std::size_t gg = parent[ pp ].load( std::memory_order_relaxed );
+      if ( gg != pp ) parent[ ii ].compare_exchange_weak( pp, gg, std::memory_order_relaxed );
+      ii = gg;
+    }
+  }
+
+  // merges the trees of aa and bb, linking the larger root under the smaller
+  // (retried when another thread has linked the root in the meantime)
+  inline void unite ( forest & parent, std::size_t aa, std::size_t bb ) noexcept {
+    while ( true ) {
+      aa = find( parent, aa );
+      bb = find( parent, bb );
+      if ( aa == bb ) return;
+      if ( aa < bb ) std::swap( aa, bb );
+      std::size_t expected = aa;
+      if ( parent[ aa ].compare_exchange_strong( expected, bb, std::memory_order_relaxed ) ) return;
+    }
+  }
+
+  // Links every pair of objects closer than the linking length bb (at most the
+  // rmax of the grid): each pair of neighbour cells is visited once, from the
+  // cell of smaller index.
+  template < bool periodic >
+  void link ( const utl::cell_list & cl, const float bb, forest & parent, const bool omp ) {
+
+    const float b2 = bb * bb, box = cl.geo.box;
+    const std::size_t ncells = cl.geo.size();
+
+#pragma omp parallel if(omp)
+    {
+#pragma omp for schedule(dynamic, 16)
+      for ( std::size_t cc = 0; cc < ncells; ++cc ) {
+	if ( cl.count( cc ) == 0 ) continue;
+	cl.for_each_neighbour( cc, [ & ] ( const std::size_t nb ) {
+	  if ( nb < cc ) return;
+	  for ( std::size_t ii = cl.start[ cc ]; ii < cl.start[ cc + 1 ]; ++ii )
+	    for ( std::size_t jj = nb == cc ? ii + 1 : cl.start[ nb ]; jj < cl.start[ nb + 1 ]; ++jj ) {
+	      const float dx = utl::separation< periodic >( cl.xx[ jj ] - cl.xx[ ii ], box );
+	      const float dy = utl::separation< periodic >( cl.yy[ jj ] - cl.yy[ ii ], box );
+	      const float dz = utl::separation< periodic >( cl.zz[ jj ] - cl.zz[ ii ], box );
+	      if ( dx * dx + dy * dy + dz * dz <= b2 ) unite( parent, ii, jj );
+	    } // endfor jj, ii
+	} );
+      } // endfor cc
+    } // end parallel
+
+  }
+
+  utl::fof_result fof ( const utl::array_view< float > & XX,
+			const utl::array_view< float > & YY,
+			const utl::array_view< float > & ZZ,
+			const float linking_length,
+			const float box,
+			const bool omp ) {
+
+    if ( !( linking_length > 0.f ) || !std::isfinite( linking_length ) )
+      throw std::invalid_argument( "friends of friends need a positive linking length" );
+    if ( box > 0. && !( linking_length < 0.5f * box ) )
+      throw std::invalid_argument( "the linking length in a periodic box should be below box/2" );
+    if ( YY.size() != XX.size() || ZZ.size() != XX.size() )
+      throw std::length_error( "coordinate arrays should have the same size." );
+
+    const std::size_t nobj = XX.size();
+    utl::fof_result res;
+    res.group.resize( nobj );
+    {
+      // on sparse catalogues, cells of the size of the linking length are mostly
+      // empty: coarser cells, holding about 8 objects each, are lighter to build
+      // and walk
+      utl::grid_geometry geo { XX, YY, ZZ, {}, {}, {}, linking_length, box };
+      const double fill = double( nobj ) / geo.size();
+      if ( fill < 8. )
+	geo = utl::grid_geometry { XX, YY, ZZ, {}, {}, {},
+				   float( linking_length * std::cbrt( 8. / fill ) ), box };
+      const utl::cell_list cl { XX, YY, ZZ, geo };
+      forest parent ( nobj );
+#pragma omp parallel for schedule(static) if(omp)
+      for ( std::size_t ii = 0; ii < nobj; ++ii ) parent[ ii ].store( ii, std::memory_order_relaxed );
+
+      if ( box > 0. ) link< true >( cl, linking_length, parent, omp );
+      else link< false >( cl, linking_length, parent, omp );
+
+      // root of each object, in input order for now
+#pragma omp parallel for schedule(static) if(omp)
+      for ( std::size_t ii = 0; ii < nobj; ++ii ) res.group[ cl.idx[ ii ] ] = find( parent, ii );
+    }
+
+    // groups numbered in order of their first object in the input catalogue
+    std::vector< std::size_t > label ( nobj, nobj );
+    for ( std::size_t ii = 0; ii < nobj; ++ii ) {
+      std::size_t & ll = label[ res.group[ ii ] ];
+      if ( ll == nobj ) {
+	ll = res.multiplicity.size();
+	res.multiplicity.push_back( 0 );
+      }
+      res.group[ ii ] = ll;
+      ++res.multiplicity[ ll ];
+    }
+    return res;
+
+  }
+
+} // endnamespace
+
+//==================================================================================
+
+utl::fof_result utl::friends_of_friends ( const utl::array_view< float > & XX,
+					  const utl::array_view< float > & YY,
+					  const utl::array_view< float > & ZZ,
+					  const float linking_length,
+					  const float box ) {
+
+  return fof( XX, YY, ZZ, linking_length, box, false );
+
+}
+
+utl::fof_result utl::friends_of_friends_omp ( const utl::array_view< float > & XX,
+					      const utl::array_view< float > & YY,
+					      const utl::array_view< float > & ZZ,
+					      const float linking_length,
+					      const float box ) {
+
+  return fof( XX, YY, ZZ, linking_length, box, true );
+
+}
+
+//==================================================================================
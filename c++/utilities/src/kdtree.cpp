@@ -0,0 +1,94 @@
+#include <kdtree.h>
+#include <limits>
+#include <stdexcept>
+
+//==================================================================================
+
+utl::kdtree::kdtree ( const utl::array_view< float > & XX,
+		      const utl::array_view< float > & YY,
+		      const utl::array_view< float > & ZZ,
+		      const std::size_t leaf_size,
+		      const utl::array_view< float > & WW ) {
+
+  const std::size_t size = XX.size();
+  if ( YY.size() != size || ZZ.size() != size || ( !WW.empty() && WW.size() != size ) )
+    throw std::length_error( "coordinates and weights should have the same size." );
+  xx.assign( XX.begin(), XX.end() );
+  yy.assign( YY.begin(), YY.end() );
+  zz.assign( ZZ.begin(), ZZ.end() );
+  ww.assign( WW.begin(), WW.end() );
+  idx.resize( size );
+  for ( std::size_t ii = 0; ii < size; ++ii ) idx[ ii ] = ii;
+
+  nodes.reserve( 2 * ( size / std::max( leaf_size, std::size_t( 1 ) ) + 1 ) );
+  nodes.emplace_back();
+  nodes[ 0 ].begin = 0;
+  nodes[ 0 ].end = size;
+  split( 0, std::max( leaf_size, std::size_t( 1 ) ) );
+
+  // re-order the coordinates following the tree
+  for ( std::size_t ii = 0; ii < size; ++ii ) {
+    xx[ ii ] = XX[ idx[ ii ] ];
+    yy[ ii ] = YY[ idx[ ii ] ];
+    zz[ ii ] = ZZ[ idx[ ii ] ];
+  }
+  if ( !ww.empty() )
+    for ( std::size_t ii = 0; ii < size; ++ii ) ww[ ii ] = WW[ idx[ ii ] ];
+
+}
+
+//==================================================================================
+
+void utl::kdtree::split ( const std::size_t nn, const std::size_t leaf_size ) {
+
+  const std::size_t begin = nodes[ nn ].begin, end = nodes[ nn ].end;
+  const std::vector< float > * coord[ 3 ] = { &xx, &yy, &zz };
+
+  // bounding box (coordinates are still in input order, accessed through idx)
+  std::array< float, 3 > lo, hi;
+  lo.fill( std::numeric_limits< float >::max() );
+  hi.fill( std::numeric_limits< float >::lowest() );
+  for ( std::size_t ii = begin; ii < end; ++ii )
+    for ( std::size_t dd = 0; dd < 3; ++dd ) {
+      float vv = ( *coord[ dd ] )[ idx[ ii ] ];
+      lo[ dd ] = std::min( lo[ dd ], vv );
+      hi[ dd ] = std::max( hi[ dd ], vv );
+    }
+  if ( begin == end ) { lo.fill( 0. ); hi.fill( 0. ); }
+  nodes[ nn ].lo = lo;
+  nodes[ nn ].hi = hi;
+
+  if ( !ww.empty() )
+    for ( std::size_t ii = begin; ii < end; ++ii ) {
+      nodes[ nn ].wsum += ww[ idx[ ii ] ];
+      nodes[ nn ].w2sum += double( ww[ idx[ ii ] ] ) * ww[ idx[ ii ] ];
+    }
+
+  if ( end - begin <= leaf_size ) return;
+
+  // split at the median of the widest dimension
+  std::size_t dim = 0;
+  for ( std::size_t dd = 1; dd < 3; ++dd )
+    if ( hi[ dd ] - lo[ dd ] > hi[ dim ] - lo[ dim ] ) dim = dd;
+  const std::vector< float > & cc = *coord[ dim ];
+  const std::size_t mid = begin + ( end - begin ) / 2;
+  std::nth_element( idx.begin() + begin, idx.begin() + mid, idx.begin() + end,
+		    [ & ] ( const std::size_t aa, const std::size_t bb ) {
+		      return cc[ aa ] < cc[ bb ];
+		    } );
+
+  const std::size_t left = nodes.size();
+  nodes.emplace_back();
+  nodes.emplace_back();
+  nodes[ nn ].left = left;
+  nodes[ nn ].right = left + 1;
+  nodes[ left ].begin = begin;
+  nodes[ left ].end = mid;
+  nodes[ left + 1 ].begin = mid;
+  nodes[ left + 1 ].end = end;
+  split( left, leaf_size );
+  split( left + 1, leaf_size );
+
+}
+
+//==================================================================================
@@ -0,0 +1,201 @@
+#include <knn_cdf.h>
+#include <kdtree.h>
+#include <cell_list.h>
+#include <separation.h>
+#include <thread_histogram.h>
+#include <omp.h>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+//==================================================================================
+
+namespace {
+
+  // squared distance from qq to the bounding box of node nn (minimum image
+  // with periodic = true)
+  template < bool periodic >
+  inline float box_dist2 ( const utl::kdtree::node & nn, const float * qq, const float box ) noexcept {
+    float d2 = 0.;
+    for ( std::size_t dd = 0; dd < 3; ++dd ) {
+      float gg = std::max( { nn.lo[ dd ] - qq[ dd ], qq[ dd ] - nn.hi[ dd ], 0.f } );
+      if constexpr ( periodic ) {
+	const float gmax = std::max( nn.hi[ dd ] - qq[ dd ], qq[ dd ] - nn.lo[ dd ] );
+	gg = std::max( std::min( gg, box - gmax ), 0.f );
+      }
+      d2 += gg * gg;
+    }
+    return d2;
+  }
+
+  // Depth-first search of the kmax nearest objects of qq closer than sqrt( bound2 ):
+  // heap is a max-heap of their squared distances, nearer children are visited first
+  // and nodes farther than the current k-th distance are pruned.
+  template < bool periodic >
+  void nearest ( const utl::kdtree & tree, const float * qq, const std::size_t kmax,
+		 const float bound2, const float box, std::vector< float > & heap,
+		 std::vector< std::pair< float, std::size_t > > & stack ) {
+
+    heap.clear();
+    stack.clear();
+    float top = bound2;
+    stack.emplace_back( box_dist2< periodic >( tree.nodes[ 0 ], qq, box ), 0 );
+    while ( !stack.empty() ) {
+      const auto [ dn, nn ] = stack.back();
+      stack.pop_back();
+      if ( dn > top ) continue;
+      const utl::kdtree::node & node = tree.nodes[ nn ];
+      if ( node.leaf() ) {
+	for ( std::size_t jj = node.begin; jj < node.end; ++jj ) {
+	  const float dx = utl::separation< periodic >( tree.xx[ jj ] - qq[ 0 ], box );
+	  const float dy = utl::separation< periodic >( tree.yy[ jj ] - qq[ 1 ], box );
+	  const float dz = utl::separation< periodic >( tree.zz[ jj ] - qq[ 2 ], box );
+	  const float d2 = dx * dx + dy * dy + dz * dz;
+	  if ( d2 > top || ( heap.size() == kmax && d2 == top ) ) continue;
+	  if ( heap.size() == kmax ) {
+	    std::pop_heap( heap.begin(), heap.end() );
+	    heap.back() = d2;
+	  }
+	  else heap.push_back( d2 );
+	  std::push_heap( heap.begin(), heap.end() );
+	  if ( heap.size() == kmax ) top = heap.front();
+	} // endfor jj
+	continue;
+      }
+      const float dl = box_dist2< periodic >( tree.nodes[ node.left ], qq, box );
+      const float dr = box_dist2< periodic >( tree.nodes[ node.right ], qq, box );
+      // the nearer child goes on top of the stack
+      if ( dl < dr ) {
+	if ( dr <= top ) stack.emplace_back( dr, node.right );
+	stack.emplace_back( dl, node.left );
+      }
+      else {
+	if ( dl <= top ) stack.emplace_back( dl, node.left );
+	stack.emplace_back( dr, node.right );
+      }
+    } // endwhile
+    std::sort_heap( heap.begin(), heap.end() );
+
+  }
+
+  // Query points are visited cell by cell on a grid of side ~ radii.back(), so
+  // that consecutive searches walk the same branches of the tree. hist holds,
+  // per k, the number of queries whose k-th distance lies in ( r[ ir - 1 ], r[ ir ] ]
+  // (ir == nrad: beyond the largest radius or fewer than k objects found).
+  template < bool periodic >
+  utl::knn_cdf_result knn_kernel ( const utl::kdtree & tree,
+				   const utl::cell_list & query,
+				   const std::vector< std::size_t > & kk,
+				   const std::vector< float > & radii,
+				   const bool omp ) {
+
+    const std::size_t nk = kk.size(), nrad = radii.size(), nr1 = nrad + 1;
+    const std::size_t ncells = query.geo.size(), kmax = kk.back();
+    const float box = query.geo.box;
+    std::vector< float > r2 ( nrad );
+    for ( std::size_t ir = 0; ir < nrad; ++ir ) r2[ ir ] = radii[ ir ] * radii[ ir ];
+    const std::size_t nth = omp ? omp_get_max_threads() : 1;
+    utl::thread_histogram< std::size_t > HH ( nk * nr1, nth );
+
+#pragma omp parallel if(omp)
+    {
+      std::size_t * hist = HH.local( omp_get_thread_num() );
+      std::vector< float > heap;
+      std::vector< std::pair< float, std::size_t > > stack;
+      heap.reserve( kmax );
+#pragma omp for schedule(dynamic, 16)
+      for ( std::size_t cc = 0; cc < ncells; ++cc )
+	for ( std::size_t qq = query.start[ cc ]; qq < query.start[ cc + 1 ]; ++qq ) {
+	  const float pos[ 3 ] = { query.xx[ qq ], query.yy[ qq ], query.zz[ qq ] };
+	  nearest< periodic >( tree, pos, kmax, r2.back(), box, heap, stack );
+	  for ( std::size_t ik = 0; ik < nk; ++ik ) {
+	    const std::size_t ir = kk[ ik ] <= heap.size() ?
+	      std::lower_bound( r2.begin(), r2.end(), heap[ kk[ ik ] - 1 ] ) - r2.begin() : nrad;
+	    ++hist[ ik * nr1 + ir ];
+	  }
+	} // endfor qq, cc
+    } // end parallel
+
+    const std::vector< std::size_t > hist = HH.reduce();
+    utl::knn_cdf_result res;
+    res.nquery = query.xx.size();
+    res.CDF.assign( nk * nrad, 0 );
+    for ( std::size_t ik = 0; ik < nk; ++ik ) {
+      std::size_t NN = 0;
+      for ( std::size_t ir = 0; ir < nrad; ++ir )
+	res.CDF[ ik * nrad + ir ] = NN += hist[ ik * nr1 + ir ];
+    }
+    return res;
+
+  }
+
+  utl::knn_cdf_result knn ( const utl::array_view< float > & XX,
+			    const utl::array_view< float > & YY,
+			    const utl::array_view< float > & ZZ,
+			    const utl::array_view< float > & QX,
+			    const utl::array_view< float > & QY,
+			    const utl::array_view< float > & QZ,
+			    const std::vector< std::size_t > & kk,
+			    const std::vector< float > & radii,
+			    const float box,
+			    const bool omp ) {
+
+    if ( kk.empty() || kk.front() == 0 )
+      throw std::invalid_argument( "kNN distributions need positive k" );
+    for ( std::size_t ik = 1; ik < kk.size(); ++ik )
+      if ( !( kk[ ik ] > kk[ ik - 1 ] ) )
+	throw std::invalid_argument( "k should be strictly increasing" );
+    if ( radii.empty() || !( radii.front() > 0.f ) )
+      throw std::invalid_argument( "kNN distributions need positive radii" );
+    for ( std::size_t ir = 1; ir < radii.size(); ++ir )
+      if ( !( radii[ ir ] > radii[ ir - 1 ] ) )
+	throw std::invalid_argument( "radii should be strictly increasing" );
+    if ( box > 0. && radii.back() > 0.5f * box )
+      throw std::invalid_argument( "radii in a periodic box should not exceed box/2" );
+    if ( YY.size() != XX.size() || ZZ.size() != XX.size() ||
+	 QY.size() != QX.size() || QZ.size() != QX.size() )
+      throw std::length_error( "coordinate arrays should have the same size." );
+
+    const utl::kdtree tree { XX, YY, ZZ };
+    const utl::grid_geometry geo { QX, QY, QZ, {}, {}, {}, radii.back(), box };
+    const utl::cell_list query { QX, QY, QZ, geo };
+
+    return box > 0. ?
+      knn_kernel< true >( tree, query, kk, radii, omp ) :
+      knn_kernel< false >( tree, query, kk, radii, omp );
+
+  }
+
+} // endnamespace
+
+//==================================================================================
+
+utl::knn_cdf_result utl::knn_cdf ( const utl::array_view< float > & XX,
+				   const utl::array_view< float > & YY,
+				   const utl::array_view< float > & ZZ,
+				   const utl::array_view< float > & QX,
+				   const utl::array_view< float > & QY,
+				   const utl::array_view< float > & QZ,
+				   const std::vector< std::size_t > & kk,
+				   const std::vector< float > & radii,
+				   const float box ) {
+
+  return knn( XX, YY, ZZ, QX, QY, QZ, kk, radii, box, false );
+
+}
+
+utl::knn_cdf_result utl::knn_cdf_omp ( const utl::array_view< float > & XX,
+				       const utl::array_view< float > & YY,
+				       const utl::array_view< float > & ZZ,
+				       const utl::array_view< float > & QX,
+				       const utl::array_view< float > & QY,
+				       const utl::array_view< float > & QZ,
+				       const std::vector< std::size_t > & kk,
+				       const std::vector< float > & radii,
+				       const float box ) {
+
+  return knn( XX, YY, ZZ, QX, QY, QZ, kk, radii, box, true );
+
+}
+
+//==================================================================================
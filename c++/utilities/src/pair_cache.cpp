@@ -0,0 +1,215 @@
+#include <pair_cache.h>
+#include <omp.h>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+  // multiplicative constants of the 64-bit lanes
+  constexpr std::uint64_t P1 = 0x9E3779B185EBCA87ull, P2 = 0xC2B2AE3D27D4EB4Full;
+  constexpr std::uint64_t P3 = 0x165667B19E3779F9ull, P4 = 0x85EBCA77C2B2AE63ull;
+
+  // buffers are hashed in blocks of this size, independently of the number of threads
+  constexpr std::size_t block_bytes = std::size_t( 1 ) << 20;
+
+  inline std::uint64_t rotl ( const std::uint64_t xx, const int rr ) noexcept {
+    return ( xx << rr ) | ( xx >> ( 64 - rr ) );
+  }
+
+  // finaliser of SplitMix64, a bijection with full avalanche
+  inline std::uint64_t mix64 ( std::uint64_t zz ) noexcept {
+    zz = ( zz ^ ( zz >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+    zz = ( zz ^ ( zz >> 27 ) ) * 0x94D049BB133111EBull;
+    return zz ^ ( zz >> 31 );
+  }
+
+  inline std::uint64_t word ( const unsigned char * ptr ) noexcept {
+    std::uint64_t ww;
+    std::memcpy( &ww, ptr, sizeof( ww ) );
+    return ww;
+  }
+
+  inline std::uint64_t lane ( const std::uint64_t acc, const std::uint64_t in ) noexcept {
+    return rotl( acc + in * P2, 31 ) * P1;
+  }
+
+  // 128-bit digest of one block: four independent lanes over 32-byte stripes
+  utl::pair_key hash_block ( const unsigned char * ptr, const std::size_t nbytes,
+			     const std::uint64_t seed ) {
+
+    std::uint64_t v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+    std::size_t ii = 0;
+    for ( ; ii + 32 <= nbytes; ii += 32 ) {
+      v1 = lane( v1, word( ptr + ii ) );
+      v2 = lane( v2, word( ptr + ii + 8 ) );
+      v3 = lane( v3, word( ptr + ii + 16 ) );
+      v4 = lane( v4, word( ptr + ii + 24 ) );
+    }
+    std::uint64_t tail = P4 ^ nbytes;
+    for ( ; ii + 8 <= nbytes; ii += 8 ) tail = lane( tail, word( ptr + ii ) ) * P3;
+    for ( ; ii < nbytes; ++ii ) tail = rotl( tail ^ ( ptr[ ii ] * P1 ), 11 ) * P2;
+    return {
+      mix64( rotl( v1, 1 ) + rotl( v2, 7 ) + rotl( v3, 12 ) + rotl( v4, 18 ) + tail ),
+      mix64( ( v1 ^ rotl( v2, 29 ) ) + ( rotl( v3, 41 ) ^ v4 ) + rotl( tail, 32 ) + P3 )
+    };
+
+  }
+
+  // entries are followed by the low word of the hash of their bytes
+  constexpr std::uint64_t checksum_seed = 0x6A09E667F3BCC908ull;
+
+  std::uint64_t checksum ( const char * data, const std::size_t nbytes ) {
+    return utl::pair_hash { checksum_seed }.update( data, nbytes ).digest().lo;
+  }
+
+} // endnamespace
+
+//==================================================================================
+
+std::string utl::pair_key::hex () const {
+
+  char buf[ 33 ];
+  std::snprintf( buf, sizeof( buf ), "%016llx%016llx",
+		 static_cast< unsigned long long >( hi ), static_cast< unsigned long long >( lo ) );
+  return std::string { buf };
+
+}
+
+//==================================================================================
+
+utl::pair_hash::pair_hash ( const std::uint64_t seed ) :
+  state_lo { mix64( seed ^ P3 ) }, state_hi { mix64( seed ^ P4 ) } {}
+
+utl::pair_hash & utl::pair_hash::update ( const void * data, const std::size_t nbytes ) {
+
+  const unsigned char * ptr = static_cast< const unsigned char * >( data );
+  const std::size_t nblock = ( nbytes + block_bytes - 1 ) / block_bytes;
+  std::vector< utl::pair_key > blocks ( nblock );
+#pragma omp parallel for schedule(static) if(nblock > 1)
+  for ( std::size_t ib = 0; ib < nblock; ++ib )
+    blocks[ ib ] = hash_block( ptr + ib * block_bytes,
+			       std::min( block_bytes, nbytes - ib * block_bytes ), ib );
+
+  // fold the blocks in order, then the field in the running state
+  std::uint64_t lo = nbytes, hi = ~std::uint64_t( nbytes );
+  for ( const utl::pair_key & kk : blocks ) {
+    lo = mix64( lo ^ kk.lo ) + P1;
+    hi = mix64( hi ^ kk.hi ) + P2;
+  }
+  state_lo = mix64( state_lo ^ lo ) * P3 + hi;
+  state_hi = mix64( state_hi ^ hi ) * P4 + lo;
+  return *this;
+
+}
+
+utl::pair_key utl::pair_hash::digest () const noexcept {
+
+  return { mix64( state_lo ^ rotl( state_hi, 32 ) ), mix64( state_hi ^ P1 ) };
+
+}
+
+//==================================================================================
+
+utl::pair_cache::pair_cache ( const std::string & directory ) : dir { directory } {
+
+  std::error_code ec;
+  std::filesystem::create_directories( dir, ec );
+  if ( !std::filesystem::is_directory( dir ) )
+    throw std::runtime_error( "cannot create the cache directory " + dir );
+
+}
+
+std::string utl::pair_cache::path ( const utl::pair_key & key ) const {
+
+  return ( std::filesystem::path { dir } / ( key.hex() + ".pairs" ) ).string();
+
+}
+
+//==================================================================================
+
+template < typename T >
+bool utl::pair_cache::load ( const utl::pair_key & key,
+			     std::vector< std::size_t > & shape,
+			     std::vector< T > & values ) const {
+
+  std::ifstream fin ( path( key ), std::ios::binary | std::ios::ate );
+  if ( !fin ) return false;
+  const std::streamoff size = fin.tellg();
+  if ( size < std::streamoff( sizeof( std::uint64_t ) ) ) return false;
+  std::vector< char > buf ( size );
+  fin.seekg( 0 );
+  if ( !fin.read( buf.data(), size ) ) return false;
+
+  // integrity: checksum, then consistency of the vector lengths with the file size
+  const std::size_t nbytes = size - sizeof( std::uint64_t );
+  std::uint64_t sum = 0;
+  SerialPOD< std::uint64_t >::deserialize( buf.data() + nbytes, sum );
+  if ( sum != checksum( buf.data(), nbytes ) ) return false;
+  const std::size_t head = sizeof( std::uint32_t ) + sizeof( char ) + 2 * sizeof( std::uint64_t );
+  std::size_t nshape, nvalue;
+  if ( nbytes < head + 2 * sizeof( std::size_t ) ) return false;
+  SerialPOD< std::size_t >::deserialize( buf.data() + head, nshape );
+  if ( nshape > ( nbytes - head ) / sizeof( std::size_t ) - 2 ) return false;
+  const std::size_t offset = head + ( nshape + 1 ) * sizeof( std::size_t );
+  SerialPOD< std::size_t >::deserialize( buf.data() + offset, nvalue );
+  if ( nbytes != offset + sizeof( std::size_t ) + nvalue * sizeof( T ) ) return false;
+
+  utl::pair_counts< T > entry;
+  entry.deserialize( buf.data() );
+  // a different version or type leaves the key unset
+  if ( !( entry.key == key ) ) return false;
+  shape = std::move( entry.shape );
+  values = std::move( entry.values );
+  return true;
+
+}
+
+template < typename T >
+void utl::pair_cache::store ( const utl::pair_key & key,
+			      const std::vector< std::size_t > & shape,
+			      const std::vector< T > & values ) const {
+
+  const utl::pair_counts< T > entry { key, shape, values };
+  const std::size_t nbytes = entry.serialize_size();
+  std::vector< char > buf ( nbytes + sizeof( std::uint64_t ) );
+  entry.serialize( buf.data() );
+  SerialPOD< std::uint64_t >::serialize( buf.data() + nbytes, checksum( buf.data(), nbytes ) );
+
+  // write under a unique temporary name, then publish the entry atomically
+  const std::string target = path( key );
+  const std::string tmp = target + ".tmp" + std::to_string( std::random_device {}() );
+  {
+    std::ofstream fout ( tmp, std::ios::binary | std::ios::trunc );
+    fout.write( buf.data(), buf.size() );
+    fout.close();
+    if ( !fout ) {
+      std::remove( tmp.c_str() );
+      throw std::runtime_error( "cannot write the cache entry " + tmp );
+    }
+  }
+  if ( std::rename( tmp.c_str(), target.c_str() ) != 0 ) {
+    std::remove( tmp.c_str() );
+    throw std::runtime_error( "cannot write the cache entry " + target );
+  }
+
+}
+
+template bool utl::pair_cache::load ( const utl::pair_key &,
+				      std::vector< std::size_t > &,
+				      std::vector< std::size_t > & ) const;
+template bool utl::pair_cache::load ( const utl::pair_key &,
+				      std::vector< std::size_t > &,
+				      std::vector< double > & ) const;
+template void utl::pair_cache::store ( const utl::pair_key &,
+				       const std::vector< std::size_t > &,
+				       const std::vector< std::size_t > & ) const;
+template void utl::pair_cache::store ( const utl::pair_key &,
+				       const std::vector< std::size_t > &,
+				       const std::vector< double > & ) const;
+
+//==================================================================================
@@ -0,0 +1,303 @@
+#include <pair_stream.h>
+#include <clustering_core.h>
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//==================================================================================
+
+utl::coordinate_file::coordinate_file ( const std::string & path, const std::size_t ncol ) :
+  fname { path }, ncol { ncol } {
+
+  if ( ncol != 3 && ncol != 4 )
+    throw std::invalid_argument( "coordinate files hold 3 or 4 values per object" );
+  const int fd = ::open( path.c_str(), O_RDONLY );
+  if ( fd < 0 ) throw std::runtime_error( "cannot open the coordinate file " + path );
+  struct stat st;
+  if ( ::fstat( fd, &st ) != 0 ) {
+    ::close( fd );
+    throw std::runtime_error( "cannot read the size of the coordinate file " + path );
+  }
+  nbytes = st.st_size;
+  if ( nbytes % ( ncol * sizeof( float ) ) != 0 ) {
+    ::close( fd );
+    throw std::invalid_argument( "the size of " + path + " is not a multiple of " +
+				 std::to_string( ncol ) + " float32 values" );
+  }
+  nobj = nbytes / ( ncol * sizeof( float ) );
+
+  // the mapping keeps the file open
+  if ( nbytes > 0 ) {
+    void * ptr = ::mmap( nullptr, nbytes, PROT_READ, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    if ( ptr == MAP_FAILED ) throw std::runtime_error( "cannot map the coordinate file " + path );
+    ::madvise( ptr, nbytes, MADV_SEQUENTIAL );
+    base = static_cast< const float * >( ptr );
+  }
+  else ::close( fd );
+
+}
+
+utl::coordinate_file::~coordinate_file () {
+
+  if ( base ) ::munmap( const_cast< float * >( base ), nbytes );
+
+}
+
+void utl::coordinate_file::read ( const std::size_t begin, const std::size_t end,
+				  std::vector< float > & xx,
+				  std::vector< float > & yy,
+				  std::vector< float > & zz,
+				  std::vector< float > & ww ) const {
+
+  if ( begin > end || end > nobj )
+    throw std::out_of_range( "objects out of the coordinate file " + fname );
+  const std::size_t size = end - begin;
+  xx.resize( size ); yy.resize( size ); zz.resize( size );
+  ww.resize( weighted() ? size : 0 );
+  const float * rec = base + begin * ncol;
+  for ( std::size_t ii = 0; ii < size; ++ii, rec += ncol ) {
+    xx[ ii ] = rec[ 0 ];
+    yy[ ii ] = rec[ 1 ];
+    zz[ ii ] = rec[ 2 ];
+    if ( ncol == 4 ) ww[ ii ] = rec[ 3 ];
+  }
+
+  // drop the pages read from the resident set (whole pages only), they are
+  // read back from the file if the chunk is needed again
+  if ( size > 0 ) {
+    const std::size_t page = ::sysconf( _SC_PAGESIZE );
+    const std::size_t lo = ( begin * ncol * sizeof( float ) + page - 1 ) / page * page;
+    const std::size_t hi = end * ncol * sizeof( float ) / page * page;
+    if ( hi > lo )
+      ::madvise( const_cast< char * >( reinterpret_cast< const char * >( base ) ) + lo,
+		 hi - lo, MADV_DONTNEED );
+  }
+
+}
+
+void utl::coordinate_file::hash ( utl::pair_hash & hh ) const {
+
+  std::error_code ec;
+  const auto mtime = std::filesystem::last_write_time( fname, ec ).time_since_epoch().count();
+  hh.update( std::filesystem::absolute( fname, ec ).string() )
+    .update_value( nbytes ).update_value( ncol ).update_value( mtime );
+
+}
+
+//==================================================================================
+
+namespace {
+
+  template < bool weighted >
+  using count_t = std::conditional_t< weighted, double, std::size_t >;
+
+  // objects [ begin, end ) of a file, in the layout of the counters
+  struct chunk {
+
+    std::vector< float > xx, yy, zz, ww;
+
+    std::size_t index = std::size_t( -1 );
+
+    void load ( const utl::coordinate_file & file, const std::size_t ic, const std::size_t chunk_size ) {
+      if ( ic == index ) return;
+      file.read( ic * chunk_size, std::min( ( ic + 1 ) * chunk_size, file.size() ), xx, yy, zz, ww );
+      index = ic;
+    }
+
+  }; // endstruct chunk
+
+  // Counts the pairs of chunks in order, from the checkpoint if there is one.
+  // f2 == nullptr for auto-counts, where chunk pairs ( i, j ) with j < i are
+  // skipped and the diagonal is counted with the DD counter.
+  // A checkpoint is a pair_cache entry whose shape is { nbin, next chunk pair }.
+  template < bool weighted >
+  std::vector< count_t< weighted > > stream_count ( const char * mode,
+						    const utl::coordinate_file & f1,
+						    const utl::coordinate_file * f2,
+						    const std::vector< float > & rbin,
+						    const float box,
+						    const utl::binning::scheme binning,
+						    const std::size_t chunk_size,
+						    const std::string & checkpoint_dir,
+						    const bool omp ) {
+
+    if ( chunk_size == 0 ) throw std::invalid_argument( "chunk_size has to be positive" );
+    if ( weighted && ( !f1.weighted() || ( f2 && !f2->weighted() ) ) )
+      throw std::invalid_argument( "weighted counts need files of ( x, y, z, w ) records" );
+    const utl::coordinate_file & g2 = f2 ? *f2 : f1;
+
+    const std::size_t n1 = ( f1.size() + chunk_size - 1 ) / chunk_size;
+    const std::size_t n2 = ( g2.size() + chunk_size - 1 ) / chunk_size;
+    std::vector< std::pair< std::size_t, std::size_t > > tasks;
+    for ( std::size_t ii = 0; ii < n1; ++ii )
+      for ( std::size_t jj = f2 ? 0 : ii; jj < n2; ++jj )
+	tasks.emplace_back( ii, jj );
+
+    const std::size_t nbin = utl::binning::visit( binning, rbin, [] ( const auto & bins ) {
+      return bins.size();
+    } );
+    std::vector< count_t< weighted > > NN ( nbin, 0 );
+    std::size_t next = 0;
+
+    std::unique_ptr< utl::pair_cache > cache;
+    utl::pair_key key;
+    if ( !checkpoint_dir.empty() ) {
+      cache = std::make_unique< utl::pair_cache >( checkpoint_dir );
+      utl::pair_hash hh;
+      hh.update( mode );
+      f1.hash( hh );
+      if ( f2 ) f2->hash( hh );
+      key = hh.update( rbin ).update_value( box ).update_value( binning )
+	.update_value( chunk_size ).digest();
+      std::vector< std::size_t > shape;
+      std::vector< count_t< weighted > > partial;
+      if ( cache->load( key, shape, partial ) &&
+	   shape.size() == 2 && shape[ 0 ] == nbin && partial.size() == nbin && shape[ 1 ] <= tasks.size() ) {
+	NN = std::move( partial );
+	next = shape[ 1 ];
+      }
+    }
+
+    chunk c1, c2;
+    for ( ; next < tasks.size(); ++next ) {
+      const auto [ ii, jj ] = tasks[ next ];
+      c1.load( f1, ii, chunk_size );
+      std::vector< count_t< weighted > > part;
+      if ( !f2 && ii == jj ) {
+	if constexpr ( weighted )
+	  part = ( omp ? utl::wd3D_DD_grid_omp : utl::wd3D_DD_grid )
+	    ( c1.xx, c1.yy, c1.zz, c1.ww, rbin, box, binning );
+	else
+	  part = ( omp ? utl::d3D_DD_grid_omp : utl::d3D_DD_grid )
+	    ( c1.xx, c1.yy, c1.zz, rbin, box, binning );
+      }
+      else {
+	c2.load( g2, jj, chunk_size );
+	if constexpr ( weighted )
+	  part = ( omp ? utl::wd3D_DR_grid_omp : utl::wd3D_DR_grid )
+	    ( c1.xx, c1.yy, c1.zz, c1.ww, c2.xx, c2.yy, c2.zz, c2.ww, rbin, box, binning );
+	else
+	  part = ( omp ? utl::d3D_DR_grid_omp : utl::d3D_DR_grid )
+	    ( c1.xx, c1.yy, c1.zz, c2.xx, c2.yy, c2.zz, rbin, box, binning );
+      }
+      for ( std::size_t ib = 0; ib < nbin; ++ib ) NN[ ib ] += part[ ib ];
+      if ( cache ) cache->store( key, { nbin, next + 1 }, NN );
+    } // endfor next
+
+    return NN;
+
+  }
+
+} // endnamespace
+
+//==================================================================================
+
+std::vector< std::size_t > utl::d3D_DD_stream ( const utl::coordinate_file & file,
+						const std::vector< float > & rbin,
+						const float box,
+						const utl::binning::scheme binning,
+						const std::size_t chunk_size,
+						const std::string & checkpoint_dir ) {
+
+  return stream_count< false >( "d3D_DD_stream", file, nullptr, rbin, box, binning,
+				chunk_size, checkpoint_dir, false );
+
+}
+
+std::vector< std::size_t > utl::d3D_DD_stream_omp ( const utl::coordinate_file & file,
+						    const std::vector< float > & rbin,
+						    const float box,
+						    const utl::binning::scheme binning,
+						    const std::size_t chunk_size,
+						    const std::string & checkpoint_dir ) {
+
+  return stream_count< false >( "d3D_DD_stream", file, nullptr, rbin, box, binning,
+				chunk_size, checkpoint_dir, true );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_stream ( const utl::coordinate_file & file1,
+						const utl::coordinate_file & file2,
+						const std::vector< float > & rbin,
+						const float box,
+						const utl::binning::scheme binning,
+						const std::size_t chunk_size,
+						const std::string & checkpoint_dir ) {
+
+  return stream_count< false >( "d3D_DR_stream", file1, &file2, rbin, box, binning,
+				chunk_size, checkpoint_dir, false );
+
+}
+
+std::vector< std::size_t > utl::d3D_DR_stream_omp ( const utl::coordinate_file & file1,
+						    const utl::coordinate_file & file2,
+						    const std::vector< float > & rbin,
+						    const float box,
+						    const utl::binning::scheme binning,
+						    const std::size_t chunk_size,
+						    const std::string & checkpoint_dir ) {
+
+  return stream_count< false >( "d3D_DR_stream", file1, &file2, rbin, box, binning,
+				chunk_size, checkpoint_dir, true );
+
+}
+
+std::vector< double > utl::wd3D_DD_stream ( const utl::coordinate_file & file,
+					    const std::vector< float > & rbin,
+					    const float box,
+					    const utl::binning::scheme binning,
+					    const std::size_t chunk_size,
+					    const std::string & checkpoint_dir ) {
+
+  return stream_count< true >( "wd3D_DD_stream", file, nullptr, rbin, box, binning,
+			       chunk_size, checkpoint_dir, false );
+
+}
+
+std::vector< double > utl::wd3D_DD_stream_omp ( const utl::coordinate_file & file,
+						const std::vector< float > & rbin,
+						const float box,
+						const utl::binning::scheme binning,
+						const std::size_t chunk_size,
+						const std::string & checkpoint_dir ) {
+
+  return stream_count< true >( "wd3D_DD_stream", file, nullptr, rbin, box, binning,
+			       chunk_size, checkpoint_dir, true );
+
+}
+
+std::vector< double > utl::wd3D_DR_stream ( const utl::coordinate_file & file1,
+					    const utl::coordinate_file & file2,
+					    const std::vector< float > & rbin,
+					    const float box,
+					    const utl::binning::scheme binning,
+					    const std::size_t chunk_size,
+					    const std::string & checkpoint_dir ) {
+
+  return stream_count< true >( "wd3D_DR_stream", file1, &file2, rbin, box, binning,
+			       chunk_size, checkpoint_dir, false );
+
+}
+
+std::vector< double > utl::wd3D_DR_stream_omp ( const utl::coordinate_file & file1,
+						const utl::coordinate_file & file2,
+						const std::vector< float > & rbin,
+						const float box,
+						const utl::binning::scheme binning,
+						const std::size_t chunk_size,
+						const std::string & checkpoint_dir ) {
+
+  return stream_count< true >( "wd3D_DR_stream", file1, &file2, rbin, box, binning,
+			       chunk_size, checkpoint_dir, true );
+
+}
+
+//==================================================================================
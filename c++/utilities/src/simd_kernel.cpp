@@ -0,0 +1,279 @@
+#include <simd_kernel.h>
+#include <cmath>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+//==================================================================================
+
+// All the kernels compute d2 = dx*dx + dy*dy + dz*dz with separate products and
+// sums, the source must be compiled with -ffp-contract=off so that no kernel gets
+// FMA-contracted and the binning does not depend on the instruction set selected:
+// pair counts are identical on every instruction set. The weighted kernels instead
+// add the weights of a block with a horizontal sum whose association depends on the
+// vector width, so weighted counts agree across instruction sets only to rounding
+// (relative differences of a few 1e-14 for ~1e7 pairs per bin, in double precision).
+//
+// The AVX-512 kernels use the masked (explicit pass-through) forms of min, cvtps_pd
+// and extractf64x4: the plain intrinsics, also behind the 512 -> 256 casts and
+// _mm512_reduce_add_pd, hand an undefined vector to the builtins, which GCC 12
+// reports as maybe-uninitialized with -Wall -Wextra.
+
+namespace {
+
+  // histogram entry: pair counts, or sums of weight products when weighted
+  template < bool weighted >
+  using count_t = std::conditional_t< weighted, double, std::size_t >;
+
+  template < bool weighted >
+  using kernel_t = void (*) ( const float, const float, const float, const float,
+			      const float *, const float *, const float *, const float *,
+			      const std::size_t, const float *, const std::size_t,
+			      const float, count_t< weighted > * );
+
+  // scalar loop on objects [ j0, nn ), also used for the tail of the vector kernels
+  template < bool periodic, bool weighted >
+  inline void scalar_tail ( const float xi, const float yi, const float zi, const float wi,
+			    const float * xx, const float * yy, const float * zz, const float * ww,
+			    const std::size_t j0, const std::size_t nn,
+			    const float * edges2, const std::size_t nedge,
+			    const float box, count_t< weighted > * cum ) {
+
+    const float rmax2 = edges2[ nedge - 1 ];
+    for ( std::size_t jj = j0; jj < nn; ++jj ) {
+      float dx = xi - xx[ jj ], dy = yi - yy[ jj ], dz = zi - zz[ jj ];
+      if constexpr ( periodic ) {
+	dx = std::fabs( dx ); dx = std::fmin( dx, box - dx );
+	dy = std::fabs( dy ); dy = std::fmin( dy, box - dy );
+	dz = std::fabs( dz ); dz = std::fmin( dz, box - dz );
+      }
+      float d2 = dx * dx + dy * dy + dz * dz;
+      if ( d2 > rmax2 ) continue;
+      for ( std::size_t kk = 0; kk + 1 < nedge && d2 >= edges2[ kk ]; ++kk )
+	if constexpr ( weighted ) cum[ kk ] += double( wi ) * ww[ jj ];
+	else ++cum[ kk ];
+    }
+
+  }
+
+  template < bool periodic, bool weighted >
+  void kernel_scalar ( const float xi, const float yi, const float zi, const float wi,
+		       const float * xx, const float * yy, const float * zz, const float * ww,
+		       const std::size_t nn,
+		       const float * edges2, const std::size_t nedge,
+		       const float box, count_t< weighted > * cum ) {
+
+    scalar_tail< periodic, weighted >( xi, yi, zi, wi, xx, yy, zz, ww, 0, nn,
+				       edges2, nedge, box, cum );
+
+  }
+
+#ifdef SIMD_KERNEL_X86
+
+  template < bool periodic, bool weighted >
+  __attribute__((target("sse2")))
+  void kernel_sse2 ( const float xi, const float yi, const float zi, const float wi,
+		     const float * xx, const float * yy, const float * zz, const float * ww,
+		     const std::size_t nn,
+		     const float * edges2, const std::size_t nedge,
+		     const float box, count_t< weighted > * cum ) {
+
+    const __m128 vxi = _mm_set1_ps( xi ), vyi = _mm_set1_ps( yi ), vzi = _mm_set1_ps( zi );
+    const __m128 vbox = _mm_set1_ps( box ), vmax = _mm_set1_ps( edges2[ nedge - 1 ] );
+    const __m128 sign = _mm_set1_ps( -0.f );
+    std::size_t jj = 0;
+    for ( ; jj + 4 <= nn; jj += 4 ) {
+      __m128 dx = _mm_sub_ps( vxi, _mm_loadu_ps( xx + jj ) );
+      __m128 dy = _mm_sub_ps( vyi, _mm_loadu_ps( yy + jj ) );
+      __m128 dz = _mm_sub_ps( vzi, _mm_loadu_ps( zz + jj ) );
+      if constexpr ( periodic ) {
+	dx = _mm_andnot_ps( sign, dx ); dx = _mm_min_ps( dx, _mm_sub_ps( vbox, dx ) );
+	dy = _mm_andnot_ps( sign, dy ); dy = _mm_min_ps( dy, _mm_sub_ps( vbox, dy ) );
+	dz = _mm_andnot_ps( sign, dz ); dz = _mm_min_ps( dz, _mm_sub_ps( vbox, dz ) );
+      }
+      __m128 d2 = _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ),
+			      _mm_mul_ps( dz, dz ) );
+      __m128 in = _mm_cmple_ps( d2, vmax );
+      if ( _mm_movemask_ps( in ) == 0 ) continue;
+      for ( std::size_t kk = 0; kk + 1 < nedge; ++kk ) {
+	__m128 sel = _mm_and_ps( in, _mm_cmpge_ps( d2, _mm_set1_ps( edges2[ kk ] ) ) );
+	int mm = _mm_movemask_ps( sel );
+	if ( mm == 0 ) break;
+	if constexpr ( weighted ) {
+	  __m128 wm = _mm_and_ps( sel, _mm_loadu_ps( ww + jj ) );
+	  __m128d ss = _mm_add_pd( _mm_cvtps_pd( wm ), _mm_cvtps_pd( _mm_movehl_ps( wm, wm ) ) );
+	  cum[ kk ] += double( wi ) * _mm_cvtsd_f64( _mm_add_sd( ss, _mm_unpackhi_pd( ss, ss ) ) );
+	}
+	else cum[ kk ] += __builtin_popcount( mm );
+      }
+    }
+    scalar_tail< periodic, weighted >( xi, yi, zi, wi, xx, yy, zz, ww, jj, nn,
+				       edges2, nedge, box, cum );
+
+  }
+
+  template < bool periodic, bool weighted >
+  __attribute__((target("avx2")))
+  void kernel_avx2 ( const float xi, const float yi, const float zi, const float wi,
+		     const float * xx, const float * yy, const float * zz, const float * ww,
+		     const std::size_t nn,
+		     const float * edges2, const std::size_t nedge,
+		     const float box, count_t< weighted > * cum ) {
+
+    const __m256 vxi = _mm256_set1_ps( xi ), vyi = _mm256_set1_ps( yi ), vzi = _mm256_set1_ps( zi );
+    const __m256 vbox = _mm256_set1_ps( box ), vmax = _mm256_set1_ps( edges2[ nedge - 1 ] );
+    const __m256 sign = _mm256_set1_ps( -0.f );
+    std::size_t jj = 0;
+    for ( ; jj + 8 <= nn; jj += 8 ) {
+      __m256 dx = _mm256_sub_ps( vxi, _mm256_loadu_ps( xx + jj ) );
+      __m256 dy = _mm256_sub_ps( vyi, _mm256_loadu_ps( yy + jj ) );
+      __m256 dz = _mm256_sub_ps( vzi, _mm256_loadu_ps( zz + jj ) );
+      if constexpr ( periodic ) {
+	dx = _mm256_andnot_ps( sign, dx ); dx = _mm256_min_ps( dx, _mm256_sub_ps( vbox, dx ) );
+	dy = _mm256_andnot_ps( sign, dy ); dy = _mm256_min_ps( dy, _mm256_sub_ps( vbox, dy ) );
+	dz = _mm256_andnot_ps( sign, dz ); dz = _mm256_min_ps( dz, _mm256_sub_ps( vbox, dz ) );
+      }
+      __m256 d2 = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( dx, dx ), _mm256_mul_ps( dy, dy ) ),
+				 _mm256_mul_ps( dz, dz ) );
+      __m256 in = _mm256_cmp_ps( d2, vmax, _CMP_LE_OQ );
+      if ( _mm256_movemask_ps( in ) == 0 ) continue;
+      for ( std::size_t kk = 0; kk + 1 < nedge; ++kk ) {
+	__m256 sel = _mm256_and_ps( in, _mm256_cmp_ps( d2, _mm256_set1_ps( edges2[ kk ] ), _CMP_GE_OQ ) );
+	int mm = _mm256_movemask_ps( sel );
+	if ( mm == 0 ) break;
+	if constexpr ( weighted ) {
+	  __m256 wm = _mm256_and_ps( sel, _mm256_loadu_ps( ww + jj ) );
+	  __m256d s4 = _mm256_add_pd( _mm256_cvtps_pd( _mm256_castps256_ps128( wm ) ),
+				      _mm256_cvtps_pd( _mm256_extractf128_ps( wm, 1 ) ) );
+	  __m128d ss = _mm_add_pd( _mm256_castpd256_pd128( s4 ), _mm256_extractf128_pd( s4, 1 ) );
+	  cum[ kk ] += double( wi ) * _mm_cvtsd_f64( _mm_add_sd( ss, _mm_unpackhi_pd( ss, ss ) ) );
+	}
+	else cum[ kk ] += __builtin_popcount( mm );
+      }
+    }
+    scalar_tail< periodic, weighted >( xi, yi, zi, wi, xx, yy, zz, ww, jj, nn,
+				       edges2, nedge, box, cum );
+
+  }
+
+  template < bool periodic, bool weighted >
+  __attribute__((target("avx512f")))
+  void kernel_avx512 ( const float xi, const float yi, const float zi, const float wi,
+		       const float * xx, const float * yy, const float * zz, const float * ww,
+		       const std::size_t nn,
+		       const float * edges2, const std::size_t nedge,
+		       const float box, count_t< weighted > * cum ) {
+
+    const __m512 vxi = _mm512_set1_ps( xi ), vyi = _mm512_set1_ps( yi ), vzi = _mm512_set1_ps( zi );
+    const __m512 vbox = _mm512_set1_ps( box ), vmax = _mm512_set1_ps( edges2[ nedge - 1 ] );
+    std::size_t jj = 0;
+    for ( ; jj + 16 <= nn; jj += 16 ) {
+      __m512 dx = _mm512_sub_ps( vxi, _mm512_loadu_ps( xx + jj ) );
+      __m512 dy = _mm512_sub_ps( vyi, _mm512_loadu_ps( yy + jj ) );
+      __m512 dz = _mm512_sub_ps( vzi, _mm512_loadu_ps( zz + jj ) );
+      if constexpr ( periodic ) {
+	const __mmask16 all = 0xFFFF;
+	dx = _mm512_abs_ps( dx ); dx = _mm512_mask_min_ps( dx, all, dx, _mm512_sub_ps( vbox, dx ) );
+	dy = _mm512_abs_ps( dy ); dy = _mm512_mask_min_ps( dy, all, dy, _mm512_sub_ps( vbox, dy ) );
+	dz = _mm512_abs_ps( dz ); dz = _mm512_mask_min_ps( dz, all, dz, _mm512_sub_ps( vbox, dz ) );
+      }
+      __m512 d2 = _mm512_add_ps( _mm512_add_ps( _mm512_mul_ps( dx, dx ), _mm512_mul_ps( dy, dy ) ),
+				 _mm512_mul_ps( dz, dz ) );
+      __mmask16 in = _mm512_cmp_ps_mask( d2, vmax, _CMP_LE_OQ );
+      if ( in == 0 ) continue;
+      for ( std::size_t kk = 0; kk + 1 < nedge; ++kk ) {
+	__mmask16 mm = _mm512_mask_cmp_ps_mask( in, d2, _mm512_set1_ps( edges2[ kk ] ), _CMP_GE_OQ );
+	if ( mm == 0 ) break;
+	if constexpr ( weighted ) {
+	  __m512d lo = _mm512_maskz_cvtps_pd( __mmask8( mm ), _mm256_loadu_ps( ww + jj ) );
+	  __m512d hi = _mm512_maskz_cvtps_pd( __mmask8( mm >> 8 ), _mm256_loadu_ps( ww + jj + 8 ) );
+	  __m512d s8 = _mm512_add_pd( lo, hi );
+	  __m256d s4 = _mm256_add_pd( _mm512_maskz_extractf64x4_pd( 0xF, s8, 0 ),
+				      _mm512_maskz_extractf64x4_pd( 0xF, s8, 1 ) );
+	  __m128d ss = _mm_add_pd( _mm256_castpd256_pd128( s4 ), _mm256_extractf128_pd( s4, 1 ) );
+	  cum[ kk ] += double( wi ) * _mm_cvtsd_f64( _mm_add_sd( ss, _mm_unpackhi_pd( ss, ss ) ) );
+	}
+	else cum[ kk ] += __builtin_popcount( mm );
+      }
+    }
+    scalar_tail< periodic, weighted >( xi, yi, zi, wi, xx, yy, zz, ww, jj, nn,
+				       edges2, nedge, box, cum );
+
+  }
+
+#endif //SIMD_KERNEL_X86
+
+  // instruction set selected on first call
+  struct dispatch {
+
+    kernel_t< false > open = kernel_scalar< false, false >, periodic = kernel_scalar< true, false >;
+    kernel_t< true > w_open = kernel_scalar< false, true >, w_periodic = kernel_scalar< true, true >;
+    std::string name = "scalar";
+
+    dispatch () {
+#ifdef SIMD_KERNEL_X86
+      __builtin_cpu_init();
+      if ( __builtin_cpu_supports( "avx512f" ) ) {
+	open = kernel_avx512< false, false >; periodic = kernel_avx512< true, false >;
+	w_open = kernel_avx512< false, true >; w_periodic = kernel_avx512< true, true >;
+	name = "avx512";
+      }
+      else if ( __builtin_cpu_supports( "avx2" ) ) {
+	open = kernel_avx2< false, false >; periodic = kernel_avx2< true, false >;
+	w_open = kernel_avx2< false, true >; w_periodic = kernel_avx2< true, true >;
+	name = "avx2";
+      }
+      else if ( __builtin_cpu_supports( "sse2" ) ) {
+	open = kernel_sse2< false, false >; periodic = kernel_sse2< true, false >;
+	w_open = kernel_sse2< false, true >; w_periodic = kernel_sse2< true, true >;
+	name = "sse2";
+      }
+#endif //SIMD_KERNEL_X86
+    }
+
+  }; // endstruct dispatch
+
+  const dispatch & selected () {
+    static const dispatch sel;
+    return sel;
+  }
+
+} // endnamespace
+
+//==================================================================================
+
+void utl::simd::count_cumulative ( const float xi, const float yi, const float zi,
+				   const float * xx, const float * yy, const float * zz,
+				   const std::size_t nn,
+				   const float * edges2, const std::size_t nedge,
+				   const float box,
+				   std::size_t * cum ) {
+
+  const dispatch & sel = selected();
+  ( box > 0. ? sel.periodic : sel.open )( xi, yi, zi, 0.f, xx, yy, zz, nullptr,
+					  nn, edges2, nedge, box, cum );
+
+}
+
+void utl::simd::count_cumulative ( const float xi, const float yi, const float zi, const float wi,
+				   const float * xx, const float * yy, const float * zz,
+				   const float * ww,
+				   const std::size_t nn,
+				   const float * edges2, const std::size_t nedge,
+				   const float box,
+				   double * cum ) {
+
+  const dispatch & sel = selected();
+  ( box > 0. ? sel.w_periodic : sel.w_open )( xi, yi, zi, wi, xx, yy, zz, ww,
+					      nn, edges2, nedge, box, cum );
+
+}
+
+//==================================================================================
+
+std::string utl::simd::isa_name () { return selected().name; }
+
+//==================================================================================
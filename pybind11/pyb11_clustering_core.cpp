@@ -4,116 +4,2146 @@
 #include <pybind11/stl.h>
 // External includes
 #include <vector>
+#include <array>
+#include <string>
+#include <utility>
+#include <cmath>
+#include <type_traits>
 // Internal includes
 #include <clustering_core.h>
+#include <pair_cache.h>
+#include <pair_stream.h>
+#include <counts_in_cells.h>
+#include <knn_cdf.h>
+#include <friends_of_friends.h>
+#include <simd_kernel.h>
 
 namespace py = pybind11;
 
+#define BOX_PARAM_DOC \
+  "box : float, optional\n    Side of the periodic box, coordinates are expected in\n" \
+  "    ``[0, box)`` and separations follow the minimum-image convention.\n" \
+  "    The default (0) selects open boundaries.\n"
+
+#define BINNING_PARAM_DOC \
+  "binning : binning, optional\n    Binning scheme: ``binning.log`` (default) and ``binning.lin``\n" \
+  "    place ``len(rbin)`` logarithmic or linear bins between ``rbin[0]``\n" \
+  "    and ``rbin[-1]``, ``binning.edges`` uses ``rbin`` as the sorted\n" \
+  "    edges of ``len(rbin) - 1`` bins.\n"
+
 #define DD2D_DOC \
   "Count data-data pairs in 2D separation bins.\n" \
   "\nParameters\n----------\n" \
-  "X : list of float\n    X-coordinates of the catalogue.\n" \
-  "Y : list of float\n    Y-coordinates of the catalogue.\n" \
+  "X : array_like of float\n    X-coordinates of the catalogue.\n" \
+  "Y : array_like of float\n    Y-coordinates of the catalogue.\n" \
   "rbin : list of float\n    Separation bin edges.\n" \
-  "\nReturns\n-------\nlist of int\n    Pair counts per bin."
+  BOX_PARAM_DOC \
+  BINNING_PARAM_DOC \
+  "\nReturns\n-------\nnumpy.ndarray of int\n    Pair counts per bin."
 
 #define DR2D_DOC \
   "Count data-random cross-pairs in 2D separation bins.\n" \
   "\nParameters\n----------\n" \
-  "X1 : list of float\n    X-coordinates of the first (data) catalogue.\n" \
-  "Y1 : list of float\n    Y-coordinates of the first catalogue.\n" \
-  "X2 : list of float\n    X-coordinates of the second (random) catalogue.\n" \
-  "Y2 : list of float\n    Y-coordinates of the second catalogue.\n" \
+  "X1 : array_like of float\n    X-coordinates of the first (data) catalogue.\n" \
+  "Y1 : array_like of float\n    Y-coordinates of the first catalogue.\n" \
+  "X2 : array_like of float\n    X-coordinates of the second (random) catalogue.\n" \
+  "Y2 : array_like of float\n    Y-coordinates of the second catalogue.\n" \
   "rbin : list of float\n    Separation bin edges.\n" \
-  "\nReturns\n-------\nlist of int\n    Pair counts per bin."
+  BOX_PARAM_DOC \
+  BINNING_PARAM_DOC \
+  "\nReturns\n-------\nnumpy.ndarray of int\n    Pair counts per bin."
 
 #define DA2D_DD_DOC \
   "Count data-data pairs in 2D angular separation bins.\n" \
   "\nParameters\n----------\n" \
-  "RA : list of float\n    Right-ascension coordinates [rad].\n" \
-  "Dec : list of float\n    Declination coordinates [rad].\n" \
+  "RA : array_like of float\n    Right-ascension coordinates [rad].\n" \
+  "Dec : array_like of float\n    Declination coordinates [rad].\n" \
   "thetabin : list of float\n    Angular separation bin edges [rad].\n" \
-  "\nReturns\n-------\nlist of int\n    Pair counts per bin."
+  BINNING_PARAM_DOC \
+  "\nReturns\n-------\nnumpy.ndarray of int\n    Pair counts per bin."
 
 #define DA2D_DR_DOC \
   "Count data-random cross-pairs in 2D angular separation bins.\n" \
   "\nParameters\n----------\n" \
-  "RA1 : list of float\n    Right-ascension of the first (data) catalogue [rad].\n" \
-  "Dec1 : list of float\n    Declination of the first catalogue [rad].\n" \
-  "RA2 : list of float\n    Right-ascension of the second (random) catalogue [rad].\n" \
-  "Dec2 : list of float\n    Declination of the second catalogue [rad].\n" \
+  "RA1 : array_like of float\n    Right-ascension of the first (data) catalogue [rad].\n" \
+  "Dec1 : array_like of float\n    Declination of the first catalogue [rad].\n" \
+  "RA2 : array_like of float\n    Right-ascension of the second (random) catalogue [rad].\n" \
+  "Dec2 : array_like of float\n    Declination of the second catalogue [rad].\n" \
   "thetabin : list of float\n    Angular separation bin edges [rad].\n" \
-  "\nReturns\n-------\nlist of int\n    Pair counts per bin."
+  BINNING_PARAM_DOC \
+  "\nReturns\n-------\nnumpy.ndarray of int\n    Pair counts per bin."
 
 #define DD3D_DOC \
   "Count data-data pairs in 3D separation bins.\n" \
   "\nParameters\n----------\n" \
-  "X : list of float\n    X-coordinates of the catalogue.\n" \
-  "Y : list of float\n    Y-coordinates of the catalogue.\n" \
-  "Z : list of float\n    Z-coordinates of the catalogue.\n" \
+  "X : array_like of float\n    X-coordinates of the catalogue.\n" \
+  "Y : array_like of float\n    Y-coordinates of the catalogue.\n" \
+  "Z : array_like of float\n    Z-coordinates of the catalogue.\n" \
   "rbin : list of float\n    Separation bin edges.\n" \
-  "\nReturns\n-------\nlist of int\n    Pair counts per bin."
+  BOX_PARAM_DOC \
+  BINNING_PARAM_DOC \
+  "\nReturns\n-------\nnumpy.ndarray of int\n    Pair counts per bin."
 
 #define DR3D_DOC \
   "Count data-random cross-pairs in 3D separation bins.\n" \
   "\nParameters\n----------\n" \
-  "X1 : list of float\n    X-coordinates of the first (data) catalogue.\n" \
-  "Y1 : list of float\n    Y-coordinates of the first catalogue.\n" \
-  "Z1 : list of float\n    Z-coordinates of the first catalogue.\n" \
-  "X2 : list of float\n    X-coordinates of the second (random) catalogue.\n" \
-  "Y2 : list of float\n    Y-coordinates of the second catalogue.\n" \
-  "Z2 : list of float\n    Z-coordinates of the second catalogue.\n" \
+  "X1 : array_like of float\n    X-coordinates of the first (data) catalogue.\n" \
+  "Y1 : array_like of float\n    Y-coordinates of the first catalogue.\n" \
+  "Z1 : array_like of float\n    Z-coordinates of the first catalogue.\n" \
+  "X2 : array_like of float\n    X-coordinates of the second (random) catalogue.\n" \
+  "Y2 : array_like of float\n    Y-coordinates of the second catalogue.\n" \
+  "Z2 : array_like of float\n    Z-coordinates of the second catalogue.\n" \
+  "rbin : list of float\n    Separation bin edges.\n" \
+  BOX_PARAM_DOC \
+  BINNING_PARAM_DOC \
+  "\nReturns\n-------\nnumpy.ndarray of int\n    Pair counts per bin."
+
+#define POS_DOC \
+  "\n\nThe catalogue can also be passed as a single ``pos`` array of shape\n" \
+  "``(N, Ndim)`` (``pos1``, ``pos2`` for cross-pairs). Contiguous float32\n" \
+  "columns are read in place, other inputs are converted once to float32.\n" \
+  "The GIL is released while counting."
+
+#define RPPI_PARAM_DOC \
+  "rpbin : list of float\n    Bins of the separation perpendicular to the line of sight.\n" \
+  "pimax : float\n    Maximum separation parallel to the line of sight.\n" \
+  "npi : int\n    Number of linear bins of ``|pi|`` in ``[0, pimax)``.\n" \
+  BOX_PARAM_DOC \
+  "los : line_of_sight, optional\n    ``line_of_sight.z`` (default) for the plane-parallel\n" \
+  "    approximation along the z axis, ``line_of_sight.midpoint`` for the\n" \
+  "    direction of the pair midpoint (open boundaries only).\n" \
+  BINNING_PARAM_DOC \
+  "\nReturns\n-------\nnumpy.ndarray of int, shape (nrp, npi)\n    Pair counts per ( rp, pi ) bin."
+
+#define DD_RPPI_DOC \
+  "Count data-data pairs in bins of separation perpendicular (rp) and\n" \
+  "parallel (pi) to the line of sight.\n" \
+  "\nParameters\n----------\n" \
+  "X, Y, Z : array_like of float\n    Coordinates of the catalogue.\n" \
+  RPPI_PARAM_DOC
+
+#define DR_RPPI_DOC \
+  "Count data-random cross-pairs in bins of separation perpendicular (rp)\n" \
+  "and parallel (pi) to the line of sight.\n" \
+  "\nParameters\n----------\n" \
+  "X1, Y1, Z1 : array_like of float\n    Coordinates of the first (data) catalogue.\n" \
+  "X2, Y2, Z2 : array_like of float\n    Coordinates of the second (random) catalogue.\n" \
+  RPPI_PARAM_DOC
+
+#define SMU_PARAM_DOC \
+  BOX_PARAM_DOC \
+  "los : line_of_sight, optional\n    Line of sight, see ``d3D_DD_rppi``.\n" \
+  BINNING_PARAM_DOC
+
+#define SMU_DOC( pairs, coords ) \
+  "Count " pairs " in bins of separation s and of |mu|, the cosine\n" \
+  "of the angle between separation and line of sight.\n" \
+  "\nParameters\n----------\n" coords \
+  "sbin : list of float\n    Separation bins.\n" \
+  "nmu : int\n    Number of linear bins of ``|mu|`` in ``[0, 1]``.\n" \
+  SMU_PARAM_DOC \
+  "\nReturns\n-------\nnumpy.ndarray of int, shape (ns, nmu)\n    Pair counts per ( s, mu ) bin."
+
+#define MULTIPOLES_DOC( pairs, coords ) \
+  "Sum, over " pairs " in each separation bin, the even Legendre\n" \
+  "polynomials L_0(mu), L_2(mu), ..., L_lmax(mu) of the cosine mu of the\n" \
+  "angle between separation and line of sight.\n" \
+  "\nParameters\n----------\n" coords \
+  "sbin : list of float\n    Separation bins.\n" \
+  "lmax : int\n    Highest multipole, even.\n" \
+  SMU_PARAM_DOC \
+  "\nReturns\n-------\nnumpy.ndarray of float, shape (ns, lmax / 2 + 1)\n" \
+  "    Legendre sums per separation bin, column ell / 2 for multipole ell."
+
+#define DD_COORDS_DOC \
+  "X, Y, Z : array_like of float\n    Coordinates of the catalogue.\n"
+
+#define DR_COORDS_DOC \
+  "X1, Y1, Z1 : array_like of float\n    Coordinates of the first (data) catalogue.\n" \
+  "X2, Y2, Z2 : array_like of float\n    Coordinates of the second (random) catalogue.\n"
+
+#define JK_DOC( name ) \
+  "Jackknife version of ``" name "``: each catalogue is followed by the\n" \
+  "region labels of its objects (``R``, or ``R1`` and ``R2``, array_like of\n" \
+  "int in ``[0, nreg)``) and by ``nreg``. Returns, in a single traversal,\n" \
+  "a numpy.ndarray of int of shape (nreg + 1, nbin): row k < nreg counts\n" \
+  "the pairs with no object in region k, row nreg counts all pairs."
+
+#define BOOT_DOC( name ) \
+  "Bootstrap version of ``" name "``: the coordinates are followed by\n" \
+  "``nboot``, ``seed`` and, after the usual arguments, by ``resampling``.\n" \
+  "Each object of the (first) catalogue has ``nboot`` multiplicities drawn\n" \
+  "from a counter-based generator keyed by ``seed``, the same in the DD and\n" \
+  "DR counters. Returns, in a single traversal, a numpy.ndarray of int of\n" \
+  "shape (nboot + 1, nbin): row b < nboot sums the products of the\n" \
+  "multiplicities of the pairs in resample b, row nboot counts all pairs."
+
+#define WEIGHTED_DOC( name ) \
+  "Weighted version of ``" name "``: the weights of each catalogue\n" \
+  "(``W``, or ``W1`` and ``W2``, array_like of float) follow its coordinates\n" \
+  "and each pair contributes the product of the weights of its objects.\n" \
+  "Returns a numpy.ndarray of float, sums are accumulated in double precision.\n" \
+  "With positions arrays, weights are passed as ``w`` (``w1``, ``w2``)."
+
+#define GRID_DOC \
+  " Only pairs of objects in neighbouring cells of a grid with cell side\n" \
+  "of the order of ``rbin[-1]`` are visited, the cell side is chosen\n" \
+  "automatically. Returns the same histogram as the brute-force version."
+
+#define TILED_DOC \
+  " Both catalogues are sorted along a Z-order curve and split in tiles\n" \
+  "(64 objects for the first, 256 for the second), each tile of the second\n" \
+  "catalogue is compared with a whole tile of the first while it sits in\n" \
+  "cache and a tree over the tiles skips those farther apart than\n" \
+  "``rbin[-1]``: suited for random catalogues much larger than the caches.\n" \
+  "Returns the same histogram as the brute-force version. Experimental and\n" \
+  "opt-in: it is not faster than ``d3D_DR`` at every separation range, so\n" \
+  "the estimators of :mod:`scampy.measure.clustering` keep ``d3D_DR`` and\n" \
+  "the tiled counters are only run when called directly."
+
+#define STREAM_DOC( counter ) \
+  "Out-of-core version of ``" counter "`` on memory-mapped coordinate files:\n" \
+  "the catalogues are counted one pair of chunks of ``chunk_size`` objects\n" \
+  "at a time, with the cell-list counters, so that memory is bounded by\n" \
+  "the chunk size. With ``checkpoint`` (a directory), the partial histogram\n" \
+  "is saved after each pair of chunks and a count started again with the\n" \
+  "same arguments resumes from there; a completed count is read back.\n" \
+  "Files are identified by path, size and modification time."
+
+#define LS_DOC \
+  "Landy-Szalay correlation function of catalogue 1 (data) with randoms\n" \
+  "catalogue 2, with DD, DR and RR counted in a single call: each catalogue\n" \
+  "is distributed once on a cell list shared by the counts, and the three\n" \
+  "counts run in one parallel loop. Returns a dict with ``xi``, the raw\n" \
+  "counts ``DD``, ``DR``, ``RR`` and their normalisations ``normDD``,\n" \
+  "``normDR``, ``normRR``."
+
+#define TRACERS_DOC( counter ) \
+  "Multi-tracer version of ``" counter "``: the catalogue is followed by the\n" \
+  "tracer labels of its objects (``T``, array_like of int in ``[0, ntracer)``)\n" \
+  "and by ``ntracer``. Returns, in a single traversal of the cell list, an\n" \
+  "array of shape (ntracer * (ntracer + 1) / 2, nbin) whose rows are the\n" \
+  "histograms of the pairs of labels (a, b), a <= b, in the order\n" \
+  "(0, 0), (0, 1), ..., (0, ntracer - 1), (1, 1), ...: the auto-counts of\n" \
+  "each sample and the cross-counts of each pair of samples."
+
+#define CIC_DOC \
+  "Counts of the objects of catalogue ( X, Y, Z ) within distance r < R of the\n" \
+  "centres ( CX, CY, CZ ), for the strictly increasing radii R, on the cell list\n" \
+  "of the catalogue. Returns P, of shape ( nradius, nmax + 1 ), the number of\n" \
+  "spheres holding N objects (column nmax collecting N >= nmax, column 0 giving\n" \
+  "the void probability function), and M, of shape ( nradius, 4 ), the mean and\n" \
+  "the central moments of order 2, 3, 4 of the counts. With box > 0 centres lie\n" \
+  "in [0, box) and distances follow the minimum-image convention."
+
+#define KNN_DOC \
+  "Cumulative distributions of the distances from the query points\n" \
+  "( QX, QY, QZ ) to their k-th nearest object of catalogue ( X, Y, Z ), for\n" \
+  "each of the strictly increasing ``k``, searched on a k-d tree of the\n" \
+  "catalogue. Returns an array of shape ( nk, nradius ) holding the number of\n" \
+  "query points whose k-th neighbour lies at distance r <= radii[ i ]; the\n" \
+  "distances themselves are never stored. With box > 0 queries lie in [0, box)\n" \
+  "and distances follow the minimum-image convention."
+
+#define FOF_DOC \
+  "Friends-of-friends groups of catalogue ( X, Y, Z ): objects linked by chains\n" \
+  "of pairs at separation r <= linking_length, found by a union-find over the\n" \
+  "pairs of the cell list. Returns the group of each object and the number of\n" \
+  "objects in each group; groups are numbered in the order of their first\n" \
+  "object and isolated objects are groups of one. With box > 0 objects lie in\n" \
+  "[0, box) and groups extend across the faces of the box."
+
+#define FINE_DOC( counter ) \
+  "Pair counts of ``" counter "`` between ``rmin`` and ``rmax``, recorded once\n" \
+  "in a fine histogram of the squared separations (relative bin width\n" \
+  "2^-13 in r^2) that ``rebin`` turns into the counts in any bins within\n" \
+  "that range, in microseconds and without counting again.\n" \
+  "Uses the cell-list engine."
+
+#define MARKED_DOC( counter ) \
+  "Marked version of ``" counter "``: the catalogues carry ``marks`` of shape\n" \
+  "``(nmark, N)``. Returns, in a single traversal, an array of shape\n" \
+  "``(nbin, nmark + 1)`` holding per bin the pair count (column 0) and the\n" \
+  "sums over pairs of the products of the marks of each kind (column\n" \
+  "``1 + k`` for mark ``k``)."
+
+#define THREEPCF_DOC \
+  "Legendre multipoles of the three-point counts. For each primary, the\n" \
+  "neighbours within ``rbin[-1]`` are projected on spherical harmonics in\n" \
+  "each separation bin and, by the addition theorem, the sums over pairs\n" \
+  "of neighbours of P_ell of the angle between them follow without\n" \
+  "visiting the pairs (Slepian & Eisenstein 2015).\n" \
+  "\nParameters\n----------\n" \
+  "X, Y, Z : array_like of float\n    Coordinates of the catalogue.\n" \
   "rbin : list of float\n    Separation bin edges.\n" \
-  "\nReturns\n-------\nlist of int\n    Pair counts per bin."
+  "lmax : int\n    Highest multipole (at most 32).\n" \
+  BOX_PARAM_DOC \
+  BINNING_PARAM_DOC \
+  "\nReturns\n-------\nnumpy.ndarray of float, shape (lmax + 1, nbin, nbin)\n" \
+  "    Element ``[ell, b1, b2]`` is the sum over primaries and ordered pairs of\n" \
+  "    distinct neighbours in bins ``b1`` and ``b2`` of P_ell(cos theta)."
+
+#define RR_PERIODIC_DOC( geometry, volume ) \
+  "Normalised RR counts of a uniform catalogue in a periodic box, in " geometry "\n" \
+  "bins: the fraction of pairs in each bin, " volume " of the bin over the box\n" \
+  "volume. Bins have to fit in the box (up to box / 2).\n"
+
+#define XI_PERIODIC_DOC \
+  "Correlation function of a catalogue in a periodic box from its DD counts\n" \
+  "alone, with the natural estimator DD / RR - 1 and the analytic RR of\n" \
+  "``RR_periodic_*``: no random catalogue is needed.\n" \
+  "\nReturns\n-------\nnumpy.ndarray of float\n    Correlation function per bin."
+
+#define SPHERE_DOC \
+  " Separations are exact great-circle angles, not flat-sky ones: positions\n" \
+  "are turned into unit vectors once and pairs are binned by chord length,\n" \
+  "with a dual-tree traversal of k-d trees built on the unit vectors.\n" \
+  "thetabin can reach pi."
+
+#define TREE_DOC \
+  " Pairs are counted with a dual-tree traversal of k-d trees built on the\n" \
+  "catalogues, whole pairs of nodes are binned at once when all their\n" \
+  "separations fall in the same bin. Best suited for catalogues with strongly\n" \
+  "varying density, such as lightcones."
+
+namespace {
+
+  using view = utl::array_view< float >;
+  using scheme = utl::binning::scheme;
+  using hist = std::vector< std::size_t >;
+  using whist = std::vector< double >;
+
+  // float32 arrays: contiguous float32 inputs are not copied, any
+  // other input (lists, float64, strided views) is converted once
+  using farray = py::array_t< float, py::array::c_style | py::array::forcecast >;
+
+  // region labels, as for coordinates int32 arrays are not copied
+  using iarray = py::array_t< int, py::array::c_style | py::array::forcecast >;
+
+  // view on a 1D coordinate array
+  view column ( const farray & arr ) {
+
+    if ( arr.ndim() != 1 )
+      throw py::value_error( "coordinate arrays must be 1-dimensional" );
+    return { arr.data(), std::size_t( arr.shape( 0 ) ) };
+
+  }
+
+  // columns of an ( N, D ) positions array, de-interleaved into the
+  // structure-of-arrays layout required by the counters (no GIL needed)
+  template < std::size_t D >
+  std::array< std::vector< float >, D > columns ( const farray & pos ) {
+
+    const std::size_t size = pos.shape( 0 );
+    const float * pp = pos.data();
+    std::array< std::vector< float >, D > out;
+    for ( std::size_t dd = 0; dd < D; ++dd ) {
+      out[ dd ].resize( size );
+      for ( std::size_t ii = 0; ii < size; ++ii ) out[ dd ][ ii ] = pp[ ii * D + dd ];
+    }
+    return out;
+
+  }
+
+  template < std::size_t D >
+  void check_positions ( const farray & pos ) {
+
+    if ( pos.ndim() != 2 || pos.shape( 1 ) != D )
+      throw py::value_error( "positions must be an array of shape (N, " +
+			     std::to_string( D ) + ")" );
+
+  }
+
+  // coordinate array, checked against the first coordinate of its catalogue
+  view column ( const farray & arr, const std::size_t size ) {
+
+    const view cc = column( arr );
+    if ( cc.size() != size )
+      throw py::value_error( "coordinate arrays must have the same length" );
+    return cc;
+
+  }
+
+  // weights array, checked against the size of its catalogue
+  view weights ( const farray & arr, const std::size_t size ) {
+
+    const view ww = column( arr );
+    if ( ww.size() != size )
+      throw py::value_error( "weights must have the same length as the coordinates" );
+    return ww;
+
+  }
+
+  // region labels, checked against the size of their catalogue
+  utl::array_view< int > regions ( const iarray & arr, const std::size_t size ) {
+
+    if ( arr.ndim() != 1 || std::size_t( arr.shape( 0 ) ) != size )
+      throw py::value_error( "region labels must be a 1D array with the same length as the coordinates" );
+    return { arr.data(), size };
+
+  }
+
+  // runs a counter with the GIL released and returns the histogram as a NumPy array
+  template < typename F >
+  auto count ( F && fn ) {
+
+    std::invoke_result_t< F & > NN;
+    {
+      py::gil_scoped_release release;
+      NN = fn();
+    }
+    return py::array_t< typename decltype( NN )::value_type >( NN.size(), NN.data() );
+
+  }
+
+  using counter_2D_DD = hist (*) ( const view &, const view &,
+				   const std::vector< float > &, const float, const scheme );
+  using counter_2D_DR = hist (*) ( const view &, const view &, const view &, const view &,
+				   const std::vector< float > &, const float, const scheme );
+  using counter_A2D_DD = hist (*) ( const view &, const view &,
+				    const std::vector< float > &, const scheme );
+  using counter_A2D_DR = hist (*) ( const view &, const view &, const view &, const view &,
+				    const std::vector< float > &, const scheme );
+  using counter_3D_DD = hist (*) ( const view &, const view &, const view &,
+				   const std::vector< float > &, const float, const scheme );
+  using counter_3D_DR = hist (*) ( const view &, const view &, const view &,
+				   const view &, const view &, const view &,
+				   const std::vector< float > &, const float, const scheme );
+
+  using counter_rppi_DD = hist (*) ( const view &, const view &, const view &,
+				     const std::vector< float > &, const float, const std::size_t,
+				     const float, const utl::line_of_sight, const scheme );
+  using counter_rppi_DR = hist (*) ( const view &, const view &, const view &,
+				     const view &, const view &, const view &,
+				     const std::vector< float > &, const float, const std::size_t,
+				     const float, const utl::line_of_sight, const scheme );
+
+  // ( s, mu ) counters, the size argument is nmu for the histograms and
+  // lmax for the multipoles
+  template < typename R >
+  using counter_smu_DD = R (*) ( const view &, const view &, const view &,
+				 const std::vector< float > &, const std::size_t,
+				 const float, const utl::line_of_sight, const scheme );
+  template < typename R >
+  using counter_smu_DR = R (*) ( const view &, const view &, const view &,
+				 const view &, const view &, const view &,
+				 const std::vector< float > &, const std::size_t,
+				 const float, const utl::line_of_sight, const scheme );
+
+  // jackknife counters, region labels follow the coordinates of each catalogue
+  using ilabels = utl::array_view< int >;
+  using counter_jk_2D_DD = hist (*) ( const view &, const view &, const ilabels &, const std::size_t,
+				      const std::vector< float > &, const float, const scheme );
+  using counter_jk_2D_DR = hist (*) ( const view &, const view &, const ilabels &,
+				      const view &, const view &, const ilabels &, const std::size_t,
+				      const std::vector< float > &, const float, const scheme );
+  using counter_jk_A2D_DD = hist (*) ( const view &, const view &, const ilabels &, const std::size_t,
+				       const std::vector< float > &, const scheme );
+  using counter_jk_A2D_DR = hist (*) ( const view &, const view &, const ilabels &,
+				       const view &, const view &, const ilabels &, const std::size_t,
+				       const std::vector< float > &, const scheme );
+  using counter_jk_3D_DD = hist (*) ( const view &, const view &, const view &,
+				      const ilabels &, const std::size_t,
+				      const std::vector< float > &, const float, const scheme );
+  using counter_jk_3D_DR = hist (*) ( const view &, const view &, const view &, const ilabels &,
+				      const view &, const view &, const view &, const ilabels &,
+				      const std::size_t, const std::vector< float > &, const float, const scheme );
+
+  // bootstrap counters, number of resamples and seed follow the coordinates
+  using counter_boot_2D_DD = hist (*) ( const view &, const view &, const std::size_t, const std::uint64_t,
+					const std::vector< float > &, const float, const scheme,
+					const utl::resampling );
+  using counter_boot_2D_DR = hist (*) ( const view &, const view &, const view &, const view &,
+					const std::size_t, const std::uint64_t,
+					const std::vector< float > &, const float, const scheme,
+					const utl::resampling );
+  using counter_boot_A2D_DD = hist (*) ( const view &, const view &, const std::size_t, const std::uint64_t,
+					 const std::vector< float > &, const scheme, const utl::resampling );
+  using counter_boot_A2D_DR = hist (*) ( const view &, const view &, const view &, const view &,
+					 const std::size_t, const std::uint64_t,
+					 const std::vector< float > &, const scheme, const utl::resampling );
+  using counter_boot_3D_DD = hist (*) ( const view &, const view &, const view &,
+					const std::size_t, const std::uint64_t,
+					const std::vector< float > &, const float, const scheme,
+					const utl::resampling );
+  using counter_boot_3D_DR = hist (*) ( const view &, const view &, const view &,
+					const view &, const view &, const view &,
+					const std::size_t, const std::uint64_t,
+					const std::vector< float > &, const float, const scheme,
+					const utl::resampling );
+
+  // marked counters, marks passed with their number
+  using counter_marked_DD = whist (*) ( const view &, const view &, const view &,
+					const view &, const std::size_t,
+					const std::vector< float > &, const float, const scheme );
+  using counter_marked_DR = whist (*) ( const view &, const view &, const view &, const view &,
+					const view &, const view &, const view &, const view &,
+					const std::size_t,
+					const std::vector< float > &, const float, const scheme );
+
+  // three-point multipoles
+  using counter_3pcf = whist (*) ( const view &, const view &, const view &,
+				   const std::vector< float > &, const std::size_t,
+				   const float, const scheme );
+  using wcounter_3pcf = whist (*) ( const view &, const view &, const view &, const view &,
+				    const std::vector< float > &, const std::size_t,
+				    const float, const scheme );
+
+  // periodic-box estimators with analytic RR
+  using xi_periodic_2D = whist (*) ( const view &, const view &,
+				     const std::vector< float > &, const float, const scheme );
+  using xi_periodic_3D = whist (*) ( const view &, const view &, const view &,
+				     const std::vector< float > &, const float, const scheme );
+  using wp_periodic = whist (*) ( const view &, const view &, const view &,
+				  const std::vector< float > &, const float, const std::size_t,
+				  const float, const scheme );
+
+  // weighted counters, weights follow the coordinates of each catalogue
+  using wcounter_2D_DD = whist (*) ( const view &, const view &, const view &,
+				     const std::vector< float > &, const float, const scheme );
+  using wcounter_2D_DR = whist (*) ( const view &, const view &, const view &,
+				     const view &, const view &, const view &,
+				     const std::vector< float > &, const float, const scheme );
+  using wcounter_A2D_DD = whist (*) ( const view &, const view &, const view &,
+				      const std::vector< float > &, const scheme );
+  using wcounter_A2D_DR = whist (*) ( const view &, const view &, const view &,
+				      const view &, const view &, const view &,
+				      const std::vector< float > &, const scheme );
+  using wcounter_3D_DD = whist (*) ( const view &, const view &, const view &, const view &,
+				     const std::vector< float > &, const float, const scheme );
+  using wcounter_3D_DR = whist (*) ( const view &, const view &, const view &, const view &,
+				     const view &, const view &, const view &, const view &,
+				     const std::vector< float > &, const float, const scheme );
+
+  // Each def_* registers a counter twice: on separate coordinate
+  // arrays and on ( N, Ndim ) positions arrays
+
+  void def_2D_DD ( py::module_ & m, const char * name, counter_2D_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() );
+	     return count( [ & ] { return fn( xx, yy, rbin, box, binning ); } );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     check_positions< 2 >( pos );
+	     return count( [ & ] {
+	       auto cc = columns< 2 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], rbin, box, binning );
+	     } );
+	   },
+	   py::arg("pos"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_2D_DR ( py::module_ & m, const char * name, counter_2D_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1,
+			  const farray & X2, const farray & Y2,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() );
+	     return count( [ & ] { return fn( x1, y1, x2, y2, rbin, box, binning ); } );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("X2"), py::arg("Y2"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos1, const farray & pos2,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     check_positions< 2 >( pos1 );
+	     check_positions< 2 >( pos2 );
+	     return count( [ & ] {
+	       auto c1 = columns< 2 >( pos1 ), c2 = columns< 2 >( pos2 );
+	       return fn( c1[ 0 ], c1[ 1 ], c2[ 0 ], c2[ 1 ], rbin, box, binning );
+	     } );
+	   },
+	   py::arg("pos1"), py::arg("pos2"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_A2D_DD ( py::module_ & m, const char * name, counter_A2D_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & RA, const farray & Dec,
+			  const std::vector< float > & thetabin, const scheme binning ) {
+	     const view ra = column( RA ), dec = column( Dec, ra.size() );
+	     return count( [ & ] { return fn( ra, dec, thetabin, binning ); } );
+	   }, doc,
+	   py::arg("RA"), py::arg("Dec"), py::arg("thetabin"),
+	   py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos,
+			  const std::vector< float > & thetabin, const scheme binning ) {
+	     check_positions< 2 >( pos );
+	     return count( [ & ] {
+	       auto cc = columns< 2 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], thetabin, binning );
+	     } );
+	   },
+	   py::arg("pos"), py::arg("thetabin"),
+	   py::arg("binning") = scheme::log );
+
+  }
+
+  void def_A2D_DR ( py::module_ & m, const char * name, counter_A2D_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & RA1, const farray & Dec1,
+			  const farray & RA2, const farray & Dec2,
+			  const std::vector< float > & thetabin, const scheme binning ) {
+	     const view ra1 = column( RA1 ), dec1 = column( Dec1, ra1.size() );
+	     const view ra2 = column( RA2 ), dec2 = column( Dec2, ra2.size() );
+	     return count( [ & ] { return fn( ra1, dec1, ra2, dec2, thetabin, binning ); } );
+	   }, doc,
+	   py::arg("RA1"), py::arg("Dec1"), py::arg("RA2"), py::arg("Dec2"), py::arg("thetabin"),
+	   py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos1, const farray & pos2,
+			  const std::vector< float > & thetabin, const scheme binning ) {
+	     check_positions< 2 >( pos1 );
+	     check_positions< 2 >( pos2 );
+	     return count( [ & ] {
+	       auto c1 = columns< 2 >( pos1 ), c2 = columns< 2 >( pos2 );
+	       return fn( c1[ 0 ], c1[ 1 ], c2[ 0 ], c2[ 1 ], thetabin, binning );
+	     } );
+	   },
+	   py::arg("pos1"), py::arg("pos2"), py::arg("thetabin"),
+	   py::arg("binning") = scheme::log );
+
+  }
+
+  void def_3D_DD ( py::module_ & m, const char * name, counter_3D_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     return count( [ & ] { return fn( xx, yy, zz, rbin, box, binning ); } );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     check_positions< 3 >( pos );
+	     return count( [ & ] {
+	       auto cc = columns< 3 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], cc[ 2 ], rbin, box, binning );
+	     } );
+	   },
+	   py::arg("pos"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_3D_DR ( py::module_ & m, const char * name, counter_3D_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1, const farray & Z1,
+			  const farray & X2, const farray & Y2, const farray & Z2,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() ), z1 = column( Z1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() ), z2 = column( Z2, x2.size() );
+	     return count( [ & ] { return fn( x1, y1, z1, x2, y2, z2, rbin, box, binning ); } );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("Z1"),
+	   py::arg("X2"), py::arg("Y2"), py::arg("Z2"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos1, const farray & pos2,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     check_positions< 3 >( pos1 );
+	     check_positions< 3 >( pos2 );
+	     return count( [ & ] {
+	       auto c1 = columns< 3 >( pos1 ), c2 = columns< 3 >( pos2 );
+	       return fn( c1[ 0 ], c1[ 1 ], c1[ 2 ], c2[ 0 ], c2[ 1 ], c2[ 2 ], rbin, box, binning );
+	     } );
+	   },
+	   py::arg("pos1"), py::arg("pos2"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_w2D_DD ( py::module_ & m, const char * name, wcounter_2D_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & W,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), ww = weights( W, xx.size() );
+	     return count( [ & ] { return fn( xx, yy, ww, rbin, box, binning ); } );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("W"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos, const farray & w,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     check_positions< 2 >( pos );
+	     const view ww = weights( w, pos.shape( 0 ) );
+	     return count( [ & ] {
+	       auto cc = columns< 2 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], ww, rbin, box, binning );
+	     } );
+	   },
+	   py::arg("pos"), py::arg("w"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_w2D_DR ( py::module_ & m, const char * name, wcounter_2D_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1, const farray & W1,
+			  const farray & X2, const farray & Y2, const farray & W2,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() ), w1 = weights( W1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() ), w2 = weights( W2, x2.size() );
+	     return count( [ & ] { return fn( x1, y1, w1, x2, y2, w2, rbin, box, binning ); } );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("W1"),
+	   py::arg("X2"), py::arg("Y2"), py::arg("W2"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos1, const farray & w1,
+			  const farray & pos2, const farray & w2,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     check_positions< 2 >( pos1 );
+	     check_positions< 2 >( pos2 );
+	     const view ww1 = weights( w1, pos1.shape( 0 ) ), ww2 = weights( w2, pos2.shape( 0 ) );
+	     return count( [ & ] {
+	       auto c1 = columns< 2 >( pos1 ), c2 = columns< 2 >( pos2 );
+	       return fn( c1[ 0 ], c1[ 1 ], ww1, c2[ 0 ], c2[ 1 ], ww2, rbin, box, binning );
+	     } );
+	   },
+	   py::arg("pos1"), py::arg("w1"), py::arg("pos2"), py::arg("w2"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_wA2D_DD ( py::module_ & m, const char * name, wcounter_A2D_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & RA, const farray & Dec, const farray & W,
+			  const std::vector< float > & thetabin, const scheme binning ) {
+	     const view ra = column( RA ), dec = column( Dec, ra.size() ), ww = weights( W, ra.size() );
+	     return count( [ & ] { return fn( ra, dec, ww, thetabin, binning ); } );
+	   }, doc,
+	   py::arg("RA"), py::arg("Dec"), py::arg("W"), py::arg("thetabin"),
+	   py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos, const farray & w,
+			  const std::vector< float > & thetabin, const scheme binning ) {
+	     check_positions< 2 >( pos );
+	     const view ww = weights( w, pos.shape( 0 ) );
+	     return count( [ & ] {
+	       auto cc = columns< 2 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], ww, thetabin, binning );
+	     } );
+	   },
+	   py::arg("pos"), py::arg("w"), py::arg("thetabin"),
+	   py::arg("binning") = scheme::log );
+
+  }
+
+  void def_wA2D_DR ( py::module_ & m, const char * name, wcounter_A2D_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & RA1, const farray & Dec1, const farray & W1,
+			  const farray & RA2, const farray & Dec2, const farray & W2,
+			  const std::vector< float > & thetabin, const scheme binning ) {
+	     const view ra1 = column( RA1 ), dec1 = column( Dec1, ra1.size() ), w1 = weights( W1, ra1.size() );
+	     const view ra2 = column( RA2 ), dec2 = column( Dec2, ra2.size() ), w2 = weights( W2, ra2.size() );
+	     return count( [ & ] { return fn( ra1, dec1, w1, ra2, dec2, w2, thetabin, binning ); } );
+	   }, doc,
+	   py::arg("RA1"), py::arg("Dec1"), py::arg("W1"),
+	   py::arg("RA2"), py::arg("Dec2"), py::arg("W2"), py::arg("thetabin"),
+	   py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos1, const farray & w1,
+			  const farray & pos2, const farray & w2,
+			  const std::vector< float > & thetabin, const scheme binning ) {
+	     check_positions< 2 >( pos1 );
+	     check_positions< 2 >( pos2 );
+	     const view ww1 = weights( w1, pos1.shape( 0 ) ), ww2 = weights( w2, pos2.shape( 0 ) );
+	     return count( [ & ] {
+	       auto c1 = columns< 2 >( pos1 ), c2 = columns< 2 >( pos2 );
+	       return fn( c1[ 0 ], c1[ 1 ], ww1, c2[ 0 ], c2[ 1 ], ww2, thetabin, binning );
+	     } );
+	   },
+	   py::arg("pos1"), py::arg("w1"), py::arg("pos2"), py::arg("w2"), py::arg("thetabin"),
+	   py::arg("binning") = scheme::log );
+
+  }
+
+  void def_w3D_DD ( py::module_ & m, const char * name, wcounter_3D_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z, const farray & W,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() ), ww = weights( W, xx.size() );
+	     return count( [ & ] { return fn( xx, yy, zz, ww, rbin, box, binning ); } );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("W"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos, const farray & w,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     check_positions< 3 >( pos );
+	     const view ww = weights( w, pos.shape( 0 ) );
+	     return count( [ & ] {
+	       auto cc = columns< 3 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], cc[ 2 ], ww, rbin, box, binning );
+	     } );
+	   },
+	   py::arg("pos"), py::arg("w"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_w3D_DR ( py::module_ & m, const char * name, wcounter_3D_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1, const farray & Z1, const farray & W1,
+			  const farray & X2, const farray & Y2, const farray & Z2, const farray & W2,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() ), z1 = column( Z1, x1.size() ), w1 = weights( W1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() ), z2 = column( Z2, x2.size() ), w2 = weights( W2, x2.size() );
+	     return count( [ & ] { return fn( x1, y1, z1, w1, x2, y2, z2, w2, rbin, box, binning ); } );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("Z1"), py::arg("W1"),
+	   py::arg("X2"), py::arg("Y2"), py::arg("Z2"), py::arg("W2"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos1, const farray & w1,
+			  const farray & pos2, const farray & w2,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     check_positions< 3 >( pos1 );
+	     check_positions< 3 >( pos2 );
+	     const view ww1 = weights( w1, pos1.shape( 0 ) ), ww2 = weights( w2, pos2.shape( 0 ) );
+	     return count( [ & ] {
+	       auto c1 = columns< 3 >( pos1 ), c2 = columns< 3 >( pos2 );
+	       return fn( c1[ 0 ], c1[ 1 ], c1[ 2 ], ww1, c2[ 0 ], c2[ 1 ], c2[ 2 ], ww2, rbin, box, binning );
+	     } );
+	   },
+	   py::arg("pos1"), py::arg("w1"), py::arg("pos2"), py::arg("w2"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  // flattened 2D histograms are returned with shape ( nrow, ncol )
+  template < typename T >
+  py::array as_2D ( py::array_t< T > && NN, const std::size_t ncol ) {
+    return NN.reshape( { std::size_t( NN.size() ) / ncol, ncol } );
+  }
+
+  void def_rppi_DD ( py::module_ & m, const char * name, counter_rppi_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z,
+			  const std::vector< float > & rpbin, const float pimax, const std::size_t npi,
+			  const float box, const utl::line_of_sight los, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     return as_2D( count( [ & ] {
+	       return fn( xx, yy, zz, rpbin, pimax, npi, box, los, binning );
+	     } ), npi );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("rpbin"), py::arg("pimax"), py::arg("npi"),
+	   py::arg("box") = 0.f, py::arg("los") = utl::line_of_sight::z,
+	   py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos,
+			  const std::vector< float > & rpbin, const float pimax, const std::size_t npi,
+			  const float box, const utl::line_of_sight los, const scheme binning ) {
+	     check_positions< 3 >( pos );
+	     return as_2D( count( [ & ] {
+	       auto cc = columns< 3 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], cc[ 2 ], rpbin, pimax, npi, box, los, binning );
+	     } ), npi );
+	   },
+	   py::arg("pos"), py::arg("rpbin"), py::arg("pimax"), py::arg("npi"),
+	   py::arg("box") = 0.f, py::arg("los") = utl::line_of_sight::z,
+	   py::arg("binning") = scheme::log );
+
+  }
+
+  void def_rppi_DR ( py::module_ & m, const char * name, counter_rppi_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1, const farray & Z1,
+			  const farray & X2, const farray & Y2, const farray & Z2,
+			  const std::vector< float > & rpbin, const float pimax, const std::size_t npi,
+			  const float box, const utl::line_of_sight los, const scheme binning ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() ), z1 = column( Z1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() ), z2 = column( Z2, x2.size() );
+	     return as_2D( count( [ & ] {
+	       return fn( x1, y1, z1, x2, y2, z2, rpbin, pimax, npi, box, los, binning );
+	     } ), npi );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("Z1"),
+	   py::arg("X2"), py::arg("Y2"), py::arg("Z2"), py::arg("rpbin"), py::arg("pimax"), py::arg("npi"),
+	   py::arg("box") = 0.f, py::arg("los") = utl::line_of_sight::z,
+	   py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos1, const farray & pos2,
+			  const std::vector< float > & rpbin, const float pimax, const std::size_t npi,
+			  const float box, const utl::line_of_sight los, const scheme binning ) {
+	     check_positions< 3 >( pos1 );
+	     check_positions< 3 >( pos2 );
+	     return as_2D( count( [ & ] {
+	       auto c1 = columns< 3 >( pos1 ), c2 = columns< 3 >( pos2 );
+	       return fn( c1[ 0 ], c1[ 1 ], c1[ 2 ], c2[ 0 ], c2[ 1 ], c2[ 2 ],
+			  rpbin, pimax, npi, box, los, binning );
+	     } ), npi );
+	   },
+	   py::arg("pos1"), py::arg("pos2"), py::arg("rpbin"), py::arg("pimax"), py::arg("npi"),
+	   py::arg("box") = 0.f, py::arg("los") = utl::line_of_sight::z,
+	   py::arg("binning") = scheme::log );
+
+  }
+
+  // number of columns of the ( s, mu ) output: nmu bins or lmax / 2 + 1 multipoles
+  inline std::size_t smu_columns ( const std::size_t nn, const bool multipoles ) {
+    return multipoles ? nn / 2 + 1 : nn;
+  }
+
+  template < typename R >
+  void def_smu_DD ( py::module_ & m, const char * name, counter_smu_DD< R > fn,
+		    const char * nname, const bool multipoles, const char * doc ) {
+
+    m.def( name, [ fn, multipoles ] ( const farray & X, const farray & Y, const farray & Z,
+				      const std::vector< float > & sbin, const std::size_t nn,
+				      const float box, const utl::line_of_sight los, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     return as_2D( count( [ & ] {
+	       return fn( xx, yy, zz, sbin, nn, box, los, binning );
+	     } ), smu_columns( nn, multipoles ) );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("sbin"), py::arg( nname ),
+	   py::arg("box") = 0.f, py::arg("los") = utl::line_of_sight::z,
+	   py::arg("binning") = scheme::log );
+    m.def( name, [ fn, multipoles ] ( const farray & pos,
+				      const std::vector< float > & sbin, const std::size_t nn,
+				      const float box, const utl::line_of_sight los, const scheme binning ) {
+	     check_positions< 3 >( pos );
+	     return as_2D( count( [ & ] {
+	       auto cc = columns< 3 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], cc[ 2 ], sbin, nn, box, los, binning );
+	     } ), smu_columns( nn, multipoles ) );
+	   },
+	   py::arg("pos"), py::arg("sbin"), py::arg( nname ),
+	   py::arg("box") = 0.f, py::arg("los") = utl::line_of_sight::z,
+	   py::arg("binning") = scheme::log );
+
+  }
+
+  template < typename R >
+  void def_smu_DR ( py::module_ & m, const char * name, counter_smu_DR< R > fn,
+		    const char * nname, const bool multipoles, const char * doc ) {
+
+    m.def( name, [ fn, multipoles ] ( const farray & X1, const farray & Y1, const farray & Z1,
+				      const farray & X2, const farray & Y2, const farray & Z2,
+				      const std::vector< float > & sbin, const std::size_t nn,
+				      const float box, const utl::line_of_sight los, const scheme binning ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() ), z1 = column( Z1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() ), z2 = column( Z2, x2.size() );
+	     return as_2D( count( [ & ] {
+	       return fn( x1, y1, z1, x2, y2, z2, sbin, nn, box, los, binning );
+	     } ), smu_columns( nn, multipoles ) );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("Z1"),
+	   py::arg("X2"), py::arg("Y2"), py::arg("Z2"), py::arg("sbin"), py::arg( nname ),
+	   py::arg("box") = 0.f, py::arg("los") = utl::line_of_sight::z,
+	   py::arg("binning") = scheme::log );
+    m.def( name, [ fn, multipoles ] ( const farray & pos1, const farray & pos2,
+				      const std::vector< float > & sbin, const std::size_t nn,
+				      const float box, const utl::line_of_sight los, const scheme binning ) {
+	     check_positions< 3 >( pos1 );
+	     check_positions< 3 >( pos2 );
+	     return as_2D( count( [ & ] {
+	       auto c1 = columns< 3 >( pos1 ), c2 = columns< 3 >( pos2 );
+	       return fn( c1[ 0 ], c1[ 1 ], c1[ 2 ], c2[ 0 ], c2[ 1 ], c2[ 2 ],
+			  sbin, nn, box, los, binning );
+	     } ), smu_columns( nn, multipoles ) );
+	   },
+	   py::arg("pos1"), py::arg("pos2"), py::arg("sbin"), py::arg( nname ),
+	   py::arg("box") = 0.f, py::arg("los") = utl::line_of_sight::z,
+	   py::arg("binning") = scheme::log );
+
+  }
+
+  // jackknife and bootstrap histograms are returned with one row per realisation
+  // plus the total, shape ( nreg + 1, nbin ) or ( nboot + 1, nbin )
+  py::array jk_rows ( py::array_t< std::size_t > && NN, const std::size_t nreg ) {
+    return NN.reshape( { nreg + 1, std::size_t( NN.size() ) / ( nreg + 1 ) } );
+  }
+
+  void def_jk_2D_DD ( py::module_ & m, const char * name, counter_jk_2D_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const iarray & R, const std::size_t nreg,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() );
+	     const ilabels rr = regions( R, xx.size() );
+	     return jk_rows( count( [ & ] { return fn( xx, yy, rr, nreg, rbin, box, binning ); } ), nreg );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("R"), py::arg("nreg"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_jk_2D_DR ( py::module_ & m, const char * name, counter_jk_2D_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1, const iarray & R1,
+			  const farray & X2, const farray & Y2, const iarray & R2, const std::size_t nreg,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() );
+	     const ilabels r1 = regions( R1, x1.size() ), r2 = regions( R2, x2.size() );
+	     return jk_rows( count( [ & ] {
+	       return fn( x1, y1, r1, x2, y2, r2, nreg, rbin, box, binning );
+	     } ), nreg );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("R1"), py::arg("X2"), py::arg("Y2"), py::arg("R2"),
+	   py::arg("nreg"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_jk_A2D_DD ( py::module_ & m, const char * name, counter_jk_A2D_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & RA, const farray & Dec, const iarray & R, const std::size_t nreg,
+			  const std::vector< float > & thetabin, const scheme binning ) {
+	     const view ra = column( RA ), dec = column( Dec, ra.size() );
+	     const ilabels rr = regions( R, ra.size() );
+	     return jk_rows( count( [ & ] { return fn( ra, dec, rr, nreg, thetabin, binning ); } ), nreg );
+	   }, doc,
+	   py::arg("RA"), py::arg("Dec"), py::arg("R"), py::arg("nreg"), py::arg("thetabin"),
+	   py::arg("binning") = scheme::log );
+
+  }
+
+  void def_jk_A2D_DR ( py::module_ & m, const char * name, counter_jk_A2D_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & RA1, const farray & Dec1, const iarray & R1,
+			  const farray & RA2, const farray & Dec2, const iarray & R2, const std::size_t nreg,
+			  const std::vector< float > & thetabin, const scheme binning ) {
+	     const view ra1 = column( RA1 ), dec1 = column( Dec1, ra1.size() );
+	     const view ra2 = column( RA2 ), dec2 = column( Dec2, ra2.size() );
+	     const ilabels r1 = regions( R1, ra1.size() ), r2 = regions( R2, ra2.size() );
+	     return jk_rows( count( [ & ] {
+	       return fn( ra1, dec1, r1, ra2, dec2, r2, nreg, thetabin, binning );
+	     } ), nreg );
+	   }, doc,
+	   py::arg("RA1"), py::arg("Dec1"), py::arg("R1"), py::arg("RA2"), py::arg("Dec2"), py::arg("R2"),
+	   py::arg("nreg"), py::arg("thetabin"),
+	   py::arg("binning") = scheme::log );
+
+  }
+
+  void def_jk_3D_DD ( py::module_ & m, const char * name, counter_jk_3D_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z,
+			  const iarray & R, const std::size_t nreg,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     const ilabels rr = regions( R, xx.size() );
+	     return jk_rows( count( [ & ] { return fn( xx, yy, zz, rr, nreg, rbin, box, binning ); } ), nreg );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("R"), py::arg("nreg"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_jk_3D_DR ( py::module_ & m, const char * name, counter_jk_3D_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1, const farray & Z1, const iarray & R1,
+			  const farray & X2, const farray & Y2, const farray & Z2, const iarray & R2,
+			  const std::size_t nreg,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() ), z1 = column( Z1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() ), z2 = column( Z2, x2.size() );
+	     const ilabels r1 = regions( R1, x1.size() ), r2 = regions( R2, x2.size() );
+	     return jk_rows( count( [ & ] {
+	       return fn( x1, y1, z1, r1, x2, y2, z2, r2, nreg, rbin, box, binning );
+	     } ), nreg );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("Z1"), py::arg("R1"),
+	   py::arg("X2"), py::arg("Y2"), py::arg("Z2"), py::arg("R2"),
+	   py::arg("nreg"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_boot_2D_DD ( py::module_ & m, const char * name, counter_boot_2D_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const std::size_t nboot,
+			  const std::uint64_t seed, const std::vector< float > & rbin,
+			  const float box, const scheme binning, const utl::resampling res ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() );
+	     return jk_rows( count( [ & ] {
+	       return fn( xx, yy, nboot, seed, rbin, box, binning, res );
+	     } ), nboot );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("nboot"), py::arg("seed"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log,
+	   py::arg("resampling") = utl::resampling::poisson );
+
+  }
+
+  void def_boot_2D_DR ( py::module_ & m, const char * name, counter_boot_2D_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1, const farray & X2, const farray & Y2,
+			  const std::size_t nboot, const std::uint64_t seed,
+			  const std::vector< float > & rbin, const float box,
+			  const scheme binning, const utl::resampling res ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() );
+	     return jk_rows( count( [ & ] {
+	       return fn( x1, y1, x2, y2, nboot, seed, rbin, box, binning, res );
+	     } ), nboot );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("X2"), py::arg("Y2"),
+	   py::arg("nboot"), py::arg("seed"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log,
+	   py::arg("resampling") = utl::resampling::poisson );
+
+  }
+
+  void def_boot_A2D_DD ( py::module_ & m, const char * name, counter_boot_A2D_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & RA, const farray & Dec, const std::size_t nboot,
+			  const std::uint64_t seed, const std::vector< float > & thetabin,
+			  const scheme binning, const utl::resampling res ) {
+	     const view ra = column( RA ), dec = column( Dec, ra.size() );
+	     return jk_rows( count( [ & ] {
+	       return fn( ra, dec, nboot, seed, thetabin, binning, res );
+	     } ), nboot );
+	   }, doc,
+	   py::arg("RA"), py::arg("Dec"), py::arg("nboot"), py::arg("seed"), py::arg("thetabin"),
+	   py::arg("binning") = scheme::log, py::arg("resampling") = utl::resampling::poisson );
+
+  }
+
+  void def_boot_A2D_DR ( py::module_ & m, const char * name, counter_boot_A2D_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & RA1, const farray & Dec1, const farray & RA2, const farray & Dec2,
+			  const std::size_t nboot, const std::uint64_t seed,
+			  const std::vector< float > & thetabin,
+			  const scheme binning, const utl::resampling res ) {
+	     const view ra1 = column( RA1 ), dec1 = column( Dec1, ra1.size() );
+	     const view ra2 = column( RA2 ), dec2 = column( Dec2, ra2.size() );
+	     return jk_rows( count( [ & ] {
+	       return fn( ra1, dec1, ra2, dec2, nboot, seed, thetabin, binning, res );
+	     } ), nboot );
+	   }, doc,
+	   py::arg("RA1"), py::arg("Dec1"), py::arg("RA2"), py::arg("Dec2"),
+	   py::arg("nboot"), py::arg("seed"), py::arg("thetabin"),
+	   py::arg("binning") = scheme::log, py::arg("resampling") = utl::resampling::poisson );
+
+  }
+
+  void def_boot_3D_DD ( py::module_ & m, const char * name, counter_boot_3D_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z,
+			  const std::size_t nboot, const std::uint64_t seed,
+			  const std::vector< float > & rbin, const float box,
+			  const scheme binning, const utl::resampling res ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     return jk_rows( count( [ & ] {
+	       return fn( xx, yy, zz, nboot, seed, rbin, box, binning, res );
+	     } ), nboot );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("nboot"), py::arg("seed"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log,
+	   py::arg("resampling") = utl::resampling::poisson );
+
+  }
+
+  void def_boot_3D_DR ( py::module_ & m, const char * name, counter_boot_3D_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1, const farray & Z1,
+			  const farray & X2, const farray & Y2, const farray & Z2,
+			  const std::size_t nboot, const std::uint64_t seed,
+			  const std::vector< float > & rbin, const float box,
+			  const scheme binning, const utl::resampling res ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() ), z1 = column( Z1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() ), z2 = column( Z2, x2.size() );
+	     return jk_rows( count( [ & ] {
+	       return fn( x1, y1, z1, x2, y2, z2, nboot, seed, rbin, box, binning, res );
+	     } ), nboot );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("Z1"), py::arg("X2"), py::arg("Y2"), py::arg("Z2"),
+	   py::arg("nboot"), py::arg("seed"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log,
+	   py::arg("resampling") = utl::resampling::poisson );
+
+  }
+
+  // ( nmark, N ) marks array (or ( N, ) for a single mark), checked against
+  // the size of its catalogue
+  std::pair< view, std::size_t > marks ( const farray & arr, const std::size_t size ) {
+
+    if ( arr.ndim() < 1 || arr.ndim() > 2 || std::size_t( arr.shape( arr.ndim() - 1 ) ) != size )
+      throw py::value_error( "marks must be an array of shape (nmark, N), N objects in the catalogue" );
+    const std::size_t nmark = arr.ndim() == 1 ? 1 : arr.shape( 0 );
+    return { view { arr.data(), std::size_t( arr.size() ) }, nmark };
+
+  }
+
+  void def_marked_DD ( py::module_ & m, const char * name, counter_marked_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z, const farray & M,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     const auto [ mm, nmark ] = marks( M, xx.size() );
+	     return as_2D( count( [ &, mm = mm, nmark = nmark ] {
+	       return fn( xx, yy, zz, mm, nmark, rbin, box, binning );
+	     } ), nmark + 1 );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("marks"), py::arg("rbin"),
+	   py::arg("box") = 0., py::arg("binning") = scheme::log );
+
+  }
+
+  void def_marked_DR ( py::module_ & m, const char * name, counter_marked_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1, const farray & Z1, const farray & M1,
+			  const farray & X2, const farray & Y2, const farray & Z2, const farray & M2,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() ), z1 = column( Z1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() ), z2 = column( Z2, x2.size() );
+	     const auto [ m1, nmark ] = marks( M1, x1.size() );
+	     const auto [ m2, nmark2 ] = marks( M2, x2.size() );
+	     if ( nmark != nmark2 )
+	       throw py::value_error( "the two catalogues must carry the same number of marks" );
+	     return as_2D( count( [ &, m1 = m1, m2 = m2, nmark = nmark ] {
+	       return fn( x1, y1, z1, m1, x2, y2, z2, m2, nmark, rbin, box, binning );
+	     } ), nmark + 1 );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("Z1"), py::arg("marks1"),
+	   py::arg("X2"), py::arg("Y2"), py::arg("Z2"), py::arg("marks2"), py::arg("rbin"),
+	   py::arg("box") = 0., py::arg("binning") = scheme::log );
+
+  }
+
+  // three-point multipoles are returned with shape ( lmax + 1, nbin, nbin )
+  py::array as_3pcf ( py::array_t< double > && NN, const std::size_t lmax ) {
+    const std::size_t nbin = std::size_t( std::llround( std::sqrt( NN.size() / ( lmax + 1 ) ) ) );
+    return NN.reshape( { lmax + 1, nbin, nbin } );
+  }
+
+  void def_3pcf ( py::module_ & m, const char * name, counter_3pcf fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z,
+			  const std::vector< float > & rbin, const std::size_t lmax,
+			  const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     return as_3pcf( count( [ & ] { return fn( xx, yy, zz, rbin, lmax, box, binning ); } ), lmax );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("rbin"), py::arg("lmax"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos, const std::vector< float > & rbin, const std::size_t lmax,
+			  const float box, const scheme binning ) {
+	     check_positions< 3 >( pos );
+	     return as_3pcf( count( [ & ] {
+	       auto cc = columns< 3 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], cc[ 2 ], rbin, lmax, box, binning );
+	     } ), lmax );
+	   },
+	   py::arg("pos"), py::arg("rbin"), py::arg("lmax"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_w3pcf ( py::module_ & m, const char * name, wcounter_3pcf fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z, const farray & W,
+			  const std::vector< float > & rbin, const std::size_t lmax,
+			  const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() ), ww = weights( W, xx.size() );
+	     return as_3pcf( count( [ & ] { return fn( xx, yy, zz, ww, rbin, lmax, box, binning ); } ), lmax );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("W"), py::arg("rbin"), py::arg("lmax"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos, const farray & w,
+			  const std::vector< float > & rbin, const std::size_t lmax,
+			  const float box, const scheme binning ) {
+	     check_positions< 3 >( pos );
+	     const view ww = weights( w, pos.shape( 0 ) );
+	     return as_3pcf( count( [ & ] {
+	       auto cc = columns< 3 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], cc[ 2 ], ww, rbin, lmax, box, binning );
+	     } ), lmax );
+	   },
+	   py::arg("pos"), py::arg("w"), py::arg("rbin"), py::arg("lmax"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_xi_periodic_2D ( py::module_ & m, const char * name, xi_periodic_2D fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() );
+	     return count( [ & ] { return fn( xx, yy, rbin, box, binning ); } );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("rbin"), py::arg("box"),
+	   py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     check_positions< 2 >( pos );
+	     return count( [ & ] {
+	       auto cc = columns< 2 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], rbin, box, binning );
+	     } );
+	   },
+	   py::arg("pos"), py::arg("rbin"), py::arg("box"), py::arg("binning") = scheme::log );
+
+  }
+
+  void def_xi_periodic_3D ( py::module_ & m, const char * name, xi_periodic_3D fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     return count( [ & ] { return fn( xx, yy, zz, rbin, box, binning ); } );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("rbin"), py::arg("box"),
+	   py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     check_positions< 3 >( pos );
+	     return count( [ & ] {
+	       auto cc = columns< 3 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], cc[ 2 ], rbin, box, binning );
+	     } );
+	   },
+	   py::arg("pos"), py::arg("rbin"), py::arg("box"), py::arg("binning") = scheme::log );
+
+  }
+
+  void def_wp_periodic ( py::module_ & m, const char * name, wp_periodic fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z,
+			  const std::vector< float > & rpbin, const float pimax, const std::size_t npi,
+			  const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     return count( [ & ] { return fn( xx, yy, zz, rpbin, pimax, npi, box, binning ); } );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("rpbin"), py::arg("pimax"), py::arg("npi"),
+	   py::arg("box"), py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos,
+			  const std::vector< float > & rpbin, const float pimax, const std::size_t npi,
+			  const float box, const scheme binning ) {
+	     check_positions< 3 >( pos );
+	     return count( [ & ] {
+	       auto cc = columns< 3 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], cc[ 2 ], rpbin, pimax, npi, box, binning );
+	     } );
+	   },
+	   py::arg("pos"), py::arg("rpbin"), py::arg("pimax"), py::arg("npi"),
+	   py::arg("box"), py::arg("binning") = scheme::log );
+
+  }
+
+  template < typename T >
+  using counter_stream_DD = std::vector< T > (*) ( const utl::coordinate_file &,
+						   const std::vector< float > &, const float, const scheme,
+						   const std::size_t, const std::string & );
+  template < typename T >
+  using counter_stream_DR = std::vector< T > (*) ( const utl::coordinate_file &,
+						   const utl::coordinate_file &,
+						   const std::vector< float > &, const float, const scheme,
+						   const std::size_t, const std::string & );
+
+  template < typename T >
+  void def_stream_DD ( py::module_ & m, const char * name, counter_stream_DD< T > fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const utl::coordinate_file & file, const std::vector< float > & rbin,
+			  const float box, const scheme binning,
+			  const std::size_t chunk_size, const std::string & checkpoint ) {
+	     return count( [ & ] { return fn( file, rbin, box, binning, chunk_size, checkpoint ); } );
+	   }, doc,
+	   py::arg("file"), py::arg("rbin"), py::arg("box") = 0.f, py::arg("binning") = scheme::log,
+	   py::arg("chunk_size") = utl::default_chunk_size, py::arg("checkpoint") = "" );
+
+  }
+
+  template < typename T >
+  void def_stream_DR ( py::module_ & m, const char * name, counter_stream_DR< T > fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const utl::coordinate_file & file1, const utl::coordinate_file & file2,
+			  const std::vector< float > & rbin, const float box, const scheme binning,
+			  const std::size_t chunk_size, const std::string & checkpoint ) {
+	     return count( [ & ] {
+	       return fn( file1, file2, rbin, box, binning, chunk_size, checkpoint );
+	     } );
+	   }, doc,
+	   py::arg("file1"), py::arg("file2"), py::arg("rbin"), py::arg("box") = 0.f,
+	   py::arg("binning") = scheme::log,
+	   py::arg("chunk_size") = utl::default_chunk_size, py::arg("checkpoint") = "" );
+
+  }
+
+  // runs a counter returning a structured result with the GIL released
+  template < typename F >
+  auto capture ( F && fn ) {
+
+    std::invoke_result_t< F & > FF;
+    {
+      py::gil_scoped_release release;
+      FF = fn();
+    }
+    return FF;
+
+  }
+
+  using fine = utl::fine_histogram< std::size_t >;
+  using wfine = utl::fine_histogram< double >;
+  using fine_DD = fine (*) ( const view &, const view &, const view &,
+			     const float, const float, const float );
+  using fine_DR = fine (*) ( const view &, const view &, const view &,
+			     const view &, const view &, const view &,
+			     const float, const float, const float );
+  using wfine_DD = wfine (*) ( const view &, const view &, const view &, const view &,
+			       const float, const float, const float );
+  using wfine_DR = wfine (*) ( const view &, const view &, const view &, const view &,
+			       const view &, const view &, const view &, const view &,
+			       const float, const float, const float );
+
+  void def_fine_DD ( py::module_ & m, const char * name, fine_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z,
+			  const float rmin, const float rmax, const float box ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     return capture( [ & ] { return fn( xx, yy, zz, rmin, rmax, box ); } );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("rmin"), py::arg("rmax"),
+	   py::arg("box") = 0.f );
+    m.def( name, [ fn ] ( const farray & pos, const float rmin, const float rmax, const float box ) {
+	     check_positions< 3 >( pos );
+	     return capture( [ & ] {
+	       auto cc = columns< 3 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], cc[ 2 ], rmin, rmax, box );
+	     } );
+	   },
+	   py::arg("pos"), py::arg("rmin"), py::arg("rmax"), py::arg("box") = 0.f );
+
+  }
+
+  void def_fine_DR ( py::module_ & m, const char * name, fine_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1, const farray & Z1,
+			  const farray & X2, const farray & Y2, const farray & Z2,
+			  const float rmin, const float rmax, const float box ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() ), z1 = column( Z1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() ), z2 = column( Z2, x2.size() );
+	     return capture( [ & ] { return fn( x1, y1, z1, x2, y2, z2, rmin, rmax, box ); } );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("Z1"), py::arg("X2"), py::arg("Y2"), py::arg("Z2"),
+	   py::arg("rmin"), py::arg("rmax"), py::arg("box") = 0.f );
+    m.def( name, [ fn ] ( const farray & pos1, const farray & pos2,
+			  const float rmin, const float rmax, const float box ) {
+	     check_positions< 3 >( pos1 );
+	     check_positions< 3 >( pos2 );
+	     return capture( [ & ] {
+	       auto c1 = columns< 3 >( pos1 ), c2 = columns< 3 >( pos2 );
+	       return fn( c1[ 0 ], c1[ 1 ], c1[ 2 ], c2[ 0 ], c2[ 1 ], c2[ 2 ], rmin, rmax, box );
+	     } );
+	   },
+	   py::arg("pos1"), py::arg("pos2"), py::arg("rmin"), py::arg("rmax"), py::arg("box") = 0.f );
+
+  }
+
+  void def_wfine_DD ( py::module_ & m, const char * name, wfine_DD fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z, const farray & W,
+			  const float rmin, const float rmax, const float box ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() ), ww = weights( W, xx.size() );
+	     return capture( [ & ] { return fn( xx, yy, zz, ww, rmin, rmax, box ); } );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("W"), py::arg("rmin"), py::arg("rmax"),
+	   py::arg("box") = 0.f );
+    m.def( name, [ fn ] ( const farray & pos, const farray & w,
+			  const float rmin, const float rmax, const float box ) {
+	     check_positions< 3 >( pos );
+	     const view ww = weights( w, pos.shape( 0 ) );
+	     return capture( [ & ] {
+	       auto cc = columns< 3 >( pos );
+	       return fn( cc[ 0 ], cc[ 1 ], cc[ 2 ], ww, rmin, rmax, box );
+	     } );
+	   },
+	   py::arg("pos"), py::arg("w"), py::arg("rmin"), py::arg("rmax"), py::arg("box") = 0.f );
+
+  }
+
+  void def_wfine_DR ( py::module_ & m, const char * name, wfine_DR fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1, const farray & Z1, const farray & W1,
+			  const farray & X2, const farray & Y2, const farray & Z2, const farray & W2,
+			  const float rmin, const float rmax, const float box ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() ), z1 = column( Z1, x1.size() ), w1 = weights( W1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() ), z2 = column( Z2, x2.size() ), w2 = weights( W2, x2.size() );
+	     return capture( [ & ] { return fn( x1, y1, z1, w1, x2, y2, z2, w2, rmin, rmax, box ); } );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("Z1"), py::arg("W1"),
+	   py::arg("X2"), py::arg("Y2"), py::arg("Z2"), py::arg("W2"),
+	   py::arg("rmin"), py::arg("rmax"), py::arg("box") = 0.f );
+    m.def( name, [ fn ] ( const farray & pos1, const farray & w1,
+			  const farray & pos2, const farray & w2,
+			  const float rmin, const float rmax, const float box ) {
+	     check_positions< 3 >( pos1 );
+	     check_positions< 3 >( pos2 );
+	     const view ww1 = weights( w1, pos1.shape( 0 ) ), ww2 = weights( w2, pos2.shape( 0 ) );
+	     return capture( [ & ] {
+	       auto c1 = columns< 3 >( pos1 ), c2 = columns< 3 >( pos2 );
+	       return fn( c1[ 0 ], c1[ 1 ], c1[ 2 ], ww1, c2[ 0 ], c2[ 1 ], c2[ 2 ], ww2, rmin, rmax, box );
+	     } );
+	   },
+	   py::arg("pos1"), py::arg("w1"), py::arg("pos2"), py::arg("w2"),
+	   py::arg("rmin"), py::arg("rmax"), py::arg("box") = 0.f );
+
+  }
+
+  // the fine histogram classes, pickled through their serialised bytes
+  template < typename T >
+  void def_fine_histogram ( py::module_ & m, const char * name, const char * doc ) {
+
+    using fh = utl::fine_histogram< T >;
+    auto to_bytes = [] ( const fh & self ) {
+      std::string buf ( self.serialize_size(), '\0' );
+      self.serialize( buf.data() );
+      return py::bytes( buf );
+    };
+    auto from_bytes = [] ( const py::bytes & bb ) {
+      const std::string buf = bb;
+      // header: version, tag, mantissa bits, first key and number of bins
+      const std::size_t head = 3 * sizeof( std::uint32_t ) + sizeof( char ) + sizeof( std::size_t );
+      std::size_t nn = 0;
+      if ( buf.size() >= head )
+	SerialPOD< std::size_t >::deserialize( buf.data() + head - sizeof( std::size_t ), nn );
+      if ( buf.size() < head || nn != ( buf.size() - head ) / sizeof( T ) ||
+	   buf.size() != head + nn * sizeof( T ) )
+	throw py::value_error( "truncated or corrupted fine histogram" );
+      fh self;
+      self.deserialize( buf.data() );
+      return self;
+    };
+    py::class_< fh >( m, name, doc )
+      .def( py::init< const float, const float >(), py::arg("rmin"), py::arg("rmax") )
+      .def( "__len__", &fh::size )
+      .def_property_readonly( "counts", [] ( const fh & self ) {
+	  return py::array_t< T >( self.size(), self.counts().data() );
+	}, "Counts in the fine bins." )
+      .def_property_readonly( "edges", [] ( const fh & self ) {
+	  py::array_t< float > ee ( self.size() + 1 );
+	  for ( std::size_t kk = 0; kk <= self.size(); ++kk )
+	    ee.mutable_at( kk ) = std::sqrt( self.edge2( kk ) );
+	  return ee;
+	}, "Separations of the edges of the fine bins." )
+      .def( "rebin", [] ( const fh & self, const std::vector< float > & rbin, const scheme binning ) {
+	  const std::vector< T > NN = self.rebin( rbin, binning );
+	  return py::array_t< T >( NN.size(), NN.data() );
+	},
+	"Counts in the coarse bins ``rbin`` (same conventions as the binned\n"
+	"counters), with their edges snapped to the nearest fine edges.",
+	py::arg("rbin"), py::arg("binning") = scheme::log )
+      .def( "rebin_edges", [] ( const fh & self, const std::vector< float > & rbin, const scheme binning ) {
+	  const std::vector< float > ee = self.edges( rbin, binning );
+	  return py::array_t< float >( ee.size(), ee.data() );
+	},
+	"Edges of the coarse bins actually used by ``rebin``.",
+	py::arg("rbin"), py::arg("binning") = scheme::log )
+      .def( "__iadd__", &fh::operator+=, "Merges the counts of a histogram on the same range.",
+	    py::is_operator(), py::return_value_policy::reference_internal )
+      .def( "to_bytes", to_bytes, "Serialised histogram." )
+      .def_static( "from_bytes", from_bytes, "Histogram from the output of ``to_bytes``.",
+		   py::arg("data") )
+      .def( py::pickle( to_bytes, from_bytes ) );
+
+  }
+
+  // Landy-Szalay estimator and its counts as a dict of NumPy arrays and normalisations
+  template < typename T >
+  py::dict as_dict ( const utl::landyszalay_result< T > & res ) {
+
+    py::dict out;
+    out[ "xi" ] = py::array_t< double >( res.xi.size(), res.xi.data() );
+    out[ "DD" ] = py::array_t< T >( res.DD.size(), res.DD.data() );
+    out[ "DR" ] = py::array_t< T >( res.DR.size(), res.DR.data() );
+    out[ "RR" ] = py::array_t< T >( res.RR.size(), res.RR.data() );
+    out[ "normDD" ] = res.normDD;
+    out[ "normDR" ] = res.normDR;
+    out[ "normRR" ] = res.normRR;
+    return out;
+
+  }
+
+  using estimator_LS = utl::landyszalay_result< std::size_t > (*)
+    ( const view &, const view &, const view &, const view &, const view &, const view &,
+      const std::vector< float > &, const float, const scheme );
+  using westimator_LS = utl::landyszalay_result< double > (*)
+    ( const view &, const view &, const view &, const view &,
+      const view &, const view &, const view &, const view &,
+      const std::vector< float > &, const float, const scheme );
+
+  void def_LS ( py::module_ & m, const char * name, estimator_LS fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1, const farray & Z1,
+			  const farray & X2, const farray & Y2, const farray & Z2,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() ), z1 = column( Z1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() ), z2 = column( Z2, x2.size() );
+	     return as_dict( capture( [ & ] {
+	       return fn( x1, y1, z1, x2, y2, z2, rbin, box, binning );
+	     } ) );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("Z1"), py::arg("X2"), py::arg("Y2"), py::arg("Z2"),
+	   py::arg("rbin"), py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos1, const farray & pos2,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     check_positions< 3 >( pos1 );
+	     check_positions< 3 >( pos2 );
+	     return as_dict( capture( [ & ] {
+	       auto c1 = columns< 3 >( pos1 ), c2 = columns< 3 >( pos2 );
+	       return fn( c1[ 0 ], c1[ 1 ], c1[ 2 ], c2[ 0 ], c2[ 1 ], c2[ 2 ], rbin, box, binning );
+	     } ) );
+	   },
+	   py::arg("pos1"), py::arg("pos2"), py::arg("rbin"), py::arg("box") = 0.f,
+	   py::arg("binning") = scheme::log );
+
+  }
+
+  void def_wLS ( py::module_ & m, const char * name, westimator_LS fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X1, const farray & Y1, const farray & Z1, const farray & W1,
+			  const farray & X2, const farray & Y2, const farray & Z2, const farray & W2,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view x1 = column( X1 ), y1 = column( Y1, x1.size() ), z1 = column( Z1, x1.size() ), w1 = weights( W1, x1.size() );
+	     const view x2 = column( X2 ), y2 = column( Y2, x2.size() ), z2 = column( Z2, x2.size() ), w2 = weights( W2, x2.size() );
+	     return as_dict( capture( [ & ] {
+	       return fn( x1, y1, z1, w1, x2, y2, z2, w2, rbin, box, binning );
+	     } ) );
+	   }, doc,
+	   py::arg("X1"), py::arg("Y1"), py::arg("Z1"), py::arg("W1"),
+	   py::arg("X2"), py::arg("Y2"), py::arg("Z2"), py::arg("W2"),
+	   py::arg("rbin"), py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+    m.def( name, [ fn ] ( const farray & pos1, const farray & w1,
+			  const farray & pos2, const farray & w2,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     check_positions< 3 >( pos1 );
+	     check_positions< 3 >( pos2 );
+	     const view ww1 = weights( w1, pos1.shape( 0 ) ), ww2 = weights( w2, pos2.shape( 0 ) );
+	     return as_dict( capture( [ & ] {
+	       auto c1 = columns< 3 >( pos1 ), c2 = columns< 3 >( pos2 );
+	       return fn( c1[ 0 ], c1[ 1 ], c1[ 2 ], ww1, c2[ 0 ], c2[ 1 ], c2[ 2 ], ww2, rbin, box, binning );
+	     } ) );
+	   },
+	   py::arg("pos1"), py::arg("w1"), py::arg("pos2"), py::arg("w2"),
+	   py::arg("rbin"), py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  // tracer labels, checked against the size of their catalogue
+  utl::array_view< int > tracers ( const iarray & arr, const std::size_t size ) {
+
+    if ( arr.ndim() != 1 || std::size_t( arr.shape( 0 ) ) != size )
+      throw py::value_error( "tracer labels must be a 1D array with the same length as the coordinates" );
+    return { arr.data(), size };
+
+  }
+
+  // flattened tracer-pair histograms as rows, one per pair of labels
+  template < typename T >
+  py::array tracer_rows ( py::array_t< T > && NN, const std::size_t ntracer ) {
+    const std::size_t npair = ntracer * ( ntracer + 1 ) / 2;
+    return NN.reshape( { npair, std::size_t( NN.size() ) / npair } );
+  }
+
+  using counter_tracers = hist (*) ( const view &, const view &, const view &,
+				     const ilabels &, const std::size_t,
+				     const std::vector< float > &, const float, const scheme );
+  using counter_wtracers = whist (*) ( const view &, const view &, const view &, const view &,
+				       const ilabels &, const std::size_t,
+				       const std::vector< float > &, const float, const scheme );
+
+  void def_tracers ( py::module_ & m, const char * name, counter_tracers fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z,
+			  const iarray & T, const std::size_t ntracer,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     const ilabels tt = tracers( T, xx.size() );
+	     return tracer_rows( count( [ & ] {
+	       return fn( xx, yy, zz, tt, ntracer, rbin, box, binning );
+	     } ), ntracer );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("T"), py::arg("ntracer"), py::arg("rbin"),
+	   py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  void def_wtracers ( py::module_ & m, const char * name, counter_wtracers fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z, const farray & W,
+			  const iarray & T, const std::size_t ntracer,
+			  const std::vector< float > & rbin, const float box, const scheme binning ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() ), ww = weights( W, xx.size() );
+	     const ilabels tt = tracers( T, xx.size() );
+	     return tracer_rows( count( [ & ] {
+	       return fn( xx, yy, zz, ww, tt, ntracer, rbin, box, binning );
+	     } ), ntracer );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("W"), py::arg("T"), py::arg("ntracer"),
+	   py::arg("rbin"), py::arg("box") = 0.f, py::arg("binning") = scheme::log );
+
+  }
+
+  using counter_cic = utl::counts_in_cells_result (*)
+    ( const view &, const view &, const view &, const view &, const view &, const view &,
+      const std::vector< float > &, const std::size_t, const float );
+
+  // counts in cells, returned as the tuple ( P_N, moments )
+  void def_cic ( py::module_ & m, const char * name, counter_cic fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z,
+			  const farray & CX, const farray & CY, const farray & CZ,
+			  const std::vector< float > & radii, const std::size_t nmax, const float box ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     const view cx = column( CX ), cy = column( CY, cx.size() ), cz = column( CZ, cx.size() );
+	     const utl::counts_in_cells_result res = capture( [ & ] {
+	       return fn( xx, yy, zz, cx, cy, cz, radii, nmax, box );
+	     } );
+	     const std::size_t nrad = radii.size();
+	     return py::make_tuple( py::array_t< std::size_t >( { nrad, nmax + 1 }, res.PN.data() ),
+				    py::array_t< double >( { nrad, std::size_t( 4 ) }, res.moments.data() ) );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("CX"), py::arg("CY"), py::arg("CZ"),
+	   py::arg("radii"), py::arg("nmax"), py::arg("box") = 0.f );
+
+  }
+
+  using counter_knn = utl::knn_cdf_result (*)
+    ( const view &, const view &, const view &, const view &, const view &, const view &,
+      const std::vector< std::size_t > &, const std::vector< float > &, const float );
+
+  // kNN-CDF, returned as the ( nk, nradius ) array of cumulative counts
+  void def_knn ( py::module_ & m, const char * name, counter_knn fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z,
+			  const farray & QX, const farray & QY, const farray & QZ,
+			  const std::vector< std::size_t > & k, const std::vector< float > & radii,
+			  const float box ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     const view qx = column( QX ), qy = column( QY, qx.size() ), qz = column( QZ, qx.size() );
+	     const utl::knn_cdf_result res = capture( [ & ] {
+	       return fn( xx, yy, zz, qx, qy, qz, k, radii, box );
+	     } );
+	     return py::array_t< std::size_t >( { k.size(), radii.size() }, res.CDF.data() );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("QX"), py::arg("QY"), py::arg("QZ"),
+	   py::arg("k"), py::arg("radii"), py::arg("box") = 0.f );
+
+  }
+
+  using finder_fof = utl::fof_result (*)
+    ( const view &, const view &, const view &, const float, const float );
+
+  // friends-of-friends groups, returned as the tuple ( group, multiplicity )
+  void def_fof ( py::module_ & m, const char * name, finder_fof fn, const char * doc ) {
+
+    m.def( name, [ fn ] ( const farray & X, const farray & Y, const farray & Z,
+			  const float linking_length, const float box ) {
+	     const view xx = column( X ), yy = column( Y, xx.size() ), zz = column( Z, xx.size() );
+	     const utl::fof_result res = capture( [ & ] {
+	       return fn( xx, yy, zz, linking_length, box );
+	     } );
+	     return py::make_tuple( py::array_t< std::size_t >( res.group.size(), res.group.data() ),
+				    py::array_t< std::size_t >( res.multiplicity.size(),
+								res.multiplicity.data() ) );
+	   }, doc,
+	   py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("linking_length"), py::arg("box") = 0.f );
+
+  }
+
+  // cache key of a count: the name of the counter, dtype, shape and bytes
+  // of each input array, the numerical parameters (bins, box, ...)
+  utl::pair_key cache_key ( const std::string & mode,
+			    const std::vector< py::array > & arrays,
+			    const std::vector< double > & params ) {
+
+    std::vector< py::array > inputs;
+    utl::pair_hash hh;
+    hh.update( mode );
+    for ( const py::array & aa : arrays ) {
+      inputs.push_back( py::array::ensure( aa, py::array::c_style ) );
+      if ( !inputs.back() ) throw py::value_error( "cannot read the array to hash" );
+      const std::vector< std::size_t > shape ( aa.shape(), aa.shape() + aa.ndim() );
+      hh.update_value( aa.dtype().kind() ).update_value( std::size_t( aa.itemsize() ) ).update( shape );
+    }
+    hh.update( params );
+    py::gil_scoped_release release;
+    for ( const py::array & aa : inputs ) hh.update( aa.data(), aa.nbytes() );
+    return hh.digest();
+
+  }
+
+} // endnamespace
 
 PYBIND11_MODULE( clustering_core, m ) {
 
+  m.def( "simd_isa", &utl::simd::isa_name,
+	 "Name of the instruction set used by the vectorised 3D pair-counting\n"
+	 "kernel, selected at runtime ('avx512', 'avx2', 'sse2' or 'scalar')." );
+
+  py::enum_< utl::binning::scheme >( m, "binning",
+				    "Binning schemes of the pair counters." )
+    .value( "log", utl::binning::scheme::log,
+	    "Logarithmic bins between the first and last value of rbin." )
+    .value( "lin", utl::binning::scheme::lin,
+	    "Linear bins between the first and last value of rbin." )
+    .value( "edges", utl::binning::scheme::edges,
+	    "Arbitrary bins, rbin holds the sorted bin edges." );
+
   // 2D block
-  m.def( "d2D_DD", &utl::d2D_DD, DD2D_DOC,
-	 py::arg("X"), py::arg("Y"), py::arg("rbin") );
-  m.def( "d2D_DD_omp", &utl::d2D_DD_omp,
-	 DD2D_DOC " Uses OpenMP parallelism.",
-	 py::arg("X"), py::arg("Y"), py::arg("rbin") );
-  m.def( "d2D_DR", &utl::d2D_DR, DR2D_DOC,
-	 py::arg("X1"), py::arg("Y1"),
-	 py::arg("X2"), py::arg("Y2"),
-	 py::arg("rbin") );
-  m.def( "d2D_DR_omp", &utl::d2D_DR_omp,
-	 DR2D_DOC " Uses OpenMP parallelism.",
-	 py::arg("X1"), py::arg("Y1"),
-	 py::arg("X2"), py::arg("Y2"),
-	 py::arg("rbin") );
+  def_2D_DD( m, "d2D_DD", &utl::d2D_DD, DD2D_DOC POS_DOC );
+  def_2D_DD( m, "d2D_DD_omp", &utl::d2D_DD_omp,
+	     DD2D_DOC " Uses OpenMP parallelism." POS_DOC );
+  def_2D_DR( m, "d2D_DR", &utl::d2D_DR, DR2D_DOC POS_DOC );
+  def_2D_DR( m, "d2D_DR_omp", &utl::d2D_DR_omp,
+	     DR2D_DOC " Uses OpenMP parallelism." POS_DOC );
 
   // 2D-Angular block
-  m.def( "dA2D_DD", &utl::dA2D_DD, DA2D_DD_DOC,
-	 py::arg("RA"), py::arg("Dec"), py::arg("thetabin") );
-  m.def( "dA2D_DD_omp", &utl::dA2D_DD_omp,
-	 DA2D_DD_DOC " Uses OpenMP parallelism.",
-	 py::arg("RA"), py::arg("Dec"), py::arg("thetabin") );
-  m.def( "dA2D_DR", &utl::dA2D_DR, DA2D_DR_DOC,
-	 py::arg("RA1"), py::arg("Dec1"),
-	 py::arg("RA2"), py::arg("Dec2"),
-	 py::arg("thetabin") );
-  m.def( "dA2D_DR_omp", &utl::dA2D_DR_omp,
-	 DA2D_DR_DOC " Uses OpenMP parallelism.",
-	 py::arg("RA1"), py::arg("Dec1"),
-	 py::arg("RA2"), py::arg("Dec2"),
-	 py::arg("thetabin") );
+  def_A2D_DD( m, "dA2D_DD", &utl::dA2D_DD, DA2D_DD_DOC POS_DOC );
+  def_A2D_DD( m, "dA2D_DD_omp", &utl::dA2D_DD_omp,
+	      DA2D_DD_DOC " Uses OpenMP parallelism." POS_DOC );
+  def_A2D_DR( m, "dA2D_DR", &utl::dA2D_DR, DA2D_DR_DOC POS_DOC );
+  def_A2D_DR( m, "dA2D_DR_omp", &utl::dA2D_DR_omp,
+	      DA2D_DR_DOC " Uses OpenMP parallelism." POS_DOC );
+
+  // 2D-Angular on the sphere block
+  def_A2D_DD( m, "dA2D_DD_sphere", &utl::dA2D_DD_sphere, DA2D_DD_DOC SPHERE_DOC POS_DOC );
+  def_A2D_DD( m, "dA2D_DD_sphere_omp", &utl::dA2D_DD_sphere_omp,
+	      DA2D_DD_DOC SPHERE_DOC " Uses OpenMP parallelism." POS_DOC );
+  def_A2D_DR( m, "dA2D_DR_sphere", &utl::dA2D_DR_sphere, DA2D_DR_DOC SPHERE_DOC POS_DOC );
+  def_A2D_DR( m, "dA2D_DR_sphere_omp", &utl::dA2D_DR_sphere_omp,
+	      DA2D_DR_DOC SPHERE_DOC " Uses OpenMP parallelism." POS_DOC );
 
   // 3D block
-  m.def( "d3D_DD", &utl::d3D_DD, DD3D_DOC,
-	 py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("rbin") );
-  m.def( "d3D_DD_omp", &utl::d3D_DD_omp,
-	 DD3D_DOC " Uses OpenMP parallelism.",
-	 py::arg("X"), py::arg("Y"), py::arg("Z"), py::arg("rbin") );
-  m.def( "d3D_DR", &utl::d3D_DR, DR3D_DOC,
-	 py::arg("X1"), py::arg("Y1"), py::arg("Z1"),
-	 py::arg("X2"), py::arg("Y2"), py::arg("Z2"),
-	 py::arg("rbin") );
-  m.def( "d3D_DR_omp", &utl::d3D_DR_omp,
-	 DR3D_DOC " Uses OpenMP parallelism.",
-	 py::arg("X1"), py::arg("Y1"), py::arg("Z1"),
-	 py::arg("X2"), py::arg("Y2"), py::arg("Z2"),
-	 py::arg("rbin") );
+  def_3D_DD( m, "d3D_DD", &utl::d3D_DD, DD3D_DOC POS_DOC );
+  def_3D_DD( m, "d3D_DD_omp", &utl::d3D_DD_omp,
+	     DD3D_DOC " Uses OpenMP parallelism." POS_DOC );
+  def_3D_DR( m, "d3D_DR", &utl::d3D_DR, DR3D_DOC POS_DOC );
+  def_3D_DR( m, "d3D_DR_omp", &utl::d3D_DR_omp,
+	     DR3D_DOC " Uses OpenMP parallelism." POS_DOC );
+
+  // 3D cell-list block
+  def_3D_DD( m, "d3D_DD_grid", &utl::d3D_DD_grid, DD3D_DOC GRID_DOC POS_DOC );
+  def_3D_DD( m, "d3D_DD_grid_omp", &utl::d3D_DD_grid_omp,
+	     DD3D_DOC GRID_DOC " Uses OpenMP parallelism." POS_DOC );
+  def_3D_DR( m, "d3D_DR_grid", &utl::d3D_DR_grid, DR3D_DOC GRID_DOC POS_DOC );
+  def_3D_DR( m, "d3D_DR_grid_omp", &utl::d3D_DR_grid_omp,
+	     DR3D_DOC GRID_DOC " Uses OpenMP parallelism." POS_DOC );
+
+  // 3D k-d tree block
+  def_3D_DD( m, "d3D_DD_tree", &utl::d3D_DD_tree, DD3D_DOC TREE_DOC POS_DOC );
+  def_3D_DD( m, "d3D_DD_tree_omp", &utl::d3D_DD_tree_omp,
+	     DD3D_DOC TREE_DOC " Uses OpenMP parallelism." POS_DOC );
+  def_3D_DR( m, "d3D_DR_tree", &utl::d3D_DR_tree, DR3D_DOC TREE_DOC POS_DOC );
+  def_3D_DR( m, "d3D_DR_tree_omp", &utl::d3D_DR_tree_omp,
+	     DR3D_DOC TREE_DOC " Uses OpenMP parallelism." POS_DOC );
+
+  // 3D fine histogram block
+  def_fine_histogram< std::size_t >( m, "fine_histogram",
+				     "Fine histogram of pair counts in squared separation, see\n"
+				     "``d3D_DD_fine``. Picklable." );
+  def_fine_histogram< double >( m, "wfine_histogram",
+				"Fine histogram of weighted pair counts in squared separation,\n"
+				"see ``wd3D_DD_fine``. Picklable." );
+  def_fine_DD( m, "d3D_DD_fine", &utl::d3D_DD_fine, FINE_DOC( "d3D_DD" ) );
+  def_fine_DD( m, "d3D_DD_fine_omp", &utl::d3D_DD_fine_omp, FINE_DOC( "d3D_DD_omp" ) );
+  def_fine_DR( m, "d3D_DR_fine", &utl::d3D_DR_fine, FINE_DOC( "d3D_DR" ) );
+  def_fine_DR( m, "d3D_DR_fine_omp", &utl::d3D_DR_fine_omp, FINE_DOC( "d3D_DR_omp" ) );
+  def_wfine_DD( m, "wd3D_DD_fine", &utl::wd3D_DD_fine, FINE_DOC( "wd3D_DD" ) );
+  def_wfine_DD( m, "wd3D_DD_fine_omp", &utl::wd3D_DD_fine_omp, FINE_DOC( "wd3D_DD_omp" ) );
+  def_wfine_DR( m, "wd3D_DR_fine", &utl::wd3D_DR_fine, FINE_DOC( "wd3D_DR" ) );
+  def_wfine_DR( m, "wd3D_DR_fine_omp", &utl::wd3D_DR_fine_omp, FINE_DOC( "wd3D_DR_omp" ) );
+
+  // 3D Landy-Szalay block
+  def_LS( m, "d3D_landyszalay", &utl::d3D_landyszalay, LS_DOC );
+  def_LS( m, "d3D_landyszalay_omp", &utl::d3D_landyszalay_omp, LS_DOC );
+  def_wLS( m, "wd3D_landyszalay", &utl::wd3D_landyszalay, LS_DOC );
+  def_wLS( m, "wd3D_landyszalay_omp", &utl::wd3D_landyszalay_omp, LS_DOC );
+
+  // 3D tiled block
+  def_3D_DR( m, "d3D_DR_tiled", &utl::d3D_DR_tiled, DR3D_DOC TILED_DOC POS_DOC );
+  def_3D_DR( m, "d3D_DR_tiled_omp", &utl::d3D_DR_tiled_omp,
+	     DR3D_DOC TILED_DOC " Uses OpenMP parallelism." POS_DOC );
+
+  // 3D projected ( rp, pi ) block
+  py::enum_< utl::line_of_sight >( m, "line_of_sight",
+				   "Line of sight of the projected ( rp, pi ) counters." )
+    .value( "z", utl::line_of_sight::z,
+	    "Plane-parallel approximation along the z axis." )
+    .value( "midpoint", utl::line_of_sight::midpoint,
+	    "Direction of the pair midpoint seen from the origin." );
+  def_rppi_DD( m, "d3D_DD_rppi", &utl::d3D_DD_rppi, DD_RPPI_DOC POS_DOC );
+  def_rppi_DD( m, "d3D_DD_rppi_omp", &utl::d3D_DD_rppi_omp,
+	       DD_RPPI_DOC " Uses OpenMP parallelism." POS_DOC );
+  def_rppi_DR( m, "d3D_DR_rppi", &utl::d3D_DR_rppi, DR_RPPI_DOC POS_DOC );
+  def_rppi_DR( m, "d3D_DR_rppi_omp", &utl::d3D_DR_rppi_omp,
+	       DR_RPPI_DOC " Uses OpenMP parallelism." POS_DOC );
+  m.def( "wp_landy_szalay",
+	 [] ( const std::vector< double > & DD, const std::vector< double > & DR,
+	      const std::vector< double > & RR, const std::size_t npi, const float pimax ) {
+	   std::vector< double > wp = utl::wp_landy_szalay( DD, DR, RR, npi, pimax );
+	   return py::array_t< double >( wp.size(), wp.data() );
+	 },
+	 "Projected correlation function wp(rp) = 2 sum_pi xi(rp, pi) dpi, with\n"
+	 "xi(rp, pi) from the Landy-Szalay estimator.\n"
+	 "\nParameters\n----------\n"
+	 "DD, DR, RR : array_like of float\n    Normalised ( rp, pi ) pair counts, flattened\n"
+	 "    with the pi bins varying fastest.\n"
+	 "npi : int\n    Number of pi bins.\n"
+	 "pimax : float\n    Maximum separation parallel to the line of sight.\n"
+	 "\nReturns\n-------\nnumpy.ndarray of float\n    wp per rp bin.",
+	 py::arg("DD"), py::arg("DR"), py::arg("RR"), py::arg("npi"), py::arg("pimax") );
+
+  // 3D redshift-space ( s, mu ) block
+  def_smu_DD< hist >( m, "d3D_DD_smu", &utl::d3D_DD_smu, "nmu", false,
+		      SMU_DOC( "data-data pairs", DD_COORDS_DOC ) POS_DOC );
+  def_smu_DD< hist >( m, "d3D_DD_smu_omp", &utl::d3D_DD_smu_omp, "nmu", false,
+		      SMU_DOC( "data-data pairs", DD_COORDS_DOC ) " Uses OpenMP parallelism." POS_DOC );
+  def_smu_DR< hist >( m, "d3D_DR_smu", &utl::d3D_DR_smu, "nmu", false,
+		      SMU_DOC( "data-random cross-pairs", DR_COORDS_DOC ) POS_DOC );
+  def_smu_DR< hist >( m, "d3D_DR_smu_omp", &utl::d3D_DR_smu_omp, "nmu", false,
+		      SMU_DOC( "data-random cross-pairs", DR_COORDS_DOC ) " Uses OpenMP parallelism." POS_DOC );
+  def_smu_DD< whist >( m, "d3D_DD_multipoles", &utl::d3D_DD_multipoles, "lmax", true,
+		       MULTIPOLES_DOC( "data-data pairs", DD_COORDS_DOC ) POS_DOC );
+  def_smu_DD< whist >( m, "d3D_DD_multipoles_omp", &utl::d3D_DD_multipoles_omp, "lmax", true,
+		       MULTIPOLES_DOC( "data-data pairs", DD_COORDS_DOC ) " Uses OpenMP parallelism." POS_DOC );
+  def_smu_DR< whist >( m, "d3D_DR_multipoles", &utl::d3D_DR_multipoles, "lmax", true,
+		       MULTIPOLES_DOC( "data-random cross-pairs", DR_COORDS_DOC ) POS_DOC );
+  def_smu_DR< whist >( m, "d3D_DR_multipoles_omp", &utl::d3D_DR_multipoles_omp, "lmax", true,
+		       MULTIPOLES_DOC( "data-random cross-pairs", DR_COORDS_DOC ) " Uses OpenMP parallelism." POS_DOC );
+
+  // jackknife counters
+  def_jk_2D_DD( m, "d2D_DD_jk", &utl::d2D_DD_jk, JK_DOC( "d2D_DD" ) );
+  def_jk_2D_DD( m, "d2D_DD_jk_omp", &utl::d2D_DD_jk_omp, JK_DOC( "d2D_DD_omp" ) );
+  def_jk_2D_DR( m, "d2D_DR_jk", &utl::d2D_DR_jk, JK_DOC( "d2D_DR" ) );
+  def_jk_2D_DR( m, "d2D_DR_jk_omp", &utl::d2D_DR_jk_omp, JK_DOC( "d2D_DR_omp" ) );
+  def_jk_A2D_DD( m, "dA2D_DD_jk", &utl::dA2D_DD_jk, JK_DOC( "dA2D_DD_sphere" ) );
+  def_jk_A2D_DD( m, "dA2D_DD_jk_omp", &utl::dA2D_DD_jk_omp, JK_DOC( "dA2D_DD_sphere_omp" ) );
+  def_jk_A2D_DR( m, "dA2D_DR_jk", &utl::dA2D_DR_jk, JK_DOC( "dA2D_DR_sphere" ) );
+  def_jk_A2D_DR( m, "dA2D_DR_jk_omp", &utl::dA2D_DR_jk_omp, JK_DOC( "dA2D_DR_sphere_omp" ) );
+  def_jk_3D_DD( m, "d3D_DD_jk", &utl::d3D_DD_jk, JK_DOC( "d3D_DD" ) );
+  def_jk_3D_DD( m, "d3D_DD_jk_omp", &utl::d3D_DD_jk_omp, JK_DOC( "d3D_DD_omp" ) );
+  def_jk_3D_DR( m, "d3D_DR_jk", &utl::d3D_DR_jk, JK_DOC( "d3D_DR" ) );
+  def_jk_3D_DR( m, "d3D_DR_jk_omp", &utl::d3D_DR_jk_omp, JK_DOC( "d3D_DR_omp" ) );
+
+  // on-disk cache of counts
+  py::class_< utl::pair_cache >( m, "pair_cache",
+				 "Content-addressed on-disk cache of pair counts.\n"
+				 "\nEntries are keyed by a 128-bit hash of the counter name, of the\n"
+				 "input arrays and of the numerical parameters, and stored in one\n"
+				 "file per entry in ``directory``: repeated counts on the same inputs\n"
+				 "(e.g. the RR of a random catalogue) cost a hash of the arrays and a\n"
+				 "file read. Corrupted or incompatible entries are recomputed." )
+    .def( py::init< const std::string & >(), py::arg("directory") )
+    .def_property_readonly( "directory", &utl::pair_cache::directory )
+    .def( "key",
+	  [] ( const utl::pair_cache &, const std::string & mode,
+	       const std::vector< py::array > & arrays, const std::vector< double > & params ) {
+	    return cache_key( mode, arrays, params ).hex();
+	  },
+	  "Hexadecimal key of the inputs, also the name of the entry file.",
+	  py::arg("mode"), py::arg("arrays"), py::arg("params") )
+    .def( "fetch",
+	  [] ( const utl::pair_cache & self, const std::string & mode,
+	       const std::vector< py::array > & arrays, const std::vector< double > & params,
+	       const py::function & count ) -> py::array {
+	    const utl::pair_key key = cache_key( mode, arrays, params );
+	    std::vector< std::size_t > shape;
+	    std::vector< std::size_t > NN;
+	    std::vector< double > WW;
+	    bool found_NN, found_WW = false;
+	    {
+	      py::gil_scoped_release release;
+	      found_NN = self.load( key, shape, NN );
+	      if ( !found_NN ) found_WW = self.load( key, shape, WW );
+	    }
+	    if ( found_NN ) return py::array_t< std::size_t >( shape, NN.data() );
+	    if ( found_WW ) return py::array_t< double >( shape, WW.data() );
+
+	    py::array res = count();
+	    shape.assign( res.shape(), res.shape() + res.ndim() );
+	    if ( res.dtype().kind() == 'f' ) {
+	      auto cc = py::array_t< double, py::array::c_style | py::array::forcecast >::ensure( res );
+	      WW.assign( cc.data(), cc.data() + cc.size() );
+	      py::gil_scoped_release release;
+	      self.store( key, shape, WW );
+	    }
+	    else {
+	      auto cc = py::array_t< std::size_t, py::array::c_style | py::array::forcecast >::ensure( res );
+	      NN.assign( cc.data(), cc.data() + cc.size() );
+	      py::gil_scoped_release release;
+	      self.store( key, shape, NN );
+	    }
+	    return res;
+	  },
+	  "Counts of the inputs, read from the cache or computed by ``count()``.\n"
+	  "\nParameters\n----------\n"
+	  "mode : str\n    Name of the counter and of its options.\n"
+	  "arrays : list of numpy.ndarray\n    Input arrays (coordinates, weights, ...).\n"
+	  "params : list of float\n    Numerical parameters (bins, box side, ...).\n"
+	  "count : callable\n    Returns the counts as an integer or float array, only\n"
+	  "    called if the entry is missing.\n"
+	  "\nReturns\n-------\nnumpy.ndarray\n    The counts, with the shape returned by ``count``.",
+	  py::arg("mode"), py::arg("arrays"), py::arg("params"), py::arg("count") );
+
+  // out-of-core counters
+  py::class_< utl::coordinate_file >( m, "coordinate_file",
+				      "Read-only memory map of a flat binary catalogue.\n"
+				      "\nThe file holds native-endian float32 records ( x, y, z ) or\n"
+				      "( x, y, z, w ) with no header, as written by ``tofile`` on a\n"
+				      "C-ordered array of shape ``(N, ncol)`` and dtype float32." )
+    .def( py::init< const std::string &, const std::size_t >(),
+	  py::arg("path"), py::arg("ncol") = 3 )
+    .def_property_readonly( "path", &utl::coordinate_file::path )
+    .def_property_readonly( "columns", &utl::coordinate_file::columns )
+    .def_property_readonly( "weighted", &utl::coordinate_file::weighted )
+    .def( "__len__", &utl::coordinate_file::size );
+  def_stream_DD< std::size_t >( m, "d3D_DD_stream", &utl::d3D_DD_stream, STREAM_DOC( "d3D_DD" ) );
+  def_stream_DD< std::size_t >( m, "d3D_DD_stream_omp", &utl::d3D_DD_stream_omp,
+				STREAM_DOC( "d3D_DD_omp" ) );
+  def_stream_DR< std::size_t >( m, "d3D_DR_stream", &utl::d3D_DR_stream, STREAM_DOC( "d3D_DR" ) );
+  def_stream_DR< std::size_t >( m, "d3D_DR_stream_omp", &utl::d3D_DR_stream_omp,
+				STREAM_DOC( "d3D_DR_omp" ) );
+  def_stream_DD< double >( m, "wd3D_DD_stream", &utl::wd3D_DD_stream, STREAM_DOC( "wd3D_DD" ) );
+  def_stream_DD< double >( m, "wd3D_DD_stream_omp", &utl::wd3D_DD_stream_omp,
+			   STREAM_DOC( "wd3D_DD_omp" ) );
+  def_stream_DR< double >( m, "wd3D_DR_stream", &utl::wd3D_DR_stream, STREAM_DOC( "wd3D_DR" ) );
+  def_stream_DR< double >( m, "wd3D_DR_stream_omp", &utl::wd3D_DR_stream_omp,
+			   STREAM_DOC( "wd3D_DR_omp" ) );
+
+  // bootstrap counters
+  py::enum_< utl::resampling >( m, "resampling",
+				"Resampling of the bootstrap counters." )
+    .value( "poisson", utl::resampling::poisson,
+	    "Independent Poisson(1) multiplicities." )
+    .value( "multinomial", utl::resampling::multinomial,
+	    "As many draws with replacement as objects in the catalogue." );
+  m.def( "bootstrap_multiplicities",
+	 [] ( const std::size_t size, const std::size_t nboot,
+	      const std::uint64_t seed, const utl::resampling res ) {
+	   std::vector< std::uint16_t > MM;
+	   {
+	     py::gil_scoped_release release;
+	     MM = utl::bootstrap_multiplicities( size, nboot, seed, res );
+	   }
+	   return py::array_t< std::uint16_t >( { size, nboot }, MM.data() );
+	 },
+	 "Multiplicities drawn by the bootstrap counters.\n"
+	 "\nParameters\n----------\n"
+	 "size : int\n    Number of objects in the catalogue.\n"
+	 "nboot : int\n    Number of resamples.\n"
+	 "seed : int\n    Seed of the counter-based generator.\n"
+	 "resampling : resampling, optional\n    ``resampling.poisson`` (default) or ``resampling.multinomial``.\n"
+	 "\nReturns\n-------\nnumpy.ndarray of uint16, shape (size, nboot)\n"
+	 "    Multiplicity of each object in each resample.",
+	 py::arg("size"), py::arg("nboot"), py::arg("seed"),
+	 py::arg("resampling") = utl::resampling::poisson );
+  def_boot_2D_DD( m, "d2D_DD_boot", &utl::d2D_DD_boot, BOOT_DOC( "d2D_DD" ) );
+  def_boot_2D_DD( m, "d2D_DD_boot_omp", &utl::d2D_DD_boot_omp, BOOT_DOC( "d2D_DD_omp" ) );
+  def_boot_2D_DR( m, "d2D_DR_boot", &utl::d2D_DR_boot, BOOT_DOC( "d2D_DR" ) );
+  def_boot_2D_DR( m, "d2D_DR_boot_omp", &utl::d2D_DR_boot_omp, BOOT_DOC( "d2D_DR_omp" ) );
+  def_boot_A2D_DD( m, "dA2D_DD_boot", &utl::dA2D_DD_boot, BOOT_DOC( "dA2D_DD_sphere" ) );
+  def_boot_A2D_DD( m, "dA2D_DD_boot_omp", &utl::dA2D_DD_boot_omp, BOOT_DOC( "dA2D_DD_sphere_omp" ) );
+  def_boot_A2D_DR( m, "dA2D_DR_boot", &utl::dA2D_DR_boot, BOOT_DOC( "dA2D_DR_sphere" ) );
+  def_boot_A2D_DR( m, "dA2D_DR_boot_omp", &utl::dA2D_DR_boot_omp, BOOT_DOC( "dA2D_DR_sphere_omp" ) );
+  def_boot_3D_DD( m, "d3D_DD_boot", &utl::d3D_DD_boot, BOOT_DOC( "d3D_DD" ) );
+  def_boot_3D_DD( m, "d3D_DD_boot_omp", &utl::d3D_DD_boot_omp, BOOT_DOC( "d3D_DD_omp" ) );
+  def_boot_3D_DR( m, "d3D_DR_boot", &utl::d3D_DR_boot, BOOT_DOC( "d3D_DR" ) );
+  def_boot_3D_DR( m, "d3D_DR_boot_omp", &utl::d3D_DR_boot_omp, BOOT_DOC( "d3D_DR_omp" ) );
+
+  // marked counters
+  def_marked_DD( m, "d3D_DD_marked", &utl::d3D_DD_marked, MARKED_DOC( "d3D_DD" ) );
+  def_marked_DD( m, "d3D_DD_marked_omp", &utl::d3D_DD_marked_omp, MARKED_DOC( "d3D_DD_omp" ) );
+  def_marked_DR( m, "d3D_DR_marked", &utl::d3D_DR_marked, MARKED_DOC( "d3D_DR" ) );
+  def_marked_DR( m, "d3D_DR_marked_omp", &utl::d3D_DR_marked_omp, MARKED_DOC( "d3D_DR_omp" ) );
+
+  // three-point multipoles
+  def_3pcf( m, "d3D_3pcf_multipoles", &utl::d3D_3pcf_multipoles, THREEPCF_DOC POS_DOC );
+  def_3pcf( m, "d3D_3pcf_multipoles_omp", &utl::d3D_3pcf_multipoles_omp,
+	    THREEPCF_DOC " Uses OpenMP parallelism over primaries." POS_DOC );
+  def_w3pcf( m, "wd3D_3pcf_multipoles", &utl::wd3D_3pcf_multipoles,
+	     WEIGHTED_DOC( "d3D_3pcf_multipoles" ) " The sums are weighted by w_i w_j w_k,"
+	     " weights may be negative." );
+  def_w3pcf( m, "wd3D_3pcf_multipoles_omp", &utl::wd3D_3pcf_multipoles_omp,
+	     WEIGHTED_DOC( "d3D_3pcf_multipoles_omp" ) " The sums are weighted by w_i w_j w_k,"
+	     " weights may be negative." );
+
+  // multi-tracer counters
+  def_tracers( m, "d3D_DD_tracers", &utl::d3D_DD_tracers, TRACERS_DOC( "d3D_DD" ) );
+  def_tracers( m, "d3D_DD_tracers_omp", &utl::d3D_DD_tracers_omp, TRACERS_DOC( "d3D_DD_omp" ) );
+  def_wtracers( m, "wd3D_DD_tracers", &utl::wd3D_DD_tracers, TRACERS_DOC( "wd3D_DD" ) );
+  def_wtracers( m, "wd3D_DD_tracers_omp", &utl::wd3D_DD_tracers_omp, TRACERS_DOC( "wd3D_DD_omp" ) );
+
+  // counts in cells
+  def_cic( m, "counts_in_cells", &utl::counts_in_cells, CIC_DOC );
+  def_cic( m, "counts_in_cells_omp", &utl::counts_in_cells_omp, CIC_DOC " Uses OpenMP parallelism." );
+
+  // k-nearest-neighbour distributions
+  def_knn( m, "knn_cdf", &utl::knn_cdf, KNN_DOC );
+  def_knn( m, "knn_cdf_omp", &utl::knn_cdf_omp, KNN_DOC " Uses OpenMP parallelism." );
+
+  // friends-of-friends groups
+  def_fof( m, "friends_of_friends", &utl::friends_of_friends, FOF_DOC );
+  def_fof( m, "friends_of_friends_omp", &utl::friends_of_friends_omp, FOF_DOC " Uses OpenMP parallelism." );
+
+  // periodic box, analytic RR
+  m.def( "RR_periodic_2D",
+	 [] ( const std::vector< float > & rbin, const float box, const scheme binning ) {
+	   std::vector< double > RR = utl::RR_periodic_2D( rbin, box, binning );
+	   return py::array_t< double >( RR.size(), RR.data() );
+	 },
+	 RR_PERIODIC_DOC( "2D separation", "the area" ),
+	 py::arg("rbin"), py::arg("box"), py::arg("binning") = scheme::log );
+  m.def( "RR_periodic_3D",
+	 [] ( const std::vector< float > & rbin, const float box, const scheme binning ) {
+	   std::vector< double > RR = utl::RR_periodic_3D( rbin, box, binning );
+	   return py::array_t< double >( RR.size(), RR.data() );
+	 },
+	 RR_PERIODIC_DOC( "3D separation", "the volume" ),
+	 py::arg("rbin"), py::arg("box"), py::arg("binning") = scheme::log );
+  m.def( "RR_periodic_rppi",
+	 [] ( const std::vector< float > & rpbin, const float pimax, const std::size_t npi,
+	      const float box, const scheme binning ) {
+	   std::vector< double > RR = utl::RR_periodic_rppi( rpbin, pimax, npi, box, binning );
+	   return as_2D( py::array_t< double >( RR.size(), RR.data() ), npi );
+	 },
+	 RR_PERIODIC_DOC( "( rp, pi )", "the volume" )
+	 "Same layout as ``d3D_DD_rppi``, line of sight along z.",
+	 py::arg("rpbin"), py::arg("pimax"), py::arg("npi"), py::arg("box"),
+	 py::arg("binning") = scheme::log );
+  def_xi_periodic_2D( m, "xi_periodic_2D", &utl::xi_periodic_2D, XI_PERIODIC_DOC POS_DOC );
+  def_xi_periodic_2D( m, "xi_periodic_2D_omp", &utl::xi_periodic_2D_omp,
+		      XI_PERIODIC_DOC " Uses OpenMP parallelism." POS_DOC );
+  def_xi_periodic_3D( m, "xi_periodic_3D", &utl::xi_periodic_3D, XI_PERIODIC_DOC POS_DOC );
+  def_xi_periodic_3D( m, "xi_periodic_3D_omp", &utl::xi_periodic_3D_omp,
+		      XI_PERIODIC_DOC " Uses OpenMP parallelism." POS_DOC );
+  def_wp_periodic( m, "wp_periodic", &utl::wp_periodic,
+		   "Projected correlation function wp(rp), line of sight along z. " XI_PERIODIC_DOC POS_DOC );
+  def_wp_periodic( m, "wp_periodic_omp", &utl::wp_periodic_omp,
+		   "Projected correlation function wp(rp), line of sight along z. " XI_PERIODIC_DOC
+		   " Uses OpenMP parallelism." POS_DOC );
+
+  // weighted counters
+  def_w2D_DD( m, "wd2D_DD", &utl::wd2D_DD, WEIGHTED_DOC( "d2D_DD" ) );
+  def_w2D_DD( m, "wd2D_DD_omp", &utl::wd2D_DD_omp, WEIGHTED_DOC( "d2D_DD_omp" ) );
+  def_w2D_DR( m, "wd2D_DR", &utl::wd2D_DR, WEIGHTED_DOC( "d2D_DR" ) );
+  def_w2D_DR( m, "wd2D_DR_omp", &utl::wd2D_DR_omp, WEIGHTED_DOC( "d2D_DR_omp" ) );
+  def_wA2D_DD( m, "wdA2D_DD", &utl::wdA2D_DD, WEIGHTED_DOC( "dA2D_DD" ) );
+  def_wA2D_DD( m, "wdA2D_DD_omp", &utl::wdA2D_DD_omp, WEIGHTED_DOC( "dA2D_DD_omp" ) );
+  def_wA2D_DR( m, "wdA2D_DR", &utl::wdA2D_DR, WEIGHTED_DOC( "dA2D_DR" ) );
+  def_wA2D_DR( m, "wdA2D_DR_omp", &utl::wdA2D_DR_omp, WEIGHTED_DOC( "dA2D_DR_omp" ) );
+  def_wA2D_DD( m, "wdA2D_DD_sphere", &utl::wdA2D_DD_sphere, WEIGHTED_DOC( "dA2D_DD_sphere" ) );
+  def_wA2D_DD( m, "wdA2D_DD_sphere_omp", &utl::wdA2D_DD_sphere_omp,
+	       WEIGHTED_DOC( "dA2D_DD_sphere_omp" ) );
+  def_wA2D_DR( m, "wdA2D_DR_sphere", &utl::wdA2D_DR_sphere, WEIGHTED_DOC( "dA2D_DR_sphere" ) );
+  def_wA2D_DR( m, "wdA2D_DR_sphere_omp", &utl::wdA2D_DR_sphere_omp,
+	       WEIGHTED_DOC( "dA2D_DR_sphere_omp" ) );
+  def_w3D_DD( m, "wd3D_DD", &utl::wd3D_DD, WEIGHTED_DOC( "d3D_DD" ) );
+  def_w3D_DD( m, "wd3D_DD_omp", &utl::wd3D_DD_omp, WEIGHTED_DOC( "d3D_DD_omp" ) );
+  def_w3D_DR( m, "wd3D_DR", &utl::wd3D_DR, WEIGHTED_DOC( "d3D_DR" ) );
+  def_w3D_DR( m, "wd3D_DR_omp", &utl::wd3D_DR_omp, WEIGHTED_DOC( "d3D_DR_omp" ) );
+  def_w3D_DD( m, "wd3D_DD_grid", &utl::wd3D_DD_grid, WEIGHTED_DOC( "d3D_DD_grid" ) );
+  def_w3D_DD( m, "wd3D_DD_grid_omp", &utl::wd3D_DD_grid_omp, WEIGHTED_DOC( "d3D_DD_grid_omp" ) );
+  def_w3D_DR( m, "wd3D_DR_grid", &utl::wd3D_DR_grid, WEIGHTED_DOC( "d3D_DR_grid" ) );
+  def_w3D_DR( m, "wd3D_DR_grid_omp", &utl::wd3D_DR_grid_omp, WEIGHTED_DOC( "d3D_DR_grid_omp" ) );
+  def_w3D_DD( m, "wd3D_DD_tree", &utl::wd3D_DD_tree, WEIGHTED_DOC( "d3D_DD_tree" ) );
+  def_w3D_DD( m, "wd3D_DD_tree_omp", &utl::wd3D_DD_tree_omp, WEIGHTED_DOC( "d3D_DD_tree_omp" ) );
+  def_w3D_DR( m, "wd3D_DR_tree", &utl::wd3D_DR_tree, WEIGHTED_DOC( "d3D_DR_tree" ) );
+  def_w3D_DR( m, "wd3D_DR_tree_omp", &utl::wd3D_DR_tree_omp, WEIGHTED_DOC( "d3D_DR_tree_omp" ) );
+  def_w3D_DR( m, "wd3D_DR_tiled", &utl::wd3D_DR_tiled, WEIGHTED_DOC( "d3D_DR_tiled" ) );
+  def_w3D_DR( m, "wd3D_DR_tiled_omp", &utl::wd3D_DR_tiled_omp, WEIGHTED_DOC( "d3D_DR_tiled_omp" ) );
 
 }
@@ -4,60 +4,209 @@ Provides standard and Landy–Szalay estimators for the two-point
 correlation function :math:`\\xi(r)` (Eq. 23 of Ronconi et al. 2020),
 together with a bootstrap error estimator.  Pair counting is delegated
 to the compiled C++ extension :mod:`scampy.measure.clustering_core`.
+The experimental tiled DR counters of the extension (``d3D_DR_tiled``,
+``wd3D_DR_tiled``) are opt-in: the estimators below do not use them.
 """
 
 ##################################################################################
 # External imports
+import math
 import numpy
 
 #Internal imports
 import scampy.measure.clustering_core as cc
-from scampy.boxes import equatorial_to_cartesian, angular_to_euclidean_dist
 
 ##################################################################################
 
-def _kernel_DD (data, Nd, rbins, omp = True, angular = False
-                ) :
-    """Count data–data pairs in each separation bin."""
+def _binning ( binning ) :
+    """Convert a binning name (``'log'``, ``'lin'`` or ``'edges'``) to the C++ scheme."""
+
+    if isinstance( binning, cc.binning ) :
+        return binning
+    try :
+        return cc.binning.__members__[ binning ]
+    except KeyError :
+        raise ValueError(
+            f"Unknown binning {binning!r}, choose among {list( cc.binning.__members__ )}"
+        ) from None
+
+def _line_of_sight ( los ) :
+    """Convert a line-of-sight name (``'z'`` or ``'midpoint'``) to the C++ enumeration."""
+
+    if isinstance( los, cc.line_of_sight ) :
+        return los
+    try :
+        return cc.line_of_sight.__members__[ los ]
+    except KeyError :
+        raise ValueError(
+            f"Unknown line of sight {los!r}, choose among {list( cc.line_of_sight.__members__ )}"
+        ) from None
+
+def _resampling ( resampling ) :
+    """Convert a resampling name (``'poisson'`` or ``'multinomial'``) to the C++ enum."""
+
+    if isinstance( resampling, cc.resampling ) :
+        return resampling
+    try :
+        return cc.resampling.__members__[ resampling ]
+    except KeyError :
+        raise ValueError(
+            f"Unknown resampling {resampling!r}, choose among {list( cc.resampling.__members__ )}"
+        ) from None
+
+def _as_coordinates ( cat ) :
+    """Catalogue as a C-contiguous float32 array, whose rows the C++ counters read without copies."""
+
+    return numpy.ascontiguousarray( cat, dtype = numpy.float32 )
+
+def _as_weights ( weights, Nobj ) :
+    """Per-object weights as a float32 array of length ``Nobj`` (``None`` if unweighted)."""
+
+    if weights is None :
+        return None
+    weights = numpy.ascontiguousarray( weights, dtype = numpy.float32 )
+    if weights.shape != ( Nobj, ) :
+        raise ValueError( f"Weights should be a 1D array of {Nobj} elements, got shape {weights.shape}" )
+    return weights
+
+def _weight_sums ( weights, Nobj ) :
+    """Sum of the weights and of the squared weights (both ``Nobj`` when unweighted)."""
+
+    if weights is None :
+        return float( Nobj ), float( Nobj )
+    ww = weights.astype( numpy.float64 )
+    return ww.sum(), ( ww * ww ).sum()
+
+def _cached ( cache, mode, arrays, params, count ) :
+    """Return ``count()``, read from ``cache`` (a directory or a :class:`pair_cache`) if already there."""
+
+    if cache is None :
+        return count()
+    if not isinstance( cache, cc.pair_cache ) :
+        cache = cc.pair_cache( str( cache ) )
+    return cache.fetch( mode, [ arr for arr in arrays if arr is not None ],
+                        numpy.asarray( params, dtype = float ).ravel(), count )
+
+def _kernel_DD (data, Nd, rbins, omp = True, angular = False, box = 0.,
+                binning = 'log', weights = None, cache = None ) :
+    """Count data–data pairs in each separation bin, summing the products
+    of the weights when ``weights`` is given.  With ``cache``, counts
+    already computed on the same inputs are read from disk."""
     
+    binning = _binning( binning )
+    if cache is not None :
+        mode = f"DD/{Nd}D/{'sphere' if angular else 'flat'}/{binning.name}/{weights is not None:d}"
+        return _cached( cache, mode, ( *data, weights ), ( *rbins, box ),
+                        lambda : _kernel_DD( data, Nd, rbins, omp, angular, box, binning, weights ) )
+    if weights is not None :
+        return _kernel_wDD( data, weights, Nd, rbins, omp, angular, box, binning )
     if omp :
         if Nd == 2 :
             if angular :
-                return numpy.array( cc.dA2D_DD_omp( *data, rbins ) )
-            return numpy.array( cc.d2D_DD_omp( *data, rbins ) )
+                return numpy.array( cc.dA2D_DD_sphere_omp( *data, rbins, binning = binning ) )
+            return numpy.array( cc.d2D_DD_omp( *data, rbins, box, binning ) )
         if Nd == 3 :
-            return numpy.array( cc.d3D_DD_omp( *data, rbins ) )
+            return numpy.array( cc.d3D_DD_omp( *data, rbins, box, binning ) )
     else :
         if Nd == 2 :
             if angular :
-                return numpy.array( cc.dA2D_DD( *data, rbins ) )
-            return numpy.array( cc.d2D_DD( *data, rbins ) )
+                return numpy.array( cc.dA2D_DD_sphere( *data, rbins, binning = binning ) )
+            return numpy.array( cc.d2D_DD( *data, rbins, box, binning ) )
         if Nd == 3 :
-            return numpy.array( cc.d3D_DD( *data, rbins ) )
+            return numpy.array( cc.d3D_DD( *data, rbins, box, binning ) )
             
     return None
 
-def _kernel_DR (data1, data2, Nd, rbins, omp = True, angular = False
-                ) :
-    """Count data–random cross-pairs in each separation bin."""
+def _kernel_DR (data1, data2, Nd, rbins, omp = True, angular = False, box = 0.,
+                binning = 'log', weights1 = None, weights2 = None, cache = None ) :
+    """Count data–random cross-pairs in each separation bin, summing the
+    products of the weights when any of ``weights1``, ``weights2`` is given
+    (the other catalogue then has unit weights).  With ``cache``, counts
+    already computed on the same inputs are read from disk."""
     
+    binning = _binning( binning )
+    if cache is not None :
+        mode = ( f"DR/{Nd}D/{'sphere' if angular else 'flat'}/{binning.name}/"
+                 f"{weights1 is not None:d}{weights2 is not None:d}" )
+        return _cached( cache, mode, ( *data1, weights1, *data2, weights2 ), ( *rbins, box ),
+                        lambda : _kernel_DR( data1, data2, Nd, rbins, omp, angular, box, binning,
+                                             weights1, weights2 ) )
+    if weights1 is not None or weights2 is not None :
+        if weights1 is None :
+            weights1 = numpy.ones( data1.shape[ 1 ], dtype = numpy.float32 )
+        if weights2 is None :
+            weights2 = numpy.ones( data2.shape[ 1 ], dtype = numpy.float32 )
+        return _kernel_wDR( data1, weights1, data2, weights2, Nd, rbins, omp, angular, box, binning )
     if omp :
         if Nd == 2 :
             if angular :
-                return numpy.array( cc.dA2D_DR_omp( *data1, *data2, rbins ) )
-            return numpy.array( cc.d2D_DR_omp( *data1, *data2, rbins ) )
+                return numpy.array( cc.dA2D_DR_sphere_omp( *data1, *data2, rbins, binning = binning ) )
+            return numpy.array( cc.d2D_DR_omp( *data1, *data2, rbins, box, binning ) )
         if Nd == 3 :
-            return numpy.array( cc.d3D_DR_omp( *data1, *data2, rbins ) )
+            return numpy.array( cc.d3D_DR_omp( *data1, *data2, rbins, box, binning ) )
     else :
         if Nd == 2 :
             if angular :
-                return numpy.array( cc.dA2D_DR( *data1, *data2, rbins ) )
-            return numpy.array( cc.d2D_DR( *data1, *data2, rbins ) )
+                return numpy.array( cc.dA2D_DR_sphere( *data1, *data2, rbins, binning = binning ) )
+            return numpy.array( cc.d2D_DR( *data1, *data2, rbins, box, binning ) )
         if Nd == 3 :
-            return numpy.array( cc.d3D_DR( *data1, *data2, rbins ) )
+            return numpy.array( cc.d3D_DR( *data1, *data2, rbins, box, binning ) )
             
     return None
 
+def _kernel_wDD (data, weights, Nd, rbins, omp, angular, box, binning ) :
+    """Weighted data–data pair counts in each separation bin."""
+    
+    if omp :
+        if Nd == 2 :
+            if angular :
+                return cc.wdA2D_DD_sphere_omp( *data, weights, rbins, binning = binning )
+            return cc.wd2D_DD_omp( *data, weights, rbins, box, binning )
+        if Nd == 3 :
+            return cc.wd3D_DD_omp( *data, weights, rbins, box, binning )
+    else :
+        if Nd == 2 :
+            if angular :
+                return cc.wdA2D_DD_sphere( *data, weights, rbins, binning = binning )
+            return cc.wd2D_DD( *data, weights, rbins, box, binning )
+        if Nd == 3 :
+            return cc.wd3D_DD( *data, weights, rbins, box, binning )
+            
+    return None
+
+def _kernel_wDR (data1, weights1, data2, weights2, Nd, rbins, omp, angular, box, binning ) :
+    """Weighted data–random cross-pair counts in each separation bin."""
+    
+    if omp :
+        if Nd == 2 :
+            if angular :
+                return cc.wdA2D_DR_sphere_omp( *data1, weights1, *data2, weights2, rbins, binning = binning )
+            return cc.wd2D_DR_omp( *data1, weights1, *data2, weights2, rbins, box, binning )
+        if Nd == 3 :
+            return cc.wd3D_DR_omp( *data1, weights1, *data2, weights2, rbins, box, binning )
+    else :
+        if Nd == 2 :
+            if angular :
+                return cc.wdA2D_DR_sphere( *data1, weights1, *data2, weights2, rbins, binning = binning )
+            return cc.wd2D_DR( *data1, weights1, *data2, weights2, rbins, box, binning )
+        if Nd == 3 :
+            return cc.wd3D_DR( *data1, weights1, *data2, weights2, rbins, box, binning )
+            
+    return None
+
+##################################################################################
+
+def _periodic_RR ( rbins, Nd, box, angular, binning ) :
+    """Analytic normalised RR of a periodic box, used in place of a random catalogue."""
+
+    if not box > 0. or angular :
+        raise ValueError( "A random catalogue is required unless ``box > 0`` and ``angular = False``" )
+    if Nd == 2 :
+        return cc.RR_periodic_2D( rbins, box, _binning( binning ) )
+    if Nd == 3 :
+        return cc.RR_periodic_3D( rbins, box, _binning( binning ) )
+    raise ValueError( "Input space ``data`` should be 2D or 3D" )
+
 ##################################################################################
 
 def _kernel_standard ( DD, RR ) :
@@ -74,8 +223,8 @@ def _kernel_standard ( DD, RR ) :
 
 ##################################################################################
 
-def two_point_standard ( data, rand, rbins, omp = True, angular = False
-                        ) :
+def two_point_standard ( data, rand, rbins, omp = True, angular = False, box = 0.,
+                         binning = 'log', weights = None, rand_weights = None, cache = None ) :
     """Two-point correlation function with the standard estimator.
 
     Computes :math:`\\xi(r) = DD/RR - 1`, where :math:`DD` and
@@ -86,15 +235,40 @@ def two_point_standard ( data, rand, rbins, omp = True, angular = False
     ----------
     data : ndarray, shape ``(Ndim, Nobj)``
         Coordinates of the data catalogue.  ``Ndim`` must be 2 or 3.
-    rand : ndarray, shape ``(Ndim, Nrand)``
+    rand : ndarray, shape ``(Ndim, Nrand)``, or None
         Coordinates of the random catalogue, same dimensionality as
-        ``data``.
+        ``data``.  In a periodic box (``box > 0``) it can be ``None``:
+        the uniform :math:`RR` is then computed analytically.
     rbins : array-like
         Bin edges for the separation :math:`r`.
     omp : bool, optional
         Use the OpenMP-parallel pair counter (default: ``True``).
     angular : bool, optional
-        Reserved for future angular-space counting (currently unused).
+        If ``True``, ``data`` and ``rand`` are equatorial coordinates
+        ``(ra, dec)`` and ``rbins`` angular separations, in radians,
+        counted as exact great-circle angles (default: ``False``).
+    box : float, optional
+        Side of a periodic box: when positive, coordinates are expected
+        in ``[0, box)`` and separations follow the minimum-image
+        convention (default: ``0``, open boundaries).
+    binning : str, optional
+        Binning scheme: ``'log'`` (default) or ``'lin'`` place
+        ``len(rbins)`` logarithmic or linear bins between ``rbins[0]``
+        and ``rbins[-1]``; ``'edges'`` uses ``rbins`` as the sorted
+        edges of ``len(rbins) - 1`` bins of arbitrary width.
+    weights : array-like, optional
+        Per-object weights of the data catalogue, shape ``(Nobj,)``:
+        each pair contributes the product of the weights of its objects
+        and the counts are normalised by the corresponding sums of
+        weights (default: ``None``, unit weights).
+    rand_weights : array-like, optional
+        Per-object weights of the random catalogue, shape ``(Nrand,)``
+        (default: ``None``, unit weights).
+    cache : str or :class:`pair_cache`, optional
+        Directory of an on-disk cache of the pair counts involving the
+        random catalogue: counts on catalogues, weights, binning and box
+        already seen are read from disk instead of being recomputed
+        (default: ``None``, no cache).
 
     Returns
     -------
@@ -103,7 +277,17 @@ def two_point_standard ( data, rand, rbins, omp = True, angular = False
         ``(rbins.size - 1,)``.
     """
 
+    data = _as_coordinates( data )
     NdimD, NobjD = data.shape
+    if rand is None :
+        if not NobjD > 1 :
+            raise ValueError( "Cannot compute clustering if the catalogue does not have at least 2 elements" )
+        weights = _as_weights( weights, NobjD )
+        sumD, sumD2 = _weight_sums( weights, NobjD )
+        RR = _periodic_RR( rbins, NdimD, box, angular, binning )
+        DD = _kernel_DD( data, NdimD, rbins, omp, angular, box, binning, weights )
+        return _kernel_standard( DD * ( 2.0 / ( sumD * sumD - sumD2 ) ), RR )
+    rand = _as_coordinates( rand )
     NdimR, NobjR = rand.shape
     if NdimD != NdimR :
         raise ValueError( "Input spaces ``data`` and ``rand`` should have the same dimensions" )
@@ -112,18 +296,39 @@ def two_point_standard ( data, rand, rbins, omp = True, angular = False
             "Cannot compute clustering if one of the two catalogues does not have at least 2 elements"
         )
 
-    normDD = 2.0 / ( NobjD * ( NobjD - 1 ) )
-    normRR = 2.0 / ( NobjR * ( NobjR - 1 ) )
+    weights = _as_weights( weights, NobjD )
+    rand_weights = _as_weights( rand_weights, NobjR )
+    sumD, sumD2 = _weight_sums( weights, NobjD )
+    sumR, sumR2 = _weight_sums( rand_weights, NobjR )
+    normDD = 2.0 / ( sumD * sumD - sumD2 )
+    normRR = 2.0 / ( sumR * sumR - sumR2 )
 
-    DD = _kernel_DD( data, NdimD, rbins, omp, angular ) * normDD
+    DD = _kernel_DD( data, NdimD, rbins, omp, angular, box, binning, weights ) * normDD
     # DD = _kernel_DD( data, NdimD, rbins, omp ) * normDD
-    RR = _kernel_DD( rand, NdimD, rbins, omp, angular ) * normRR
+    RR = _kernel_DD( rand, NdimD, rbins, omp, angular, box, binning, rand_weights, cache ) * normRR
     # RR = _kernel_DD( rand, NdimD, rbins, omp ) * normRR
 
     return _kernel_standard( DD, RR )
     
 ##################################################################################
 
+def _kernel_landy_szalay_3D ( data, rand, rbins, omp, box, binning, weights, rand_weights ) :
+    """Fused 3D Landy–Szalay call: dict of ``xi``, the raw ``DD``, ``DR``,
+    ``RR`` counts and their normalisations ``normDD``, ``normDR``, ``normRR``."""
+
+    binning = _binning( binning )
+    if weights is None and rand_weights is None :
+        kernel = cc.d3D_landyszalay_omp if omp else cc.d3D_landyszalay
+        return kernel( *data, *rand, rbins, box, binning )
+    if weights is None :
+        weights = numpy.ones( data.shape[ 1 ], dtype = numpy.float32 )
+    if rand_weights is None :
+        rand_weights = numpy.ones( rand.shape[ 1 ], dtype = numpy.float32 )
+    kernel = cc.wd3D_landyszalay_omp if omp else cc.wd3D_landyszalay
+    return kernel( *data, weights, *rand, rand_weights, rbins, box, binning )
+
+##################################################################################
+
 def _kernel_landy_szalay ( DD, RR, DR ) :
     """Apply the Landy–Szalay estimator: :math:`\\xi = (DD - 2DR)/RR + 1`."""
 
@@ -144,7 +349,9 @@ def _kernel_error_landy_szalay () :
     
 ##################################################################################
 
-def two_point_landyszalay ( data, rand, rbins, omp = True, return_error = False, angular = False ) :
+def two_point_landyszalay ( data, rand, rbins, omp = True, return_error = False, angular = False,
+                            box = 0., binning = 'log', weights = None, rand_weights = None,
+                            cache = None ) :
     """Two-point correlation function with the Landy–Szalay estimator.
 
     Implements Eq. 23 of Ronconi et al. (2020):
@@ -161,8 +368,11 @@ def two_point_landyszalay ( data, rand, rbins, omp = True, return_error = False,
     ----------
     data : ndarray, shape ``(Ndim, Nobj)``
         Coordinates of the data catalogue.  ``Ndim`` must be 2 or 3.
-    rand : ndarray, shape ``(Ndim, Nrand)``
-        Coordinates of the random catalogue.
+    rand : ndarray, shape ``(Ndim, Nrand)``, or None
+        Coordinates of the random catalogue.  In a periodic box
+        (``box > 0``) it can be ``None``: the uniform :math:`RR` is then
+        computed analytically and :math:`DR = RR`, so that the estimator
+        reduces to :math:`DD/RR - 1`.
     rbins : array-like
         Bin edges for the separation :math:`r`.
     omp : bool, optional
@@ -171,7 +381,31 @@ def two_point_landyszalay ( data, rand, rbins, omp = True, return_error = False,
         If ``True``, also return a per-bin error estimate derived from
         the Poisson fluctuations of the pair counts (default: ``False``).
     angular : bool, optional
-        Reserved for future angular-space counting (currently unused).
+        If ``True``, ``data`` and ``rand`` are equatorial coordinates
+        ``(ra, dec)`` and ``rbins`` angular separations, in radians,
+        counted as exact great-circle angles (default: ``False``).
+    box : float, optional
+        Side of a periodic box: when positive, coordinates are expected
+        in ``[0, box)`` and separations follow the minimum-image
+        convention (default: ``0``, open boundaries).
+    binning : str, optional
+        Binning scheme: ``'log'`` (default) or ``'lin'`` place
+        ``len(rbins)`` logarithmic or linear bins between ``rbins[0]``
+        and ``rbins[-1]``; ``'edges'`` uses ``rbins`` as the sorted
+        edges of ``len(rbins) - 1`` bins of arbitrary width.
+    weights : array-like, optional
+        Per-object weights of the data catalogue, shape ``(Nobj,)``:
+        each pair contributes the product of the weights of its objects
+        and the counts are normalised by the corresponding sums of
+        weights (default: ``None``, unit weights).
+    rand_weights : array-like, optional
+        Per-object weights of the random catalogue, shape ``(Nrand,)``
+        (default: ``None``, unit weights).
+    cache : str or :class:`pair_cache`, optional
+        Directory of an on-disk cache of the pair counts involving the
+        random catalogue: counts on catalogues, weights, binning and box
+        already seen are read from disk instead of being recomputed
+        (default: ``None``, no cache).
 
     Returns
     -------
@@ -181,27 +415,54 @@ def two_point_landyszalay ( data, rand, rbins, omp = True, return_error = False,
         Per-bin error estimate, only returned when ``return_error=True``.
     """
 
+    data = _as_coordinates( data )
     NdimD, NobjD = data.shape
-    NdimR, NobjR = rand.shape
-    if NdimD != NdimR :
-        raise ValueError( "Input spaces ``data`` and ``rand`` should have the same dimensions" )
-    if not NobjD > 0 or not NobjR > 0 :
-        raise ValueError(
-            "Cannot compute clustering if one of the two catalogues does not have at least 2 elements"
-        )
-    normDD = 2.0 / ( NobjD * ( NobjD - 1 ) )
-    normRR = 2.0 / ( NobjR * ( NobjR - 1 ) )
-    normDR = 1.0 / ( NobjD * NobjR )
+    if rand is None :
+        if not NobjD > 1 :
+            raise ValueError( "Cannot compute clustering if the catalogue does not have at least 2 elements" )
+        RRn = _periodic_RR( rbins, NdimD, box, angular, binning )
+        # pair-count normalisation of a random catalogue with as many objects as the data
+        normRR = 2.0 / ( NobjD * ( NobjD - 1 ) )
+        RR = RRn / normRR
+    else :
+        rand = _as_coordinates( rand )
+        NdimR, NobjR = rand.shape
+        if NdimD != NdimR :
+            raise ValueError( "Input spaces ``data`` and ``rand`` should have the same dimensions" )
+        if not NobjD > 0 or not NobjR > 0 :
+            raise ValueError(
+                "Cannot compute clustering if one of the two catalogues does not have at least 2 elements"
+            )
+    weights = _as_weights( weights, NobjD )
+    sumD, sumD2 = _weight_sums( weights, NobjD )
+    normDD = 2.0 / ( sumD * sumD - sumD2 )
 
-    DD = _kernel_DD( data, NdimD, rbins, omp, angular )
-    # DD = _kernel_DD( data, NdimD, rbins, omp )
-    DDn = DD * normDD
-    RR = _kernel_DD( rand, NdimD, rbins, omp, angular )
-    # RR = _kernel_DD( rand, NdimD, rbins, omp )
-    RRn = RR * normRR
-    DR = _kernel_DR( data, rand, NdimD, rbins, omp, angular )
-    # DR = _kernel_DR( data, rand, NdimD, rbins, omp )
-    DRn = DR * normDR
+    if rand is not None and NdimD == 3 and not angular and cache is None :
+        # DD, DR and RR in a single call, on cell lists built once per catalogue
+        counts = _kernel_landy_szalay_3D( data, rand, rbins, omp, box, binning,
+                                          weights, _as_weights( rand_weights, NobjR ) )
+        normRR, RR = counts[ 'normRR' ], counts[ 'RR' ]
+        DDn = counts[ 'DD' ] * normDD
+        RRn = RR * normRR
+        DRn = counts[ 'DR' ] * counts[ 'normDR' ]
+    else :
+        DD = _kernel_DD( data, NdimD, rbins, omp, angular, box, binning, weights )
+        # DD = _kernel_DD( data, NdimD, rbins, omp )
+        DDn = DD * normDD
+        if rand is None :
+            DRn = RRn
+        else :
+            rand_weights = _as_weights( rand_weights, NobjR )
+            sumR, sumR2 = _weight_sums( rand_weights, NobjR )
+            normRR = 2.0 / ( sumR * sumR - sumR2 )
+            normDR = 1.0 / ( sumD * sumR )
+            RR = _kernel_DD( rand, NdimD, rbins, omp, angular, box, binning, rand_weights, cache )
+            # RR = _kernel_DD( rand, NdimD, rbins, omp )
+            RRn = RR * normRR
+            DR = _kernel_DR( data, rand, NdimD, rbins, omp, angular, box, binning,
+                             weights, rand_weights, cache )
+            # DR = _kernel_DR( data, rand, NdimD, rbins, omp )
+            DRn = DR * normDR
 
     # compute baseline clustering
     xi = _kernel_landy_szalay( DDn, RRn, DRn )
@@ -219,11 +480,1033 @@ def two_point_landyszalay ( data, rand, rbins, omp = True, return_error = False,
 
 ##################################################################################
 
+def multipoles_landyszalay ( data, rand, sbins, lmax = 4, nmu = None, omp = True, box = 0.,
+                             binning = 'log', los = 'z' ) :
+    """Legendre multipoles :math:`\\xi_\\ell(s)` of the redshift-space correlation function.
+
+    By default (``nmu = None``) the pair counters accumulate, for each
+    separation bin, the sums of the even Legendre polynomials
+    :math:`L_\\ell(\\mu)` over pairs, so that no :math:`\\mu` histogram is
+    stored.  The multipoles of the Landy–Szalay estimator then follow
+    assuming an isotropic :math:`RR`:
+
+    .. math::
+
+        \\xi_\\ell(s) = (2\\ell + 1)\\,
+        \\frac{DD_\\ell(s) - 2\\,DR_\\ell(s) + RR_\\ell(s)}{RR_0(s)}.
+
+    With ``nmu`` given, :math:`\\xi(s, \\mu)` is computed in ``nmu``
+    bins of :math:`|\\mu|` and integrated against :math:`L_\\ell`, which
+    does not assume an isotropic :math:`RR`.
+
+    Parameters
+    ----------
+    data : ndarray, shape ``(3, Nobj)``
+        Cartesian coordinates of the data catalogue.
+    rand : ndarray, shape ``(3, Nrand)``, or None
+        Cartesian coordinates of the random catalogue.  In a periodic
+        box it can be ``None``: the isotropic :math:`RR` is then computed
+        analytically and :math:`DR = RR`.
+    sbins : array-like
+        Separation bins, interpreted according to ``binning``.
+    lmax : int, optional
+        Highest multipole, even (default: ``4``, i.e. monopole,
+        quadrupole and hexadecapole).
+    nmu : int or None, optional
+        Number of :math:`|\\mu|` bins, ``None`` (default) for the
+        on-the-fly multipole sums.
+    omp : bool, optional
+        Use the OpenMP-parallel pair counter (default: ``True``).
+    box : float, optional
+        Side of a periodic box, requires ``los = 'z'`` (default: ``0``,
+        open boundaries).
+    binning : str, optional
+        Binning scheme of :math:`s`, ``'log'`` (default), ``'lin'`` or
+        ``'edges'``, see :func:`two_point_landyszalay`.
+    los : str, optional
+        Line of sight, ``'z'`` (default) or ``'midpoint'``, see
+        :func:`projected_landyszalay`.
+
+    Returns
+    -------
+    ndarray, shape ``(lmax // 2 + 1, Ns)``
+        Multipoles :math:`\\xi_0, \\xi_2, \\ldots, \\xi_{lmax}` per separation bin.
+    """
+
+    data = _as_coordinates( data )
+    NdimD, NobjD = data.shape
+    if rand is not None :
+        rand = _as_coordinates( rand )
+    NdimR, NobjR = rand.shape if rand is not None else data.shape
+    if NdimD != 3 or NdimR != 3 :
+        raise ValueError( "Input spaces ``data`` and ``rand`` should be 3D" )
+    if not NobjD > 1 or not NobjR > 1 :
+        raise ValueError(
+            "Cannot compute clustering if one of the two catalogues does not have at least 2 elements"
+        )
+    if lmax < 0 or lmax % 2 :
+        raise ValueError( "lmax should be a non-negative even integer" )
+
+    binning = _binning( binning )
+    los = _line_of_sight( los )
+    normDD = 2.0 / ( NobjD * ( NobjD - 1 ) )
+    normRR = 2.0 / ( NobjR * ( NobjR - 1 ) )
+    normDR = 1.0 / ( NobjD * NobjR )
+    ells = numpy.arange( 0, lmax + 1, 2 )
+    if rand is None :
+        # uniform pairs have L_0 = 1 and vanishing higher multipoles, flat in |mu|
+        RR0 = _periodic_RR( sbins, 3, box, False, binning )
+
+    if nmu is None :
+        kernel_DD = cc.d3D_DD_multipoles_omp if omp else cc.d3D_DD_multipoles
+        kernel_DR = cc.d3D_DR_multipoles_omp if omp else cc.d3D_DR_multipoles
+        DD = kernel_DD( *data, sbins, lmax, box, los, binning ) * normDD
+        if rand is None :
+            RR = numpy.zeros_like( DD )
+            RR[ :, 0 ] = RR0
+            DR = RR
+        else :
+            RR = kernel_DD( *rand, sbins, lmax, box, los, binning ) * normRR
+            DR = kernel_DR( *data, *rand, sbins, lmax, box, los, binning ) * normDR
+        ww = RR[ :, 0 ] > 0
+        out = numpy.zeros( ( ells.size, RR.shape[ 0 ] ) )
+        out[ :, ww ] = ( ( 2 * ells[ :, None ] + 1 ) *
+                         ( DD[ ww ] - 2.0 * DR[ ww ] + RR[ ww ] ).T / RR[ ww, 0 ] )
+        return out
+
+    kernel_DD = cc.d3D_DD_smu_omp if omp else cc.d3D_DD_smu
+    kernel_DR = cc.d3D_DR_smu_omp if omp else cc.d3D_DR_smu
+    DD = kernel_DD( *data, sbins, nmu, box, los, binning ) * normDD
+    if rand is None :
+        RR = numpy.outer( RR0, numpy.full( nmu, 1.0 / nmu ) )
+        DR = RR
+    else :
+        RR = kernel_DD( *rand, sbins, nmu, box, los, binning ) * normRR
+        DR = kernel_DR( *data, *rand, sbins, nmu, box, los, binning ) * normDR
+    xi = _kernel_landy_szalay( DD.ravel(), RR.ravel(), DR.ravel() ).reshape( DD.shape )
+    mu = ( numpy.arange( nmu ) + 0.5 ) / nmu
+    legendre = numpy.array( [ numpy.polynomial.legendre.legval( mu, numpy.eye( ell + 1 )[ ell ] )
+                              for ell in ells ] )
+    return ( 2 * ells[ :, None ] + 1 ) * ( xi @ legendre.T ).T / nmu
+
+##################################################################################
+
+def projected_landyszalay ( data, rand, rpbins, pimax, npi = 40, omp = True, box = 0.,
+                            binning = 'log', los = 'z', return_counts = False ) :
+    """Projected two-point correlation function :math:`w_p(r_p)`.
+
+    Pairs are counted in bins of separation perpendicular (:math:`r_p`)
+    and parallel (:math:`\\pi`) to the line of sight, the Landy–Szalay
+    estimator :math:`\\xi(r_p, \\pi)` is then integrated along the line
+    of sight:
+
+    .. math::
+
+        w_p(r_p) = 2 \\sum_{\\pi < \\pi_{max}} \\xi(r_p, \\pi)\\, \\Delta\\pi.
+
+    Parameters
+    ----------
+    data : ndarray, shape ``(3, Nobj)``
+        Cartesian coordinates of the data catalogue.
+    rand : ndarray, shape ``(3, Nrand)``, or None
+        Cartesian coordinates of the random catalogue.  In a periodic
+        box with ``los = 'z'`` it can be ``None``: the uniform
+        :math:`RR(r_p, \\pi)` is then computed analytically and
+        :math:`DR = RR`.
+    rpbins : array-like
+        Bins of the perpendicular separation :math:`r_p`, interpreted
+        according to ``binning``.
+    pimax : float
+        Integration limit along the line of sight.
+    npi : int, optional
+        Number of linear :math:`\\pi` bins in ``[0, pimax)`` (default: ``40``).
+    omp : bool, optional
+        Use the OpenMP-parallel pair counter (default: ``True``).
+    box : float, optional
+        Side of a periodic box, requires ``los = 'z'`` (default: ``0``,
+        open boundaries).
+    binning : str, optional
+        Binning scheme of :math:`r_p`, ``'log'`` (default), ``'lin'`` or
+        ``'edges'``, see :func:`two_point_landyszalay`.
+    los : str, optional
+        Line of sight: ``'z'`` (default) for the plane-parallel
+        approximation along the z axis (simulation boxes), ``'midpoint'``
+        for the direction of the pair midpoint seen from the origin
+        (lightcones).
+    return_counts : bool, optional
+        If ``True``, also return the normalised ``(DD, DR, RR)`` counts,
+        each of shape ``(Nrp, npi)`` (default: ``False``).
+
+    Returns
+    -------
+    wp : ndarray
+        Projected correlation function, one value per :math:`r_p` bin.
+    counts : tuple of ndarray
+        Normalised ``(DD, DR, RR)``, only returned when ``return_counts=True``.
+    """
+
+    data = _as_coordinates( data )
+    NdimD, NobjD = data.shape
+    if rand is not None :
+        rand = _as_coordinates( rand )
+    NdimR, NobjR = rand.shape if rand is not None else data.shape
+    if NdimD != 3 or NdimR != 3 :
+        raise ValueError( "Input spaces ``data`` and ``rand`` should be 3D" )
+    if not NobjD > 1 or not NobjR > 1 :
+        raise ValueError(
+            "Cannot compute clustering if one of the two catalogues does not have at least 2 elements"
+        )
+
+    binning = _binning( binning )
+    los = _line_of_sight( los )
+    kernel_DD = cc.d3D_DD_rppi_omp if omp else cc.d3D_DD_rppi
+    kernel_DR = cc.d3D_DR_rppi_omp if omp else cc.d3D_DR_rppi
+
+    DD = kernel_DD( *data, rpbins, pimax, npi, box, los, binning ) * ( 2.0 / ( NobjD * ( NobjD - 1 ) ) )
+    if rand is None :
+        if not box > 0. or los != cc.line_of_sight.z :
+            raise ValueError( "A random catalogue is required unless ``box > 0`` and ``los = 'z'``" )
+        RR = cc.RR_periodic_rppi( rpbins, pimax, npi, box, binning )
+        DR = RR
+    else :
+        RR = kernel_DD( *rand, rpbins, pimax, npi, box, los, binning ) * ( 2.0 / ( NobjR * ( NobjR - 1 ) ) )
+        DR = kernel_DR( *data, *rand, rpbins, pimax, npi, box, los, binning ) * ( 1.0 / ( NobjD * NobjR ) )
+
+    wp = cc.wp_landy_szalay( DD.ravel(), DR.ravel(), RR.ravel(), npi, pimax )
+    if return_counts :
+        return wp, ( DD, DR, RR )
+    return wp
+
+##################################################################################
+
+def marked_correlation ( data, marks, rbins, omp = True, box = 0., binning = 'log',
+                         return_counts = False ) :
+    """Marked correlation functions :math:`M_k(r)` of a set of marks.
+
+    For each mark :math:`m_k` the pair counts weighted by the product
+    of the marks, :math:`WW_k`, and the plain counts :math:`DD` are
+    accumulated in the same traversal of the catalogue, then
+
+    .. math::
+
+        M_k(r) = \\frac{WW_k(r) / \\sum_{i \\neq j} m_{k,i} m_{k,j}}
+                        {DD(r) / N (N - 1)},
+
+    i.e. the ratio of the normalised marked and unmarked counts, equal
+    to :math:`(1 + W_k(r)) / (1 + \\xi(r))`.
+
+    Parameters
+    ----------
+    data : ndarray, shape ``(3, Nobj)``
+        Cartesian coordinates of the catalogue.
+    marks : ndarray, shape ``(Nmark, Nobj)`` or ``(Nobj,)``
+        Marks of the objects (e.g. mass, colour), one row per mark.
+    rbins : array-like
+        Separation bins, interpreted according to ``binning``.
+    omp : bool, optional
+        Use the OpenMP-parallel pair counter (default: ``True``).
+    box : float, optional
+        Side of a periodic box (default: ``0``, open boundaries).
+    binning : str, optional
+        Binning scheme, ``'log'`` (default), ``'lin'`` or ``'edges'``,
+        see :func:`two_point_landyszalay`.
+    return_counts : bool, optional
+        If ``True``, also return the raw counts, shape ``(Nbin, Nmark + 1)``,
+        column 0 holding :math:`DD` and column ``1 + k`` :math:`WW_k`
+        (default: ``False``).
+
+    Returns
+    -------
+    M : ndarray, shape ``(Nmark, Nbin)``
+        Marked correlation function of each mark, 0 in empty bins.
+    counts : ndarray
+        Raw counts, only returned when ``return_counts=True``.
+    """
+
+    data = _as_coordinates( data )
+    Ndim, Nobj = data.shape
+    if Ndim != 3 :
+        raise ValueError( "Input space ``data`` should be 3D" )
+    if not Nobj > 1 :
+        raise ValueError( "Cannot compute clustering if the catalogue does not have at least 2 elements" )
+    marks = _as_coordinates( marks )
+    if marks.ndim == 1 :
+        marks = marks[ None, : ]
+    if marks.ndim != 2 or marks.shape[ 1 ] != Nobj :
+        raise ValueError( f"Marks should have shape (Nmark, {Nobj}), got shape {marks.shape}" )
+
+    kernel = cc.d3D_DD_marked_omp if omp else cc.d3D_DD_marked
+    counts = kernel( *data, marks, rbins, box, _binning( binning ) )
+    mm = marks.astype( numpy.float64 )
+    norm = ( mm.sum( axis = 1 )**2 - ( mm * mm ).sum( axis = 1 ) ) / ( Nobj * ( Nobj - 1.0 ) )
+    DD = counts[ :, 0 ]
+    ww = DD > 0
+    out = numpy.zeros( ( marks.shape[ 0 ], DD.size ) )
+    out[ :, ww ] = counts[ ww, 1: ].T / DD[ ww ] / norm[ :, None ]
+    if return_counts :
+        return out, counts
+    return out
+
+##################################################################################
+
+def tracer_pair_counts ( data, tracers, rbins, ntracer = None, omp = True, box = 0.,
+                         binning = 'log', weights = None ) :
+    """Auto- and cross-pair counts of the tracer samples of one catalogue.
+
+    Every pair of the catalogue is visited once and counted in the
+    histogram of the tracer labels of its two objects, so that the
+    auto-counts of all the samples and the cross-counts of all the pairs
+    of samples come out of a single traversal, instead of one count per
+    pair of samples.
+
+    Parameters
+    ----------
+    data : ndarray, shape ``(3, Nobj)``
+        Cartesian coordinates of the catalogue.
+    tracers : array-like of int, shape ``(Nobj,)``
+        Tracer label of each object, in ``[0, ntracer)``.
+    rbins : array-like
+        Separation bins, interpreted according to ``binning``.
+    ntracer : int, optional
+        Number of samples (default: ``max( tracers ) + 1``).
+    omp : bool, optional
+        Use the OpenMP-parallel pair counter (default: ``True``).
+    box : float, optional
+        Side of a periodic box (default: ``0``, open boundaries).
+    binning : str, optional
+        Binning scheme, ``'log'`` (default), ``'lin'`` or ``'edges'``.
+    weights : array-like, optional
+        Per-object weights, pairs then contribute the product of the
+        weights of their objects (default: ``None``, pair counts).
+
+    Returns
+    -------
+    counts : ndarray, shape ``(ntracer, ntracer, Nbin)``
+        Symmetric matrix of histograms: ``counts[a, a]`` holds the pairs
+        of objects of sample ``a`` (each pair once, as ``d3D_DD``),
+        ``counts[a, b]`` the pairs of an object of sample ``a`` and one
+        of sample ``b`` (as ``d3D_DR``).
+    """
+
+    data = _as_coordinates( data )
+    Ndim, Nobj = data.shape
+    if Ndim != 3 :
+        raise ValueError( "Input space ``data`` should be 3D" )
+    tracers = numpy.ascontiguousarray( tracers, dtype = numpy.int32 )
+    if tracers.shape != ( Nobj, ) :
+        raise ValueError( f"Tracer labels should be a 1D array of {Nobj} elements, got shape {tracers.shape}" )
+    if ntracer is None :
+        ntracer = int( tracers.max() ) + 1 if Nobj > 0 else 1
+    weights = _as_weights( weights, Nobj )
+
+    binning = _binning( binning )
+    if weights is None :
+        kernel = cc.d3D_DD_tracers_omp if omp else cc.d3D_DD_tracers
+        rows = kernel( *data, tracers, ntracer, rbins, box, binning )
+    else :
+        kernel = cc.wd3D_DD_tracers_omp if omp else cc.wd3D_DD_tracers
+        rows = kernel( *data, weights, tracers, ntracer, rbins, box, binning )
+
+    counts = numpy.zeros( ( ntracer, ntracer, rows.shape[ 1 ] ), dtype = rows.dtype )
+    aa, bb = numpy.triu_indices( ntracer )
+    counts[ aa, bb ] = rows
+    counts[ bb, aa ] = rows
+    return counts
+
+##################################################################################
+
+def _wigner3j_000_squared ( l1, l2, l3 ) :
+    """Squared Wigner 3j symbol :math:`(l_1\\, l_2\\, l_3; 0\\, 0\\, 0)^2`."""
+
+    J = l1 + l2 + l3
+    if J % 2 or l3 < abs( l1 - l2 ) or l3 > l1 + l2 :
+        return 0.
+    g = J // 2
+    fact = math.factorial
+    return ( fact( J - 2 * l1 ) * fact( J - 2 * l2 ) * fact( J - 2 * l3 ) / fact( J + 1 ) *
+             ( fact( g ) / ( fact( g - l1 ) * fact( g - l2 ) * fact( g - l3 ) ) )**2 )
+
+def three_point_multipoles ( data, rbins, lmax = 4, rand = None, omp = True, box = 0.,
+                             binning = 'log', return_counts = False ) :
+    """Legendre multipoles :math:`\\zeta_\\ell(r_1, r_2)` of the three-point correlation function.
+
+    Triplets are counted with the spherical-harmonic decomposition of
+    Slepian & Eisenstein (2015): for each primary, the multipole sums
+    over pairs of neighbours at separations :math:`r_1` and :math:`r_2`
+    follow from the harmonic coefficients of the neighbours, at a cost
+    linear in the number of pairs within ``rbins[-1]``.
+
+    With a random catalogue (lightcones, or boxes) the edge-corrected
+    estimator of Slepian & Eisenstein is used: the multipoles
+    :math:`N_\\ell` of the field :math:`D - \\alpha R` and
+    :math:`R_\\ell` of the randoms (up to ``2 lmax``) are related by
+
+    .. math::
+
+        \\frac{N_\\ell}{R_0} = \\sum_{\\ell'} \\zeta_{\\ell'}
+        \\sum_L (2L + 1) \\frac{R_L}{R_0}
+        \\begin{pmatrix} \\ell & \\ell' & L \\\\ 0 & 0 & 0 \\end{pmatrix}^2,
+
+    solved for :math:`\\zeta_\\ell` in each :math:`(r_1, r_2)` bin: this is
+    the connected three-point function.  Without randoms in a periodic
+    box, the natural estimator :math:`DDD / RRR - 1` with the analytic,
+    isotropic :math:`RRR` is used instead, which also contains the
+    two-point terms :math:`\\xi_{12} + \\xi_{13} + \\xi_{23}`.
+
+    Parameters
+    ----------
+    data : ndarray, shape ``(3, Nobj)``
+        Cartesian coordinates of the data catalogue.
+    rbins : array-like
+        Separation bins of the two sides from the primary, interpreted
+        according to ``binning``.
+    lmax : int, optional
+        Highest multipole (default: ``4``).
+    rand : ndarray, shape ``(3, Nrand)``, optional
+        Cartesian coordinates of the random catalogue, required unless
+        ``box > 0``.
+    omp : bool, optional
+        Use the OpenMP-parallel counter (default: ``True``).
+    box : float, optional
+        Side of a periodic box (default: ``0``, open boundaries).
+    binning : str, optional
+        Binning scheme, ``'log'`` (default), ``'lin'`` or ``'edges'``,
+        see :func:`two_point_landyszalay`.
+    return_counts : bool, optional
+        If ``True``, also return the raw multipole sums, ``NNN`` (and
+        ``RRR`` with randoms), see ``clustering_core.d3D_3pcf_multipoles``
+        (default: ``False``).
+
+    Returns
+    -------
+    zeta : ndarray, shape ``(lmax + 1, Nbin, Nbin)``
+        Multipoles :math:`\\zeta_\\ell(r_1, r_2)`, 0 where the randoms are empty.
+    counts : tuple of ndarray
+        Raw multipole sums, only returned when ``return_counts=True``.
+    """
+
+    data = _as_coordinates( data )
+    NdimD, NobjD = data.shape
+    if NdimD != 3 :
+        raise ValueError( "Input space ``data`` should be 3D" )
+    if not NobjD > 2 :
+        raise ValueError( "Cannot compute triplet clustering with less than 3 objects" )
+    binning = _binning( binning )
+    kernel = cc.d3D_3pcf_multipoles_omp if omp else cc.d3D_3pcf_multipoles
+    ells = numpy.arange( lmax + 1 )
+
+    if rand is None :
+        if not box > 0. :
+            raise ValueError( "A random catalogue is required unless ``box > 0``" )
+        NNN = kernel( *data, rbins, lmax, box, binning )
+        # secondaries of a uniform catalogue: fraction of the box in each shell
+        shell = cc.RR_periodic_3D( rbins, box, binning )
+        RRR0 = NobjD * ( NobjD - 1.0 ) * ( NobjD - 2.0 ) * numpy.outer( shell, shell )
+        zeta = ( 2 * ells[ :, None, None ] + 1 ) * NNN / RRR0
+        zeta[ 0 ] -= 1.0
+        if return_counts :
+            return zeta, ( NNN, )
+        return zeta
+
+    rand = _as_coordinates( rand )
+    NdimR, NobjR = rand.shape
+    if NdimR != 3 :
+        raise ValueError( "Input space ``rand`` should be 3D" )
+    if not NobjR > 2 :
+        raise ValueError( "Cannot compute triplet clustering with less than 3 random objects" )
+    alpha = NobjD / NobjR
+    wkernel = cc.wd3D_3pcf_multipoles_omp if omp else cc.wd3D_3pcf_multipoles
+    weights = numpy.concatenate( ( numpy.ones( NobjD, dtype = numpy.float32 ),
+                                   numpy.full( NobjR, -alpha, dtype = numpy.float32 ) ) )
+    NNN = wkernel( *numpy.concatenate( ( data, rand ), axis = 1 ), weights,
+                   rbins, lmax, box, binning )
+    RRR = kernel( *rand, rbins, 2 * lmax, box, binning ) * alpha**3
+
+    # coupling of the multipoles by the anisotropy of the randoms
+    coupling = numpy.array( [ [ [ ( 2 * L + 1 ) * _wigner3j_000_squared( l1, l2, L )
+                                  for L in range( 2 * lmax + 1 ) ]
+                                for l2 in ells ] for l1 in ells ] )
+    zeta = numpy.zeros_like( NNN )
+    ww = RRR[ 0 ] > 0
+    fL = RRR[ :, ww ] / RRR[ 0, ww ]
+    A = numpy.einsum( 'ijL,Lb->bij', coupling, fL )
+    zeta[ :, ww ] = numpy.linalg.solve( A, ( NNN[ :, ww ] / RRR[ 0, ww ] ).T[ :, :, None ] )[ :, :, 0 ].T
+    if return_counts :
+        return zeta, ( NNN, RRR )
+    return zeta
+
+##################################################################################
+
+def counts_in_cells ( data, radii, nsphere = 100000, centres = None, nmax = 1000, box = 0.,
+                      omp = True, seed = None ) :
+    """Counts in spheres: distribution :math:`P_N(R)`, void probability function and moments.
+
+    The catalogue is distributed once on a cell list, and the objects
+    within each radius of every sphere centre are counted in a single
+    pass over the centres.  The reduced moments are corrected for
+    shot noise:
+
+    .. math::
+
+        \\bar\\xi_2 = \\frac{\\mu_2 - \\bar N}{\\bar N^2}, \\qquad
+        \\bar\\xi_3 = \\frac{\\mu_3 - 3\\mu_2 + 2\\bar N}{\\bar N^3}.
+
+    Parameters
+    ----------
+    data : ndarray, shape ``(3, Nobj)``
+        Cartesian coordinates of the catalogue.
+    radii : array-like
+        Strictly increasing sphere radii.
+    nsphere : int, optional
+        Number of random sphere centres, when ``centres`` is not given
+        (default: ``100000``).
+    centres : ndarray, shape ``(3, Nsphere)``, optional
+        Sphere centres.  By default uniform random points in the periodic
+        box, or, with open boundaries, in the bounding box of the
+        catalogue shrunk by the largest radius, so that spheres do not
+        cross its edges.
+    nmax : int, optional
+        Counts above ``nmax`` are accumulated in the last bin of
+        :math:`P_N`; the moments are not truncated (default: ``1000``).
+    box : float, optional
+        Side of a periodic box (default: ``0``, open boundaries).
+    omp : bool, optional
+        Use the OpenMP-parallel engine (default: ``True``).
+    seed : int, optional
+        Seed of the random centres (default: ``None``).
+
+    Returns
+    -------
+    cic : dict
+        ``'P'``, shape ``(Nradius, nmax + 1)``, the probability of
+        :math:`N` objects in a sphere; ``'vpf'`` the void probability
+        :math:`P_0(R)`; ``'mean'``, ``'variance'``, ``'mu3'``, ``'mu4'``
+        the mean and central moments of the counts; ``'xi2'`` and
+        ``'xi3'`` the shot-noise corrected reduced moments
+        :math:`\\bar\\xi_2`, :math:`\\bar\\xi_3`; ``'centres'`` the centres used.
+    """
+
+    data = _as_coordinates( data )
+    if data.shape[ 0 ] != 3 :
+        raise ValueError( "Input space ``data`` should be 3D" )
+    radii = numpy.asarray( radii, dtype = numpy.float32 )
+    if centres is None :
+        rng = numpy.random.default_rng( seed )
+        if box > 0. :
+            lo, hi = numpy.zeros( 3 ), numpy.full( 3, box )
+        else :
+            lo = data.min( axis = 1 ) + radii[ -1 ]
+            hi = data.max( axis = 1 ) - radii[ -1 ]
+            if numpy.any( hi <= lo ) :
+                raise ValueError( "The catalogue is too small for spheres of the largest radius" )
+        centres = _as_coordinates( rng.uniform( lo, hi, size = ( int( nsphere ), 3 ) ).T )
+        if box > 0. :
+            # uniform draws can round up to box in single precision
+            centres = numpy.mod( centres, numpy.float32( box ) )
+    centres = _as_coordinates( centres )
+    if centres.ndim != 2 or centres.shape[ 0 ] != 3 :
+        raise ValueError( "Sphere centres should have shape (3, Nsphere)" )
+
+    kernel = cc.counts_in_cells_omp if omp else cc.counts_in_cells
+    PN, moments = kernel( *data, *centres, radii, int( nmax ), box )
+    nsph = max( centres.shape[ 1 ], 1 )
+    mean, mu2, mu3, mu4 = moments.T
+    with numpy.errstate( divide = 'ignore', invalid = 'ignore' ) :
+        xi2 = numpy.where( mean > 0, ( mu2 - mean ) / mean**2, 0. )
+        xi3 = numpy.where( mean > 0, ( mu3 - 3. * mu2 + 2. * mean ) / mean**3, 0. )
+    P = PN / nsph
+    return dict( P = P, vpf = P[ :, 0 ], mean = mean, variance = mu2, mu3 = mu3, mu4 = mu4,
+                 xi2 = xi2, xi3 = xi3, centres = centres )
+
+##################################################################################
+
+def knn_cdf ( data, k, radii, nquery = 1000000, queries = None, box = 0., omp = True,
+              seed = None, chunk = 4194304 ) :
+    """Cumulative distributions of the k-th nearest neighbour distances (kNN-CDF).
+
+    The distances from volume-filling query points to their k-th
+    nearest object of the catalogue are searched on a k-d tree and
+    binned on the fly: memory does not grow with the number of query
+    points, which are drawn and processed in chunks.
+
+    Parameters
+    ----------
+    data : ndarray, shape ``(3, Nobj)``
+        Cartesian coordinates of the catalogue.
+    k : array-like of int
+        Strictly increasing neighbour orders.
+    radii : array-like
+        Strictly increasing radii on which the distributions are computed.
+    nquery : int, optional
+        Number of random query points, when ``queries`` is not given
+        (default: ``1000000``).
+    queries : ndarray, shape ``(3, Nquery)``, optional
+        Query points.  By default uniform random points in the periodic
+        box, or, with open boundaries, in the bounding box of the
+        catalogue shrunk by the largest radius.
+    box : float, optional
+        Side of a periodic box (default: ``0``, open boundaries).
+    omp : bool, optional
+        Use the OpenMP-parallel engine (default: ``True``).
+    seed : int, optional
+        Seed of the random query points (default: ``None``).
+    chunk : int, optional
+        Maximum number of random query points drawn at once
+        (default: ``4194304``).
+
+    Returns
+    -------
+    knn : dict
+        ``'cdf'``, shape ``(Nk, Nradius)``, the fraction of query points
+        whose k-th neighbour lies at distance :math:`r \\le R`; ``'pcdf'``
+        the peaked CDF :math:`\\min(\\mathrm{CDF}, 1 - \\mathrm{CDF})`;
+        ``'k'`` and ``'radii'``.
+    """
+
+    data = _as_coordinates( data )
+    if data.shape[ 0 ] != 3 :
+        raise ValueError( "Input space ``data`` should be 3D" )
+    k = numpy.asarray( k, dtype = numpy.uint64 ).ravel()
+    radii = numpy.asarray( radii, dtype = numpy.float32 )
+    kernel = cc.knn_cdf_omp if omp else cc.knn_cdf
+
+    if queries is not None :
+        queries = _as_coordinates( queries )
+        if queries.ndim != 2 or queries.shape[ 0 ] != 3 :
+            raise ValueError( "Query points should have shape (3, Nquery)" )
+        counts, total = kernel( *data, *queries, k, radii, box ), queries.shape[ 1 ]
+    else :
+        rng = numpy.random.default_rng( seed )
+        if box > 0. :
+            lo, hi = numpy.zeros( 3 ), numpy.full( 3, box )
+        else :
+            lo = data.min( axis = 1 ) + radii[ -1 ]
+            hi = data.max( axis = 1 ) - radii[ -1 ]
+            if numpy.any( hi <= lo ) :
+                raise ValueError( "The catalogue is too small for the largest radius" )
+        counts, total = numpy.zeros( ( len( k ), len( radii ) ), dtype = numpy.uint64 ), 0
+        while total < nquery :
+            nn = min( int( chunk ), int( nquery ) - total )
+            qq = _as_coordinates( rng.uniform( lo, hi, size = ( nn, 3 ) ).T )
+            if box > 0. :
+                # uniform draws can round up to box in single precision
+                qq = numpy.mod( qq, numpy.float32( box ) )
+            counts += kernel( *data, *qq, k, radii, box ).astype( numpy.uint64 )
+            total += nn
+
+    cdf = counts / max( total, 1 )
+    return dict( cdf = cdf, pcdf = numpy.minimum( cdf, 1. - cdf ), k = k, radii = radii )
+
+##################################################################################
+
+def friends_of_friends ( data, linking_length, box = 0., omp = True, min_members = 1 ) :
+    """Friends-of-friends groups of a catalogue (e.g. of a HOD mock).
+
+    Objects closer than the linking length are friends, and groups are
+    the sets of objects connected by chains of friends.  Pairs are
+    searched on a cell list and merged by a parallel union-find.
+
+    Parameters
+    ----------
+    data : ndarray, shape ``(3, Nobj)``
+        Cartesian coordinates of the catalogue.
+    linking_length : float
+        Maximum separation of two friends, in the units of ``data``
+        (commonly :math:`b\\,\\bar n^{-1/3}`, with :math:`b \\simeq 0.2`).
+    box : float, optional
+        Side of a periodic box (default: ``0``, open boundaries): groups
+        then extend across the faces of the box.
+    omp : bool, optional
+        Use the OpenMP-parallel finder (default: ``True``).
+    min_members : int, optional
+        Groups with fewer objects are discarded: their objects get group
+        ``-1`` and the remaining groups are numbered consecutively
+        (default: ``1``, all groups are kept).
+
+    Returns
+    -------
+    group : ndarray of int64, shape ``(Nobj,)``
+        Group of each object, groups being numbered from ``0`` in the
+        order of their first object.
+    multiplicity : ndarray of int64, shape ``(Ngroup,)``
+        Number of objects in each group.
+    """
+
+    data = _as_coordinates( data )
+    if data.shape[ 0 ] != 3 :
+        raise ValueError( "Input space ``data`` should be 3D" )
+    finder = cc.friends_of_friends_omp if omp else cc.friends_of_friends
+    group, multiplicity = finder( *data, linking_length, box )
+    group, multiplicity = group.astype( numpy.int64 ), multiplicity.astype( numpy.int64 )
+    if min_members > 1 :
+        keep = multiplicity >= min_members
+        relabel = numpy.where( keep, numpy.cumsum( keep ) - 1, -1 )
+        group, multiplicity = relabel[ group ], multiplicity[ keep ]
+    return group, multiplicity
+
+##################################################################################
+
+def write_coordinate_file ( path, data, weights = None, append = False ) :
+    """Write a 3D catalogue in the flat binary layout read by :func:`stream_pair_counts`.
+
+    Records are native-endian float32 ``( x, y, z )``, or ``( x, y, z, w )``
+    with weights, with no header.  Catalogues larger than memory can be
+    written in pieces with ``append=True``.
+
+    Parameters
+    ----------
+    path : str
+        Destination file.
+    data : ndarray, shape ``(3, Nobj)``
+        Cartesian coordinates.
+    weights : ndarray, shape ``(Nobj,)``, optional
+        Per-object weights, stored as a fourth column.
+    append : bool, optional
+        Append to an existing file instead of overwriting it (default: ``False``).
+    """
+
+    data = _as_coordinates( data )
+    if data.shape[ 0 ] != 3 :
+        raise ValueError( "Input space ``data`` should be 3D" )
+    weights = _as_weights( weights, data.shape[ 1 ] )
+    columns = data if weights is None else numpy.vstack( ( data, weights ) )
+    with open( path, 'ab' if append else 'wb' ) as fout :
+        numpy.ascontiguousarray( columns.T ).tofile( fout )
+
+def stream_pair_counts ( file1, rbins, file2 = None, omp = True, box = 0., binning = 'log',
+                         weighted = False, columns = None, chunk_size = None, checkpoint = None ) :
+    """Out-of-core 3D pair counts of catalogues stored in coordinate files.
+
+    The files, written by :func:`write_coordinate_file`, are memory-mapped
+    and counted one pair of chunks of ``chunk_size`` objects at a time, so
+    that catalogues larger than memory can be counted.  With
+    ``checkpoint``, the partial histogram is saved in that directory after
+    each pair of chunks: a job killed and started again with the same
+    arguments resumes from the last pair of chunks completed.
+
+    Parameters
+    ----------
+    file1 : str
+        Coordinate file of the first catalogue.
+    rbins : array-like
+        Separation bins, interpreted according to ``binning``.
+    file2 : str, optional
+        Coordinate file of the second catalogue, for cross-pair (DR) counts;
+        auto-pair (DD or RR) counts of ``file1`` otherwise.
+    omp : bool, optional
+        Use the OpenMP-parallel counters (default: ``True``).
+    box : float, optional
+        Side of a periodic box (default: ``0``, open boundaries).
+    binning : str, optional
+        Binning scheme, ``'log'`` (default), ``'lin'`` or ``'edges'``.
+    weighted : bool, optional
+        Sum the products of the weights stored in the files, which then
+        have four columns (default: ``False``).
+    columns : int, optional
+        Values per object in the files, 3 or 4 (default: 4 if ``weighted``,
+        3 otherwise); weights are ignored by unweighted counts.
+    chunk_size : int, optional
+        Objects per chunk, at most two chunks are held in memory
+        (default: ``2**24``).
+    checkpoint : str, optional
+        Directory of the checkpoints (default: ``None``, no checkpointing).
+
+    Returns
+    -------
+    counts : ndarray
+        Pair counts (float sums of weights when ``weighted``) in each bin.
+    """
+
+    binning = _binning( binning )
+    ncol = columns if columns is not None else ( 4 if weighted else 3 )
+    kw = dict( box = box, binning = binning, checkpoint = '' if checkpoint is None else str( checkpoint ) )
+    if chunk_size is not None :
+        kw[ 'chunk_size' ] = int( chunk_size )
+    f1 = cc.coordinate_file( str( file1 ), ncol )
+    if file2 is None :
+        kernel = ( ( cc.wd3D_DD_stream_omp if omp else cc.wd3D_DD_stream ) if weighted else
+                   ( cc.d3D_DD_stream_omp if omp else cc.d3D_DD_stream ) )
+        return kernel( f1, rbins, **kw )
+    f2 = cc.coordinate_file( str( file2 ), ncol )
+    kernel = ( ( cc.wd3D_DR_stream_omp if omp else cc.wd3D_DR_stream ) if weighted else
+               ( cc.d3D_DR_stream_omp if omp else cc.d3D_DR_stream ) )
+    return kernel( f1, f2, rbins, **kw )
+
+##################################################################################
+
+def fine_pair_counts ( data, rand, rmin, rmax, omp = True, box = 0., weights = None,
+                       rand_weights = None ) :
+    """3D pair counts in fine bins of squared separation, for cheap re-binning.
+
+    Pairs between ``rmin`` and ``rmax`` are counted once into histograms
+    with a relative bin width of :math:`2^{-13}` in :math:`r^2`, that
+    :func:`landyszalay_rebinned` turns into the correlation function in
+    any bins within that range without counting again.  The histograms
+    are picklable, so counts can be stored and re-binned later.
+
+    Parameters
+    ----------
+    data : ndarray, shape ``(3, Nobj)``
+        Cartesian coordinates of the data catalogue.
+    rand : ndarray, shape ``(3, Nrand)``, or None
+        Coordinates of the random catalogue; in a periodic box it can be
+        ``None``, the random counts are then analytic at re-binning.
+    rmin, rmax : float
+        Range of separations recorded, ``0 < rmin < rmax``.
+    omp : bool, optional
+        Use the OpenMP-parallel counters (default: ``True``).
+    box : float, optional
+        Side of a periodic box (default: ``0``, open boundaries).
+    weights, rand_weights : array-like, optional
+        Per-object weights of the catalogues (default: ``None``, unit weights).
+
+    Returns
+    -------
+    counts : dict
+        Fine histograms ``'DD'``, ``'DR'`` and ``'RR'`` (``None`` without
+        random catalogue) with their normalisations ``'normDD'``,
+        ``'normDR'`` and ``'normRR'``, the ``'box'`` and the number of
+        data objects ``'Nd'``.
+    """
+
+    data = _as_coordinates( data )
+    NdimD, NobjD = data.shape
+    if NdimD != 3 :
+        raise ValueError( "Input space ``data`` should be 3D" )
+    if not NobjD > 1 :
+        raise ValueError( "Cannot compute clustering if the catalogue does not have at least 2 elements" )
+    weights = _as_weights( weights, NobjD )
+    sumD, sumD2 = _weight_sums( weights, NobjD )
+    if rand is None :
+        if not box > 0. :
+            raise ValueError( "A random catalogue is required unless ``box > 0``" )
+    else :
+        rand = _as_coordinates( rand )
+        NdimR, NobjR = rand.shape
+        if NdimR != 3 or not NobjR > 1 :
+            raise ValueError( "Input space ``rand`` should be 3D with at least 2 elements" )
+        rand_weights = _as_weights( rand_weights, NobjR )
+        sumR, sumR2 = _weight_sums( rand_weights, NobjR )
+
+    def _DD ( cat, ww ) :
+        if ww is None :
+            return ( cc.d3D_DD_fine_omp if omp else cc.d3D_DD_fine )( *cat, rmin, rmax, box )
+        return ( cc.wd3D_DD_fine_omp if omp else cc.wd3D_DD_fine )( *cat, ww, rmin, rmax, box )
+
+    counts = dict( DD = _DD( data, weights ), normDD = 2.0 / ( sumD * sumD - sumD2 ),
+                   DR = None, RR = None, normDR = None, normRR = None, box = box, Nd = NobjD )
+    if rand is None :
+        return counts
+
+    counts[ 'RR' ] = _DD( rand, rand_weights )
+    counts[ 'normRR' ] = 2.0 / ( sumR * sumR - sumR2 )
+    if weights is None and rand_weights is None :
+        counts[ 'DR' ] = ( cc.d3D_DR_fine_omp if omp else cc.d3D_DR_fine )( *data, *rand, rmin, rmax, box )
+    else :
+        ww = numpy.ones( NobjD, dtype = numpy.float32 ) if weights is None else weights
+        wr = numpy.ones( NobjR, dtype = numpy.float32 ) if rand_weights is None else rand_weights
+        counts[ 'DR' ] = ( cc.wd3D_DR_fine_omp if omp else cc.wd3D_DR_fine )( *data, ww, *rand, wr,
+                                                                              rmin, rmax, box )
+    counts[ 'normDR' ] = 1.0 / ( sumD * sumR )
+    return counts
+
+def landyszalay_rebinned ( counts, rbins, binning = 'log' ) :
+    """Landy–Szalay correlation function from fine pair counts.
+
+    Parameters
+    ----------
+    counts : dict
+        Output of :func:`fine_pair_counts`.
+    rbins : array-like
+        Separation bins within the recorded range, interpreted according
+        to ``binning``; edges are snapped to the nearest fine edges
+        (relative shift below :math:`3 \\times 10^{-5}`).  Edges
+        outside ``[rmin, rmax]`` raise ``ValueError``.
+    binning : str, optional
+        Binning scheme, ``'log'`` (default), ``'lin'`` or ``'edges'``.
+
+    Returns
+    -------
+    xi : ndarray
+        Correlation function in the bins.
+    edges : ndarray
+        Bin edges actually used.
+    """
+
+    scheme = _binning( binning )
+    DDn = counts[ 'DD' ].rebin( rbins, scheme ) * counts[ 'normDD' ]
+    edges = counts[ 'DD' ].rebin_edges( rbins, scheme )
+    if counts[ 'RR' ] is None :
+        RRn = cc.RR_periodic_3D( edges, counts[ 'box' ], cc.binning.edges )
+        DRn = RRn
+    else :
+        RRn = counts[ 'RR' ].rebin( rbins, scheme ) * counts[ 'normRR' ]
+        DRn = counts[ 'DR' ].rebin( rbins, scheme ) * counts[ 'normDR' ]
+    return _kernel_landy_szalay( DDn, RRn, DRn ), edges
+
+##################################################################################
+
+def _kernel_DD_jk ( data, regions, nreg, Nd, rbins, omp, angular, box, binning ) :
+    """Leave-one-region-out data–data counts, shape ``(nreg + 1, Nbin)``."""
+
+    if Nd == 2 :
+        if angular :
+            kernel = cc.dA2D_DD_jk_omp if omp else cc.dA2D_DD_jk
+            return kernel( *data, regions, nreg, rbins, binning = binning )
+        kernel = cc.d2D_DD_jk_omp if omp else cc.d2D_DD_jk
+        return kernel( *data, regions, nreg, rbins, box, binning )
+    if Nd == 3 :
+        kernel = cc.d3D_DD_jk_omp if omp else cc.d3D_DD_jk
+        return kernel( *data, regions, nreg, rbins, box, binning )
+    return None
+
+def _kernel_DR_jk ( data1, regions1, data2, regions2, nreg, Nd, rbins, omp, angular, box, binning ) :
+    """Leave-one-region-out data–random counts, shape ``(nreg + 1, Nbin)``."""
+
+    if Nd == 2 :
+        if angular :
+            kernel = cc.dA2D_DR_jk_omp if omp else cc.dA2D_DR_jk
+            return kernel( *data1, regions1, *data2, regions2, nreg, rbins, binning = binning )
+        kernel = cc.d2D_DR_jk_omp if omp else cc.d2D_DR_jk
+        return kernel( *data1, regions1, *data2, regions2, nreg, rbins, box, binning )
+    if Nd == 3 :
+        kernel = cc.d3D_DR_jk_omp if omp else cc.d3D_DR_jk
+        return kernel( *data1, regions1, *data2, regions2, nreg, rbins, box, binning )
+    return None
+
+def jackknife_two_point ( data, rand, rbins, data_regions, rand_regions, nreg = None,
+                          standard = False, omp = True, angular = False, box = 0.,
+                          binning = 'log', return_realisations = False ) :
+    """Two-point correlation function with jackknife covariance.
+
+    The catalogues are split in ``nreg`` regions, labelled per object.
+    All the leave-one-region-out pair counts are obtained from a single
+    traversal of the pairs, so that the ``nreg`` jackknife realisations
+    cost about as much as the baseline measurement.  The covariance is
+
+    .. math::
+
+        C_{ij} = \\frac{N_{reg} - 1}{N_{reg}} \\sum_k
+        (\\xi_k(r_i) - \\bar\\xi(r_i))(\\xi_k(r_j) - \\bar\\xi(r_j)).
+
+    Parameters
+    ----------
+    data : ndarray, shape ``(Ndim, Nobj)``
+        Coordinates of the data catalogue.  ``Ndim`` must be 2 or 3.
+    rand : ndarray, shape ``(Ndim, Nrand)``
+        Coordinates of the random catalogue.
+    rbins : array-like
+        Separation bins, interpreted according to ``binning``.
+    data_regions : array-like of int, shape ``(Nobj,)``
+        Jackknife region of each data object, in ``[0, nreg)``.
+    rand_regions : array-like of int, shape ``(Nrand,)``
+        Jackknife region of each random object, in ``[0, nreg)``.
+    nreg : int or None, optional
+        Number of regions, by default one more than the largest label.
+    standard : bool, optional
+        If ``True`` use the standard estimator, otherwise (default) the
+        Landy–Szalay estimator.
+    omp : bool, optional
+        Use the OpenMP-parallel pair counter (default: ``True``).
+    angular : bool, optional
+        Count great-circle angular separations as
+        :func:`two_point_landyszalay`, with coordinates ``(ra, dec)`` in
+        radians (default: ``False``).
+    box : float, optional
+        Side of a periodic box (default: ``0``, open boundaries).
+    binning : str, optional
+        Binning scheme, ``'log'`` (default), ``'lin'`` or ``'edges'``,
+        see :func:`two_point_landyszalay`.
+    return_realisations : bool, optional
+        If ``True``, also return the ``nreg`` jackknife realisations
+        (default: ``False``).
+
+    Returns
+    -------
+    xi : ndarray
+        Correlation function of the full catalogues.
+    cov : ndarray, shape ``(Nbin, Nbin)``
+        Jackknife covariance of ``xi``.
+    xi_jk : ndarray, shape ``(nreg, Nbin)``
+        Jackknife realisations, only returned when ``return_realisations=True``.
+    """
+
+    data = _as_coordinates( data )
+    rand = _as_coordinates( rand )
+    NdimD, NobjD = data.shape
+    NdimR, NobjR = rand.shape
+    if NdimD != NdimR :
+        raise ValueError( "Input spaces ``data`` and ``rand`` should have the same dimensions" )
+    if not NobjD > 0 or not NobjR > 0 :
+        raise ValueError(
+            "Cannot compute clustering if one of the two catalogues does not have at least 2 elements"
+        )
+    data_regions = numpy.ascontiguousarray( data_regions, dtype = numpy.int32 )
+    rand_regions = numpy.ascontiguousarray( rand_regions, dtype = numpy.int32 )
+    if nreg is None :
+        nreg = int( max( data_regions.max(), rand_regions.max() ) ) + 1
+    binning = _binning( binning )
+
+    # objects left in each jackknife realisation, the last one is the full catalogue
+    ND = NobjD - numpy.append( numpy.bincount( data_regions, minlength = nreg ), 0 )
+    NR = NobjR - numpy.append( numpy.bincount( rand_regions, minlength = nreg ), 0 )
+    normDD = ( 2.0 / ( ND * ( ND - 1.0 ) ) )[ :, None ]
+    normRR = ( 2.0 / ( NR * ( NR - 1.0 ) ) )[ :, None ]
+    normDR = ( 1.0 / ( ND * NR.astype( float ) ) )[ :, None ]
+
+    DD = _kernel_DD_jk( data, data_regions, nreg, NdimD, rbins, omp, angular, box, binning ) * normDD
+    RR = _kernel_DD_jk( rand, rand_regions, nreg, NdimD, rbins, omp, angular, box, binning ) * normRR
+    if standard :
+        xi = numpy.array( [ _kernel_standard( dd, rr ) for dd, rr in zip( DD, RR ) ] )
+    else :
+        DR = _kernel_DR_jk( data, data_regions, rand, rand_regions, nreg, NdimD,
+                            rbins, omp, angular, box, binning ) * normDR
+        xi = numpy.array( [ _kernel_landy_szalay( dd, rr, dr ) for dd, rr, dr in zip( DD, RR, DR ) ] )
+
+    xi_jk = xi[ :nreg ]
+    delta = xi_jk - xi_jk.mean( axis = 0 )
+    cov = ( nreg - 1.0 ) / nreg * delta.T @ delta
+
+    if return_realisations :
+        return xi[ nreg ], cov, xi_jk
+    return xi[ nreg ], cov
+
+##################################################################################
+
+def _kernel_DD_boot ( data, Nd, nboot, seed, rbins, omp, angular, binning, resampling ) :
+    """Resampled data–data counts, shape ``(nboot + 1, Nbin)``, the last row unresampled."""
+
+    if Nd == 2 and angular :
+        kernel = cc.dA2D_DD_boot_omp if omp else cc.dA2D_DD_boot
+    elif Nd == 2 :
+        kernel = cc.d2D_DD_boot_omp if omp else cc.d2D_DD_boot
+    elif Nd == 3 :
+        kernel = cc.d3D_DD_boot_omp if omp else cc.d3D_DD_boot
+    else :
+        return None
+    return kernel( *data, nboot, seed, rbins, binning = binning, resampling = resampling )
+
+def _kernel_DR_boot ( data1, data2, Nd, nboot, seed, rbins, omp, angular, binning, resampling ) :
+    """Data–random counts with ``data1`` resampled, shape ``(nboot + 1, Nbin)``."""
+
+    if Nd == 2 and angular :
+        kernel = cc.dA2D_DR_boot_omp if omp else cc.dA2D_DR_boot
+    elif Nd == 2 :
+        kernel = cc.d2D_DR_boot_omp if omp else cc.d2D_DR_boot
+    elif Nd == 3 :
+        kernel = cc.d3D_DR_boot_omp if omp else cc.d3D_DR_boot
+    else :
+        return None
+    return kernel( *data1, *data2, nboot, seed, rbins, binning = binning, resampling = resampling )
+
+##################################################################################
+
 def bootstrap_two_point ( data, rand, rbins,
                           standard = True,
                           Nboots = 10, return_boots = False,
                           omp = True, verbose = True, angular = False,
-                          rng = None, kw_rng = { 'seed' : 555 } ) :
+                          rng = None, kw_rng = { 'seed' : 555 }, binning = 'log',
+                          resampling = 'multinomial' ) :
     """Two-point correlation function with bootstrap error estimate.
 
     Computes a baseline :math:`\\xi(r)` and estimates its uncertainty by
@@ -232,6 +1515,11 @@ def bootstrap_two_point ( data, rand, rbins,
     computed once).  Either the standard or the Landy–Szalay estimator
     can be used for each resample.
 
+    Resamples are not drawn explicitly: each data object carries its
+    multiplicity in every resample and all the resampled :math:`DD` (and
+    :math:`DR`) counts are obtained from a single traversal of the pairs,
+    together with the baseline ones.
+
     Parameters
     ----------
     data : ndarray, shape ``(Ndim, Nobj)``
@@ -256,15 +1544,22 @@ def bootstrap_two_point ( data, rand, rbins,
         Print progress messages (default: ``True``).
     angular : bool, optional
         If ``True``, interpret ``data`` and ``rand`` as equatorial
-        coordinates ``(ra, dec)`` in radians, convert to 3D Cartesian
-        unit vectors, and convert ``rbins`` from angular to chord
-        distances (default: ``False``).
+        coordinates ``(ra, dec)`` in radians and bin the great-circle
+        separations as :func:`two_point_landyszalay` (default: ``False``).
     rng : numpy.random.Generator or None, optional
-        Random number generator.  If ``None`` (default) one is created
-        via ``numpy.random.default_rng(**kw_rng)``.
+        Random number generator, draws the seed of the multiplicities.
+        If ``None`` (default) one is created via
+        ``numpy.random.default_rng(**kw_rng)``.
     kw_rng : dict, optional
         Keyword arguments forwarded to ``numpy.random.default_rng``
         (default: ``{'seed': 555}``).
+    binning : str, optional
+        Binning scheme, ``'log'`` (default), ``'lin'`` or ``'edges'``,
+        see :func:`two_point_landyszalay`.
+    resampling : str, optional
+        ``'multinomial'`` (default) draws ``Nobj`` objects with
+        replacement per resample, ``'poisson'`` gives each object an
+        independent Poisson(1) multiplicity.
 
     Returns
     -------
@@ -282,23 +1577,13 @@ def bootstrap_two_point ( data, rand, rbins,
     data = numpy.array( data )
     rand = numpy.array( rand )
 
-    if angular :
-        rbins = angular_to_euclidean_dist( rbins, r = 1.0 )
-        if data.shape[0] != 2 or rand.shape[0] != 2 :
-            raise RuntimeError(
-                'Input spaces ``data`` and ``rand`` should be 2D when ``angular = True`` is chosen'
-            )
-        data = numpy.array(
-            equatorial_to_cartesian(
-                ( numpy.ones_like( data[ 0 ] ), data[ 0 ], data[ 1 ] )
-            )
-        )
-        rand = numpy.array(
-            equatorial_to_cartesian(
-                ( numpy.ones_like( rand[ 0 ] ), rand[ 0 ], rand[ 1 ] )
-            )
+    if angular and ( data.shape[0] != 2 or rand.shape[0] != 2 ) :
+        raise RuntimeError(
+            'Input spaces ``data`` and ``rand`` should be 2D when ``angular = True`` is chosen'
         )
 
+    data = _as_coordinates( data )
+    rand = _as_coordinates( rand )
     NdimD, NobjD = data.shape
     NdimR, NobjR = rand.shape
     if NdimD != NdimR :
@@ -307,43 +1592,35 @@ def bootstrap_two_point ( data, rand, rbins,
         raise ValueError(
             "Cannot compute clustering if one of the two catalogues does not have at least 2 elements"
         )
+    binning = _binning( binning )
+    resampling = _resampling( resampling )
+    seed = int( rng.integers( 2**63 ) )
 
-    normDD = 2.0 / ( NobjD * ( NobjD - 1 ) )
+    # resampled catalogues are weighted by the multiplicities, the last
+    # realisation is the baseline (unit multiplicities)
+    MM = cc.bootstrap_multiplicities( NobjD, Nboots, seed, resampling )
+    SD = numpy.append( MM.sum( axis = 0, dtype = float ), NobjD )
+    SD2 = numpy.append( ( MM.astype( float )**2 ).sum( axis = 0 ), NobjD )
+    normDD = ( 2.0 / ( SD * SD - SD2 ) )[ :, None ]
     normRR = 2.0 / ( NobjR * ( NobjR - 1 ) )
-    normDR = 1.0 / ( NobjD * NobjR )
-    
+    normDR = ( 1.0 / ( SD * NobjR ) )[ :, None ]
+
     if verbose : print( 'Computing RR ...' )
-    # RR = _kernel_DD( rand, NdimR, rbins, omp, angular ) * normRR
-    RR = _kernel_DD( rand, NdimR, rbins, omp ) * normRR
+    RR = _kernel_DD( rand, NdimR, rbins, omp, angular, binning = binning ) * normRR
     if verbose : print( '... done RR.' )
 
-    # get the baseline estimate
-    if verbose : print( 'Computing baseline ...' )
-    # DD = _kernel_DD( data, NdimD, rbins, omp, angular ) * normDD
-    DD = _kernel_DD( data, NdimD, rbins, omp ) * normDD
+    if verbose : print( f'Computing baseline and {Nboots} bootstraps ...' )
+    DD = _kernel_DD_boot( data, NdimD, Nboots, seed, rbins, omp, angular,
+                          binning, resampling ) * normDD
     if standard :
-        tpt = _kernel_standard( DD, RR )
+        xi = numpy.array( [ _kernel_standard( dd, RR ) for dd in DD ] )
     else :
-        # DR = _kernel_DR( data, rand, NdimD, rbins, omp, angular ) * normDR
-        DR = _kernel_DR( data, rand, NdimD, rbins, omp ) * normDR
-        tpt = _kernel_landy_szalay( DD, RR, DR )
-    if verbose : print( '... done baseline.' )
-
-    # get bootstraps
-    boots = numpy.zeros( ( Nboots, tpt.size ) )
-    for ii in range( Nboots ):
-        if verbose : print( f'Computing bootstrap {ii+1:d} of {Nboots} ...', end='\r' )
-        iD = rng.integers( NobjD, size = NobjD )
-        # DD = _kernel_DD( data[:,iD], NdimD, rbins, omp, angular ) * normDD
-        DD = _kernel_DD( data[:,iD], NdimD, rbins, omp ) * normDD
-        if standard :
-            boots[ii] = _kernel_standard( DD, RR )
-        else :
-            # DR = _kernel_DR( data[:,iD], rand, NdimD, rbins, omp, angular ) * normDR
-            DR = _kernel_DR( data[:,iD], rand, NdimD, rbins, omp ) * normDR
-            boots[ii] = _kernel_landy_szalay( DD, RR, DR )
-    if verbose : print( '\n... done bootstraps.' )
+        DR = _kernel_DR_boot( data, rand, NdimD, Nboots, seed, rbins, omp, angular,
+                              binning, resampling ) * normDR
+        xi = numpy.array( [ _kernel_landy_szalay( dd, RR, dr ) for dd, dr in zip( DD, DR ) ] )
+    if verbose : print( '... done bootstraps.' )
 
+    tpt, boots = xi[ Nboots ], xi[ :Nboots ]
     if return_boots:
         return tpt, boots.std(axis=0), boots
     else:
@@ -49,11 +49,20 @@ def main () :
         "scampy.measure.clustering_core",
         sorted(
             [ os.path.join( 'pybind11', 'pyb11_clustering_core.cpp' ),
-              os.path.join( 'c++', 'utilities', 'src', 'clustering_core.cpp' ) ]
+              os.path.join( 'c++', 'utilities', 'src', 'clustering_core.cpp' ),
+              os.path.join( 'c++', 'utilities', 'src', 'cell_list.cpp' ),
+              os.path.join( 'c++', 'utilities', 'src', 'counts_in_cells.cpp' ),
+              os.path.join( 'c++', 'utilities', 'src', 'friends_of_friends.cpp' ),
+              os.path.join( 'c++', 'utilities', 'src', 'kdtree.cpp' ),
+              os.path.join( 'c++', 'utilities', 'src', 'knn_cdf.cpp' ),
+              os.path.join( 'c++', 'utilities', 'src', 'pair_cache.cpp' ),
+              os.path.join( 'c++', 'utilities', 'src', 'pair_stream.cpp' ),
+              os.path.join( 'c++', 'utilities', 'src', 'simd_kernel.cpp' ) ]
         ),
         include_dirs = sorted( [ os.path.join( 'c++', 'utilities', 'include' ) ] ),
         libraries = [ "m", "gomp" ],
-        extra_compile_args=['-std=c++17'] + extra_OMP_compile_args,
+        # no FMA contraction: binning must not depend on the SIMD kernel selected at runtime
+        extra_compile_args=['-std=c++17', '-ffp-contract=off'] + extra_OMP_compile_args,
         extra_link_args=extra_OMP_link_args
     )
 